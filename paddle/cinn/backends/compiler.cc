@@ -485,6 +485,20 @@ void Compiler::ExportObject(const std::string& path) {
   engine_->ExportObject(path);
 }
 
+std::string Compiler::GetObjectCode() const {
+  if (!std::holds_alternative<common::X86Arch>(target_.arch)) {
+    return "";
+  }
+  return engine_->GetObjectCode();
+}
+
+bool Compiler::LoadObjectCode(const std::string& object_code) {
+  if (!std::holds_alternative<common::X86Arch>(target_.arch)) {
+    return false;
+  }
+  return engine_->AddObjectCode(object_code);
+}
+
 void* Compiler::Lookup(absl::string_view fn_name) {
   PADDLE_ENFORCE_NOT_NULL(
       engine_, ::common::errors::InvalidArgument("Sorry, engine_ is nullptr"));
@@ -116,6 +116,18 @@ class Compiler final {
 
   void ExportObject(const std::string& path);
 
+  /**
+   * The object code of the X86 modules compiled by EndCompile, available after
+   * Lookup, or an empty string for other targets.
+   */
+  std::string GetObjectCode() const;
+
+  /**
+   * Loads the object code returned by GetObjectCode instead of compiling.
+   * @return false if the target is not X86 or the object code is invalid.
+   */
+  bool LoadObjectCode(const std::string& object_code);
+
   std::string GetSourceCode(const ir::Module& module);
 
   void BuildDefault(const ir::Module& module);
@@ -247,6 +247,27 @@ bool ExecutionEngine::AddSelfModule() {
   return AddModule(std::move(m), std::move(ctx));
 }
 
+std::string ExecutionEngine::GetObjectCode() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (cache_->objects().size() != 1) {
+    return "";
+  }
+  return cache_->objects().begin()->second->getBuffer().str();
+}
+
+bool ExecutionEngine::AddObjectCode(const std::string &object_code) {
+  utils::RecordEvent("ExecutionEngine AddObjectCode",
+                     utils::EventType::kOrdinary);
+  auto buffer = llvm::MemoryBuffer::getMemBufferCopy(AsStringRef(object_code),
+                                                     "cinn_cached_object");
+  if (auto error = jit_->addObjectFile(std::move(buffer))) {
+    LOG(WARNING) << "Failed to add object code: "
+                 << llvm::toString(std::move(error));
+    return false;
+  }
+  return true;
+}
+
 void ExecutionEngine::ExportObject(const std::string &path) {
   FILE *of = fopen(path.c_str(), "w");
   fwrite(buffer_.data(), 1, buffer_.size(), of);
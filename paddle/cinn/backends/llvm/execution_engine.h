@@ -56,6 +56,10 @@ class NaiveObjectCache : public llvm::ObjectCache {
                             llvm::MemoryBufferRef) override;
   std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override;
 
+  const llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> &objects() const {
+    return cached_objects_;
+  }
+
  private:
   llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> cached_objects_;
 };
@@ -87,6 +91,15 @@ class ExecutionEngine {
 
   bool AddSelfModule();
 
+  // Returns the object code compiled from the module added by AddSelfModule,
+  // which is available after the module is materialized, e.g. by Lookup, or
+  // an empty string otherwise.
+  std::string GetObjectCode() const;
+
+  // Adds the object code returned by GetObjectCode of another engine instead
+  // of compiling a module.
+  bool AddObjectCode(const std::string &object_code);
+
  protected:
   explicit ExecutionEngine(bool enable_object_cache)
       : cache_(std::make_unique<NaiveObjectCache>()),
@@ -57,6 +57,7 @@ class BackendResource final {
   }
   pir::CINNKernelInfo GenerateKernelInfo(bool need_x86_kernel = false) const;
   const std::string& GetHostFuncName() const { return host_fn_name_; }
+  const std::string& GetInferFuncName() const { return infer_fn_name_; }
 
  private:
   std::string host_fn_name_;
@@ -95,6 +96,8 @@ class CompilationResult final {
     return backend_resource_->GenerateKernelInfo(have_cx86_kernel_);
   }
 
+  bool HaveCX86Kernel() const { return have_cx86_kernel_; }
+
  private:
   Target target_;
   std::shared_ptr<BackendResource> backend_resource_{nullptr};
@@ -0,0 +1,359 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/cinn/hlir/framework/pir/disk_compilation_cache.h"
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/Host.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "paddle/common/flags.h"
+#include "paddle/fluid/framework/commit.h"
+
+PD_DECLARE_bool(enable_cinn_compile_cache);
+PD_DECLARE_string(cinn_compile_cache_dir);
+PD_DECLARE_bool(cinn_bc_branch_optimize);
+PD_DECLARE_bool(cinn_enable_grid_reduce);
+PD_DECLARE_bool(cinn_enable_map_expr_inline);
+PD_DECLARE_bool(cinn_enable_tile_broadcast);
+PD_DECLARE_bool(cinn_longlong2int);
+PD_DECLARE_string(cinn_tile_config_filename_label);
+PD_DECLARE_string(tile_config_policy);
+COMMON_DECLARE_bool(enable_append_iters_in_fusion);
+COMMON_DECLARE_bool(enable_reuse_iters_in_fusion);
+COMMON_DECLARE_bool(enable_transpose_iters_in_fusion);
+COMMON_DECLARE_int64(pir_broadcast_tree_limit);
+
+namespace cinn::hlir::framework::pir {
+
+namespace {
+
+constexpr char kMagic[] = "CINNCACHE";
+
+template <typename T>
+void WritePod(std::ostream& os, const T& value) {
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void WriteString(std::ostream& os, const std::string& str) {
+  WritePod<uint64_t>(os, str.size());
+  os.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+// Reads from the content of a cache file, failing instead of throwing on
+// truncated or corrupted files.
+class Reader {
+ public:
+  explicit Reader(const std::string& content) : content_(content) {}
+
+  template <typename T>
+  bool ReadPod(T* value) {
+    if (content_.size() - pos_ < sizeof(T)) {
+      return false;
+    }
+    std::copy_n(content_.data() + pos_,
+                sizeof(T),
+                reinterpret_cast<char*>(value));
+    pos_ += sizeof(T);
+    return true;
+  }
+
+  bool ReadString(std::string* str) {
+    uint64_t size = 0;
+    if (!ReadPod(&size) || content_.size() - pos_ < size) {
+      return false;
+    }
+    str->assign(content_, pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  bool AtEnd() const { return pos_ == content_.size(); }
+
+ private:
+  const std::string& content_;
+  size_t pos_{0};
+};
+
+std::string HashString(const std::string& str) {
+  // 64-bit FNV-1a, which unlike std::hash is the same for every build.
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  std::ostringstream os;
+  os << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return os.str();
+}
+
+bool MakeDirectory(const std::string& dirname) {
+  struct stat st;
+  std::string path;
+  for (size_t i = 0; i < dirname.size(); ++i) {
+    path.push_back(dirname[i]);
+    if (!(dirname[i] == '/' || i + 1 == dirname.size())) {
+      continue;
+    }
+    if (stat(path.c_str(), &st) == 0) {
+      if (!S_ISDIR(st.st_mode)) {
+        LOG(WARNING) << path << " is not a directory, please check your path.";
+        return false;
+      }
+    } else if (mkdir(path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) !=
+                   0 &&
+               stat(path.c_str(), &st) != 0) {
+      // Another process may create it at the same time.
+      LOG(WARNING) << "Make directory fail: " << path;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool DiskCompilationCache::IsEnabled(const Target& target) {
+  return FLAGS_enable_cinn_compile_cache &&
+         !FLAGS_cinn_compile_cache_dir.empty() &&
+         std::holds_alternative<common::X86Arch>(target.arch);
+}
+
+DiskCompilationCache::DiskCompilationCache(const Target& target,
+                                           const std::string& dir)
+    : target_(target), dir_(dir) {
+  std::ostringstream os;
+  os << "format: " << kFormatVersion << "\n";
+  os << "target: " << target_ << "\n";
+  os << "host cpu: " << llvm::sys::getHostCPUName().str();
+  llvm::StringMap<bool> host_features;
+  if (llvm::sys::getHostCPUFeatures(host_features)) {
+    std::vector<std::string> features;
+    for (const auto& feature : host_features) {
+      if (feature.getValue()) {
+        features.push_back(feature.getKey().str());
+      }
+    }
+    std::sort(features.begin(), features.end());
+    for (const auto& feature : features) {
+      os << " +" << feature;
+    }
+  }
+  os << "\n";
+  os << "llvm: " << LLVM_VERSION_STRING << "\n";
+  os << "paddle: " << paddle::framework::paddle_version() << " "
+     << paddle::framework::paddle_commit() << "\n";
+  // The flags changing how a group is fused, scheduled and lowered after its
+  // fingerprint is taken.
+  os << "flags:"
+     << " cinn_bc_branch_optimize=" << FLAGS_cinn_bc_branch_optimize
+     << " cinn_enable_grid_reduce=" << FLAGS_cinn_enable_grid_reduce
+     << " cinn_enable_map_expr_inline=" << FLAGS_cinn_enable_map_expr_inline
+     << " cinn_enable_tile_broadcast=" << FLAGS_cinn_enable_tile_broadcast
+     << " cinn_longlong2int=" << FLAGS_cinn_longlong2int
+     << " cinn_tile_config_filename_label="
+     << FLAGS_cinn_tile_config_filename_label
+     << " tile_config_policy=" << FLAGS_tile_config_policy
+     << " enable_append_iters_in_fusion=" << FLAGS_enable_append_iters_in_fusion
+     << " enable_reuse_iters_in_fusion=" << FLAGS_enable_reuse_iters_in_fusion
+     << " enable_transpose_iters_in_fusion="
+     << FLAGS_enable_transpose_iters_in_fusion
+     << " pir_broadcast_tree_limit=" << FLAGS_pir_broadcast_tree_limit << "\n";
+  environment_ = os.str();
+}
+
+std::string DiskCompilationCache::Key(const FusionInfo& fusion_info) const {
+  return environment_ + fusion_info.Fingerprint();
+}
+
+std::string DiskCompilationCache::FilePath(const std::string& key) const {
+  return dir_ + "/" + HashString(key) + ".cinn";
+}
+
+std::shared_ptr<CompilationResult> DiskCompilationCache::Load(
+    const FusionInfo& fusion_info) const {
+  const std::string key = Key(fusion_info);
+  const std::string path = FilePath(key);
+  std::ifstream fin(path, std::ios::binary);
+  if (!fin.is_open()) {
+    VLOG(4) << "No compilation cache file " << path;
+    return nullptr;
+  }
+  std::string content((std::istreambuf_iterator<char>(fin)),
+                      std::istreambuf_iterator<char>());
+
+  Reader reader(content);
+  std::string magic;
+  uint32_t format_version = 0;
+  std::string saved_key;
+  std::string host_fn_name;
+  std::string infer_fn_name;
+  uint8_t have_cx86_kernel = 0;
+  uint64_t symbol_arg_num = 0;
+  std::map<int, CINNKernelInfo::SymbolArgBindInfo> symbol_args_map;
+  uint64_t temp_space_num = 0;
+  std::vector<int64_t> temp_space_sizes;
+  std::string object_code;
+
+  const auto ReadFields = [&]() -> bool {
+    if (!reader.ReadString(&magic) || magic != kMagic ||
+        !reader.ReadPod(&format_version) || format_version != kFormatVersion ||
+        !reader.ReadString(&saved_key) || saved_key != key ||
+        !reader.ReadString(&host_fn_name) ||
+        !reader.ReadString(&infer_fn_name) ||
+        !reader.ReadPod(&have_cx86_kernel) ||
+        !reader.ReadPod(&symbol_arg_num)) {
+      return false;
+    }
+    for (uint64_t i = 0; i < symbol_arg_num; ++i) {
+      int32_t arg_idx = 0;
+      uint8_t kind = 0;
+      int32_t input_idx = 0;
+      int32_t idx = 0;
+      if (!reader.ReadPod(&arg_idx) || !reader.ReadPod(&kind) ||
+          !reader.ReadPod(&input_idx) || !reader.ReadPod(&idx) || kind > 1) {
+        return false;
+      }
+      if (kind == 0) {
+        symbol_args_map[arg_idx] = CINNKernelInfo::ArgDimIdx{input_idx, idx};
+      } else {
+        symbol_args_map[arg_idx] = CINNKernelInfo::ArgValueIdx{input_idx, idx};
+      }
+    }
+    if (!reader.ReadPod(&temp_space_num)) {
+      return false;
+    }
+    for (uint64_t i = 0; i < temp_space_num; ++i) {
+      int64_t size = 0;
+      if (!reader.ReadPod(&size)) {
+        return false;
+      }
+      temp_space_sizes.push_back(size);
+    }
+    return reader.ReadString(&object_code) && reader.AtEnd();
+  };
+  if (!ReadFields()) {
+    LOG(WARNING) << "Ignore the invalid or outdated compilation cache file "
+                 << path;
+    return nullptr;
+  }
+
+  auto backend_resource = std::make_shared<BackendResource>(target_,
+                                                            host_fn_name,
+                                                            infer_fn_name,
+                                                            symbol_args_map,
+                                                            temp_space_sizes);
+  if (!backend_resource->GetBackendCompiler()->LoadObjectCode(object_code)) {
+    return nullptr;
+  }
+  auto compilation_result =
+      std::make_shared<CompilationResult>(target_, have_cx86_kernel != 0);
+  compilation_result->SetBackendResource(backend_resource);
+  try {
+    // Links the object code and checks that the kernels are there.
+    compilation_result->GetKernelInfo();
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Failed to load the compilation cache file " << path
+                 << ": " << e.what();
+    return nullptr;
+  }
+  VLOG(4) << "Load " << host_fn_name << " from compilation cache file "
+          << path;
+  return compilation_result;
+}
+
+void DiskCompilationCache::Save(const FusionInfo& fusion_info,
+                                const CompilationResult& result) const {
+  const auto& backend_resource = result.GetBackendResource();
+  if (backend_resource == nullptr) {
+    return;
+  }
+  std::string object_code =
+      backend_resource->GetBackendCompiler()->GetObjectCode();
+  if (object_code.empty()) {
+    VLOG(4) << "No object code of " << backend_resource->GetHostFuncName()
+            << " to save";
+    return;
+  }
+  if (!MakeDirectory(dir_)) {
+    return;
+  }
+
+  const std::string key = Key(fusion_info);
+  const std::string path = FilePath(key);
+  std::ostringstream suffix;
+  suffix << ".tmp" << std::hash<std::thread::id>{}(std::this_thread::get_id())
+         << "_" << reinterpret_cast<uintptr_t>(&result);
+  const std::string tmp_path = path + suffix.str();
+  {
+    std::ofstream fout(tmp_path, std::ios::binary);
+    if (!fout.is_open()) {
+      LOG(WARNING) << "Can not write compilation cache file " << tmp_path;
+      return;
+    }
+    WriteString(fout, kMagic);
+    WritePod<uint32_t>(fout, kFormatVersion);
+    WriteString(fout, key);
+    WriteString(fout, backend_resource->GetHostFuncName());
+    WriteString(fout, backend_resource->GetInferFuncName());
+    WritePod<uint8_t>(fout, result.HaveCX86Kernel() ? 1 : 0);
+    const auto& symbol_args_map = backend_resource->GetSymbolArgsMap();
+    WritePod<uint64_t>(fout, symbol_args_map.size());
+    for (const auto& [arg_idx, bind_info] : symbol_args_map) {
+      WritePod<int32_t>(fout, arg_idx);
+      using ArgDimIdx = CINNKernelInfo::ArgDimIdx;
+      using ArgValueIdx = CINNKernelInfo::ArgValueIdx;
+      if (const auto* dim_idx = std::get_if<ArgDimIdx>(&bind_info)) {
+        WritePod<uint8_t>(fout, 0);
+        WritePod<int32_t>(fout, dim_idx->arg_idx);
+        WritePod<int32_t>(fout, dim_idx->dim_idx);
+      } else {
+        const auto& value_idx = std::get<ArgValueIdx>(bind_info);
+        WritePod<uint8_t>(fout, 1);
+        WritePod<int32_t>(fout, value_idx.arg_idx);
+        WritePod<int32_t>(fout, value_idx.value_idx);
+      }
+    }
+    const auto& temp_space_sizes = backend_resource->GetTempSpaceSizes();
+    WritePod<uint64_t>(fout, temp_space_sizes.size());
+    for (int64_t size : temp_space_sizes) {
+      WritePod<int64_t>(fout, size);
+    }
+    WriteString(fout, object_code);
+    if (!fout.good()) {
+      LOG(WARNING) << "Failed to write compilation cache file " << tmp_path;
+      fout.close();
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to rename " << tmp_path << " to " << path;
+    std::remove(tmp_path.c_str());
+    return;
+  }
+  VLOG(4) << "Save " << backend_resource->GetHostFuncName()
+          << " to compilation cache file " << path;
+}
+
+}  // namespace cinn::hlir::framework::pir
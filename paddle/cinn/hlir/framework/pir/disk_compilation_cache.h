@@ -0,0 +1,64 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "paddle/cinn/common/target.h"
+#include "paddle/cinn/hlir/framework/pir/compilation_cache.h"
+#include "paddle/cinn/hlir/framework/pir/fusion_info.h"
+
+namespace cinn::hlir::framework::pir {
+
+/**
+ * The persistent compilation cache of X86 kernels, which saves the object code
+ * and the kernel information of each compiled group as one file in a
+ * directory, so that later processes load them instead of lowering and
+ * compiling the group again.
+ *
+ * Entries are keyed by the fingerprint of the FusionInfo, the target, the host
+ * CPU, the versions of LLVM and Paddle and the flags changing the generated
+ * code, so an entry written by another compiler, for another machine or with
+ * other schedule options is never used. Each file is written to a
+ * temporary path first and then renamed, so processes may share a directory.
+ */
+class DiskCompilationCache final {
+ public:
+  static constexpr uint32_t kFormatVersion = 1;
+
+  // Whether FLAGS_cinn_compile_cache_dir is set and `target` is supported.
+  static bool IsEnabled(const Target& target);
+
+  DiskCompilationCache(const Target& target, const std::string& dir);
+
+  // Returns nullptr if the entry does not exist or can not be used.
+  std::shared_ptr<CompilationResult> Load(const FusionInfo& fusion_info) const;
+
+  // Saves a result whose kernels are already compiled, see
+  // backends::Compiler::GetObjectCode.
+  void Save(const FusionInfo& fusion_info,
+            const CompilationResult& result) const;
+
+ private:
+  std::string Key(const FusionInfo& fusion_info) const;
+  std::string FilePath(const std::string& key) const;
+
+  Target target_;
+  std::string dir_;
+  // The target and compiler part of the keys.
+  std::string environment_;
+};
+
+}  // namespace cinn::hlir::framework::pir
@@ -15,8 +15,11 @@
 #include "paddle/cinn/hlir/framework/pir_compiler.h"
 #include "paddle/cinn/ir/group_schedule/config/schedule_config_manager.h"
 
+#include <optional>
+
 #include "paddle/cinn/hlir/dialect/operator/transforms/lowering_pass/utils.h"
 #include "paddle/cinn/hlir/framework/pir/broadcast_with_cf.h"
+#include "paddle/cinn/hlir/framework/pir/disk_compilation_cache.h"
 #include "paddle/cinn/hlir/framework/pir/utils.h"
 #include "paddle/cinn/runtime/arch_device.h"
 #include "paddle/cinn/utils/multi_threading.h"
@@ -25,6 +28,7 @@
 
 PD_DECLARE_bool(enable_cinn_compile_cache);
 PD_DECLARE_int64(cinn_compile_thread_num);
+PD_DECLARE_string(cinn_compile_cache_dir);
 
 namespace cinn::hlir::framework {
 class CompilationContextMapper {
@@ -98,6 +102,16 @@ std::vector<pir::CINNKernelInfo> PirCompiler::Build(
 
 std::shared_ptr<pir::CompilationResult> PirCompiler::Compile(
     GroupCompilationContext* ctx) {
+  std::optional<pir::DiskCompilationCache> disk_cache;
+  std::optional<pir::FusionInfo> fusion_info;
+  if (pir::DiskCompilationCache::IsEnabled(target_)) {
+    disk_cache.emplace(target_, FLAGS_cinn_compile_cache_dir);
+    fusion_info.emplace(*ctx->GetGroup());
+    if (auto cached_result = disk_cache->Load(*fusion_info)) {
+      return cached_result;
+    }
+  }
+
   std::shared_ptr<pir::CompilationResult> compile_result;
   CompilationTask task(ctx);
 
@@ -136,6 +150,9 @@ std::shared_ptr<pir::CompilationResult> PirCompiler::Compile(
 
   // Triggering llvm compilation in thread
   compile_result->GetKernelInfo();
+  if (disk_cache.has_value()) {
+    disk_cache->Save(*fusion_info, *compile_result);
+  }
   return compile_result;
 }
 
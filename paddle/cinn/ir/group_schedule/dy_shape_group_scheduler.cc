@@ -18,6 +18,7 @@
 #include "paddle/cinn/ir/group_schedule/tactic/compute_at_reduction_tactic.h"
 #include "paddle/cinn/ir/group_schedule/tactic/compute_inline_tactic.h"
 #include "paddle/cinn/ir/group_schedule/tactic/tile_broadcast_tactic.h"
+#include "paddle/cinn/ir/group_schedule/tactic/tile_cpu_tactic.h"
 #include "paddle/cinn/ir/group_schedule/tactic/tile_first_general_tactic.h"
 #include "paddle/cinn/ir/ir_analyzer/ir_analyzer.h"
 #include "paddle/cinn/ir/op/ir_operators.h"
@@ -32,8 +33,12 @@ void DynamicShapeGroupScheduler::Init() {
   VLOG(4) << "original group func body: \n"
           << ir_sch_->GetModule().GetExprs()[0];
   InitBuckets();
-  tactics_.emplace_back(CreateTileBroadcastTactic());
-  tactics_.emplace_back(CreateTileFirstGeneralTactic());
+  if (std::holds_alternative<common::X86Arch>(target_.arch)) {
+    tactics_.emplace_back(CreateTileCPUTactic());
+  } else {
+    tactics_.emplace_back(CreateTileBroadcastTactic());
+    tactics_.emplace_back(CreateTileFirstGeneralTactic());
+  }
   tactics_.emplace_back(CreateComputeInlineTactic());
   tactics_.emplace_back(CreateComputeAtReductionTactic());
 }
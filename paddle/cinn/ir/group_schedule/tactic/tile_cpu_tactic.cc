@@ -0,0 +1,359 @@
+// Copyright (c) 2024 CINN Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/cinn/ir/group_schedule/tactic/tile_cpu_tactic.h"
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Host.h>
+
+#include <algorithm>
+#include <numeric>
+#include <set>
+
+#include "paddle/cinn/ir/ir.h"
+#include "paddle/cinn/ir/ir_analyzer/ir_analyzer.h"
+#include "paddle/cinn/ir/schedule/ir_schedule_util.h"
+#include "paddle/cinn/ir/utils/ir_nodes_collector.h"
+#include "paddle/cinn/runtime/cpu/thread_backend.h"
+
+namespace cinn {
+namespace ir {
+
+using cinn::ir::analyzer::IsReductionSBlock;
+
+namespace {
+
+// The data of the innermost tile is kept within the L1 data cache, and that
+// of the tiles run by one thread within the L2 cache. The tiles of one thread
+// are contiguous so that the hardware prefetcher runs ahead of them.
+constexpr int64_t kL1CacheBytes = 32 * 1024;
+constexpr int64_t kL2CacheBytes = 256 * 1024;
+
+// Loop nests with fewer iterations than this run on the calling thread, as
+// launching the thread pool costs more than they do.
+constexpr int64_t kMinParallelNumel = 16 * 1024;
+
+// The vector register width of the host, which is also the target of the
+// JIT compiled kernels.
+int GetHostVectorBits() {
+  static const int vector_bits = []() -> int {
+    llvm::StringMap<bool> features;
+    if (llvm::sys::getHostCPUFeatures(features)) {
+      if (features.lookup("avx512f")) return 512;
+      if (features.lookup("avx")) return 256;
+    }
+    return 128;
+  }();
+  return vector_bits;
+}
+
+// Returns the largest multiple of `lanes` that divides `numel` and is not
+// greater than `max_tile`, `numel` is required to be a multiple of `lanes`.
+int64_t FindDivisibleTile(int64_t numel, int64_t max_tile, int64_t lanes) {
+  for (int64_t tile = max_tile / lanes * lanes; tile > lanes; tile -= lanes) {
+    if (numel % tile == 0) return tile;
+  }
+  return lanes;
+}
+
+}  // namespace
+
+class TileCPUTactic final : public ScheduleTactic {
+ public:
+  void Init(ScheduleContext* context, ir::IRSchedule* sch) override;
+
+  void Apply(ir::IRSchedule* sch, const std::string& block_id) override;
+
+  std::string TacticName() const override { return "TileCPUTactic"; }
+
+ private:
+  void AlignToReduceInput(ir::IRSchedule* sch, const std::string& block_id);
+  void MergeFlattenAxis(ir::IRSchedule* sch, const std::string& block_id);
+  void MergeReduceAxis(ir::IRSchedule* sch, const std::string& block_id);
+  void TileSpatial(ir::IRSchedule* sch, const std::string& block_id);
+  void TileReduce(ir::IRSchedule* sch, const std::string& block_id);
+  int GetVectorLanes(ir::IRSchedule* sch, const std::string& block_id);
+  int64_t GetElementBytes(ir::IRSchedule* sch, const std::string& block_id);
+
+ private:
+  ScheduleContext* context_;
+  bool can_apply_;
+  std::vector<int32_t> vec_flatten_axis_;
+  std::vector<int32_t> vec_reduce_axis_;
+};
+
+void TileCPUTactic::Init(ScheduleContext* context, ir::IRSchedule* sch) {
+  context_ = context;
+  can_apply_ = false;
+
+  // Check whether this group has been tiled by previous tactic.
+  ir::Expr module_root = sch->GetModule().GetExprs().front();
+  ir::Expr root_block = ir::analyzer::GetRootSBlock(module_root);
+  auto* root_node = root_block.As<ir::ScheduleBlockRealize>()
+                        ->schedule_block.As<ir::ScheduleBlock>();
+  if (root_node->attrs.count(kTileMethod) > 0) {
+    return;
+  }
+  can_apply_ = true;
+  root_node->attrs[kTileMethod] = TacticName();
+
+  // reduce axes have been re-ordered to the last
+  vec_flatten_axis_.clear();
+  vec_reduce_axis_.clear();
+  int data_rank = context_->config.base_info->loop_ranges.size();
+  int32_t reduce_start_idx =
+      data_rank - context_->config.base_info->reduce_axis.size();
+  for (int32_t i = 0; i < data_rank; ++i) {
+    if (i >= reduce_start_idx) {
+      vec_reduce_axis_.push_back(i);
+    } else {
+      vec_flatten_axis_.push_back(i);
+    }
+  }
+}
+
+void TileCPUTactic::Apply(ir::IRSchedule* sch, const std::string& block_id) {
+  if (!can_apply_) return;
+  if (ir::IsReduceInitTensorName(block_id)) return;
+
+  AlignToReduceInput(sch, block_id);
+  MergeReduceAxis(sch, block_id);
+  MergeFlattenAxis(sch, block_id);
+  VLOG(6) << "After merging axes on block: [" << block_id << "], loop nest:\n"
+          << sch->GetLoops(block_id)[0];
+
+  if (vec_reduce_axis_.empty()) {
+    TileSpatial(sch, block_id);
+  } else {
+    TileReduce(sch, block_id);
+  }
+  VLOG(6) << "After TileCPUTactic on block: [" << block_id
+          << "], loop nest:\n"
+          << sch->GetLoops(block_id)[0];
+}
+
+void TileCPUTactic::AlignToReduceInput(ir::IRSchedule* sch,
+                                       const std::string& block_id) {
+  const auto& loop_strides = context_->config.base_info->loop_strides;
+  if (loop_strides.empty()) {
+    return;
+  }
+
+  std::vector<ir::Expr> loops = sch->GetLoops(block_id);
+  std::vector<int64_t> loop_perm(loops.size());
+  std::iota(loop_perm.begin(), loop_perm.end(), 0);
+
+  const auto IsReduce = [&](int64_t axis) {
+    auto& reduce_axis = context_->config.base_info->reduce_axis;
+    return std::find(reduce_axis.begin(), reduce_axis.end(), axis) !=
+           reduce_axis.end();
+  };
+
+  std::sort(loop_perm.begin(), loop_perm.end(), [&](int64_t a, int64_t b) {
+    if (IsReduce(a) == IsReduce(b)) {
+      return loop_strides[a] > loop_strides[b];
+    }
+    return IsReduce(b);
+  });
+  VLOG(4) << "loop_perm: " << utils::Join(loop_perm, ", ");
+
+  // Reorder S/R loops seperately, otherwise reduce_init will be de-inlined.
+  std::vector<Expr> sp_loops, rd_loops;
+  for (auto i : loop_perm) {
+    if (IsReduce(i)) {
+      rd_loops.push_back(loops[i]);
+    } else if (loop_strides[i] != 0) {
+      sp_loops.push_back(loops[i]);
+    }
+  }
+  sch->Reorder(sp_loops);
+  sch->Reorder(rd_loops);
+}
+
+void TileCPUTactic::MergeFlattenAxis(ir::IRSchedule* sch,
+                                     const std::string& block_id) {
+  if (vec_flatten_axis_.size() >= 2) {
+    sch->Fuse(block_id, vec_flatten_axis_);
+  }
+}
+
+void TileCPUTactic::MergeReduceAxis(ir::IRSchedule* sch,
+                                    const std::string& block_id) {
+  std::vector<ir::Expr> loops = sch->GetLoops(block_id);
+  int32_t max_loop_idx = 0;
+  for (int32_t idx : vec_reduce_axis_) {
+    max_loop_idx = std::max(max_loop_idx, idx);
+  }
+  if (max_loop_idx < loops.size() && vec_reduce_axis_.size() >= 2) {
+    sch->Fuse(block_id, vec_reduce_axis_);
+  }
+}
+
+int TileCPUTactic::GetVectorLanes(ir::IRSchedule* sch,
+                                  const std::string& block_id) {
+  ir::Tensor tensor =
+      ir::analyzer::GetStoreTensorOfSBlock(sch->GetBlock(block_id));
+  int type_bits = tensor->type().bits();
+  // Booleans are not packed into vector registers.
+  if (type_bits < 8) return 1;
+  return std::max(GetHostVectorBits() / type_bits, 1);
+}
+
+int64_t TileCPUTactic::GetElementBytes(ir::IRSchedule* sch,
+                                       const std::string& block_id) {
+  // The bytes of one iteration are those of every tensor the block reads or
+  // writes, counted once for each tensor.
+  ir::Expr block = sch->GetBlock(block_id);
+  std::set<std::string> tensor_names;
+  int64_t element_bytes = 0;
+  const auto AddTensor = [&](const ir::Tensor& tensor) {
+    if (tensor_names.insert(tensor->name).second) {
+      element_bytes += std::max(tensor->type().bytes(), 1);
+    }
+  };
+  AddTensor(ir::analyzer::GetStoreTensorOfSBlock(block));
+  ir::ir_utils::CollectLoadTensors(block, [&](const ir::Expr* x) {
+    if (x->as_tensor()) AddTensor(x->as_tensor_ref());
+    return false;
+  });
+  return std::max<int64_t>(element_bytes, 1);
+}
+
+void TileCPUTactic::TileSpatial(ir::IRSchedule* sch,
+                                const std::string& block_id) {
+  std::vector<ir::Expr> loops = sch->GetLoops(block_id);
+  if (vec_flatten_axis_.empty() || loops.empty()) return;
+  const int lanes = GetVectorLanes(sch, block_id);
+  const int64_t element_bytes = GetElementBytes(sch, block_id);
+  const int64_t l1_max_tile = std::max<int64_t>(
+      kL1CacheBytes / element_bytes, static_cast<int64_t>(lanes));
+
+  ir::Expr extent = loops[0].As<ir::For>()->extent;
+  if (!extent.is_constant()) {
+    // [S] => [S(-1, parallel), S(tile)], the inner loop has a dynamic tail
+    // so it is left to the loop vectorizer of LLVM.
+    sch->Split(loops[0], std::vector<int>{-1, static_cast<int>(l1_max_tile)});
+    loops = sch->GetLoops(block_id);
+    sch->Parallel(loops[0]);
+    return;
+  }
+
+  const int64_t numel = static_cast<int64_t>(extent.get_constant());
+  if (lanes <= 1 || numel % lanes != 0 || numel < lanes) {
+    // [S] => [S(-1, parallel), S(tile)]
+    if (numel > l1_max_tile && numel >= kMinParallelNumel) {
+      sch->Split(loops[0],
+                 std::vector<int>{-1, static_cast<int>(l1_max_tile)});
+      loops = sch->GetLoops(block_id);
+      sch->Parallel(loops[0]);
+    }
+    return;
+  }
+
+  // [S] => [S(parallel), S(l2 / l1), S(l1 / lanes), S(lanes, vectorized)]
+  // The L1 tile is the unit of the vectorized loops, and the L1 tiles of one
+  // L2 tile run on one thread. An L2 tile is at most the share of one thread
+  // so that all threads get work. The tiles divide the extent so that no
+  // loop has a tail, and loops of extent 1 are omitted.
+  const int64_t l1_tile = FindDivisibleTile(numel, l1_max_tile, lanes);
+  int64_t l2_tile = numel;
+  if (numel >= kMinParallelNumel) {
+    const int64_t l2_max_tile =
+        std::min(kL2CacheBytes / element_bytes,
+                 numel / std::max<int64_t>(max_concurrency(), 1));
+    l2_tile = FindDivisibleTile(numel, l2_max_tile, l1_tile);
+  }
+  std::vector<int> factors;
+  for (int64_t factor : {numel / l2_tile, l2_tile / l1_tile, l1_tile / lanes}) {
+    if (factor > 1) factors.push_back(static_cast<int>(factor));
+  }
+  factors.push_back(lanes);
+  if (factors.size() >= 2) {
+    sch->Split(loops[0], factors);
+  }
+  loops = sch->GetLoops(block_id);
+  if (numel > l2_tile) {
+    sch->Parallel(loops[0]);
+    loops = sch->GetLoops(block_id);
+  }
+  sch->Vectorize(loops.back(), lanes);
+}
+
+void TileCPUTactic::TileReduce(ir::IRSchedule* sch,
+                               const std::string& block_id) {
+  std::vector<ir::Expr> loops = sch->GetLoops(block_id);
+  const int rd_loop_idx = vec_flatten_axis_.empty() ? 0 : 1;
+  if (loops.size() <= rd_loop_idx) return;
+  const int lanes = GetVectorLanes(sch, block_id);
+
+  // For [S, R] whose reduce axis is contiguous in memory, the reduce loop is
+  // split by the vector width and factorized into `lanes` partial results,
+  // which are accumulated by vector instructions and then reduced
+  // horizontally:
+  //   [S, R] => rf block:         [S, R(lanes, vectorized), R(-1)]
+  //             write back block: [S, R(lanes, unrolled)]
+  const auto& iter_space_type = context_->config.base_info->iter_space_type;
+  const bool is_continuous_reduce =
+      !iter_space_type.empty() && iter_space_type.back().first == "R";
+  ir::Expr rd_extent = loops[rd_loop_idx].As<ir::For>()->extent;
+  const int64_t rd_numel =
+      rd_extent.is_constant() ? static_cast<int64_t>(rd_extent.get_constant())
+                              : -1;
+  std::string rf_block_id;
+  if (lanes > 1 && is_continuous_reduce && rd_numel > lanes &&
+      rd_numel % lanes == 0) {
+    sch->Split(loops[rd_loop_idx], std::vector<int>{-1, lanes});
+    loops = sch->GetLoops(block_id);
+    sch->Reorder({loops[rd_loop_idx + 1], loops[rd_loop_idx]});
+
+    ir::Expr block = sch->GetBlock(block_id);
+    if (IsReductionSBlock(block)) {
+      loops = sch->GetLoops(block_id);
+      int rf_axis = ir::analyzer::GetStoreTensorOfSBlock(block)
+                        ->domain_without_reduce_axis()
+                        .size();
+      ir::Expr rf_tensor = sch->FactorizeReduction(loops[rd_loop_idx], rf_axis);
+      rf_block_id = rf_tensor.as_tensor_ref()->name;
+
+      std::vector<ir::Expr> rf_loops = sch->GetLoops(rf_block_id);
+      sch->Vectorize(rf_loops[rd_loop_idx], lanes);
+      loops = sch->GetLoops(block_id);
+      sch->Unroll(loops[rd_loop_idx]);
+    }
+  }
+
+  // Parallelize the spatial loop, a reduction without spatial axes runs on
+  // one thread as there is no parallel reduce on CPU yet.
+  if (vec_flatten_axis_.empty()) return;
+  const ir::Expr& sp_extent = context_->iter_space_info.total_sp_extent;
+  const ir::Expr& rb_extent = context_->iter_space_info.total_rb_extent;
+  if (sp_extent.is_constant() && rb_extent.is_constant()) {
+    const auto sp_numel = static_cast<int64_t>(sp_extent.get_constant());
+    const auto rb_numel = static_cast<int64_t>(rb_extent.get_constant());
+    if (sp_numel <= 1 || sp_numel * rb_numel < kMinParallelNumel) {
+      return;
+    }
+  }
+  sch->Parallel(sch->GetLoops(block_id)[0]);
+  if (!rf_block_id.empty()) {
+    sch->Parallel(sch->GetLoops(rf_block_id)[0]);
+  }
+}
+
+std::unique_ptr<ScheduleTactic> CreateTileCPUTactic() {
+  return std::make_unique<TileCPUTactic>();
+}
+
+}  // namespace ir
+}  // namespace cinn
@@ -0,0 +1,29 @@
+// Copyright (c) 2024 CINN Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "paddle/cinn/ir/group_schedule/tactic/schedule_tactic.h"
+
+namespace cinn {
+namespace ir {
+
+// The tile tactic of x86 CPU targets, which parallelizes the outer spatial
+// loop, tiles it for the L1 and L2 caches and vectorizes the innermost loop
+// by the SIMD width of the host. Contiguous reductions are factorized into
+// vector partial results that are reduced horizontally.
+std::unique_ptr<ScheduleTactic> CreateTileCPUTactic();
+
+}  // namespace ir
+}  // namespace cinn
@@ -0,0 +1,92 @@
+// Copyright (c) 2024 CINN Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>  // NOLINT
+#include <vector>
+
+#include "paddle/cinn/cinn.h"
+#include "paddle/cinn/common/test_helper.h"
+#include "paddle/cinn/ir/test/tile_cpu_tactic_test_helper.h"
+
+namespace cinn {
+namespace ir {
+
+using common::BufferBuilder;
+using common::Float;
+
+// Logs the time of an elementwise and a reduce kernel with and without
+// TileCPUTactic.
+// Built but not run as a test, run ./tile_cpu_tactic_benchmark.
+TEST(TileCPUTacticBenchmark, Kernels) {
+  common::Context::Global().ResetNameId();
+  constexpr int M = 4096;
+  constexpr int N = 1024;
+  Placeholder<float> A("A", {Expr(M), Expr(N)});
+  Var reduce_j(N, "reduce_j");
+  ir::Tensor B = Compute(
+      {Expr(M), Expr(N)},
+      [&](Var i, Var j) { return A(i, j) * Expr(2.f) + Expr(1.f); },
+      "B");
+  ir::Tensor C = Compute(
+      {Expr(M)},
+      [&](Var i) { return lang::ReduceSum(A(i, reduce_j), {reduce_j}); },
+      "C");
+  ast_gen_ius::TensorGroup elementwise_group({A, B});
+  auto elementwise = LowerToAst("fn_scale", {A, B}, &elementwise_group);
+  ast_gen_ius::TensorGroup reduce_group({A, C});
+  auto reduce = LowerToAst("fn_row_sum", {A, C}, &reduce_group);
+
+  auto* a_buf = BufferBuilder(Float(32), {M, N}).set_random().Build();
+  auto* b_buf = BufferBuilder(Float(32), {M, N}).set_zero().Build();
+  auto* c_buf = BufferBuilder(Float(32), {M}).set_zero().Build();
+  const auto TimeKernel = [](const HostKernel& kernel,
+                             const std::vector<cinn_pod_value_t>& args) {
+    constexpr int kRepeat = 20;
+    kernel(args);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRepeat; ++i) {
+      kernel(args);
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kRepeat;
+  };
+
+  const std::vector<cinn_pod_value_t> elementwise_args{
+      cinn_pod_value_t(a_buf), cinn_pod_value_t(b_buf)};
+  double naive_ms = TimeKernel(HostKernel(elementwise), elementwise_args);
+  double tiled_ms = TimeKernel(
+      HostKernel(ScheduleOnCPU(
+          elementwise, {"B"}, {M, N}, 0, Expr(M * N), Expr(1))),
+      elementwise_args);
+  LOG(INFO) << "elementwise [" << M << ", " << N << "]: " << naive_ms
+            << " ms without TileCPUTactic, " << tiled_ms << " ms with it";
+
+  const std::vector<cinn_pod_value_t> reduce_args{cinn_pod_value_t(a_buf),
+                                                  cinn_pod_value_t(c_buf)};
+  naive_ms = TimeKernel(HostKernel(reduce), reduce_args);
+  tiled_ms = TimeKernel(HostKernel(ScheduleOnCPU(reduce,
+                                                 {"C__reduce_init", "C"},
+                                                 {M, N},
+                                                 1,
+                                                 Expr(M),
+                                                 Expr(N))),
+                        reduce_args);
+  LOG(INFO) << "reduce [" << M << ", " << N << "]: " << naive_ms
+            << " ms without TileCPUTactic, " << tiled_ms << " ms with it";
+  FreeBuffers({a_buf, b_buf, c_buf});
+}
+
+}  // namespace ir
+}  // namespace cinn
@@ -0,0 +1,216 @@
+// Copyright (c) 2024 CINN Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/cinn/ir/group_schedule/tactic/tile_cpu_tactic.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "paddle/cinn/cinn.h"
+#include "paddle/cinn/common/test_helper.h"
+#include "paddle/cinn/ir/schedule/ir_schedule_util.h"
+#include "paddle/cinn/ir/test/tile_cpu_tactic_test_helper.h"
+
+namespace cinn {
+namespace ir {
+
+using common::Bool;
+using common::BufferBuilder;
+using common::Float;
+using common::Int;
+
+// [64, 1024] => [S(parallel), S(l2 / l1), S(l1 / lanes), S(lanes)], the
+// innermost loop is vectorized and the tiles depend on the host, so only
+// their bounds are checked.
+TEST(TileCPUTactic, Elementwise) {
+  common::Context::Global().ResetNameId();
+  constexpr int M = 64;
+  constexpr int N = 1024;
+  Placeholder<float> A("A", {Expr(M), Expr(N)});
+  Placeholder<float> B("B", {Expr(M), Expr(N)});
+  ir::Tensor C = Compute(
+      {Expr(M), Expr(N)},
+      [&](Var i, Var j) { return A(i, j) * B(i, j) + Expr(1.f); },
+      "C");
+  ast_gen_ius::TensorGroup tensor_group({A, B, C});
+  auto func = LowerToAst("fn_elementwise", {A, B, C}, &tensor_group);
+
+  auto scheduled = ScheduleOnCPU(func, {"C"}, {M, N}, 0, Expr(M * N), Expr(1));
+  auto loops = GetLoops(scheduled, "C");
+  ASSERT_GE(loops.size(), 2UL);
+  ASSERT_LE(loops.size(), 4UL);
+  EXPECT_TRUE(loops[0].As<ir::For>()->is_parallel());
+  EXPECT_TRUE(loops.back().As<ir::For>()->is_vectorized());
+  EXPECT_EQ(CountLoops(scheduled, &ir::For::is_parallel), 1);
+  EXPECT_EQ(CountLoops(scheduled, &ir::For::is_vectorized), 1);
+  // A, B and C are read or written by every iteration.
+  constexpr int64_t kElementBytes = 3 * sizeof(float);
+  int64_t numel = 1;
+  for (const auto& loop : loops) {
+    numel *= GetLoopExtent(loop);
+  }
+  EXPECT_EQ(numel, M * N);
+  const int64_t thread_numel = numel / GetLoopExtent(loops[0]);
+  const int64_t l1_numel =
+      GetLoopExtent(loops[loops.size() - 2]) * GetLoopExtent(loops.back());
+  EXPECT_LE(thread_numel * kElementBytes, 256 * 1024);
+  EXPECT_LE(l1_numel * kElementBytes, 32 * 1024);
+
+  auto* a_buf = BufferBuilder(Float(32), {M, N}).set_random().Build();
+  auto* b_buf = BufferBuilder(Float(32), {M, N}).set_random().Build();
+  auto* c_buf = BufferBuilder(Float(32), {M, N}).set_zero().Build();
+  HostKernel kernel(scheduled);
+  kernel({cinn_pod_value_t(a_buf),
+          cinn_pod_value_t(b_buf),
+          cinn_pod_value_t(c_buf)});
+  const auto* a = reinterpret_cast<float*>(a_buf->memory);
+  const auto* b = reinterpret_cast<float*>(b_buf->memory);
+  const auto* c = reinterpret_cast<float*>(c_buf->memory);
+  for (int i = 0; i < M * N; ++i) {
+    ASSERT_FLOAT_EQ(c[i], a[i] * b[i] + 1.f) << "element " << i;
+  }
+  FreeBuffers({a_buf, b_buf, c_buf});
+}
+
+// [256, 1024] reduced over the contiguous axis =>
+//   rf block:         [S(256, parallel), R(lanes, vectorized), R(-1)]
+//   write back block: [S(256, parallel), R(lanes, unrolled)]
+TEST(TileCPUTactic, ContiguousReduce) {
+  common::Context::Global().ResetNameId();
+  constexpr int M = 256;
+  constexpr int N = 1024;
+  Placeholder<float> A("A", {Expr(M), Expr(N)});
+  Var reduce_j(N, "reduce_j");
+  ir::Tensor B = Compute(
+      {Expr(M)},
+      [&](Var i) { return lang::ReduceSum(A(i, reduce_j), {reduce_j}); },
+      "B");
+  ast_gen_ius::TensorGroup tensor_group({A, B});
+  auto func = LowerToAst("fn_reduce_sum", {A, B}, &tensor_group);
+
+  auto scheduled = ScheduleOnCPU(
+      func, {"B__reduce_init", "B"}, {M, N}, 1, Expr(M), Expr(N));
+  auto loops = GetLoops(scheduled, "B");
+  ASSERT_EQ(loops.size(), 2UL);
+  EXPECT_TRUE(loops[0].As<ir::For>()->is_parallel());
+  EXPECT_EQ(GetLoopExtent(loops[0]), M);
+  EXPECT_TRUE(loops[1].As<ir::For>()->is_unrolled());
+  const int64_t lanes = GetLoopExtent(loops[1]);
+  EXPECT_GT(lanes, 1);
+  EXPECT_EQ(N % lanes, 0);
+  EXPECT_EQ(CountLoops(scheduled, &ir::For::is_parallel), 2);
+  EXPECT_EQ(CountLoops(scheduled, &ir::For::is_vectorized), 1);
+
+  auto* a_buf = BufferBuilder(Float(32), {M, N}).set_random().Build();
+  auto* b_buf = BufferBuilder(Float(32), {M}).set_val(-1.f).Build();
+  HostKernel kernel(scheduled);
+  kernel({cinn_pod_value_t(a_buf), cinn_pod_value_t(b_buf)});
+  const auto* a = reinterpret_cast<float*>(a_buf->memory);
+  const auto* b = reinterpret_cast<float*>(b_buf->memory);
+  for (int i = 0; i < M; ++i) {
+    double expected = 0;
+    for (int j = 0; j < N; ++j) {
+      expected += a[i * N + j];
+    }
+    ASSERT_NEAR(b[i], expected, 1e-3) << "row " << i;
+  }
+  FreeBuffers({a_buf, b_buf});
+}
+
+// [n, 64] => [S(-1, parallel), S(4096)] for the 8 bytes of A and B, the
+// tail of the inner loop is checked at runtime.
+TEST(TileCPUTactic, DynamicShape) {
+  common::Context::Global().ResetNameId();
+  constexpr int N = 64;
+  Var n("n", Int(32));
+  Placeholder<float> A("A", {Expr(n), Expr(N)});
+  ir::Tensor B = Compute(
+      {Expr(n), Expr(N)},
+      [&](Var i, Var j) { return A(i, j) * Expr(2.f); },
+      "B");
+  ast_gen_ius::TensorGroup tensor_group({A, B});
+  auto lowered = LowerToAst("fn_dynamic", {A, B}, &tensor_group);
+  // The dynamic dimension is passed after the tensors as by the group
+  // lowering.
+  std::vector<ir::Argument> args = lowered->args;
+  args.emplace_back(n, ir::Argument::IO::kInput);
+  auto func = ir::_LoweredFunc_::Make(
+      lowered->name, args, lowered->body, lowered->temp_bufs);
+
+  auto scheduled =
+      ScheduleOnCPU(func, {"B"}, {-1, N}, 0, Expr(n) * Expr(N), Expr(1));
+  auto loops = GetLoops(scheduled, "B");
+  ASSERT_EQ(loops.size(), 2UL);
+  EXPECT_TRUE(loops[0].As<ir::For>()->is_parallel());
+  EXPECT_EQ(GetLoopExtent(loops[1]), 4096);
+  EXPECT_EQ(CountLoops(scheduled, &ir::For::is_vectorized), 0);
+
+  HostKernel kernel(scheduled);
+  // Less than one tile, and whole tiles with a tail.
+  for (int rows : {3, 128, 300}) {
+    auto* a_buf = BufferBuilder(Float(32), {rows, N}).set_random().Build();
+    auto* b_buf = BufferBuilder(Float(32), {rows, N}).set_zero().Build();
+    kernel({cinn_pod_value_t(a_buf),
+            cinn_pod_value_t(b_buf),
+            cinn_pod_value_t(static_cast<int32_t>(rows))});
+    const auto* a = reinterpret_cast<float*>(a_buf->memory);
+    const auto* b = reinterpret_cast<float*>(b_buf->memory);
+    for (int i = 0; i < rows * N; ++i) {
+      ASSERT_FLOAT_EQ(b[i], a[i] * 2.f) << "element " << i << " of " << rows;
+    }
+    FreeBuffers({a_buf, b_buf});
+  }
+}
+
+// Booleans are not vectorized, [64, 1024] => [S(19, parallel), S(3640)] for
+// the 9 bytes of A, B and C, the last tile has a tail.
+TEST(TileCPUTactic, Bool) {
+  common::Context::Global().ResetNameId();
+  constexpr int M = 64;
+  constexpr int N = 1024;
+  Placeholder<float> A("A", {Expr(M), Expr(N)});
+  Placeholder<float> B("B", {Expr(M), Expr(N)});
+  ir::Tensor C = Compute(
+      {Expr(M), Expr(N)}, [&](Var i, Var j) { return A(i, j) > B(i, j); }, "C");
+  ast_gen_ius::TensorGroup tensor_group({A, B, C});
+  auto func = LowerToAst("fn_greater", {A, B, C}, &tensor_group);
+
+  auto scheduled = ScheduleOnCPU(func, {"C"}, {M, N}, 0, Expr(M * N), Expr(1));
+  auto loops = GetLoops(scheduled, "C");
+  ASSERT_EQ(loops.size(), 2UL);
+  EXPECT_TRUE(loops[0].As<ir::For>()->is_parallel());
+  EXPECT_EQ(GetLoopExtent(loops[0]), 19);
+  EXPECT_EQ(GetLoopExtent(loops[1]), 3640);
+  EXPECT_EQ(CountLoops(scheduled, &ir::For::is_vectorized), 0);
+
+  auto* a_buf = BufferBuilder(Float(32), {M, N}).set_random().Build();
+  auto* b_buf = BufferBuilder(Float(32), {M, N}).set_random().Build();
+  auto* c_buf = BufferBuilder(Bool(), {M, N}).set_zero().Build();
+  HostKernel kernel(scheduled);
+  kernel({cinn_pod_value_t(a_buf),
+          cinn_pod_value_t(b_buf),
+          cinn_pod_value_t(c_buf)});
+  const auto* a = reinterpret_cast<float*>(a_buf->memory);
+  const auto* b = reinterpret_cast<float*>(b_buf->memory);
+  const auto* c = reinterpret_cast<bool*>(c_buf->memory);
+  for (int i = 0; i < M * N; ++i) {
+    ASSERT_EQ(c[i], a[i] > b[i]) << "element " << i;
+  }
+  FreeBuffers({a_buf, b_buf, c_buf});
+}
+
+}  // namespace ir
+}  // namespace cinn
@@ -0,0 +1,131 @@
+// Copyright (c) 2024 CINN Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle/cinn/backends/compiler.h"
+#include "paddle/cinn/cinn.h"
+#include "paddle/cinn/ir/group_schedule/tactic/tile_cpu_tactic.h"
+#include "paddle/cinn/ir/schedule/ir_schedule.h"
+#include "paddle/cinn/ir/utils/ir_copy.h"
+#include "paddle/cinn/ir/utils/ir_nodes_collector.h"
+#include "paddle/cinn/runtime/cinn_runtime.h"
+
+namespace cinn {
+namespace ir {
+
+// Helpers shared by the test and the benchmark of TileCPUTactic.
+
+using HostFn = void (*)(void*, int32_t);
+
+// Schedules the blocks of `func` with TileCPUTactic as
+// DynamicShapeGroupScheduler does for x86 targets. The last
+// `num_reduce_axis` of `loop_ranges` are reduced, -1 is a dynamic range.
+inline ir::LoweredFunc ScheduleOnCPU(const ir::LoweredFunc& func,
+                                     const std::vector<std::string>& block_ids,
+                                     const std::vector<int64_t>& loop_ranges,
+                                     int num_reduce_axis,
+                                     const ir::Expr& sp_extent,
+                                     const ir::Expr& rb_extent) {
+  ir::IRSchedule sch(ir::ModuleExpr({ir::ir_utils::IRCopy(func->body)}),
+                     -1,
+                     false,
+                     utils::ErrorMessageLevel::kGeneral,
+                     /* is_dynamic_shape = */ true);
+  ScheduleContext context;
+  context.target = common::DefaultHostTarget();
+  context.iter_space_info.total_sp_extent = sp_extent;
+  context.iter_space_info.total_rb_extent = rb_extent;
+  context.config.base_info = std::make_shared<ScheduleConfig::BaseInfo>();
+  context.config.base_info->loop_ranges = loop_ranges;
+  const int rank = static_cast<int>(loop_ranges.size());
+  for (int i = 0; i < rank; ++i) {
+    const bool is_reduce = i + num_reduce_axis >= rank;
+    if (is_reduce) {
+      context.config.base_info->reduce_axis.push_back(i);
+    }
+    context.config.base_info->iter_space_type.emplace_back(
+        is_reduce ? "R" : "S", loop_ranges[i] < 0 ? "dynamic" : "static");
+  }
+
+  std::unique_ptr<ScheduleTactic> tactic = CreateTileCPUTactic();
+  tactic->Init(&context, &sch);
+  for (const auto& block_id : block_ids) {
+    tactic->Apply(&sch, block_id);
+  }
+  return ir::_LoweredFunc_::Make(func->name,
+                                 func->args,
+                                 sch.GetModule().GetExprs().front(),
+                                 func->temp_bufs);
+}
+
+inline std::vector<ir::Expr> GetLoops(const ir::LoweredFunc& func,
+                                      const std::string& block_id) {
+  ir::IRSchedule sch(ir::ModuleExpr({func->body}),
+                     -1,
+                     false,
+                     utils::ErrorMessageLevel::kGeneral,
+                     /* is_dynamic_shape = */ true);
+  return sch.GetLoops(block_id);
+}
+
+inline int CountLoops(const ir::LoweredFunc& func,
+                      bool (ir::For::*type_check)() const) {
+  return ir::ir_utils::CollectIRNodes(func->body,
+                                      [&](const ir::Expr* x) {
+                                        const auto* loop = x->As<ir::For>();
+                                        return loop && (loop->*type_check)();
+                                      })
+      .size();
+}
+
+// A function JIT compiled for the host through the low level passes of the
+// group lowering.
+class HostKernel {
+ public:
+  explicit HostKernel(const ir::LoweredFunc& func)
+      : compiler_(backends::Compiler::Create(common::DefaultHostTarget())) {
+    const Target target = common::DefaultHostTarget();
+    ir::Module::Builder builder(func->name, target);
+    builder.AddFunction(optim::Optimize(func, target));
+    compiler_->Build(builder.Build());
+    compiler_->EndCompile();
+    fn_ = reinterpret_cast<HostFn>(compiler_->Lookup(func->name));
+    EXPECT_NE(fn_, nullptr);
+  }
+
+  void operator()(std::vector<cinn_pod_value_t> args) const {
+    fn_(args.data(), static_cast<int32_t>(args.size()));
+  }
+
+ private:
+  std::unique_ptr<backends::Compiler> compiler_;
+  HostFn fn_{nullptr};
+};
+
+inline void FreeBuffers(const std::vector<cinn_buffer_t*>& buffers) {
+  for (auto* buffer : buffers) {
+    cinn_buffer_free(nullptr, buffer);
+    cinn_buffer_t::delete_(buffer);
+  }
+}
+
+}  // namespace ir
+}  // namespace cinn
@@ -17,6 +17,7 @@
 #include "paddle/cinn/ir/ir_printer.h"
 #include "paddle/cinn/ir/schedule/ir_schedule_util.h"
 #include "paddle/cinn/ir/utils/ir_copy.h"
+#include "paddle/cinn/ir/utils/ir_nodes_collector.h"
 #include "paddle/cinn/ir/utils/stmt_converter.h"
 #include "paddle/cinn/optim/call_arg_list_to_pod_value.h"
 #include "paddle/cinn/optim/cast_bool_to_int8.h"
@@ -110,8 +111,18 @@ ir::LoweredFunc Optimize(ir::LoweredFunc fn,
   pass_manager.AddPass(CreateIfFusionPass());
   pass_manager.Run(copied);
 
-  VectorizeForTrans(&copied->body);
-  VLOG(10) << "After Optimize vectorize" << copied;
+  // Vectorized loops are lowered to CUDA vector types on GPU, and to Ramp and
+  // Broadcast vectors for the LLVM backend on CPU. The latter works on the
+  // loads and stores left by RemoveScheduleBlock.
+  target.arch.Match(
+      [&](std::variant<common::UnknownArch, common::X86Arch, common::ARMArch>) {
+      },
+      [&](std::variant<common::NVGPUArch,
+                       common::HygonDCUArchHIP,
+                       common::HygonDCUArchSYCL>) {
+        VectorizeForTrans(&copied->body);
+        VLOG(10) << "After Optimize vectorize" << copied;
+      });
 
   Simplify(&copied->body);
   VLOG(10) << "After Optimize Simplify" << copied;
@@ -119,6 +130,26 @@ ir::LoweredFunc Optimize(ir::LoweredFunc fn,
   RemoveScheduleBlock(&copied->body);
   VLOG(10) << "After RemoveScheduleBlock:" << copied;
 
+  target.arch.Match(
+      [&](std::variant<common::UnknownArch, common::X86Arch, common::ARMArch>) {
+        bool has_vectorized_loop =
+            !ir::ir_utils::CollectIRNodesWithoutTensor(
+                 copied->body,
+                 [](const ir::Expr* x) {
+                   const auto* loop = x->As<ir::For>();
+                   return loop && loop->is_vectorized();
+                 },
+                 /* uniq_target = */ true)
+                 .empty();
+        if (has_vectorized_loop) {
+          VectorizeLoops(&copied->body, target);
+          VLOG(10) << "After Optimize vectorize" << copied;
+        }
+      },
+      [&](std::variant<common::NVGPUArch,
+                       common::HygonDCUArchHIP,
+                       common::HygonDCUArchSYCL>) {});
+
   LowerIntrin(&copied->body, target);
   VLOG(10) << "After LowerIntrin:" << copied;
 
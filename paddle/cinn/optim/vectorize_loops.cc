@@ -31,6 +31,7 @@
 #include "paddle/cinn/ir/utils/ir_nodes_collector.h"
 #include "paddle/cinn/ir/utils/ir_replace.h"
 #include "paddle/cinn/optim/ir_simplify.h"
+#include "paddle/cinn/optim/lower_intrin.h"
 #include "paddle/cinn/optim/unroll_loops.h"
 #include "paddle/cinn/utils/functional.h"
 
@@ -748,9 +749,25 @@ struct VectorizeLoops_ : public IRMutator<Expr *> {
     auto it = op->attrs.find("vectorizable");
     if (it != op->attrs.end()) {
       vectorizable_ = absl::get<bool>(it->second);
+    } else if (op->is_extern_call() && !kIntrinsicCalls.count(op->name)) {
+      // On CPU only the calls lowered to LLVM intrinsics take vectors, the
+      // other extern functions are scalar.
+      target.arch.Match(
+          [&](std::variant<common::UnknownArch,
+                           common::X86Arch,
+                           common::ARMArch>) { vectorizable_ = false; },
+          [&](std::variant<common::NVGPUArch,
+                           common::HygonDCUArchHIP,
+                           common::HygonDCUArchSYCL>) {});
     }
   }
 
+  void Visit(const IfThenElse *op, Expr *expr) override {
+    // Vectorizer does not widen the branches.
+    vectorizable_ = false;
+    IRMutator<>::Visit(op, expr);
+  }
+
   void Visit(const For *forloop, Expr *expr) {
     auto *node = expr->As<For>();
     auto loop_var_name = forloop->loop_var->name;
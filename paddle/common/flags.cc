@@ -50,6 +50,22 @@ PHI_DEFINE_EXPORTED_int32(paddle_num_threads,
                           1,
                           "Number of threads for each paddle instance.");
 
+/**
+ * CPU kernel related FLAG
+ * Name: FLAGS_cpu_intra_op_num_threads
+ * Since Version: 3.0.0
+ * Value Range: int32, default=0
+ * Example: FLAGS_cpu_intra_op_num_threads=8, CPU kernels split large inputs
+ * across up to 8 threads
+ * Note: The intra-op threads are shared by all CPU contexts of the process,
+ * so they add to rather than multiply with the inter-op threads of the
+ * executor. 0 or 1 runs kernels on the calling thread only.
+ */
+PHI_DEFINE_EXPORTED_int32(cpu_intra_op_num_threads,
+                          0,
+                          "Number of intra-op threads of CPU kernels, 0 or 1 "
+                          "disables intra-op parallelism.");
+
 /**
  * Low Precision Op related FLAG
  * Name: FLAGS_low_precision_op_list
@@ -1059,6 +1075,21 @@ PHI_DEFINE_EXPORTED_int64(
     cinn_compile_thread_num,
     -1,
     "It controls how many thread numbers applying compilation cache.");
+
+/*
+ * CINN related FLAG
+ * Name: FLAGS_cinn_compile_cache_dir
+ * Since Version: 3.0
+ * Value Range: string, default=""
+ * Example: FLAGS_cinn_compile_cache_dir="/tmp/cinn_cache" would save the
+ * object code of the compiled X86 kernels there and load it in later
+ * processes instead of compiling again. Disabled if empty.
+ */
+PHI_DEFINE_EXPORTED_string(
+    cinn_compile_cache_dir,
+    "",
+    "The directory of the persistent cinn compilation cache, "
+    "empty to disable.");
 /*
  * CINN related FLAG
  * Name: FLAGS_enable_interpretercore_launch_cinn
@@ -1217,6 +1248,10 @@ PD_DEFINE_bool(enable_slotrecord_reset_shrink,  // NOLINT
 PD_DEFINE_bool(enable_ins_parser_file,  // NOLINT
                false,
                "enable parser ins file, default false");
+PD_DEFINE_bool(enable_slotrecord_columnar_input,  // NOLINT
+               false,
+               "SlotRecordDataset files are read in the columnar binary "
+               "format instead of as text lines, default false");
 PHI_DEFINE_EXPORTED_bool(
     gpugraph_enable_hbm_table_collision_stat,
     false,
@@ -1604,6 +1639,69 @@ PHI_DEFINE_EXPORTED_bool(
     false,
     "whether PirInterpreter::RecordStreamForGC use cache strategy.");
 
+/**
+ * Executor related FLAG
+ * Name: FLAGS_pir_interpreter_static_memory_plan
+ * Since Version: 3.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_pir_interpreter_static_memory_plan=true
+ * Note: If True, PirInterpreter records the lifetime and size of intermediate
+ * tensors in the first run, then places them into one preallocated arena by
+ * offset and stops garbage collecting them in later runs. Only takes effect in
+ * trace run mode with one device context and no control flow.
+ */
+PHI_DEFINE_EXPORTED_bool(pir_interpreter_static_memory_plan,
+                         false,
+                         "whether PirInterpreter plans the memory of "
+                         "intermediate tensors into one arena.");
+
+/**
+ * Executor related FLAG
+ * Name: FLAGS_pir_interpreter_shape_bucket_plan
+ * Since Version: 3.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_pir_interpreter_shape_bucket_plan=true
+ * Note: If True together with FLAGS_pir_interpreter_static_memory_plan,
+ * PirInterpreter keeps one memory plan per bucket of input shapes instead of
+ * one for the first shape. A new bucket is profiled by its first run, and a
+ * bucket whose tensors outgrow the plan is planned again with the larger
+ * sizes, so inputs of varying shapes reuse their arenas once warmed up.
+ */
+PHI_DEFINE_EXPORTED_bool(pir_interpreter_shape_bucket_plan,
+                         false,
+                         "whether PirInterpreter keeps a memory plan per "
+                         "bucket of input shapes.");
+
+/**
+ * Executor related FLAG
+ * Name: FLAGS_pir_interpreter_shape_bucket_granularity
+ * Since Version: 3.0
+ * Value Range: int64, default=0
+ * Example: FLAGS_pir_interpreter_shape_bucket_granularity=64
+ * Note: Each input dimension is rounded up to a multiple of it to find the
+ * shape bucket, or to a power of 2 if it is not positive.
+ */
+PHI_DEFINE_EXPORTED_int64(pir_interpreter_shape_bucket_granularity,
+                          0,
+                          "the granularity of the input dimensions in shape "
+                          "buckets, 0 for powers of 2.");
+
+/**
+ * Executor related FLAG
+ * Name: FLAGS_pir_interpreter_sequential_run
+ * Since Version: 3.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_pir_interpreter_sequential_run=true
+ * Note: If True, PirInterpreter runs small CPU programs after the first run
+ * by a tight loop on the calling thread, which frees variables at
+ * precomputed steps instead of using dependency counters and the event
+ * garbage collector. Programs with enough parallelism keep the normal path.
+ */
+PHI_DEFINE_EXPORTED_bool(pir_interpreter_sequential_run,
+                         false,
+                         "whether PirInterpreter runs small CPU programs "
+                         "sequentially on the calling thread.");
+
 /**
  * Using PIR API in Python
  * Name: enable_pir_api
@@ -0,0 +1,335 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace distributed {
+
+struct SlabArenaStat {
+  size_t slab_num = 0;
+  size_t reserved_bytes = 0;  // bytes mapped for slabs
+  size_t used_bytes = 0;      // bytes held by live blocks
+  size_t fallback_bytes = 0;  // blocks above max_floats, served by malloc
+};
+
+// Size-class arena for float blocks, e.g. sparse feature values.
+//
+// Every size class (rounded up to 8 bytes) carves its blocks out of large
+// slabs aligned to their own size, so a block costs exactly its rounded
+// size, with no malloc header, and the owning slab is found by masking the
+// block address. Free blocks go to a per-class free list.
+//
+// Compaction moves the live blocks of the emptiest slabs of every class into
+// the free blocks of the fullest ones and returns the emptied slabs to the
+// OS:
+//   arena.BeginCompact();
+//   for each block owner: ptr = arena.Relocate(ptr, n);
+//   arena.EndCompact();
+class SlabArena {
+ public:
+  static constexpr size_t kDefaultSlabBytes = 256 * 1024;
+
+  explicit SlabArena(size_t max_floats,
+                     size_t slab_bytes = kDefaultSlabBytes)
+      : _slab_bytes(slab_bytes) {
+    PADDLE_ENFORCE_EQ(
+        slab_bytes & (slab_bytes - 1),
+        0UL,
+        common::errors::InvalidArgument(
+            "The slab size of SlabArena must be a power of 2, but got %d.",
+            slab_bytes));
+    size_t max_class = BlockBytes(max_floats) / kBlockAlign;
+    PADDLE_ENFORCE_LE(
+        sizeof(SlabHeader) + max_class * kBlockAlign,
+        slab_bytes,
+        common::errors::InvalidArgument(
+            "The slab size %d of SlabArena can not hold a block of %d floats.",
+            slab_bytes,
+            max_floats));
+    _max_floats = max_floats;
+    _classes.resize(max_class + 1);
+  }
+  SlabArena(const SlabArena&) = delete;
+  ~SlabArena() {
+    for (auto& size_class : _classes) {
+      for (auto* slab : size_class.slabs) {
+        UnmapSlab(slab);
+      }
+    }
+  }
+
+  size_t max_floats() const { return _max_floats; }
+
+  float* Allocate(size_t n) {
+    if (n == 0) {
+      return nullptr;
+    }
+    if (n > _max_floats) {
+      _fallback_bytes += n * sizeof(float);
+      return reinterpret_cast<float*>(malloc(n * sizeof(float)));
+    }
+    std::lock_guard<Lock> guard(_lock);
+    return AllocateLocked(BlockBytes(n) / kBlockAlign);
+  }
+
+  void Free(float* ptr, size_t n) {
+    if (ptr == nullptr) {
+      return;
+    }
+    if (n > _max_floats) {
+      _fallback_bytes -= n * sizeof(float);
+      free(ptr);
+      return;
+    }
+    std::lock_guard<Lock> guard(_lock);
+    FreeLocked(ptr);
+  }
+
+  // Whether blocks of n and m floats share one size class.
+  static bool SameClass(size_t n, size_t m) {
+    return BlockBytes(n) == BlockBytes(m);
+  }
+
+  SlabArenaStat Stat() {
+    std::lock_guard<Lock> guard(_lock);
+    SlabArenaStat stat;
+    for (size_t idx = 1; idx < _classes.size(); ++idx) {
+      for (auto* slab : _classes[idx].slabs) {
+        ++stat.slab_num;
+        stat.used_bytes += slab->live * idx * kBlockAlign;
+      }
+    }
+    stat.reserved_bytes = stat.slab_num * _slab_bytes;
+    stat.fallback_bytes = _fallback_bytes;
+    return stat;
+  }
+
+  // Marks the slabs to evacuate and returns how many there are.
+  size_t BeginCompact() {
+    std::lock_guard<Lock> guard(_lock);
+    size_t evacuating = 0;
+    for (size_t idx = 1; idx < _classes.size(); ++idx) {
+      auto& size_class = _classes[idx];
+      if (size_class.slabs.size() < 2) {
+        continue;
+      }
+      size_t per_slab = BlocksPerSlab(idx);
+      size_t live = 0;
+      for (auto* slab : size_class.slabs) {
+        live += slab->live;
+      }
+      size_t keep = (live + per_slab - 1) / per_slab;
+      if (keep >= size_class.slabs.size()) {
+        continue;
+      }
+      std::sort(size_class.slabs.begin(),
+                size_class.slabs.end(),
+                [](const SlabHeader* a, const SlabHeader* b) {
+                  return a->live > b->live;
+                });
+      for (size_t i = keep; i < size_class.slabs.size(); ++i) {
+        size_class.slabs[i]->evacuating = true;
+        ++evacuating;
+      }
+      if (size_class.current != nullptr && size_class.current->evacuating) {
+        size_class.current = nullptr;
+      }
+      // drop free blocks living in evacuating slabs
+      FreeBlock** link = &size_class.free_list;
+      while (*link != nullptr) {
+        if (SlabOf(*link)->evacuating) {
+          *link = (*link)->next;
+        } else {
+          link = &(*link)->next;
+        }
+      }
+    }
+    return evacuating;
+  }
+
+  // Moves a block of n floats out of an evacuating slab, returns the block's
+  // (possibly new) address.
+  float* Relocate(float* ptr, size_t n) {
+    if (ptr == nullptr || n > _max_floats) {
+      return ptr;
+    }
+    std::lock_guard<Lock> guard(_lock);
+    SlabHeader* slab = SlabOf(ptr);
+    if (!slab->evacuating) {
+      return ptr;
+    }
+    float* new_ptr = AllocateLocked(slab->class_idx);
+    memcpy(new_ptr, ptr, n * sizeof(float));
+    --slab->live;
+    return new_ptr;
+  }
+
+  // Releases evacuated slabs and returns the number of released bytes.
+  size_t EndCompact() {
+    std::lock_guard<Lock> guard(_lock);
+    size_t released = 0;
+    for (size_t idx = 1; idx < _classes.size(); ++idx) {
+      auto& slabs = _classes[idx].slabs;
+      auto new_end = std::remove_if(
+          slabs.begin(), slabs.end(), [this, &released](SlabHeader* slab) {
+            if (!slab->evacuating) {
+              return false;
+            }
+            if (slab->live != 0) {
+              // an owner was not relocated, keep the slab; its free
+              // blocks stay out of the free list
+              slab->evacuating = false;
+              return false;
+            }
+            UnmapSlab(slab);
+            released += _slab_bytes;
+            return true;
+          });
+      slabs.erase(new_end, slabs.end());
+    }
+    return released;
+  }
+
+ private:
+  static constexpr size_t kBlockAlign = 8;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct alignas(64) SlabHeader {
+    size_t class_idx;
+    size_t live;    // allocated blocks
+    size_t carved;  // blocks handed out by bump allocation
+    bool evacuating;
+  };
+
+  struct SizeClass {
+    FreeBlock* free_list = nullptr;
+    SlabHeader* current = nullptr;  // slab with un-carved room
+    std::vector<SlabHeader*> slabs;
+  };
+
+  class Lock {
+   public:
+    void lock() {
+      while (_flag.test_and_set(std::memory_order_acquire)) {
+      }
+    }
+    void unlock() { _flag.clear(std::memory_order_release); }
+
+   private:
+    std::atomic_flag _flag = ATOMIC_FLAG_INIT;
+  };
+
+  static size_t BlockBytes(size_t n) {
+    return (n * sizeof(float) + kBlockAlign - 1) / kBlockAlign * kBlockAlign;
+  }
+
+  size_t BlocksPerSlab(size_t class_idx) const {
+    return (_slab_bytes - sizeof(SlabHeader)) / (class_idx * kBlockAlign);
+  }
+
+  SlabHeader* SlabOf(const void* ptr) const {
+    return reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(ptr) &
+                                         ~(_slab_bytes - 1));
+  }
+
+  float* AllocateLocked(size_t class_idx) {
+    auto& size_class = _classes[class_idx];
+    FreeBlock* block = size_class.free_list;
+    if (block != nullptr) {
+      size_class.free_list = block->next;
+      ++SlabOf(block)->live;
+      return reinterpret_cast<float*>(block);
+    }
+    SlabHeader* slab = size_class.current;
+    if (slab == nullptr || slab->carved == BlocksPerSlab(class_idx)) {
+      slab = MapSlab(class_idx);
+      size_class.slabs.push_back(slab);
+      size_class.current = slab;
+    }
+    char* ptr = reinterpret_cast<char*>(slab) + sizeof(SlabHeader) +
+                slab->carved * class_idx * kBlockAlign;
+    ++slab->carved;
+    ++slab->live;
+    return reinterpret_cast<float*>(ptr);
+  }
+
+  void FreeLocked(float* ptr) {
+    SlabHeader* slab = SlabOf(ptr);
+    --slab->live;
+    if (slab->evacuating) {
+      return;
+    }
+    auto& size_class = _classes[slab->class_idx];
+    FreeBlock* block = reinterpret_cast<FreeBlock*>(ptr);
+    block->next = size_class.free_list;
+    size_class.free_list = block;
+  }
+
+  // maps twice the slab size and trims it down to an aligned slab
+  SlabHeader* MapSlab(size_t class_idx) {
+    size_t map_bytes = _slab_bytes * 2;
+    void* addr = mmap(nullptr,
+                      map_bytes,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+    PADDLE_ENFORCE_NE(addr,
+                      MAP_FAILED,
+                      common::errors::ResourceExhausted(
+                          "Fail to map memory of %ld size for SlabArena.",
+                          map_bytes));
+    uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+    uintptr_t aligned = (begin + _slab_bytes - 1) & ~(_slab_bytes - 1);
+    if (aligned > begin) {
+      munmap(addr, aligned - begin);
+    }
+    size_t tail = begin + map_bytes - (aligned + _slab_bytes);
+    if (tail > 0) {
+      munmap(reinterpret_cast<void*>(aligned + _slab_bytes), tail);
+    }
+    SlabHeader* slab = reinterpret_cast<SlabHeader*>(aligned);
+    slab->class_idx = class_idx;
+    slab->live = 0;
+    slab->carved = 0;
+    slab->evacuating = false;
+    return slab;
+  }
+
+  void UnmapSlab(SlabHeader* slab) { munmap(slab, _slab_bytes); }
+
+  size_t _slab_bytes;
+  size_t _max_floats;
+  std::vector<SizeClass> _classes;
+  std::atomic<size_t> _fallback_bytes{0};
+  Lock _lock;
+};
+
+}  // namespace distributed
+}  // namespace paddle
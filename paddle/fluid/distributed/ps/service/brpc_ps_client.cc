@@ -14,6 +14,7 @@
 
 #include "paddle/fluid/distributed/ps/service/brpc_ps_client.h"
 
+#include <chrono>  // NOLINT
 #include <memory>
 #include <sstream>
 #include <string>
@@ -24,6 +25,8 @@
 
 static const int max_port = 65535;
 
+PD_DECLARE_bool(pserver_sparse_attachment_payload);
+
 namespace paddle::framework {
 class Scope;
 class Variable;
@@ -79,6 +82,18 @@ PD_DEFINE_int32(pserver_sparse_table_shard_num,
                 1000,
                 "sparse table shard for save & load");
 
+PD_DEFINE_bool(pserver_pull_sparse_coalesce,
+               false,
+               "merge concurrent pull_sparse of a table into one request");
+
+PD_DEFINE_int32(pserver_pull_sparse_coalesce_window_us,
+                200,
+                "max time a pull_sparse waits for others to merge with");
+
+PD_DEFINE_int32(pserver_pull_sparse_coalesce_max_keys,
+                200000,
+                "a merged pull_sparse is sent once it has this many keys");
+
 inline size_t get_sparse_shard(uint32_t shard_num,
                                uint32_t server_num,
                                uint64_t key) {
@@ -88,6 +103,65 @@ inline size_t get_sparse_shard(uint32_t shard_num,
   return (key % shard_num) / local_shard_num;
 }
 
+// brpc compresses the protobuf message only, so a compressed channel keeps
+// the payload in the message
+inline bool use_sparse_attachment_payload() {
+  return FLAGS_pserver_sparse_attachment_payload &&
+         FLAGS_pserver_communicate_compress_type == 0;
+}
+
+// Returns where the |keys|values| payload of a push sparse request is
+// written. The payload is gathered from the caller's keys and values either
+// way. In attachment mode that one copy goes into a block owned by the
+// attachment, which skips the protobuf serialize copy on the client and the
+// parse copy on the server.
+inline char *push_sparse_payload(PsRequestMessage *request,
+                                 brpc::Controller *cntl,
+                                 size_t size) {
+  if (use_sparse_attachment_payload() && size > 0) {
+    char *data = static_cast<char *>(malloc(size));
+    cntl->request_attachment().append_user_data(data, size, free);
+    return data;
+  }
+  auto *push_data = request->mutable_data();
+  push_data->resize(size);
+  return const_cast<char *>(push_data->data());
+}
+
+// Reads the pull value of one key from a response. Pull values packed on
+// the wire by the accessor are decoded into the caller's buffer.
+inline bool read_select_value(butil::IOBufBytesIterator *io_buffer_itr,
+                              ValueAccessor *accessor,
+                              size_t value_size,
+                              size_t wire_size,
+                              float *value) {
+  if (wire_size == value_size) {
+    return io_buffer_itr->copy_and_forward(reinterpret_cast<void *>(value),
+                                           value_size) == value_size;
+  }
+  thread_local std::vector<char> wire;
+  wire.resize(wire_size);
+  if (io_buffer_itr->copy_and_forward(wire.data(), wire_size) != wire_size) {
+    return false;
+  }
+  accessor->DecodeSelect(value, wire.data());
+  return true;
+}
+
+// Writes the push value of one key into a request, packed when the accessor
+// compresses push values on the wire.
+inline void write_update_value(char *data,
+                               ValueAccessor *accessor,
+                               size_t value_size,
+                               size_t wire_size,
+                               const float *value) {
+  if (wire_size == value_size) {
+    memcpy(data, value, value_size);
+  } else {
+    accessor->EncodeUpdate(data, value);
+  }
+}
+
 void DownpourPsClientService::service(
     ::google::protobuf::RpcController *controller,
     const PsRequestMessage *request,
@@ -446,6 +520,8 @@ std::future<int32_t> BrpcPsClient::PrintTableStat(uint32_t table_id) {
         int ret = 0;
         uint64_t feasign_size = 0;
         uint64_t mf_size = 0;
+        uint64_t reserved_bytes = 0;
+        uint64_t used_bytes = 0;
         ::paddle::framework::BinaryArchive ar;
         auto *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
         for (size_t i = 0; i < request_call_num; ++i) {
@@ -459,11 +535,18 @@ std::future<int32_t> BrpcPsClient::PrintTableStat(uint32_t table_id) {
 
           feasign_size += ar.Get<uint64_t>();
           mf_size += ar.Get<uint64_t>();
+          // servers that predate memory stat only send the sizes
+          if (ar.Cursor() < ar.Finish()) {
+            reserved_bytes += ar.Get<uint64_t>();
+            used_bytes += ar.Get<uint64_t>();
+          }
         }
         closure->set_promise_value(ret);
         std::cout << "table id: " << table_id
                   << ", feasign size: " << feasign_size
-                  << ", mf size: " << mf_size << std::endl;
+                  << ", mf size: " << mf_size
+                  << ", reserved bytes: " << reserved_bytes
+                  << ", used bytes: " << used_bytes << std::endl;
       });
   auto promise = std::make_shared<std::promise<int32_t>>();
   closure->add_promise(promise);
@@ -1042,6 +1125,7 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradient(
 
     size_t kv_size = kvs.size();
     uint32_t value_size = accessor->GetAccessorInfo().update_size;
+    size_t wire_size = accessor->UpdateWireSize();
 
     // 发送RPC请求
     auto *push_request = closure->request(shard_idx);
@@ -1049,15 +1133,17 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradient(
     push_request->set_table_id(table_id);
     push_request->set_client_id(_client_id);
     push_request->add_params((char *)&kv_size, sizeof(uint32_t));  // NOLINT
-    auto *push_data = push_request->mutable_data();
-    push_data->resize(kv_size * (sizeof(uint64_t) + value_size));
-    char *push_data_ptr = const_cast<char *>(push_data->data());
+    char *push_data_ptr =
+        push_sparse_payload(push_request,
+                            closure->cntl(shard_idx),
+                            kv_size * (sizeof(uint64_t) + wire_size));
     memcpy(push_data_ptr, kvs.data(), kv_size * sizeof(uint64_t));
     push_data_ptr += kv_size * sizeof(uint64_t);
 
     for (size_t i = 0; i < kv_size; ++i) {
-      memcpy(push_data_ptr, value_ptr[i], value_size);
-      push_data_ptr += value_size;
+      write_update_value(
+          push_data_ptr, accessor, value_size, wire_size, value_ptr[i]);
+      push_data_ptr += wire_size;
     }
     PsService_Stub rpc_stub(GetSparseChannel(shard_idx));
     closure->cntl(shard_idx)->set_request_compress_type(
@@ -1138,6 +1224,107 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
                                               const uint64_t *keys,
                                               size_t num,
                                               bool is_training) {
+  if (FLAGS_pserver_pull_sparse_coalesce && num > 0 &&
+      num < static_cast<size_t>(FLAGS_pserver_pull_sparse_coalesce_max_keys)) {
+    return CoalescePullSparse(select_values, table_id, keys, num, is_training);
+  }
+  auto promise = std::make_shared<std::promise<int32_t>>();
+  std::future<int> fut = promise->get_future();
+  PullSparseImpl(select_values, table_id, keys, num, is_training, {promise});
+  return fut;
+}
+
+std::future<int32_t> BrpcPsClient::CoalescePullSparse(float **select_values,
+                                                      size_t table_id,
+                                                      const uint64_t *keys,
+                                                      size_t num,
+                                                      bool is_training) {
+  std::shared_ptr<PullSparseCoalescer> coalescer;
+  {
+    std::lock_guard<std::mutex> lock(_pull_coalescer_mutex);
+    auto &slot = _pull_coalescers[table_id * 2 + (is_training ? 1 : 0)];
+    if (slot == nullptr) {
+      slot = std::make_shared<PullSparseCoalescer>();
+    }
+    coalescer = slot;
+  }
+  auto promise = std::make_shared<std::promise<int32_t>>();
+  std::future<int> fut = promise->get_future();
+  size_t max_keys = FLAGS_pserver_pull_sparse_coalesce_max_keys;
+
+  coalescer->queued.fetch_add(1);
+  std::unique_lock<std::mutex> lock(coalescer->mutex);
+  coalescer->queued.fetch_sub(1);
+  ++coalescer->call_num;
+  if (coalescer->batch != nullptr) {
+    // join the open batch, its leader sends it
+    auto &batch = *coalescer->batch;
+    batch.keys.insert(batch.keys.end(), keys, keys + num);
+    batch.select_values.insert(
+        batch.select_values.end(), select_values, select_values + num);
+    batch.promises.push_back(promise);
+    if (batch.keys.size() >= max_keys) {
+      coalescer->cond.notify_all();
+    }
+    return fut;
+  }
+
+  auto batch = std::make_shared<PullSparseBatch>();
+  batch->keys.assign(keys, keys + num);
+  batch->select_values.assign(select_values, select_values + num);
+  batch->promises.push_back(promise);
+  if (coalescer->queued.load() > 0) {
+    // others are about to join, keep the batch open for them
+    coalescer->batch = batch;
+    coalescer->cond.wait_for(
+        lock,
+        std::chrono::microseconds(FLAGS_pserver_pull_sparse_coalesce_window_us),
+        [&batch, max_keys] { return batch->keys.size() >= max_keys; });
+    coalescer->batch = nullptr;
+  }
+  ++coalescer->request_num;
+  lock.unlock();
+
+  VLOG(3) << "pull_sparse table " << table_id << " merged "
+          << batch->promises.size() << " calls, " << batch->keys.size()
+          << " keys";
+  PullSparseImpl(batch->select_values.data(),
+                 table_id,
+                 batch->keys.data(),
+                 batch->keys.size(),
+                 is_training,
+                 batch->promises);
+  return fut;
+}
+
+void BrpcPsClient::GetPullSparseCoalesceStat(size_t table_id,
+                                             bool is_training,
+                                             uint64_t *call_num,
+                                             uint64_t *request_num) {
+  std::shared_ptr<PullSparseCoalescer> coalescer;
+  {
+    std::lock_guard<std::mutex> lock(_pull_coalescer_mutex);
+    auto it = _pull_coalescers.find(table_id * 2 + (is_training ? 1 : 0));
+    if (it != _pull_coalescers.end()) {
+      coalescer = it->second;
+    }
+  }
+  *call_num = 0;
+  *request_num = 0;
+  if (coalescer != nullptr) {
+    std::lock_guard<std::mutex> lock(coalescer->mutex);
+    *call_num = coalescer->call_num;
+    *request_num = coalescer->request_num;
+  }
+}
+
+void BrpcPsClient::PullSparseImpl(
+    float **select_values,
+    size_t table_id,
+    const uint64_t *keys,
+    size_t num,
+    bool is_training,
+    const std::vector<std::shared_ptr<std::promise<int32_t>>> &promises) {
   auto timer = std::make_shared<CostTimer>("pserver_client_pull_sparse");
   auto local_timer =
       std::make_shared<CostTimer>("pserver_client_pull_sparse_local");
@@ -1165,9 +1352,11 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
   auto *accessor = GetTableAccessor(table_id);
 
   size_t value_size = accessor->GetAccessorInfo().select_size;
+  size_t wire_size = accessor->SelectWireSize();
 
   DownpourBrpcClosure *closure = new DownpourBrpcClosure(
-      request_call_num, [shard_sorted_kvs, value_size](void *done) {
+      request_call_num,
+      [shard_sorted_kvs, accessor, value_size, wire_size](void *done) {
         int ret = 0;
         auto *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
         for (size_t i = 0; i < shard_sorted_kvs->size(); ++i) {
@@ -1190,9 +1379,11 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
             } else {
               last_key = kv_pair.first;
               last_value_data = kv_pair.second;
-              if (value_size !=
-                  io_buffer_itr.copy_and_forward(
-                      reinterpret_cast<void *>(last_value_data), value_size)) {
+              if (!read_select_value(&io_buffer_itr,
+                                     accessor,
+                                     value_size,
+                                     wire_size,
+                                     last_value_data)) {
                 LOG(WARNING) << "res data is lack or not in format";
                 ret = -1;
                 break;
@@ -1203,9 +1394,9 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
         closure->set_promise_value(ret);
       });
   closure->add_timer(timer);
-  auto promise = std::make_shared<std::promise<int32_t>>();
-  closure->add_promise(promise);
-  std::future<int> fut = promise->get_future();
+  for (auto promise : promises) {
+    closure->add_promise(promise);
+  }
 
   for (size_t i = 0; i < request_call_num; ++i) {
     auto &sorted_kvs = shard_sorted_kvs->at(i);
@@ -1221,7 +1412,18 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
     size_t sorted_kv_size = sorted_kvs.size();
     auto &request_buffer = closure->cntl(i)->request_attachment();
 
-    request_buffer.append(reinterpret_cast<void *>(&is_training), sizeof(bool));
+    // in attachment mode the request is written into one user block
+    // instead of an IOBuf append per key
+    char *request_data = nullptr;
+    if (use_sparse_attachment_payload() && sorted_kv_size > 0) {
+      request_data = static_cast<char *>(
+          malloc(sizeof(bool) +
+                 sorted_kv_size * (sizeof(uint64_t) + sizeof(uint32_t))));
+      memcpy(request_data, &is_training, sizeof(bool));
+    } else {
+      request_buffer.append(reinterpret_cast<void *>(&is_training),
+                            sizeof(bool));
+    }
     std::vector<uint32_t> keys_counter;
     keys_counter.reserve(sorted_kv_size);
 
@@ -1229,8 +1431,15 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
       ++kv_request_count;
       uint32_t keys = 1;
       last_key = sorted_kvs[kv_idx].first;
-      request_buffer.append(reinterpret_cast<void *>(&last_key),
-                            sizeof(uint64_t));
+      if (request_data != nullptr) {
+        memcpy(request_data + sizeof(bool) +
+                   (kv_request_count - 1) * sizeof(uint64_t),
+               &last_key,
+               sizeof(uint64_t));
+      } else {
+        request_buffer.append(reinterpret_cast<void *>(&last_key),
+                              sizeof(uint64_t));
+      }
       while (kv_idx < sorted_kv_size - 1 &&
              last_key == sorted_kvs[kv_idx + 1].first) {
         ++kv_idx;
@@ -1239,8 +1448,19 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
       keys_counter.push_back(keys);
     }
 
-    request_buffer.append(reinterpret_cast<void *>(keys_counter.data()),
-                          sizeof(uint32_t) * keys_counter.size());
+    if (request_data != nullptr) {
+      size_t keys_size = sizeof(bool) + kv_request_count * sizeof(uint64_t);
+      memcpy(request_data + keys_size,
+             keys_counter.data(),
+             sizeof(uint32_t) * keys_counter.size());
+      request_buffer.append_user_data(
+          request_data,
+          keys_size + sizeof(uint32_t) * keys_counter.size(),
+          free);
+    } else {
+      request_buffer.append(reinterpret_cast<void *>(keys_counter.data()),
+                            sizeof(uint32_t) * keys_counter.size());
+    }
 
     if (kv_request_count == 0) {
       closure->Run();
@@ -1256,7 +1476,6 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
           closure->cntl(i), closure->request(i), closure->response(i), closure);
     }
   }
-  return fut;
 }
 
 // for GEO
@@ -1279,8 +1498,10 @@ std::future<int32_t> BrpcPsClient::PullSparseParam(float **select_values,
 
   auto *accessor = GetTableAccessor(table_id);
   size_t value_size = accessor->GetAccessorInfo().select_size;
+  size_t wire_size = accessor->SelectWireSize();
   DownpourBrpcClosure *closure = new DownpourBrpcClosure(
-      request_call_num, [shard_sorted_kvs, value_size](void *done) {
+      request_call_num,
+      [shard_sorted_kvs, accessor, value_size, wire_size](void *done) {
         int ret = 0;
         auto *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
         for (size_t i = 0; i < shard_sorted_kvs->size(); ++i) {
@@ -1304,9 +1525,11 @@ std::future<int32_t> BrpcPsClient::PullSparseParam(float **select_values,
             } else {
               last_key = kv_pair.first;
               last_value_data = kv_pair.second;
-              if (value_size !=
-                  io_buffer_itr.copy_and_forward(
-                      reinterpret_cast<void *>(last_value_data), value_size)) {
+              if (!read_select_value(&io_buffer_itr,
+                                     accessor,
+                                     value_size,
+                                     wire_size,
+                                     last_value_data)) {
                 LOG(WARNING) << "res data is lack or not in format";
                 ret = -1;
                 break;
@@ -1409,6 +1632,7 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradientPartial(
     int pserver_idx) {
   auto *accessor = GetTableAccessor(table_id);
   size_t value_size = accessor->GetAccessorInfo().update_size;
+  size_t wire_size = accessor->UpdateWireSize();
   DownpourBrpcClosure *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
   auto promise = std::make_shared<std::promise<int32_t>>();
   closure->add_promise(promise);
@@ -1420,14 +1644,14 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradientPartial(
   push_request->set_table_id(table_id);
   push_request->set_client_id(_client_id);
   push_request->add_params((char *)&num, sizeof(uint32_t));  // NOLINT
-  auto *push_data = push_request->mutable_data();
-  push_data->resize(num * (sizeof(uint64_t) + value_size));
-  char *push_data_ptr = const_cast<char *>(push_data->data());
+  char *push_data_ptr = push_sparse_payload(
+      push_request, closure->cntl(0), num * (sizeof(uint64_t) + wire_size));
   memcpy(push_data_ptr, keys, num * sizeof(uint64_t));
   push_data_ptr += num * sizeof(uint64_t);
   for (uint32_t i = 0; i < num; ++i) {
-    memcpy(push_data_ptr, update_values[i], value_size);
-    push_data_ptr += value_size;
+    write_update_value(
+        push_data_ptr, accessor, value_size, wire_size, update_values[i]);
+    push_data_ptr += wire_size;
   }
   PsService_Stub rpc_stub(GetSparseChannel(pserver_idx));
   closure->cntl(0)->set_request_compress_type(
@@ -1854,10 +2078,12 @@ int BrpcPsClient::PushSparseAsyncShardPush(
   push_request->set_client_id(_client_id);
   push_request->add_params(reinterpret_cast<char *>(&merged_kv_count),
                            sizeof(uint32_t));  // NOLINT
-  auto *push_data = push_request->mutable_data();
   int update_size = accessor->GetAccessorInfo().update_size;
-  push_data->resize(merged_kv_count * (sizeof(uint64_t) + update_size));
-  char *push_data_ptr = const_cast<char *>(push_data->data());
+  size_t wire_size = accessor->UpdateWireSize();
+  char *push_data_ptr =
+      push_sparse_payload(push_request,
+                          closure->cntl(shard_idx),
+                          merged_kv_count * (sizeof(uint64_t) + wire_size));
   memcpy(push_data_ptr,
          merged_key_list.data(),
          merged_kv_count * sizeof(uint64_t));
@@ -1865,10 +2091,12 @@ int BrpcPsClient::PushSparseAsyncShardPush(
   for (size_t i = 0; i < merged_kv_count; ++i) {
     const char *task_data_ptr = merged_value_list[i].data();
 
-    memcpy(push_data_ptr,
-           (float *)(task_data_ptr),  // NOLINT
-           update_size);
-    push_data_ptr += update_size;
+    write_update_value(push_data_ptr,
+                       accessor,
+                       update_size,
+                       wire_size,
+                       (const float *)(task_data_ptr));  // NOLINT
+    push_data_ptr += wire_size;
   }
   PsService_Stub rpc_stub(GetSparseChannel(shard_idx));
   closure->cntl(shard_idx)->set_request_compress_type(
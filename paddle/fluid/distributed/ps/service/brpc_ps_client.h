@@ -16,7 +16,10 @@
 
 #include <ThreadPool.h>
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <vector>
 
@@ -193,6 +196,25 @@ struct SparseTaskPool {
   std::mutex _mutex;
 };
 
+// pull sparse calls of one table merged into a single request
+struct PullSparseBatch {
+  std::vector<uint64_t> keys;
+  std::vector<float *> select_values;
+  std::vector<std::shared_ptr<std::promise<int32_t>>> promises;
+};
+
+// the open batch of a table, the first caller waits up to
+// FLAGS_pserver_pull_sparse_coalesce_window_us for others to join and sends,
+// it sends at once if no other caller is queued on the mutex
+struct PullSparseCoalescer {
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::shared_ptr<PullSparseBatch> batch;
+  std::atomic<int> queued{0};  // callers not in a batch yet
+  uint64_t call_num = 0;       // guarded by mutex
+  uint64_t request_num = 0;    // guarded by mutex
+};
+
 template <class T>
 struct array_deleter {
   void operator()(T *&x) const { delete[] x; }  // NOLINT
@@ -316,6 +338,13 @@ class BrpcPsClient : public PSClient {
   void PrintQueueSize();
   void PrintQueueSizeThread();
 
+  // pull_sparse calls of a table that went through the coalescer and the
+  // requests they were merged into
+  void GetPullSparseCoalesceStat(size_t table_id,
+                                 bool is_training,
+                                 uint64_t *call_num,
+                                 uint64_t *request_num);
+
  protected:
   virtual size_t GetServerNums() { return _server_channels.size(); }
   inline brpc::Channel *GetSparseChannel(size_t server_id) {
@@ -351,6 +380,25 @@ class BrpcPsClient : public PSClient {
                                    int cmd_id,
                                    const std::vector<std::string> &param);
 
+  // sends one deduplicated request per server and resolves all promises
+  void PullSparseImpl(
+      float **select_values,
+      size_t table_id,
+      const uint64_t *keys,
+      size_t num,
+      bool is_training,
+      const std::vector<std::shared_ptr<std::promise<int32_t>>> &promises);
+
+  std::future<int32_t> CoalescePullSparse(float **select_values,
+                                          size_t table_id,
+                                          const uint64_t *keys,
+                                          size_t num,
+                                          bool is_training);
+
+  std::mutex _pull_coalescer_mutex;
+  std::unordered_map<uint64_t, std::shared_ptr<PullSparseCoalescer>>
+      _pull_coalescers;  // table_id * 2 + is_training
+
   bool _running = false;
   bool _flushing = false;
   std::atomic<uint32_t> _async_call_num;  // 异步请求计数
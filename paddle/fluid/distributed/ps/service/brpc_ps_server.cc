@@ -37,9 +37,26 @@ PD_DEFINE_int32(pserver_connect_timeout_ms_s2s,
 PD_DEFINE_string(pserver_connection_type_s2s,
                  "pooled",
                  "pserver connection_type[pooled:single]");
+PD_DEFINE_bool(pserver_sparse_attachment_payload,
+               false,
+               "carry sparse pull/push payloads in the brpc attachment "
+               "instead of the protobuf message, which skips its serialize "
+               "and parse copies");
 
 namespace paddle::distributed {
 
+// Contiguous view of a request attachment. An attachment held in one block
+// is read in place, otherwise it is gathered into buffer.
+static const char *AttachmentData(const butil::IOBuf &io_buffer,
+                                  std::string *buffer) {
+  if (io_buffer.backing_block_num() == 1) {
+    return io_buffer.backing_block(0).data();
+  }
+  buffer->resize(io_buffer.size());
+  io_buffer.copy_to(&(*buffer)[0], io_buffer.size());
+  return buffer->data();
+}
+
 int32_t BrpcPsServer::Initialize() {
   auto &service_config = _config.downpour_server_param().service_param();
   if (!service_config.has_service_class()) {
@@ -525,25 +542,61 @@ int32_t BrpcPsService::PullSparse(Table *table,
   CostTimer timer("pserver_server_pull_sparse");
   const uint32_t num =
       *(reinterpret_cast<const uint32_t *>(request.params(0).c_str()));
-  auto dim = table->GetValueAccessor()->GetAccessorInfo().select_dim;
+  auto *accessor = table->GetValueAccessor();
+  auto dim = accessor->GetAccessorInfo().select_dim;
+  size_t wire_size = accessor->SelectWireSize();
 
   thread_local std::string req_buffer;
-  req_buffer.reserve(req_buffer_size);
-
-  const void *data = cntl->request_attachment().fetch(
-      const_cast<char *>(req_buffer.data()), req_buffer_size);
+  const char *data = AttachmentData(req_io_buffer, &req_buffer);
 
   auto value = PullSparseValue(num, dim);
 
-  value.DeserializeFromBytes(const_cast<void *>(data));
+  value.DeserializeFromBytes(const_cast<char *>(data));
 
-  auto res_data = butil::get_object<std::vector<float>>();
-  res_data->resize(num * dim);
   TableContext table_context;
   table_context.value_type = Sparse;
   table_context.pull_context.pull_value = value;
+  size_t res_size = static_cast<size_t>(num) * dim * sizeof(float);
+  if (wire_size != dim * sizeof(float) && num > 0) {
+    // the accessor packs pull values on the wire, they are encoded into a
+    // block handed to the attachment
+    auto res_data = butil::get_object<std::vector<float>>();
+    res_data->resize(num * dim);
+    table_context.pull_context.values = res_data->data();
+    if (table->Pull(table_context) != 0) {
+      butil::return_object(res_data);
+      set_response_code(response, -1, "PullSparse error");
+      return 0;
+    }
+    char *wire = static_cast<char *>(malloc(num * wire_size));
+    for (size_t i = 0; i < num; ++i) {
+      accessor->EncodeSelect(wire + i * wire_size, res_data->data() + i * dim);
+    }
+    butil::return_object(res_data);
+    cntl->response_attachment().append_user_data(wire, num * wire_size, free);
+    return 0;
+  }
+  if (FLAGS_pserver_sparse_attachment_payload && res_size > 0) {
+    // the table writes into the block brpc sends from
+    float *res_data = static_cast<float *>(malloc(res_size));
+    table_context.pull_context.values = res_data;
+    if (table->Pull(table_context) != 0) {
+      free(res_data);
+      set_response_code(response, -1, "PullSparse error");
+      return 0;
+    }
+    cntl->response_attachment().append_user_data(res_data, res_size, free);
+    return 0;
+  }
+
+  auto res_data = butil::get_object<std::vector<float>>();
+  res_data->resize(num * dim);
   table_context.pull_context.values = res_data->data();
-  table->Pull(table_context);
+  if (table->Pull(table_context) != 0) {
+    butil::return_object(res_data);
+    set_response_code(response, -1, "PullSparse error");
+    return 0;
+  }
   // table->PullSparse(res_data->data(), value);
 
   cntl->response_attachment().append(reinterpret_cast<char *>(res_data->data()),
@@ -559,10 +612,16 @@ int32_t BrpcPsService::PushSparse(Table *table,
   phi::RecordEvent record_event(
       "PsService->PushSparse", phi::TracerEventType::Communication, 1);
   CHECK_TABLE_EXIST(table, request, response)
-  auto &push_data = request.data();
-  if (push_data.empty()) {
-    // set_response_code(response, 0, "push sparse data is empty");
-    return 0;
+  // with FLAGS_pserver_sparse_attachment_payload the payload comes in the
+  // attachment instead of the message
+  thread_local std::string push_buffer;
+  const char *push_data = request.data().data();
+  if (request.data().empty()) {
+    if (cntl->request_attachment().empty()) {
+      // set_response_code(response, 0, "push sparse data is empty");
+      return 0;
+    }
+    push_data = AttachmentData(cntl->request_attachment(), &push_buffer);
   }
   if (request.params_size() < 1) {
     set_response_code(response,
@@ -581,13 +640,24 @@ int32_t BrpcPsService::PushSparse(Table *table,
   */
   TableContext table_context;
   table_context.value_type = Sparse;
-  table_context.push_context.keys = (const uint64_t *)push_data.data();
+  table_context.push_context.keys = (const uint64_t *)push_data;
   table_context.push_context.values =
-      (const float *)(push_data.data() + sizeof(uint64_t) * num);
+      (const float *)(push_data + sizeof(uint64_t) * num);
+  auto *accessor = table->GetValueAccessor();
+  size_t update_dim = accessor->GetAccessorInfo().update_dim;
+  size_t wire_size = accessor->UpdateWireSize();
+  if (wire_size != update_dim * sizeof(float)) {
+    // push values packed by the accessor are decoded before the update
+    thread_local std::vector<float> update_buffer;
+    update_buffer.resize(num * update_dim);
+    const char *wire = push_data + sizeof(uint64_t) * num;
+    for (size_t i = 0; i < num; ++i) {
+      accessor->DecodeUpdate(update_buffer.data() + i * update_dim,
+                             wire + i * wire_size);
+    }
+    table_context.push_context.values = update_buffer.data();
+  }
   table_context.num = num;
-  // const uint64_t *keys = (const uint64_t *)push_data.data();
-  // const float *values = (const float *)(push_data.data() + sizeof(uint64_t) *
-  // num);
   if (table->Push(table_context) != 0) {
     // if (table->PushSparse(keys, values, num) != 0) {
     set_response_code(response, -1, "PushSparse error");
@@ -601,8 +671,9 @@ int32_t BrpcPsService::PrintTableStat(Table *table,
                                       brpc::Controller *cntl) {
   CHECK_TABLE_EXIST(table, request, response)
   std::pair<int64_t, int64_t> ret = table->PrintTableStat();
+  std::pair<int64_t, int64_t> mem = table->PrintTableMemoryStat();
   ::paddle::framework::BinaryArchive ar;
-  ar << ret.first << ret.second;
+  ar << ret.first << ret.second << mem.first << mem.second;
   std::string table_info(ar.Buffer(), ar.Length());
   response.set_data(table_info);
 
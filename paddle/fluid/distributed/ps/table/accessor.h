@@ -15,6 +15,7 @@
 #pragma once
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <unordered_map>
 #include <vector>
@@ -151,6 +152,24 @@ class ValueAccessor {
                          const float** update_values,
                          size_t num) = 0;
 
+  // pull and push values as sent between client and server. An accessor
+  // that compresses them encodes on one side and decodes on the other, by
+  // default they are sent as is.
+  virtual size_t SelectWireSize() { return _accessor_info.select_size; }
+  virtual void EncodeSelect(char* wire, const float* select_value) {
+    memcpy(wire, select_value, _accessor_info.select_size);
+  }
+  virtual void DecodeSelect(float* select_value, const char* wire) {
+    memcpy(select_value, wire, _accessor_info.select_size);
+  }
+  virtual size_t UpdateWireSize() { return _accessor_info.update_size; }
+  virtual void EncodeUpdate(char* wire, const float* update_value) {
+    memcpy(wire, update_value, _accessor_info.update_size);
+  }
+  virtual void DecodeUpdate(float* update_value, const char* wire) {
+    memcpy(update_value, wire, _accessor_info.update_size);
+  }
+
   // used to save model, will filter feature
   virtual std::string ParseToString(const float* value, int param) = 0;
   //  parse value from string, used to load model
@@ -204,5 +223,41 @@ class ValueAccessor {
   AccessorInfo _accessor_info;
 };
 REGISTER_PSCORE_REGISTERER(ValueAccessor);
+
+// Gathers in place updates of stored values and applies them through
+// ValueAccessor::Update in batches, so the sgd rules update many keys per
+// call. The values must stay in place until they are flushed. Values of
+// the sparse table shards are allocated by ChunkAllocator and are not moved
+// by inserting other keys, only resizing a value may move its data, so
+// callers flush before they resize or copy a batched value.
+class ValueUpdateBatcher {
+ public:
+  static constexpr size_t kBatchSize = 64;
+
+  explicit ValueUpdateBatcher(ValueAccessor* accessor)
+      : _accessor(accessor) {}
+  ~ValueUpdateBatcher() { Flush(); }
+
+  void Add(float* value, const float* update_value) {
+    _values[_num] = value;
+    _update_values[_num] = update_value;
+    if (++_num == kBatchSize) {
+      Flush();
+    }
+  }
+
+  void Flush() {
+    if (_num > 0) {
+      _accessor->Update(_values, _update_values, _num);
+      _num = 0;
+    }
+  }
+
+ private:
+  ValueAccessor* _accessor;
+  float* _values[kBatchSize];
+  const float* _update_values[kBatchSize];
+  size_t _num = 0;
+};
 }  // namespace distributed
 }  // namespace paddle
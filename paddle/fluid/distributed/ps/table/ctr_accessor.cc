@@ -14,6 +14,8 @@
 
 #include "paddle/fluid/distributed/ps/table/ctr_accessor.h"
 
+#include <algorithm>
+
 #include "glog/logging.h"
 #include "paddle/common/flags.h"
 #include "paddle/fluid/platform/enforce.h"
@@ -246,35 +248,50 @@ int32_t CtrCommonAccessor::Merge(float** update_values,
 int32_t CtrCommonAccessor::Update(float** update_values,
                                   const float** push_values,
                                   size_t num) {
-  for (size_t value_item = 0; value_item < num; ++value_item) {
-    float* update_value = update_values[value_item];
-    const float* push_value = push_values[value_item];
-    float push_show = push_value[CtrCommonPushValue::ShowIndex()];
-    float push_click = push_value[CtrCommonPushValue::ClickIndex()];
-    float slot = push_value[CtrCommonPushValue::SlotIndex()];
-    update_value[common_feature_value.ShowIndex()] += push_show;
-    update_value[common_feature_value.ClickIndex()] += push_click;
-    update_value[common_feature_value.SlotIndex()] = slot;
-    update_value[common_feature_value.DeltaScoreIndex()] +=
-        (push_show - push_click) * _config.ctr_accessor_param().nonclk_coeff() +
-        push_click * _config.ctr_accessor_param().click_coeff();
-    update_value[common_feature_value.UnseenDaysIndex()] = 0;
-    // TODO(zhaocaibei123): add configure show_scale
-    if (!_show_scale) {
-      push_show = 1;
+  // the sgd rules run over batches of keys, so their kernels and virtual
+  // dispatch are resolved once per batch instead of once per key
+  constexpr size_t kBatch = 64;
+  float* embed_w[kBatch];
+  float* embed_sgd[kBatch];
+  const float* embed_g[kBatch];
+  float* embedx_w[kBatch];
+  float* embedx_sgd[kBatch];
+  const float* embedx_g[kBatch];
+  float scales[kBatch];
+  for (size_t begin = 0; begin < num; begin += kBatch) {
+    size_t batch = std::min(kBatch, num - begin);
+    for (size_t k = 0; k < batch; ++k) {
+      float* update_value = update_values[begin + k];
+      const float* push_value = push_values[begin + k];
+      float push_show = push_value[CtrCommonPushValue::ShowIndex()];
+      float push_click = push_value[CtrCommonPushValue::ClickIndex()];
+      float slot = push_value[CtrCommonPushValue::SlotIndex()];
+      update_value[common_feature_value.ShowIndex()] += push_show;
+      update_value[common_feature_value.ClickIndex()] += push_click;
+      update_value[common_feature_value.SlotIndex()] = slot;
+      update_value[common_feature_value.DeltaScoreIndex()] +=
+          (push_show - push_click) *
+              _config.ctr_accessor_param().nonclk_coeff() +
+          push_click * _config.ctr_accessor_param().click_coeff();
+      update_value[common_feature_value.UnseenDaysIndex()] = 0;
+      // TODO(zhaocaibei123): add configure show_scale
+      if (!_show_scale) {
+        push_show = 1;
+      }
+      VLOG(3) << "accessor show scale:" << _show_scale
+              << ", push_show:" << push_show;
+      embed_w[k] = update_value + common_feature_value.EmbedWIndex();
+      embed_sgd[k] = update_value + common_feature_value.EmbedG2SumIndex();
+      embed_g[k] = push_value + CtrCommonPushValue::EmbedGIndex();
+      embedx_w[k] = update_value + common_feature_value.EmbedxWIndex();
+      embedx_sgd[k] = update_value + common_feature_value.EmbedxG2SumIndex();
+      embedx_g[k] = push_value + CtrCommonPushValue::EmbedxGIndex();
+      scales[k] = push_show;
     }
-    VLOG(3) << "accessor show scale:" << _show_scale
-            << ", push_show:" << push_show;
-    _embed_sgd_rule->UpdateValue(
-        update_value + common_feature_value.EmbedWIndex(),
-        update_value + common_feature_value.EmbedG2SumIndex(),
-        push_value + CtrCommonPushValue::EmbedGIndex(),
-        push_show);
-    _embedx_sgd_rule->UpdateValue(
-        update_value + common_feature_value.EmbedxWIndex(),
-        update_value + common_feature_value.EmbedxG2SumIndex(),
-        push_value + CtrCommonPushValue::EmbedxGIndex(),
-        push_show);
+    _embed_sgd_rule->UpdateValueBatch(
+        embed_w, embed_sgd, embed_g, scales, batch);
+    _embedx_sgd_rule->UpdateValueBatch(
+        embedx_w, embedx_sgd, embedx_g, scales, batch);
   }
   return 0;
 }
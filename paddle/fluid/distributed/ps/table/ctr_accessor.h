@@ -187,7 +187,7 @@ class CtrCommonAccessor : public ValueAccessor {
     return 0.0;
   }
 
- private:
+ protected:
   // float ShowClickScore(float show, float click);
 
   // SparseValueSGDRule* _embed_sgd_rule;
@@ -0,0 +1,362 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/table/ctr_quant_accessor.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/fluid/distributed/common/local_random.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/phi/common/float16.h"
+#include "paddle/utils/string/string_helper.h"
+
+namespace paddle::distributed {
+
+int CtrQuantAccessor::QuantSlots(int bits, int dim) {
+  if (bits == 16) {
+    return (dim + 1) / 2;
+  }
+  // scale, then 4 int8 per slot
+  return 1 + (dim + 3) / 4;
+}
+
+// rounds x to floor(x) or floor(x) + 1, with the probability of its distance
+// to the other one, so the rounding error is zero in expectation
+static float StochasticRound(float x) {
+  float floor_x = floorf(x);
+  return floor_x + (uniform_real<float>() < x - floor_x ? 1 : 0);
+}
+
+// rounds w to one of its two fp16 neighbours in the same way
+static uint16_t StochasticHalf(float w) {
+  uint16_t half = phi::dtype::float16(w).x;
+  float nearest = static_cast<float>(phi::dtype::raw_uint16_to_float16(half));
+  if (nearest == w || !std::isfinite(nearest)) {
+    return half;
+  }
+  // the other half neighbour of w, in raw bits the magnitude is monotonic
+  uint16_t other = fabsf(w) > fabsf(nearest) ? half + 1 : half - 1;
+  float other_w = static_cast<float>(phi::dtype::raw_uint16_to_float16(other));
+  if (!std::isfinite(other_w)) {
+    return half;
+  }
+  float p = (w - nearest) / (other_w - nearest);
+  return uniform_real<float>() < p ? other : half;
+}
+
+void CtrQuantAccessor::Quantize(
+    int bits, const float* w, int dim, float* packed, bool stochastic) {
+  int slots = QuantSlots(bits, dim);
+  if (bits == 16) {
+    uint16_t* half = reinterpret_cast<uint16_t*>(packed);
+    for (int i = 0; i < dim; ++i) {
+      half[i] = stochastic ? StochasticHalf(w[i]) : phi::dtype::float16(w[i]).x;
+    }
+    int half_num = slots * sizeof(float) / sizeof(uint16_t);
+    for (int i = dim; i < half_num; ++i) {
+      half[i] = 0;
+    }
+    return;
+  }
+  float max_abs = 0;
+  for (int i = 0; i < dim; ++i) {
+    max_abs = std::max(max_abs, fabsf(w[i]));
+  }
+  float scale = max_abs / 127;
+  packed[0] = scale;
+  int8_t* q = reinterpret_cast<int8_t*>(packed + 1);
+  for (int i = 0; i < dim; ++i) {
+    float v = 0;
+    if (scale > 0) {
+      v = stochastic ? StochasticRound(w[i] / scale) : rintf(w[i] / scale);
+    }
+    q[i] = static_cast<int8_t>(std::min(127.0f, std::max(-127.0f, v)));
+  }
+  int byte_num = (slots - 1) * sizeof(float);
+  for (int i = dim; i < byte_num; ++i) {
+    q[i] = 0;
+  }
+}
+
+void CtrQuantAccessor::Dequantize(int bits,
+                                  const float* packed,
+                                  int dim,
+                                  float* w) {
+  if (bits == 16) {
+    const uint16_t* half = reinterpret_cast<const uint16_t*>(packed);
+    for (int i = 0; i < dim; ++i) {
+      w[i] = static_cast<float>(phi::dtype::raw_uint16_to_float16(half[i]));
+    }
+    return;
+  }
+  float scale = packed[0];
+  const int8_t* q = reinterpret_cast<const int8_t*>(packed + 1);
+  for (int i = 0; i < dim; ++i) {
+    w[i] = q[i] * scale;
+  }
+}
+
+int CtrQuantAccessor::Initialize() {
+  CtrCommonAccessor::Initialize();
+  _quant_bits = _config.ctr_accessor_param().embedx_quant_bits();
+  PADDLE_ENFORCE_EQ(
+      _quant_bits == 16 || _quant_bits == 8,
+      true,
+      common::errors::InvalidArgument(
+          "embedx_quant_bits of CtrQuantAccessor should be 16 or 8, but got "
+          "%d.",
+          _quant_bits));
+  _embedx_dim = _config.embedx_dim();
+  _quant_slots = QuantSlots(_quant_bits, _embedx_dim);
+  common_feature_value.embedx_dim = _quant_slots;
+  InitAccessorInfo();
+  VLOG(1) << "CtrQuantAccessor embedx_dim " << _embedx_dim << " stored in "
+          << _quant_bits << " bits, value dim " << _accessor_info.dim;
+  return 0;
+}
+
+void CtrQuantAccessor::InitAccessorInfo() {
+  CtrCommonAccessor::InitAccessorInfo();
+  _accessor_info.mf_size =
+      (common_feature_value.embedx_dim + common_feature_value.embedx_sgd_dim) *
+      sizeof(float);
+}
+
+int32_t CtrQuantAccessor::Create(float** values, size_t num) {
+  thread_local std::vector<float> embedx_w;
+  embedx_w.resize(_embedx_dim);
+  bool zero_init = _config.ctr_accessor_param().zero_init();
+  for (size_t value_item = 0; value_item < num; ++value_item) {
+    float* value = values[value_item];
+    value[common_feature_value.UnseenDaysIndex()] = 0;
+    value[common_feature_value.DeltaScoreIndex()] = 0;
+    value[common_feature_value.ShowIndex()] = 0;
+    value[common_feature_value.ClickIndex()] = 0;
+    value[common_feature_value.SlotIndex()] = -1;
+    _embed_sgd_rule->InitValue(value + common_feature_value.EmbedWIndex(),
+                               value + common_feature_value.EmbedG2SumIndex(),
+                               zero_init);
+    _embedx_sgd_rule->InitValue(embedx_w.data(),
+                                value + common_feature_value.EmbedxG2SumIndex(),
+                                false);
+    Quantize(_quant_bits,
+             embedx_w.data(),
+             _embedx_dim,
+             value + common_feature_value.EmbedxWIndex());
+  }
+  return 0;
+}
+
+// from the stored value to CtrCommonPullValue
+int32_t CtrQuantAccessor::Select(float** select_values,
+                                 const float** values,
+                                 size_t num) {
+  for (size_t value_item = 0; value_item < num; ++value_item) {
+    float* select_value = select_values[value_item];
+    const float* value = values[value_item];
+    select_value[CtrCommonPullValue::ShowIndex()] =
+        value[common_feature_value.ShowIndex()];
+    select_value[CtrCommonPullValue::ClickIndex()] =
+        value[common_feature_value.ClickIndex()];
+    select_value[CtrCommonPullValue::EmbedWIndex()] =
+        value[common_feature_value.EmbedWIndex()];
+    Dequantize(_quant_bits,
+               value + common_feature_value.EmbedxWIndex(),
+               _embedx_dim,
+               select_value + CtrCommonPullValue::EmbedxWIndex());
+  }
+  return 0;
+}
+
+// from CtrCommonPushValue to the stored value, the embedx weights of a batch
+// are dequantized into a buffer for the sgd rule and quantized back
+int32_t CtrQuantAccessor::Update(float** update_values,
+                                 const float** push_values,
+                                 size_t num) {
+  constexpr size_t kBatch = 64;
+  float* embed_w[kBatch];
+  float* embed_sgd[kBatch];
+  const float* embed_g[kBatch];
+  float* embedx_w[kBatch];
+  float* embedx_sgd[kBatch];
+  const float* embedx_g[kBatch];
+  float scales[kBatch];
+  thread_local std::vector<float> embedx_buffer;
+  embedx_buffer.resize(kBatch * _embedx_dim);
+  for (size_t begin = 0; begin < num; begin += kBatch) {
+    size_t batch = std::min(kBatch, num - begin);
+    for (size_t k = 0; k < batch; ++k) {
+      float* update_value = update_values[begin + k];
+      const float* push_value = push_values[begin + k];
+      float push_show = push_value[CtrCommonPushValue::ShowIndex()];
+      float push_click = push_value[CtrCommonPushValue::ClickIndex()];
+      float slot = push_value[CtrCommonPushValue::SlotIndex()];
+      update_value[common_feature_value.ShowIndex()] += push_show;
+      update_value[common_feature_value.ClickIndex()] += push_click;
+      update_value[common_feature_value.SlotIndex()] = slot;
+      update_value[common_feature_value.DeltaScoreIndex()] +=
+          (push_show - push_click) *
+              _config.ctr_accessor_param().nonclk_coeff() +
+          push_click * _config.ctr_accessor_param().click_coeff();
+      update_value[common_feature_value.UnseenDaysIndex()] = 0;
+      if (!_show_scale) {
+        push_show = 1;
+      }
+      embed_w[k] = update_value + common_feature_value.EmbedWIndex();
+      embed_sgd[k] = update_value + common_feature_value.EmbedG2SumIndex();
+      embed_g[k] = push_value + CtrCommonPushValue::EmbedGIndex();
+      embedx_w[k] = embedx_buffer.data() + k * _embedx_dim;
+      Dequantize(_quant_bits,
+                 update_value + common_feature_value.EmbedxWIndex(),
+                 _embedx_dim,
+                 embedx_w[k]);
+      embedx_sgd[k] = update_value + common_feature_value.EmbedxG2SumIndex();
+      embedx_g[k] = push_value + CtrCommonPushValue::EmbedxGIndex();
+      scales[k] = push_show;
+    }
+    _embed_sgd_rule->UpdateValueBatch(
+        embed_w, embed_sgd, embed_g, scales, batch);
+    _embedx_sgd_rule->UpdateValueBatch(
+        embedx_w, embedx_sgd, embedx_g, scales, batch);
+    // rounded stochastically, updates smaller than the quantization step
+    // would be lost when rounded to the nearest
+    for (size_t k = 0; k < batch; ++k) {
+      Quantize(_quant_bits,
+               embedx_w[k],
+               _embedx_dim,
+               update_values[begin + k] + common_feature_value.EmbedxWIndex(),
+               true);
+    }
+  }
+  return 0;
+}
+
+size_t CtrQuantAccessor::SelectWireSize() {
+  return (CtrCommonPullValue::EmbedxWIndex() + _quant_slots) * sizeof(float);
+}
+
+void CtrQuantAccessor::EncodeSelect(char* wire, const float* select_value) {
+  float* packed = reinterpret_cast<float*>(wire);
+  memcpy(packed,
+         select_value,
+         CtrCommonPullValue::EmbedxWIndex() * sizeof(float));
+  Quantize(_quant_bits,
+           select_value + CtrCommonPullValue::EmbedxWIndex(),
+           _embedx_dim,
+           packed + CtrCommonPullValue::EmbedxWIndex());
+}
+
+void CtrQuantAccessor::DecodeSelect(float* select_value, const char* wire) {
+  const float* packed = reinterpret_cast<const float*>(wire);
+  memcpy(select_value,
+         packed,
+         CtrCommonPullValue::EmbedxWIndex() * sizeof(float));
+  Dequantize(_quant_bits,
+             packed + CtrCommonPullValue::EmbedxWIndex(),
+             _embedx_dim,
+             select_value + CtrCommonPullValue::EmbedxWIndex());
+}
+
+size_t CtrQuantAccessor::UpdateWireSize() {
+  return (CtrCommonPushValue::EmbedxGIndex() + _quant_slots) * sizeof(float);
+}
+
+void CtrQuantAccessor::EncodeUpdate(char* wire, const float* update_value) {
+  float* packed = reinterpret_cast<float*>(wire);
+  memcpy(packed,
+         update_value,
+         CtrCommonPushValue::EmbedxGIndex() * sizeof(float));
+  Quantize(_quant_bits,
+           update_value + CtrCommonPushValue::EmbedxGIndex(),
+           _embedx_dim,
+           packed + CtrCommonPushValue::EmbedxGIndex(),
+           true);
+}
+
+void CtrQuantAccessor::DecodeUpdate(float* update_value, const char* wire) {
+  const float* packed = reinterpret_cast<const float*>(wire);
+  memcpy(update_value,
+         packed,
+         CtrCommonPushValue::EmbedxGIndex() * sizeof(float));
+  Dequantize(_quant_bits,
+             packed + CtrCommonPushValue::EmbedxGIndex(),
+             _embedx_dim,
+             update_value + CtrCommonPushValue::EmbedxGIndex());
+}
+
+std::string CtrQuantAccessor::ParseToString(const float* v, int param) {
+  thread_local std::ostringstream os;
+  thread_local std::vector<float> embedx_w;
+  os.clear();
+  os.str("");
+  os << v[0] << " " << v[1] << " " << v[2] << " " << v[3] << " " << v[4] << " "
+     << v[5];
+  for (int i = common_feature_value.EmbedG2SumIndex();
+       i < common_feature_value.EmbedxWIndex();
+       i++) {
+    os << " " << v[i];
+  }
+  auto show = common_feature_value.Show(const_cast<float*>(v));
+  auto click = common_feature_value.Click(const_cast<float*>(v));
+  auto score = ShowClickScore(show, click);
+  if (score >= _config.embedx_threshold() &&
+      param > common_feature_value.EmbedxWIndex()) {
+    embedx_w.resize(_embedx_dim);
+    Dequantize(_quant_bits,
+               v + common_feature_value.EmbedxWIndex(),
+               _embedx_dim,
+               embedx_w.data());
+    for (auto w : embedx_w) {
+      os << " " << w;
+    }
+    for (auto i = common_feature_value.EmbedxG2SumIndex();
+         i < common_feature_value.Dim();
+         ++i) {
+      os << " " << v[i];
+    }
+  }
+  return os.str();
+}
+
+int CtrQuantAccessor::ParseFromString(const std::string& str, float* value) {
+  // parsed in the CtrCommonAccessor layout, then packed
+  int embedx_w_index = common_feature_value.EmbedxWIndex();
+  int embedx_sgd_dim = common_feature_value.embedx_sgd_dim;
+  thread_local std::vector<float> buffer;
+  buffer.resize(embedx_w_index + _embedx_dim + embedx_sgd_dim);
+  float* embedx_w = buffer.data() + embedx_w_index;
+  _embedx_sgd_rule->InitValue(embedx_w, embedx_w + _embedx_dim);
+  auto ret = paddle::string::str_to_float(str.data(), buffer.data());
+  PADDLE_ENFORCE_GE(
+      ret,
+      6UL,
+      common::errors::InvalidArgument(
+          "Invalid return value. Expect more than 6. But recieved %d.", ret));
+  memcpy(value, buffer.data(), embedx_w_index * sizeof(float));
+  if (static_cast<int>(ret) <= embedx_w_index) {
+    return ret;
+  }
+  Quantize(_quant_bits, embedx_w, _embedx_dim, value + embedx_w_index);
+  memcpy(value + common_feature_value.EmbedxG2SumIndex(),
+         embedx_w + _embedx_dim,
+         embedx_sgd_dim * sizeof(float));
+  return common_feature_value.Dim();
+}
+
+}  // namespace paddle::distributed
@@ -0,0 +1,83 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "paddle/fluid/distributed/ps/table/ctr_accessor.h"
+
+namespace paddle {
+namespace distributed {
+
+// CtrCommonAccessor keeping embedx_w in fp16, or in int8 with one scale per
+// value, as set by ctr_accessor_param.embedx_quant_bits (16 or 8).
+//
+// The packed weights take the float slots of embedx_w in the value:
+//   slot unseen_days delta_score show click embed_w embed_g2sum
+//   embedx_w(packed) embedx_g2sum
+// so common_feature_value describes the stored layout with embedx_dim set to
+// the packed slot count. The sgd rules see dequantized weights, which are
+// quantized again after every update with stochastic rounding.
+//
+// Pull and push values keep the CtrCommonAccessor layout for the caller. On
+// the wire their embedx part is packed the same way and the client decodes
+// pull values and encodes push values.
+class CtrQuantAccessor : public CtrCommonAccessor {
+ public:
+  CtrQuantAccessor() {}
+  virtual ~CtrQuantAccessor() {}
+  int Initialize() override;
+  void InitAccessorInfo() override;
+  int32_t Create(float** value, size_t num) override;
+  int32_t Select(float** select_values,
+                 const float** values,
+                 size_t num) override;
+  int32_t Update(float** values,
+                 const float** update_values,
+                 size_t num) override;
+
+  size_t SelectWireSize() override;
+  void EncodeSelect(char* wire, const float* select_value) override;
+  void DecodeSelect(float* select_value, const char* wire) override;
+  size_t UpdateWireSize() override;
+  void EncodeUpdate(char* wire, const float* update_value) override;
+  void DecodeUpdate(float* update_value, const char* wire) override;
+
+  // saved as text in the CtrCommonAccessor format, so checkpoints can be
+  // moved between the two accessors
+  std::string ParseToString(const float* value, int param) override;
+  int32_t ParseFromString(const std::string& str, float* v) override;
+
+  // float slots taken by dim packed weights
+  static int QuantSlots(int bits, int dim);
+  // stochastic rounding keeps the quantized weights unbiased, used where
+  // they are accumulated, the stored weights and the pushed gradients
+  static void Quantize(int bits,
+                       const float* w,
+                       int dim,
+                       float* packed,
+                       bool stochastic = false);
+  static void Dequantize(int bits, const float* packed, int dim, float* w);
+
+ private:
+  int _quant_bits = 16;
+  int _embedx_dim = 0;
+  int _quant_slots = 0;
+};
+
+}  // namespace distributed
+}  // namespace paddle
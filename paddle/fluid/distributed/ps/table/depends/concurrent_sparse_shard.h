@@ -0,0 +1,382 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <thread>        // NOLINT
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || \
+    defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace distributed {
+
+// Open-addressing hash shard for sparse feature values that allows
+// concurrent readers and writers.
+//
+// Feature values are stored inline in one slab of fixed-stride slots, so a
+// lookup touches one cache line sequence instead of chasing a pointer to a
+// heap allocated FixedFeatureValue. Every slot carries:
+//   * state:   EMPTY -> BUSY -> FULL (-> DELETED), only ever claimed from
+//              EMPTY, so two writers racing on the same key always meet in
+//              the same slot;
+//   * version: a seqlock, odd while a writer owns the slot. Readers copy the
+//              value optimistically and retry if the version moved.
+// Readers (Find) never take a lock. Writers (Upsert) hold the shard's resize
+// lock in shared mode, which is only taken exclusively when the slab grows.
+// Slabs replaced by a grow are kept alive until the next exclusive point
+// (EraseIf/Clear), so a reader never touches freed memory. As the slab
+// doubles on each grow, the retired slabs together are about as large as the
+// live one, so between two EraseIf calls (e.g. Shrink) a growing shard may
+// hold up to twice the bytes of its live slab, see memory_size().
+class ConcurrentSparseTableShard {
+ public:
+  static constexpr uint32_t kEmpty = 0;
+  static constexpr uint32_t kBusy = 1;
+  static constexpr uint32_t kFull = 2;
+  static constexpr uint32_t kDeleted = 3;
+
+  ConcurrentSparseTableShard() {}
+  ConcurrentSparseTableShard(const ConcurrentSparseTableShard&) = delete;
+  ~ConcurrentSparseTableShard() { Clear(); }
+
+  // value_dim is the max number of floats one feature value may hold.
+  void Init(size_t value_dim,
+            size_t init_capacity = 1024,
+            float max_load_factor = 0.75f) {
+    _value_dim = value_dim;
+    _max_load_factor = max_load_factor;
+    _stride = (sizeof(Slot) + value_dim * sizeof(float) + alignof(Slot) - 1) /
+              alignof(Slot) * alignof(Slot);
+    _init_capacity = RoundUpPow2(init_capacity);
+    Clear();
+  }
+
+  size_t size() const { return _size.load(std::memory_order_relaxed); }
+  bool empty() const { return size() == 0; }
+  size_t value_dim() const { return _value_dim; }
+  size_t capacity() const {
+    Slab* slab = _slab.load(std::memory_order_acquire);
+    return slab == nullptr ? 0 : slab->capacity;
+  }
+  // Bytes held by live and retired slabs.
+  size_t memory_size() const {
+    std::lock_guard<std::mutex> guard(_retired_mutex);
+    size_t bytes = 0;
+    Slab* slab = _slab.load(std::memory_order_acquire);
+    if (slab != nullptr) bytes += slab->bytes;
+    for (auto& retired : _retired) bytes += retired->bytes;
+    return bytes;
+  }
+
+  // Copies the value of key into out (at least value_dim floats) and returns
+  // the number of valid floats, or -1 if key is absent. Lock free.
+  int Find(uint64_t key, float* out) const {
+    Slab* slab = _slab.load(std::memory_order_acquire);
+    if (slab == nullptr) {
+      return -1;
+    }
+    size_t mask = slab->capacity - 1;
+    size_t pos = Hash(key) & mask;
+    for (size_t i = 0; i < slab->capacity; ++i, pos = (pos + 1) & mask) {
+      Slot* slot = slab->slot(pos, _stride);
+      uint32_t state = slot->state.load(std::memory_order_acquire);
+      if (state == kEmpty) {
+        return -1;
+      }
+      while (state == kBusy) {
+        CpuRelax();
+        state = slot->state.load(std::memory_order_acquire);
+      }
+      if (state != kFull || slot->key != key) {
+        continue;
+      }
+      for (;;) {
+        uint32_t version = slot->version.load(std::memory_order_acquire);
+        if (version & 1) {
+          CpuRelax();
+          continue;
+        }
+        uint32_t n = slot->size.load(std::memory_order_relaxed);
+        if (n > _value_dim) n = _value_dim;
+        memcpy(out, slot->data(), n * sizeof(float));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->version.load(std::memory_order_relaxed) == version) {
+          return static_cast<int>(n);
+        }
+      }
+    }
+    return -1;
+  }
+
+  // Runs update(float* data, uint32_t* size) on the value of key while
+  // holding the slot's write lock. When key is absent, create(float* data)
+  // first initializes a new value in place and returns its size; returning
+  // 0 skips the insert. Returns false if nothing was updated.
+  template <class CreateFn, class UpdateFn>
+  bool Upsert(uint64_t key, CreateFn&& create, UpdateFn&& update) {
+    for (;;) {
+      std::shared_lock<std::shared_mutex> guard(_resize_lock);
+      Slab* slab = _slab.load(std::memory_order_acquire);
+      if (_used.load(std::memory_order_relaxed) + 1 >
+          static_cast<size_t>(slab->capacity * _max_load_factor)) {
+        guard.unlock();
+        Grow(slab);
+        continue;
+      }
+      size_t mask = slab->capacity - 1;
+      size_t pos = Hash(key) & mask;
+      for (size_t i = 0; i < slab->capacity; ++i, pos = (pos + 1) & mask) {
+        Slot* slot = slab->slot(pos, _stride);
+        uint32_t state = slot->state.load(std::memory_order_acquire);
+        if (state == kEmpty &&
+            slot->state.compare_exchange_strong(
+                state, kBusy, std::memory_order_acq_rel)) {
+          _used.fetch_add(1, std::memory_order_relaxed);
+          slot->key = key;
+          uint32_t n = static_cast<uint32_t>(create(slot->data()));
+          if (n == 0) {
+            slot->state.store(kDeleted, std::memory_order_release);
+            return false;
+          }
+          slot->size.store(n, std::memory_order_relaxed);
+          slot->state.store(kFull, std::memory_order_release);
+          _size.fetch_add(1, std::memory_order_relaxed);
+          LockAndUpdate(slot, std::forward<UpdateFn>(update));
+          return true;
+        }
+        while (state == kBusy) {
+          CpuRelax();
+          state = slot->state.load(std::memory_order_acquire);
+        }
+        if (state == kFull && slot->key == key) {
+          LockAndUpdate(slot, std::forward<UpdateFn>(update));
+          return true;
+        }
+      }
+      // every slot was probed, which the load factor should rule out
+      guard.unlock();
+      Grow(slab);
+    }
+  }
+
+  // The following methods require that no other thread uses the shard.
+
+  // Calls fn(key, data, size) on every value; stops once fn returns false.
+  template <class Fn>
+  void ForEach(Fn&& fn) {
+    Slab* slab = _slab.load(std::memory_order_acquire);
+    if (slab == nullptr) return;
+    for (size_t pos = 0; pos < slab->capacity; ++pos) {
+      Slot* slot = slab->slot(pos, _stride);
+      if (slot->state.load(std::memory_order_relaxed) != kFull) continue;
+      if (!fn(slot->key,
+              slot->data(),
+              static_cast<size_t>(slot->size.load(std::memory_order_relaxed)))) {
+        return;
+      }
+    }
+  }
+
+  // Erases every value for which pred(key, data, size) holds, then rebuilds
+  // the slab to drop tombstones. Returns the number of erased values.
+  template <class Pred>
+  size_t EraseIf(Pred&& pred) {
+    std::unique_lock<std::shared_mutex> guard(_resize_lock);
+    Slab* slab = _slab.load(std::memory_order_acquire);
+    size_t erased = 0;
+    for (size_t pos = 0; pos < slab->capacity; ++pos) {
+      Slot* slot = slab->slot(pos, _stride);
+      if (slot->state.load(std::memory_order_relaxed) != kFull) continue;
+      if (pred(slot->key,
+               slot->data(),
+               static_cast<size_t>(slot->size.load(std::memory_order_relaxed)))) {
+        slot->state.store(kDeleted, std::memory_order_relaxed);
+        ++erased;
+      }
+    }
+    _size.fetch_sub(erased, std::memory_order_relaxed);
+    size_t capacity = slab->capacity;
+    while (capacity > _init_capacity &&
+           size() < capacity * _max_load_factor / 4) {
+      capacity >>= 1;
+    }
+    Rehash(capacity);
+    FreeRetired();
+    return erased;
+  }
+
+  void Clear() {
+    std::unique_lock<std::shared_mutex> guard(_resize_lock);
+    Slab* slab = _slab.exchange(nullptr, std::memory_order_acq_rel);
+    delete slab;
+    FreeRetired();
+    _size.store(0, std::memory_order_relaxed);
+    _used.store(0, std::memory_order_relaxed);
+    if (_stride != 0) {
+      _slab.store(new Slab(_init_capacity, _stride), std::memory_order_release);
+    }
+  }
+
+ private:
+  struct alignas(8) Slot {
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> version;
+    uint64_t key;
+    std::atomic<uint32_t> size;
+    uint32_t reserved;
+    float* data() { return reinterpret_cast<float*>(this + 1); }
+  };
+
+  struct Slab {
+    Slab(size_t cap, size_t stride) : capacity(cap), bytes(cap * stride) {
+      int error = posix_memalign(reinterpret_cast<void**>(&buffer), 64, bytes);
+      PADDLE_ENFORCE_EQ(
+          error,
+          0,
+          common::errors::ResourceExhausted(
+              "Fail to alloc memory of %ld size, error code is %d.",
+              bytes,
+              error));
+      // kEmpty and version 0 are all zero bits
+      memset(buffer, 0, bytes);
+    }
+    ~Slab() { free(buffer); }
+    Slot* slot(size_t pos, size_t stride) const {
+      return reinterpret_cast<Slot*>(buffer + pos * stride);
+    }
+    size_t capacity;
+    size_t bytes;
+    char* buffer = nullptr;
+  };
+
+  static inline void CpuRelax() {
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || \
+    defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  // murmur3 finalizer, feasigns routed to one shard share their low bits
+  static inline size_t Hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return static_cast<size_t>(key);
+  }
+
+  static size_t RoundUpPow2(size_t n) {
+    size_t cap = 16;
+    while (cap < n) cap <<= 1;
+    return cap;
+  }
+
+  template <class UpdateFn>
+  static void LockAndUpdate(Slot* slot, UpdateFn&& update) {
+    uint32_t version = slot->version.load(std::memory_order_relaxed);
+    for (;;) {
+      if (!(version & 1) &&
+          slot->version.compare_exchange_weak(
+              version, version + 1, std::memory_order_acquire)) {
+        break;
+      }
+      CpuRelax();
+      version = slot->version.load(std::memory_order_relaxed);
+    }
+    uint32_t n = slot->size.load(std::memory_order_relaxed);
+    update(slot->data(), &n);
+    slot->size.store(n, std::memory_order_relaxed);
+    slot->version.store(version + 2, std::memory_order_release);
+  }
+
+  void Grow(Slab* observed) {
+    std::unique_lock<std::shared_mutex> guard(_resize_lock);
+    Slab* slab = _slab.load(std::memory_order_acquire);
+    if (slab != observed) {
+      return;
+    }
+    size_t capacity = slab->capacity;
+    // only grow when live values need it, otherwise rebuilding drops
+    // enough tombstones
+    if (size() + 1 > capacity * _max_load_factor / 2) {
+      capacity <<= 1;
+    }
+    Rehash(capacity);
+  }
+
+  // Requires _resize_lock held exclusively. The old slab is retired rather
+  // than freed since lock free readers may still be probing it.
+  void Rehash(size_t capacity) {
+    Slab* old_slab = _slab.load(std::memory_order_acquire);
+    std::unique_ptr<Slab> new_slab(new Slab(capacity, _stride));
+    size_t mask = capacity - 1;
+    size_t used = 0;
+    for (size_t pos = 0; pos < old_slab->capacity; ++pos) {
+      Slot* src = old_slab->slot(pos, _stride);
+      if (src->state.load(std::memory_order_relaxed) != kFull) continue;
+      size_t dst_pos = Hash(src->key) & mask;
+      Slot* dst = new_slab->slot(dst_pos, _stride);
+      while (dst->state.load(std::memory_order_relaxed) != kEmpty) {
+        dst_pos = (dst_pos + 1) & mask;
+        dst = new_slab->slot(dst_pos, _stride);
+      }
+      memcpy(reinterpret_cast<void*>(dst),
+             reinterpret_cast<void*>(src),
+             _stride);
+      dst->version.store(0, std::memory_order_relaxed);
+      ++used;
+    }
+    _used.store(used, std::memory_order_relaxed);
+    _slab.store(new_slab.release(), std::memory_order_release);
+    std::lock_guard<std::mutex> retired_guard(_retired_mutex);
+    _retired.emplace_back(old_slab);
+  }
+
+  void FreeRetired() {
+    std::lock_guard<std::mutex> guard(_retired_mutex);
+    _retired.clear();
+  }
+
+  size_t _value_dim = 0;
+  size_t _stride = 0;
+  size_t _init_capacity = 16;
+  float _max_load_factor = 0.75f;
+  std::atomic<Slab*> _slab{nullptr};
+  std::atomic<size_t> _size{0};
+  // FULL, BUSY and DELETED slots, i.e. slots no insert can claim
+  std::atomic<size_t> _used{0};
+  std::shared_mutex _resize_lock;
+  mutable std::mutex _retired_mutex;
+  std::vector<std::unique_ptr<Slab>> _retired;
+};
+
+}  // namespace distributed
+}  // namespace paddle
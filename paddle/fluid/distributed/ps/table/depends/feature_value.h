@@ -14,12 +14,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 
 #include <mct/hash-map.hpp>
 
 #include "paddle/common/flags.h"
+#include "paddle/common/macros.h"
 #include "paddle/fluid/distributed/common/chunk_allocator.h"
+#include "paddle/fluid/distributed/common/slab_arena.h"
 
 namespace paddle {
 namespace distributed {
@@ -28,19 +32,138 @@ static const int CTR_SPARSE_SHARD_BUCKET_NUM_BITS = 6;
 static const size_t CTR_SPARSE_SHARD_BUCKET_NUM =
     static_cast<size_t>(1) << CTR_SPARSE_SHARD_BUCKET_NUM_BITS;
 
+// A sparse feature value. Storage comes from malloc by default, or from the
+// shard's SlabArena once set_arena is called.
 class FixedFeatureValue {
  public:
   FixedFeatureValue() {}
-  ~FixedFeatureValue() {}
-  float* data() { return _data.data(); }
-  size_t size() { return _data.size(); }
-  void resize(size_t size) { _data.resize(size); }
-  void shrink_to_fit() { _data.shrink_to_fit(); }
+  explicit FixedFeatureValue(SlabArena* arena) : _arena(arena) {}
+  FixedFeatureValue(const FixedFeatureValue& other) : _arena(other._arena) {
+    *this = other;
+  }
+  FixedFeatureValue(FixedFeatureValue&& other) noexcept
+      : _data(other._data),
+        _size(other._size),
+        _capacity(other._capacity),
+        _epoch(other._epoch),
+        _arena(other._arena) {
+    other._data = nullptr;
+    other._size = 0;
+    other._capacity = 0;
+  }
+  FixedFeatureValue& operator=(const FixedFeatureValue& other) {
+    if (this != &other) {
+      resize(other._size);
+      if (_size > 0) {
+        memcpy(_data, other._data, _size * sizeof(float));
+      }
+    }
+    return *this;
+  }
+  ~FixedFeatureValue() { Deallocate(_data, _capacity); }
+
+  float* data() { return _data; }
+  size_t size() { return _size; }
+  // shard epoch of the last change, see SparseTableShard::touch
+  uint32_t epoch() const { return _epoch; }
+  void set_epoch(uint32_t epoch) { _epoch = epoch; }
+  // keeps the leading values and zero fills new ones, like std::vector
+  void resize(size_t size) {
+    bool realloc = size > _capacity ||
+                   (_arena != nullptr && size <= _arena->max_floats() &&
+                    !SlabArena::SameClass(size, _capacity));
+    if (realloc) {
+      Reallocate(size);
+    }
+    if (size > _size) {
+      memset(_data + _size, 0, (size - _size) * sizeof(float));
+    }
+    _size = static_cast<uint32_t>(size);
+  }
+  void shrink_to_fit() {
+    if (_capacity != _size) {
+      Reallocate(_size);
+    }
+  }
+  // moves the storage into arena, must be called before any other thread
+  // sees this value
+  void set_arena(SlabArena* arena) {
+    if (arena == _arena) {
+      return;
+    }
+    float* data = _data;
+    size_t capacity = _capacity;
+    SlabArena* old_arena = _arena;
+    _arena = arena;
+    _data = nullptr;
+    _capacity = 0;
+    if (_size > 0) {
+      Reallocate(_size);
+      memcpy(_data, data, _size * sizeof(float));
+    }
+    if (old_arena != nullptr) {
+      old_arena->Free(data, capacity);
+    } else {
+      free(data);
+    }
+  }
+  // relocates the storage during SlabArena compaction
+  void compact() {
+    if (_arena != nullptr) {
+      _data = _arena->Relocate(_data, _capacity);
+    }
+  }
 
  private:
-  std::vector<float> _data;
+  void Reallocate(size_t capacity) {
+    float* data = nullptr;
+    if (capacity > 0) {
+      data = _arena != nullptr
+                 ? _arena->Allocate(capacity)
+                 : reinterpret_cast<float*>(malloc(capacity * sizeof(float)));
+      PADDLE_ENFORCE_NOT_NULL(
+          data,
+          common::errors::ResourceExhausted(
+              "Fail to alloc %ld floats for FixedFeatureValue.", capacity));
+      size_t keep = std::min<size_t>(_size, capacity);
+      if (keep > 0) {
+        memcpy(data, _data, keep * sizeof(float));
+      }
+    }
+    Deallocate(_data, _capacity);
+    _data = data;
+    _capacity = static_cast<uint32_t>(capacity);
+    if (_size > capacity) {
+      _size = static_cast<uint32_t>(capacity);
+    }
+  }
+  void Deallocate(float* data, size_t capacity) {
+    if (_arena != nullptr) {
+      _arena->Free(data, capacity);
+    } else {
+      free(data);
+    }
+  }
+
+  float* _data = nullptr;
+  uint32_t _size = 0;
+  uint32_t _capacity = 0;
+  uint32_t _epoch = 0;
+  SlabArena* _arena = nullptr;
 };
 
+template <class VALUE>
+inline void AttachValueArena(VALUE* value UNUSED, SlabArena* arena UNUSED) {}
+inline void AttachValueArena(FixedFeatureValue* value, SlabArena* arena) {
+  value->set_arena(arena);
+}
+
+template <class VALUE>
+inline void StampValueEpoch(VALUE* value UNUSED, uint32_t epoch UNUSED) {}
+inline void StampValueEpoch(FixedFeatureValue* value, uint32_t epoch) {
+  value->set_epoch(epoch);
+}
+
 template <class KEY, class VALUE>
 struct alignas(64) SparseTableShard {
  public:
@@ -93,6 +216,48 @@ struct alignas(64) SparseTableShard {
   };
 
   ~SparseTableShard() { clear(); }
+  // backs values inserted from now on with a slab arena of up to
+  // max_floats per size class
+  void init_value_arena(size_t max_floats) {
+    _arena.reset(new SlabArena(max_floats));
+  }
+  SlabArena* value_arena() { return _arena.get(); }
+  // moves values out of sparsely used slabs and releases them, returns the
+  // number of released bytes
+  size_t compact_values() {
+    if (_arena == nullptr || _arena->BeginCompact() == 0) {
+      return 0;
+    }
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; bucket++) {
+      map_type& data = _buckets[bucket];
+      for (auto it = data.begin(); it != data.end(); ++it) {
+        ((VALUE*)(void*)it->second)->compact();  // NOLINT
+      }
+    }
+    return _arena->EndCompact();
+  }
+  // Dirty tracking for delta saves. Every created or touched value is
+  // stamped with the current epoch; a save closes the epoch with
+  // advance_epoch and later writes only the values stamped after the epoch
+  // it closed last time.
+  uint32_t epoch() const { return _epoch; }
+  // returns the closed epoch, later changes are stamped with a newer one
+  uint32_t advance_epoch() { return _epoch++; }
+  void touch(VALUE* value) { StampValueEpoch(value, _epoch); }
+  // records erased keys until take_erased_keys, for delta saves. Once
+  // more keys were erased than the shard holds, a delta is no cheaper than
+  // a full save, so the record is dropped and erased_overflow is set.
+  void set_track_erased(bool track) {
+    _track_erased = track;
+    _erased_overflow = false;
+    std::vector<KEY>().swap(_erased_keys);
+  }
+  bool erased_overflow() const { return _erased_overflow; }
+  void take_erased_keys(std::vector<KEY>* keys) {
+    keys->swap(_erased_keys);
+    _erased_keys.clear();
+    _erased_overflow = false;
+  }
   bool empty() { return _alloc.size() == 0; }
   size_t size() { return _alloc.size(); }
   void set_max_load_factor(float x) {
@@ -150,12 +315,18 @@ struct alignas(64) SparseTableShard {
     auto res = _buckets[bucket].insert_with_hash({key, NULL}, hash);
 
     if (res.second) {
-      res.first->second = _alloc.acquire(std::forward<ARGS>(args)...);
+      VALUE* value = _alloc.acquire(std::forward<ARGS>(args)...);
+      if (_arena != nullptr) {
+        AttachValueArena(value, _arena.get());
+      }
+      StampValueEpoch(value, _epoch);
+      res.first->second = value;
     }
 
     return {{res.first, bucket, _buckets}, res.second};
   }
   iterator erase(iterator it) {
+    RecordErased(it.key());
     _alloc.release((VALUE*)(void*)it.it->second);  // NOLINT
     size_t bucket = it.bucket;
     auto it2 = _buckets[bucket].erase(it.it);
@@ -166,14 +337,17 @@ struct alignas(64) SparseTableShard {
     return {it2, bucket, _buckets};
   }
   void quick_erase(iterator it) {
+    RecordErased(it.key());
     _alloc.release((VALUE*)(void*)it.it->second);  // NOLINT
     _buckets[it.bucket].quick_erase(it.it);
   }
   local_iterator erase(size_t bucket, local_iterator it) {
+    RecordErased(it.key());
     _alloc.release((VALUE*)(void*)it.it->second);  // NOLINT
     return {_buckets[bucket].erase(it.it)};
   }
   void quick_erase(size_t bucket, local_iterator it) {
+    RecordErased(it.key());
     _alloc.release((VALUE*)(void*)it.it->second);  // NOLINT
     _buckets[bucket].quick_erase(it.it);
   }
@@ -194,9 +368,29 @@ struct alignas(64) SparseTableShard {
   }
 
  private:
+  void RecordErased(const KEY& key) {
+    if (!_track_erased || _erased_overflow) {
+      return;
+    }
+    if (_erased_keys.size() >= std::max(size(), kMinTrackedErased)) {
+      _erased_overflow = true;
+      std::vector<KEY>().swap(_erased_keys);
+      return;
+    }
+    _erased_keys.push_back(key);
+  }
+
+  static constexpr size_t kMinTrackedErased = 65536;
+
+  // declared first so it outlives the values
+  std::unique_ptr<SlabArena> _arena;
   map_type _buckets[CTR_SPARSE_SHARD_BUCKET_NUM];
   ChunkAllocator<VALUE> _alloc;
   std::hash<KEY> _hasher;
+  uint32_t _epoch = 1;
+  bool _track_erased = false;
+  bool _erased_overflow = false;
+  std::vector<KEY> _erased_keys;
 };
 
 }  // namespace distributed
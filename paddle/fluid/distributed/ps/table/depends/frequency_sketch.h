@@ -0,0 +1,148 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace paddle {
+namespace distributed {
+
+// Count-min sketch of 4 bit counters estimating how often a key was seen
+// recently, used as the admission filter of a cache tier (TinyLFU).
+//
+// After sample_size increments every counter is halved, so the estimate
+// follows the recent access frequency and old hot keys fade out. Counters
+// are updated atomically, so threads may increment and estimate at the same
+// time. An increment racing with the halving may be lost, which only makes
+// the estimate a little lower.
+class FrequencySketch {
+ public:
+  static constexpr uint32_t kMaxCount = 15;
+
+  FrequencySketch() {}
+  explicit FrequencySketch(size_t capacity) { Init(capacity); }
+  FrequencySketch(const FrequencySketch&) = delete;
+  FrequencySketch& operator=(const FrequencySketch&) = delete;
+
+  // capacity is the number of keys the sketch should tell apart, usually
+  // the capacity of the cache tier, not thread safe
+  void Init(size_t capacity) {
+    size_t width = 64;
+    while (width < capacity) {
+      width <<= 1;
+    }
+    _mask = width - 1;
+    _cells = width * kDepth / 2;
+    _table.reset(new std::atomic<uint8_t>[_cells]);
+    for (size_t i = 0; i < _cells; ++i) {
+      _table[i].store(0, std::memory_order_relaxed);
+    }
+    _sample_size = std::max<size_t>(width * 10, 1024);
+    _additions.store(0, std::memory_order_relaxed);
+  }
+
+  void Increment(uint64_t key) {
+    if (_table == nullptr) {
+      return;
+    }
+    uint64_t hash = Mix(key);
+    bool added = false;
+    for (size_t row = 0; row < kDepth; ++row) {
+      added |= IncrementAt(Index(hash, row));
+    }
+    // exactly one of the racing increments reaches the sample size
+    if (added &&
+        _additions.fetch_add(1, std::memory_order_relaxed) + 1 ==
+            _sample_size) {
+      Reset();
+    }
+  }
+
+  uint32_t Estimate(uint64_t key) const {
+    if (_table == nullptr) {
+      return 0;
+    }
+    uint64_t hash = Mix(key);
+    uint32_t count = kMaxCount;
+    for (size_t row = 0; row < kDepth; ++row) {
+      count = std::min(count, CountAt(Index(hash, row)));
+    }
+    return count;
+  }
+
+  // halves every counter, done every sample_size increments
+  void Reset() {
+    for (size_t i = 0; i < _cells; ++i) {
+      // halves both nibbles of the cell
+      uint8_t cell = _table[i].load(std::memory_order_relaxed);
+      _table[i].store((cell >> 1) & 0x77, std::memory_order_relaxed);
+    }
+    size_t additions = _additions.load(std::memory_order_relaxed);
+    while (!_additions.compare_exchange_weak(
+        additions, additions / 2, std::memory_order_relaxed)) {
+    }
+  }
+
+  size_t sample_size() const { return _sample_size; }
+
+ private:
+  static constexpr size_t kDepth = 4;
+
+  static uint64_t Mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+
+  // counter index of the key in a row, rows are laid out one after another
+  size_t Index(uint64_t hash, size_t row) const {
+    uint64_t h = hash + (row + 1) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 29;
+    return row * (_mask + 1) + (h & _mask);
+  }
+
+  uint32_t CountAt(size_t idx) const {
+    uint8_t cell = _table[idx >> 1].load(std::memory_order_relaxed);
+    return (cell >> ((idx & 1) << 2)) & 0xf;
+  }
+
+  bool IncrementAt(size_t idx) {
+    uint32_t shift = (idx & 1) << 2;
+    std::atomic<uint8_t>& cell = _table[idx >> 1];
+    uint8_t value = cell.load(std::memory_order_relaxed);
+    do {
+      if (((value >> shift) & 0xf) == kMaxCount) {
+        return false;
+      }
+    } while (!cell.compare_exchange_weak(
+        value, value + (1 << shift), std::memory_order_relaxed));
+    return true;
+  }
+
+  std::unique_ptr<std::atomic<uint8_t>[]> _table;  // two counters per byte
+  size_t _cells = 0;
+  size_t _mask = 0;
+  size_t _sample_size = 0;
+  std::atomic<size_t> _additions{0};
+};
+
+}  // namespace distributed
+}  // namespace paddle
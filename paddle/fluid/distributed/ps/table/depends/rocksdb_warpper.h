@@ -27,6 +27,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace paddle {
 namespace distributed {
@@ -215,6 +216,29 @@ class RocksDBHandler {
     return 0;
   }
 
+  int del_batch(int id, const std::vector<uint64_t>& keys) {
+    rocksdb::WriteOptions options;
+    options.disableWAL = true;
+    rocksdb::WriteBatch batch(keys.size() * 32);
+    for (auto& key : keys) {
+      batch.Delete(rocksdb::Slice(reinterpret_cast<const char*>(&key),
+                                  sizeof(uint64_t)));
+    }
+    rocksdb::Status s = _dbs[id]->Write(options, &batch);
+    assert(s.ok());
+    return 0;
+  }
+
+  // drops the tombstones left by deleted keys, which otherwise slow down
+  // every later get of the column
+  int compact_range(int id) {
+    rocksdb::CompactRangeOptions options;
+    options.exclusive_manual_compaction = false;
+    rocksdb::Status s = _dbs[id]->CompactRange(options, nullptr, nullptr);
+    assert(s.ok());
+    return 0;
+  }
+
   int flush(int id) {
     rocksdb::Status s = _dbs[id]->Flush(rocksdb::FlushOptions());
     assert(s.ok());
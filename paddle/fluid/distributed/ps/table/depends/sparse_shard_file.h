@@ -0,0 +1,399 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/distributed/common/afs_warpper.h"
+#include "paddle/fluid/framework/io/fs.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace distributed {
+
+// Binary checkpoint of one sparse table shard:
+//   header | keys: uint64 x n | sizes: uint32 x n | values: float x n x dim
+// Every section starts at a 64 byte boundary and value i lives at
+// values_offset + i * dim floats, so a mapped file is read in place and a
+// load is a memcpy per key instead of a text parse. In a delta file a key of
+// size 0 was erased.
+struct SparseShardFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t value_dim;  // floats reserved per value
+  uint64_t key_num;
+  uint64_t keys_offset;
+  uint64_t sizes_offset;
+  uint64_t values_offset;
+  uint64_t file_size;
+};
+
+constexpr char kSparseShardFileMagic[8] = {
+    'P', 'D', 'S', 'P', 'S', 'H', 'R', 'D'};
+constexpr uint32_t kSparseShardFileVersion = 1;
+constexpr size_t kSparseShardFileAlign = 64;
+constexpr const char* kSparseShardFileSuffix = ".bin";
+
+inline bool IsSparseShardFile(const std::string& path) {
+  size_t len = strlen(kSparseShardFileSuffix);
+  return path.size() >= len &&
+         path.compare(path.size() - len, len, kSparseShardFileSuffix) == 0;
+}
+
+// Collects the values of one shard and writes them as a binary shard file.
+// The value pointers must stay valid until Write returns.
+class SparseShardFileWriter {
+ public:
+  explicit SparseShardFileWriter(uint32_t value_dim) : _value_dim(value_dim) {}
+
+  void Add(uint64_t key, const float* value, uint32_t size) {
+    _keys.push_back(key);
+    _values.push_back(value);
+    _sizes.push_back(std::min(size, _value_dim));
+  }
+
+  size_t size() const { return _keys.size(); }
+
+  void Clear() {
+    _keys.clear();
+    _values.clear();
+    _sizes.clear();
+  }
+
+  // returns 0 on success, -1 if the channel failed
+  int Write(FsWriteChannel* channel) {
+    SparseShardFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kSparseShardFileMagic, sizeof(header.magic));
+    header.version = kSparseShardFileVersion;
+    header.value_dim = _value_dim;
+    header.key_num = _keys.size();
+    header.keys_offset = Align(sizeof(header));
+    header.sizes_offset =
+        Align(header.keys_offset + header.key_num * sizeof(uint64_t));
+    header.values_offset =
+        Align(header.sizes_offset + header.key_num * sizeof(uint32_t));
+    header.file_size =
+        header.values_offset + header.key_num * _value_dim * sizeof(float);
+
+    _offset = 0;
+    if (Append(channel, &header, sizeof(header)) != 0 ||
+        Pad(channel, header.keys_offset) != 0 ||
+        Append(channel, _keys.data(), _keys.size() * sizeof(uint64_t)) != 0 ||
+        Pad(channel, header.sizes_offset) != 0 ||
+        Append(channel, _sizes.data(), _sizes.size() * sizeof(uint32_t)) != 0 ||
+        Pad(channel, header.values_offset) != 0) {
+      return -1;
+    }
+    // values go through a staging buffer so the tail of short values is
+    // zero filled and the channel sees few large writes
+    size_t per_batch = std::max<size_t>(1, kStageBytes / RowBytes());
+    std::vector<float> stage;
+    for (size_t begin = 0; begin < _keys.size(); begin += per_batch) {
+      size_t end = std::min(begin + per_batch, _keys.size());
+      stage.assign((end - begin) * _value_dim, 0);
+      for (size_t i = begin; i < end; ++i) {
+        if (_sizes[i] > 0) {
+          memcpy(stage.data() + (i - begin) * _value_dim,
+                 _values[i],
+                 _sizes[i] * sizeof(float));
+        }
+      }
+      if (Append(channel, stage.data(), stage.size() * sizeof(float)) != 0) {
+        return -1;
+      }
+    }
+    return 0;
+  }
+
+ private:
+  static constexpr size_t kStageBytes = 4 * 1024 * 1024;
+
+  static uint64_t Align(uint64_t offset) {
+    return (offset + kSparseShardFileAlign - 1) / kSparseShardFileAlign *
+           kSparseShardFileAlign;
+  }
+
+  size_t RowBytes() const { return std::max<size_t>(1, _value_dim) * 4; }
+
+  int Append(FsWriteChannel* channel, const void* data, size_t size) {
+    if (size == 0) {
+      return 0;
+    }
+    if (channel->write(reinterpret_cast<const char*>(data), size) != 0) {
+      return -1;
+    }
+    _offset += size;
+    return 0;
+  }
+
+  int Pad(FsWriteChannel* channel, uint64_t offset) {
+    static const char kZeros[kSparseShardFileAlign] = {0};
+    return Append(channel, kZeros, offset - _offset);
+  }
+
+  uint32_t _value_dim;
+  uint64_t _offset = 0;
+  std::vector<uint64_t> _keys;
+  std::vector<const float*> _values;
+  std::vector<uint32_t> _sizes;
+};
+
+// Read only view of a binary shard file. Local files are mapped. Files on
+// hdfs/afs are streamed: their keys and sizes are read at Open, their values
+// a chunk at a time, so value(i) must be called in key order. Open and value
+// throw on a malformed file.
+class SparseShardFileReader {
+ public:
+  SparseShardFileReader() {}
+  SparseShardFileReader(const SparseShardFileReader&) = delete;
+  ~SparseShardFileReader() { Close(); }
+
+  void Open(AfsClient* client, const FsChannelConfig& config) {
+    Close();
+    _path = config.path;
+    if (paddle::framework::fs_select_internal(config.path) == 0) {
+      Map(config.path);
+      Parse();
+    } else {
+      OpenStream(client, config);
+    }
+  }
+
+  void Close() {
+    if (_mapped != nullptr) {
+      munmap(_mapped, _length);
+      _mapped = nullptr;
+    }
+    if (_channel != nullptr) {
+      _channel->close();
+      _channel.reset();
+    }
+    _key_buffer.clear();
+    _key_buffer.shrink_to_fit();
+    _size_buffer.clear();
+    _size_buffer.shrink_to_fit();
+    _value_buffer.clear();
+    _value_buffer.shrink_to_fit();
+    _data = nullptr;
+    _length = 0;
+    _header = nullptr;
+    _chunk_begin = 0;
+    _chunk_end = 0;
+  }
+
+  uint64_t key_num() const { return _header->key_num; }
+  uint32_t value_dim() const { return _header->value_dim; }
+  uint64_t key(size_t i) const { return _keys[i]; }
+  uint32_t size(size_t i) const { return _sizes[i]; }
+  const float* value(size_t i) {
+    if (_channel == nullptr) {
+      return _values + i * _header->value_dim;
+    }
+    if (i >= _chunk_end) {
+      ReadValues(i);
+    }
+    PADDLE_ENFORCE_GE(i,
+                      _chunk_begin,
+                      common::errors::PreconditionNotMet(
+                          "Values of the streamed sparse shard file %s are "
+                          "read in key order.",
+                          _path));
+    return _value_buffer.data() + (i - _chunk_begin) * _header->value_dim;
+  }
+
+ private:
+  static constexpr size_t kChunkBytes = 4 * 1024 * 1024;
+
+  void Map(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    PADDLE_ENFORCE_GE(fd,
+                      0,
+                      common::errors::Unavailable(
+                          "Fail to open sparse shard file %s.", path));
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      PADDLE_THROW(common::errors::InvalidArgument(
+          "Sparse shard file %s is empty.", path));
+    }
+    _length = st.st_size;
+    void* addr = mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    PADDLE_ENFORCE_NE(addr,
+                      MAP_FAILED,
+                      common::errors::ResourceExhausted(
+                          "Fail to map sparse shard file %s.", path));
+    madvise(addr, _length, MADV_SEQUENTIAL);
+    madvise(addr, _length, MADV_WILLNEED);
+    _mapped = addr;
+    _data = reinterpret_cast<const char*>(addr);
+  }
+
+  void OpenStream(AfsClient* client, const FsChannelConfig& config) {
+    int err_no = 0;
+    _channel = client->open_r(config, 0, &err_no);
+    PADDLE_ENFORCE_EQ(_channel != nullptr && err_no != -1,
+                      true,
+                      common::errors::Unavailable(
+                          "Fail to open sparse shard file %s.", _path));
+    _offset = 0;
+    ReadExact(&_stream_header, sizeof(_stream_header));
+    _header = &_stream_header;
+    // the length is checked once the last value was read
+    _length = _header->file_size;
+    CheckHeader();
+    uint64_t n = _header->key_num;
+    _key_buffer.resize(n);
+    _size_buffer.resize(n);
+    SkipTo(_header->keys_offset);
+    ReadExact(_key_buffer.data(), n * sizeof(uint64_t));
+    SkipTo(_header->sizes_offset);
+    ReadExact(_size_buffer.data(), n * sizeof(uint32_t));
+    SkipTo(_header->values_offset);
+    _keys = _key_buffer.data();
+    _sizes = _size_buffer.data();
+  }
+
+  // reads the chunk of values holding value i, skipping earlier values
+  void ReadValues(size_t i) {
+    uint64_t n = _header->key_num;
+    PADDLE_ENFORCE_LT(i,
+                      n,
+                      common::errors::OutOfRange(
+                          "Value %d is out of the %d values of sparse shard "
+                          "file %s.",
+                          i,
+                          n,
+                          _path));
+    size_t dim = _header->value_dim;
+    size_t row_bytes = std::max<size_t>(1, dim * sizeof(float));
+    size_t per_chunk = std::max<size_t>(1, kChunkBytes / row_bytes);
+    while (_chunk_end <= i) {
+      _chunk_begin = _chunk_end;
+      _chunk_end = std::min<uint64_t>(_chunk_begin + per_chunk, n);
+      _value_buffer.resize((_chunk_end - _chunk_begin) * dim);
+      ReadExact(_value_buffer.data(), _value_buffer.size() * sizeof(float));
+    }
+    if (_chunk_end == n) {
+      char extra = 0;
+      PADDLE_ENFORCE_EQ(_channel->read(&extra, 1),
+                        0,
+                        common::errors::InvalidArgument(
+                            "Sparse shard file %s is longer than %d bytes.",
+                            _path,
+                            _header->file_size));
+    }
+  }
+
+  void ReadExact(void* data, size_t size) {
+    char* dst = reinterpret_cast<char*>(data);
+    while (size > 0) {
+      size_t chunk = std::min(size, kChunkBytes);
+      PADDLE_ENFORCE_EQ(_channel->read(dst, chunk),
+                        static_cast<int>(chunk),
+                        common::errors::InvalidArgument(
+                            "Sparse shard file %s is truncated at %d bytes.",
+                            _path,
+                            _offset));
+      _offset += chunk;
+      dst += chunk;
+      size -= chunk;
+    }
+  }
+
+  // skips the padding up to a section
+  void SkipTo(uint64_t offset) {
+    char padding[kSparseShardFileAlign];
+    while (_offset < offset) {
+      ReadExact(padding,
+                std::min<uint64_t>(offset - _offset, sizeof(padding)));
+    }
+  }
+
+  void Parse() {
+    PADDLE_ENFORCE_GE(
+        _length,
+        sizeof(SparseShardFileHeader),
+        common::errors::InvalidArgument(
+            "Sparse shard file of %d bytes is truncated.", _length));
+    _header = reinterpret_cast<const SparseShardFileHeader*>(_data);
+    CheckHeader();
+    _keys = reinterpret_cast<const uint64_t*>(_data + _header->keys_offset);
+    _sizes = reinterpret_cast<const uint32_t*>(_data + _header->sizes_offset);
+    _values = reinterpret_cast<const float*>(_data + _header->values_offset);
+  }
+
+  void CheckHeader() {
+    PADDLE_ENFORCE_EQ(
+        memcmp(_header->magic, kSparseShardFileMagic, sizeof(_header->magic)),
+        0,
+        common::errors::InvalidArgument("Not a sparse shard file."));
+    PADDLE_ENFORCE_EQ(_header->version,
+                      kSparseShardFileVersion,
+                      common::errors::Unimplemented(
+                          "Sparse shard file version %d is not supported.",
+                          _header->version));
+    PADDLE_ENFORCE_EQ(_header->file_size,
+                      _length,
+                      common::errors::InvalidArgument(
+                          "Sparse shard file should have %d bytes, but got %d.",
+                          _header->file_size,
+                          _length));
+    uint64_t n = _header->key_num;
+    PADDLE_ENFORCE_EQ(
+        _header->keys_offset >= sizeof(SparseShardFileHeader) &&
+            _header->keys_offset + n * sizeof(uint64_t) <=
+                _header->sizes_offset &&
+            _header->sizes_offset + n * sizeof(uint32_t) <=
+                _header->values_offset &&
+            _header->values_offset +
+                    n * _header->value_dim * sizeof(float) <=
+                _length,
+        true,
+        common::errors::InvalidArgument(
+            "Sparse shard file has overlapping sections."));
+  }
+
+  std::string _path;
+  void* _mapped = nullptr;
+  const char* _data = nullptr;
+  size_t _length = 0;
+  const SparseShardFileHeader* _header = nullptr;
+  const uint64_t* _keys = nullptr;
+  const uint32_t* _sizes = nullptr;
+  const float* _values = nullptr;
+  // streamed files
+  std::shared_ptr<FsReadChannel> _channel;
+  SparseShardFileHeader _stream_header;
+  uint64_t _offset = 0;
+  std::vector<uint64_t> _key_buffer;
+  std::vector<uint32_t> _size_buffer;
+  std::vector<float> _value_buffer;
+  uint64_t _chunk_begin = 0;
+  uint64_t _chunk_end = 0;
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -13,12 +13,15 @@
 // limitations under the License.
 
 #include <omp.h>
+#include <map>
 #include <sstream>
+#include <unordered_set>
 
 #include "glog/logging.h"
 #include "paddle/fluid/distributed/common/cost_timer.h"
 #include "paddle/fluid/distributed/common/local_random.h"
 #include "paddle/fluid/distributed/common/topk_calculator.h"
+#include "paddle/fluid/distributed/ps/table/depends/sparse_shard_file.h"
 #include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
 #include "paddle/fluid/framework/archive.h"
 #include "paddle/fluid/framework/io/fs.h"
@@ -38,6 +41,13 @@ PD_DEFINE_bool(pserver_enable_create_feasign_randomly,
 PD_DEFINE_int32(pserver_table_save_max_retry,
                 3,
                 "pserver_table_save_max_retry");
+PD_DEFINE_int32(pserver_concurrent_shard_init_capacity,
+                1024,
+                "initial slot number of one concurrent sparse table shard");
+PD_DEFINE_int32(pserver_concurrent_min_keys_per_task,
+                512,
+                "min keys handled by one task when the table uses "
+                "concurrent shards");
 
 namespace paddle::distributed {
 
@@ -78,6 +88,41 @@ int32_t MemorySparseTable::InitializeValue() {
 
   _local_shards.reset(new shard_type[_real_local_shard_num]);
 
+  _use_concurrent_shard = _config.enable_concurrent_shard();
+  if (_use_concurrent_shard) {
+    PADDLE_ENFORCE_EQ(
+        _config.enable_revert(),
+        false,
+        common::errors::InvalidArgument(
+            "MemorySparseTable can not enable concurrent shard and revert at "
+            "the same time."));
+    size_t value_dim = _value_accessor->GetAccessorInfo().size / sizeof(float);
+    _concurrent_shards.reset(new concurrent_shard_type[_real_local_shard_num]);
+    for (int i = 0; i < _real_local_shard_num; ++i) {
+      _concurrent_shards[i].Init(value_dim,
+                                 FLAGS_pserver_concurrent_shard_init_capacity);
+    }
+    VLOG(1) << "memory sparse table use concurrent shard, value_dim: "
+            << value_dim;
+  } else if (_config.enable_value_arena()) {
+    size_t value_dim = _value_accessor->GetAccessorInfo().size / sizeof(float);
+    for (int i = 0; i < _real_local_shard_num; ++i) {
+      _local_shards[i].init_value_arena(value_dim);
+    }
+    VLOG(1) << "memory sparse table use value arena, value_dim: " << value_dim;
+  }
+
+  _use_delta_save = _config.enable_delta_save();
+  if (_use_delta_save && _use_concurrent_shard) {
+    LOG(WARNING) << "MemorySparseTable delta save does not support concurrent "
+                    "shard, disable it";
+    _use_delta_save = false;
+  }
+  _saved_epoch.assign(_real_local_shard_num, 0);
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    _local_shards[i].set_track_erased(_use_delta_save);
+  }
+
   if (_config.enable_revert()) {
     // calculate merged shard number based on config param;
     _shard_merge_rate = _config.has_shard_merge_rate()
@@ -120,6 +165,70 @@ int32_t MemorySparseTable::InitializeValue() {
   return 0;
 }
 
+template <class Fn>
+void MemorySparseTable::ForEachValue(int shard_id, Fn &&fn) {
+  if (_use_concurrent_shard) {
+    _concurrent_shards[shard_id].ForEach(std::forward<Fn>(fn));
+    return;
+  }
+  auto &shard = _local_shards[shard_id];
+  for (auto it = shard.begin(); it != shard.end(); ++it) {
+    if (!fn(it.key(), it.value().data(), it.value().size())) {
+      return;
+    }
+  }
+}
+
+template <class Fn>
+void MemorySparseTable::ForEachStampedValue(int shard_id, Fn &&fn) {
+  if (_use_concurrent_shard) {
+    _concurrent_shards[shard_id].ForEach(
+        [&fn](uint64_t key, float *data, size_t size) {
+          return fn(key, nullptr, data, size);
+        });
+    return;
+  }
+  auto &shard = _local_shards[shard_id];
+  for (auto it = shard.begin(); it != shard.end(); ++it) {
+    if (!fn(it.key(),
+            it.value_ptr(),
+            it.value().data(),
+            it.value().size())) {
+      return;
+    }
+  }
+}
+
+template <class Fn>
+void MemorySparseTable::TouchIfChanged(
+    int shard_id, FixedFeatureValue *value, float *data, size_t size, Fn &&fn) {
+  if (!_use_delta_save || value == nullptr) {
+    fn(data);
+    return;
+  }
+  thread_local std::vector<float> old_data;
+  old_data.assign(data, data + size);
+  fn(data);
+  if (memcmp(old_data.data(), data, size * sizeof(float)) != 0) {
+    _local_shards[shard_id].touch(value);
+  }
+}
+
+namespace {
+// delta-<server>-<seq>-<file>.bin, see MemorySparseTable::SaveDelta
+bool ParseDeltaFileName(const std::string &path, int *seq, int *file_idx) {
+  size_t pos = path.find_last_of('/');
+  std::string name = pos == std::string::npos ? path : path.substr(pos + 1);
+  int server_idx = 0;
+  return IsSparseShardFile(name) &&
+         sscanf(name.c_str(),  // NOLINT
+                "delta-%d-%d-%d",
+                &server_idx,
+                seq,
+                file_idx) == 3;
+}
+}  // namespace
+
 int32_t MemorySparseTable::Load(const std::string &path,
                                 const std::string &param) {
   std::string table_path = TableDir(path);
@@ -129,6 +238,21 @@ int32_t MemorySparseTable::Load(const std::string &path,
   for (auto file : file_list) {
     VLOG(1) << "MemorySparseTable::Load() file list: " << file;
   }
+  // deltas of save mode 6 are replayed over the base files in seq order
+  int max_delta_seq = 0;
+  std::map<int, std::map<int, std::string>> delta_files;
+  std::vector<std::string> base_files;
+  for (auto &file : file_list) {
+    int seq = 0;
+    int file_idx = 0;
+    if (ParseDeltaFileName(file, &seq, &file_idx)) {
+      delta_files[file_idx][seq] = file;
+      max_delta_seq = std::max(max_delta_seq, seq);
+    } else {
+      base_files.push_back(file);
+    }
+  }
+  file_list.swap(base_files);
 
   int load_param = atoi(param.c_str());
   size_t expect_shard_num = _sparse_table_shard_num;
@@ -183,6 +307,23 @@ int32_t MemorySparseTable::Load(const std::string &path,
     do {
       is_read_failed = false;
       err_no = 0;
+      mem_count = 0;
+      mem_mf_count = 0;
+      if (IsSparseShardFile(channel_config.path)) {
+        try {
+          LoadBinaryShard(i, channel_config, &mem_count, &mem_mf_count);
+        } catch (...) {
+          ++retry_num;
+          is_read_failed = true;
+          LOG(ERROR) << "MemorySparseTable load failed, retry it! path:"
+                     << channel_config.path << " , retry_num=" << retry_num;
+        }
+        if (retry_num > FLAGS_pserver_table_save_max_retry) {
+          LOG(ERROR) << "MemorySparseTable load failed reach max limit!";
+          exit(-1);
+        }
+        continue;
+      }
       std::string line_data;
       auto read_channel = _afs_client.open_r(channel_config, 0, &err_no);
       char *end = nullptr;
@@ -191,12 +332,30 @@ int32_t MemorySparseTable::Load(const std::string &path,
         while (read_channel->read_line(line_data) == 0 &&
                line_data.size() > 1) {
           uint64_t key = std::strtoul(line_data.data(), &end, 10);
-          auto &value = shard[key];
-          value.resize(feature_value_size);
-          int parse_size =
-              _value_accessor->ParseFromString(++end, value.data());
+          int parse_size = 0;
+          if (_use_concurrent_shard) {
+            ++end;
+            bool created = false;
+            _concurrent_shards[i].Upsert(
+                key,
+                [&](float *data) -> uint32_t {
+                  created = true;
+                  parse_size = _value_accessor->ParseFromString(end, data);
+                  return parse_size;
+                },
+                [&](float *data, uint32_t *size) {
+                  if (!created) {
+                    parse_size = _value_accessor->ParseFromString(end, data);
+                    *size = parse_size;
+                  }
+                });
+          } else {
+            auto &value = shard[key];
+            value.resize(feature_value_size);
+            parse_size = _value_accessor->ParseFromString(++end, value.data());
+            value.resize(parse_size);
+          }
           mem_count++;
-          value.resize(parse_size);
           if (parse_size >
               static_cast<int>(feature_value_size - mf_value_size)) {
             mem_mf_count++;
@@ -223,15 +382,123 @@ int32_t MemorySparseTable::Load(const std::string &path,
     } while (is_read_failed);
     VLOG(0) << "Table>> load done. ALL[" << mem_count << "] MEM[" << mem_count
             << "] MEM_MF[" << mem_mf_count << "]";
+
+    std::map<int, std::string> deltas;
+    auto delta_it = delta_files.find(file_start_idx + i);
+    if (delta_it != delta_files.end()) {
+      deltas = delta_it->second;
+    }
+    for (auto &delta : deltas) {
+      FsChannelConfig delta_config = {};
+      delta_config.path = delta.second;
+      uint64_t delta_count = 0;
+      uint64_t delta_mf_count = 0;
+      retry_num = 0;
+      while (true) {
+        try {
+          LoadBinaryShard(i, delta_config, &delta_count, &delta_mf_count);
+          break;
+        } catch (...) {
+          ++retry_num;
+          LOG(ERROR) << "MemorySparseTable load delta failed, retry it! path:"
+                     << delta_config.path << " , retry_num=" << retry_num;
+        }
+        if (retry_num > FLAGS_pserver_table_save_max_retry) {
+          LOG(ERROR) << "MemorySparseTable load delta failed reach max limit!";
+          exit(-1);
+        }
+      }
+      VLOG(0) << "Table>> replay delta " << delta_config.path << " done. MEM["
+              << delta_count << "]";
+    }
+    if (!_use_concurrent_shard) {
+      // the loaded state is the base of the next delta save
+      std::vector<uint64_t> erased_keys;
+      _local_shards[i].take_erased_keys(&erased_keys);
+      _saved_epoch[i] = _local_shards[i].advance_epoch();
+    }
   }
+  _delta_base_dir = path;
+  _delta_seq = max_delta_seq;
   LOG(INFO) << "MemorySparseTable load success, path from "
             << file_list[file_start_idx] << " to "
             << file_list[file_start_idx + _real_local_shard_num - 1];
   return 0;
 }
 
+void MemorySparseTable::LoadBinaryShard(int shard_id,
+                                        const FsChannelConfig &channel_config,
+                                        uint64_t *mem_count,
+                                        uint64_t *mem_mf_count) {
+  size_t feature_value_size =
+      _value_accessor->GetAccessorInfo().size / sizeof(float);
+  size_t mf_value_size =
+      _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
+  // binary shards are written without a converter
+  FsChannelConfig raw_config = {};
+  raw_config.path = channel_config.path;
+  SparseShardFileReader reader;
+  reader.Open(&_afs_client, raw_config);
+  PADDLE_ENFORCE_EQ(reader.value_dim(),
+                    feature_value_size,
+                    common::errors::InvalidArgument(
+                        "Sparse shard file %s has values of %d floats, but "
+                        "the accessor expects %d.",
+                        channel_config.path,
+                        reader.value_dim(),
+                        feature_value_size));
+  auto &shard = _local_shards[shard_id];
+  // erases of concurrent shards are batched, a delta lists the erased keys
+  // before the values, so a key created again drops out of the batch
+  std::unordered_set<uint64_t> erased_keys;
+  for (size_t j = 0; j < reader.key_num(); ++j) {
+    uint32_t size = std::min<uint32_t>(reader.size(j), feature_value_size);
+    const float *src = reader.value(j);
+    if (size == 0) {
+      if (_use_concurrent_shard) {
+        erased_keys.insert(reader.key(j));
+      } else {
+        shard.erase(reader.key(j));
+      }
+      continue;
+    }
+    if (_use_concurrent_shard) {
+      erased_keys.erase(reader.key(j));
+      _concurrent_shards[shard_id].Upsert(
+          reader.key(j),
+          [&](float *data) -> uint32_t {
+            memcpy(data, src, size * sizeof(float));
+            return size;
+          },
+          [&](float *data, uint32_t *old_size) {
+            memcpy(data, src, size * sizeof(float));
+            *old_size = size;
+          });
+    } else {
+      auto &value = shard[reader.key(j)];
+      value.resize(size);
+      memcpy(value.data(), src, size * sizeof(float));
+    }
+    ++(*mem_count);
+    if (size > feature_value_size - mf_value_size) {
+      ++(*mem_mf_count);
+    }
+  }
+  if (!erased_keys.empty()) {
+    _concurrent_shards[shard_id].EraseIf(
+        [&erased_keys](uint64_t key, float *data, size_t size) {
+          return erased_keys.count(key) > 0;
+        });
+  }
+}
+
 int32_t MemorySparseTable::LoadPatch(const std::vector<std::string> &file_list,
                                      int load_param) {
+  PADDLE_ENFORCE_EQ(_use_concurrent_shard,
+                    false,
+                    common::errors::Unimplemented(
+                        "LoadPatch is not supported by MemorySparseTable with "
+                        "concurrent shard."));
   if (!_config.enable_revert()) {
     LOG(INFO) << "MemorySparseTable should be enabled revert.";
     return 0;
@@ -368,6 +635,10 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
         &MemorySparseTable::SavePatch, this, std::string(dirname), save_param));
     return 0;
   }
+  // checkpoint delta
+  if (save_param == 6) {
+    return SaveDelta(dirname);
+  }
 
   // cache model
   int64_t tk_size = LocalSize() * _config.sparse_table_cache_rate();
@@ -376,9 +647,19 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
   std::string table_path = TableDir(dirname);
   _afs_client.remove(::paddle::string::format_string(
       "%s/part-%03d-*", table_path.c_str(), _shard_idx));
+  if (save_param == 0) {
+    // deltas of an older base must not be replayed over this one
+    _afs_client.remove(::paddle::string::format_string(
+        "%s/delta-%03d-*", table_path.c_str(), _shard_idx));
+  }
   std::atomic<uint32_t> feasign_size_all{0};
 
   size_t file_start_idx = _avg_local_shard_num * _shard_idx;
+  // only checkpoints and batch models, xbox models stay text
+  bool binary_save =
+      _config.binary_checkpoint() && (save_param == 0 || save_param == 3);
+  size_t feature_value_size =
+      _value_accessor->GetAccessorInfo().size / sizeof(float);
 
 #ifdef PADDLE_WITH_HETERPS
   int thread_num = _real_local_shard_num;
@@ -389,7 +670,15 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
 #pragma omp parallel for schedule(dynamic)
   for (int i = 0; i < _real_local_shard_num; ++i) {
     FsChannelConfig channel_config = {};
-    if (_config.compress_in_save() && (save_param == 0 || save_param == 3)) {
+    if (binary_save) {
+      channel_config.path =
+          ::paddle::string::format_string("%s/part-%03d-%05d%s",
+                                          table_path.c_str(),
+                                          _shard_idx,
+                                          file_start_idx + i,
+                                          kSparseShardFileSuffix);
+    } else if (_config.compress_in_save() &&
+               (save_param == 0 || save_param == 3)) {
       channel_config.path =
           ::paddle::string::format_string("%s/part-%03d-%05d.gz",
                                           table_path.c_str(),
@@ -401,50 +690,79 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
                                                             _shard_idx,
                                                             file_start_idx + i);
     }
-    channel_config.converter = _value_accessor->Converter(save_param).converter;
-    channel_config.deconverter =
-        _value_accessor->Converter(save_param).deconverter;
+    // a binary shard is mapped on load, so it is never compressed
+    if (!binary_save) {
+      channel_config.converter =
+          _value_accessor->Converter(save_param).converter;
+      channel_config.deconverter =
+          _value_accessor->Converter(save_param).deconverter;
+    }
     bool is_write_failed = false;
     int feasign_size = 0;
     int retry_num = 0;
     int err_no = 0;
-    auto &shard = _local_shards[i];
+    SparseShardFileWriter shard_writer(feature_value_size);
+    uint32_t closed_epoch = 0;
+    if (_use_delta_save) {
+      closed_epoch = _local_shards[i].advance_epoch();
+    }
 #if defined(PADDLE_WITH_HETERPS) && defined(PADDLE_WITH_PSCORE)
     // for incremental training, batch_model increase unseenday before save
     if (_use_gpu_graph && save_param == 3) {
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        _value_accessor->UpdateStatAfterSave(it.value().data(), save_param);
-      }
+      ForEachValue(i, [&](uint64_t key, float *data, size_t size) {
+        _value_accessor->UpdateStatAfterSave(data, save_param);
+        return true;
+      });
     }
 #endif
     do {
       err_no = 0;
       feasign_size = 0;
       is_write_failed = false;
+      shard_writer.Clear();
       auto write_channel =
           _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
+      ForEachStampedValue(i, [&](uint64_t key,
+                                 FixedFeatureValue *value,
+                                 float *data,
+                                 size_t size) {
         if (_config.enable_sparse_table_cache() &&
             (save_param == 1 || save_param == 2) &&
-            _value_accessor->Save(it.value().data(), 4)) {
+            _value_accessor->Save(data, 4)) {
           CostTimer timer10("sprase table top push");
-          tk.push(i, _value_accessor->GetField(it.value().data(), "show"));
+          tk.push(i, _value_accessor->GetField(data, "show"));
         }
-
-        if (_value_accessor->Save(it.value().data(), save_param)) {
-          std::string format_value = _value_accessor->ParseToString(
-              it.value().data(), it.value().size());
+        bool need_save = false;
+        // the filter may reset fields of the values it accepts
+        TouchIfChanged(i, value, data, size, [&](float *value_data) {
+          need_save = _value_accessor->Save(value_data, save_param);
+        });
+        if (need_save) {
+          if (binary_save) {
+            shard_writer.Add(key, data, size);
+            ++feasign_size;
+            return true;
+          }
+          std::string format_value = _value_accessor->ParseToString(data, size);
           if (0 != write_channel->write_line(::paddle::string::format_string(
-                       "%lu %s", it.key(), format_value.c_str()))) {
+                       "%lu %s", key, format_value.c_str()))) {
             ++retry_num;
             is_write_failed = true;
             LOG(ERROR)
                 << "MemorySparseTable save prefix failed, retry it! path:"
                 << channel_config.path << " , retry_num=" << retry_num;
-            break;
+            return false;
           }
           ++feasign_size;
         }
+        return true;
+      });
+      if (binary_save && !is_write_failed &&
+          shard_writer.Write(write_channel.get()) != 0) {
+        ++retry_num;
+        is_write_failed = true;
+        LOG(ERROR) << "MemorySparseTable save prefix failed, retry it! path:"
+                   << channel_config.path << " , retry_num=" << retry_num;
       }
       write_channel->close();
       if (err_no == -1) {
@@ -463,23 +781,127 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
       }
     } while (is_write_failed);
     feasign_size_all += feasign_size;
-    if (!_use_gpu_graph) {
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        _value_accessor->UpdateStatAfterSave(it.value().data(), save_param);
-      }
-    } else if (save_param != 3) {
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        _value_accessor->UpdateStatAfterSave(it.value().data(), save_param);
-      }
+    if (!_use_gpu_graph || save_param != 3) {
+      ForEachStampedValue(i, [&](uint64_t key,
+                                 FixedFeatureValue *value,
+                                 float *data,
+                                 size_t size) {
+        TouchIfChanged(i, value, data, size, [&](float *value_data) {
+          _value_accessor->UpdateStatAfterSave(value_data, save_param);
+        });
+        return true;
+      });
+    }
+    if (_use_delta_save && save_param == 0) {
+      std::vector<uint64_t> erased_keys;
+      _local_shards[i].take_erased_keys(&erased_keys);
+      _saved_epoch[i] = closed_epoch;
     }
     LOG(INFO) << "MemorySparseTable save prefix success, path: "
               << channel_config.path << " feasign_size: " << feasign_size;
   }
+  if (save_param == 0) {
+    _delta_base_dir = dirname;
+    _delta_seq = 0;
+  }
   _local_show_threshold = tk.top();
   // int32 may overflow need to change return value
   return 0;
 }
 
+int32_t MemorySparseTable::SaveDelta(const std::string &dirname) {
+  if (!_use_delta_save || _delta_base_dir != dirname) {
+    LOG(WARNING) << "MemorySparseTable has no base to save a delta of in "
+                 << dirname << ", save a checkpoint instead";
+    return Save(dirname, "0");
+  }
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    if (_local_shards[i].erased_overflow()) {
+      LOG(WARNING) << "MemorySparseTable erased more keys since the last "
+                   << "save than a delta is worth, save a checkpoint instead";
+      return Save(dirname, "0");
+    }
+  }
+  std::string table_path = TableDir(dirname);
+  size_t file_start_idx = _avg_local_shard_num * _shard_idx;
+  size_t feature_value_size =
+      _value_accessor->GetAccessorInfo().size / sizeof(float);
+  int delta_seq = ++_delta_seq;
+  std::atomic<uint32_t> feasign_size_all{0};
+  std::atomic<uint32_t> erased_size_all{0};
+
+  int thread_num = _real_local_shard_num < 20 ? _real_local_shard_num : 20;
+  omp_set_num_threads(thread_num);
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    auto &shard = _local_shards[i];
+    uint32_t closed_epoch = shard.advance_epoch();
+    std::vector<uint64_t> erased_keys;
+    shard.take_erased_keys(&erased_keys);
+    // erased keys go first, a key erased and created again is replayed as
+    // an erase followed by its new value
+    SparseShardFileWriter shard_writer(feature_value_size);
+    for (auto key : erased_keys) {
+      shard_writer.Add(key, nullptr, 0);
+    }
+    for (auto it = shard.begin(); it != shard.end(); ++it) {
+      if (it.value().epoch() > _saved_epoch[i]) {
+        shard_writer.Add(it.key(), it.value().data(), it.value().size());
+      }
+    }
+
+    FsChannelConfig channel_config = {};
+    channel_config.path =
+        ::paddle::string::format_string("%s/delta-%03d-%05d-%05d%s",
+                                        table_path.c_str(),
+                                        _shard_idx,
+                                        delta_seq,
+                                        file_start_idx + i,
+                                        kSparseShardFileSuffix);
+    bool is_write_failed = false;
+    int retry_num = 0;
+    int err_no = 0;
+    do {
+      err_no = 0;
+      is_write_failed = false;
+      auto write_channel =
+          _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
+      if (shard_writer.Write(write_channel.get()) != 0) {
+        ++retry_num;
+        is_write_failed = true;
+        LOG(ERROR) << "MemorySparseTable save delta failed, retry it! path:"
+                   << channel_config.path << " , retry_num=" << retry_num;
+      }
+      write_channel->close();
+      if (err_no == -1) {
+        ++retry_num;
+        is_write_failed = true;
+        LOG(ERROR) << "MemorySparseTable save delta failed after write, retry "
+                   << "it! path:" << channel_config.path
+                   << " , retry_num=" << retry_num;
+      }
+      if (is_write_failed) {
+        _afs_client.remove(channel_config.path);
+      }
+      if (retry_num > FLAGS_pserver_table_save_max_retry) {
+        LOG(ERROR) << "MemorySparseTable save delta failed reach max limit!";
+        exit(-1);
+      }
+    } while (is_write_failed);
+    _saved_epoch[i] = closed_epoch;
+    erased_size_all += erased_keys.size();
+    feasign_size_all += shard_writer.size() - erased_keys.size();
+    LOG(INFO) << "MemorySparseTable save delta success, path: "
+              << channel_config.path
+              << " feasign_size: " << shard_writer.size() - erased_keys.size()
+              << " erased_size: " << erased_keys.size();
+  }
+  LOG(INFO) << "MemorySparseTable save delta " << delta_seq
+            << " done, feasign_size: " << feasign_size_all
+            << " erased_size: " << erased_size_all;
+  return 0;
+}
+
 #if defined(PADDLE_WITH_HETERPS) && defined(PADDLE_WITH_PSCORE)
 int32_t MemorySparseTable::Save_v2(const std::string &dirname,
                                    const std::string &param) {
@@ -566,13 +988,16 @@ int32_t MemorySparseTable::Save_v2(const std::string &dirname,
     int retry_num_for_slot_feature = 0;
     int err_no = 0;
     int err_no_for_slot_feature = 0;
-    auto &shard = _local_shards[i];
+    const auto UpdateStatAfterSave = [&]() {
+      ForEachValue(i, [&](uint64_t key, float *data, size_t size) {
+        _value_accessor->UpdateStatAfterSave(data, save_param);
+        return true;
+      });
+    };
 #if defined(PADDLE_WITH_HETERPS) && defined(PADDLE_WITH_PSCORE)
     // for incremental training, batch_model increase unseenday before save
     if (_use_gpu_graph && save_param == 3) {
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        _value_accessor->UpdateStatAfterSave(it.value().data(), save_param);
-      }
+      UpdateStatAfterSave();
     }
 #endif
     do {
@@ -588,44 +1013,45 @@ int32_t MemorySparseTable::Save_v2(const std::string &dirname,
                              1024 * 1024 * 40,
                              &err_no_for_slot_feature);
 
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
+      ForEachValue(i, [&](uint64_t key, float *data, size_t size) {
         if (_config.enable_sparse_table_cache() &&
             (save_param == 1 || save_param == 2) &&
-            _value_accessor->Save(it.value().data(), 4)) {
+            _value_accessor->Save(data, 4)) {
           CostTimer timer10("sparse table top push");
-          tk.push(i, _value_accessor->GetField(it.value().data(), "show"));
+          tk.push(i, _value_accessor->GetField(data, "show"));
         }
 
-        if (_value_accessor->Save(it.value().data(), save_param)) {
-          std::string format_value = _value_accessor->ParseToString(
-              it.value().data(), it.value().size());
+        if (_value_accessor->Save(data, save_param)) {
+          std::string format_value =
+              _value_accessor->ParseToString(data, size);
           if (0 != write_channel->write_line(::paddle::string::format_string(
-                       "%lu %s", it.key(), format_value.c_str()))) {
+                       "%lu %s", key, format_value.c_str()))) {
             ++retry_num;
             is_write_failed = true;
             LOG(ERROR)
                 << "MemorySparseTable save prefix failed, retry it! path:"
                 << channel_config.path << " , retry_num=" << retry_num;
-            break;
+            return false;
           }
           ++feasign_size;
           // save non 9008 slot's feasign
-          if (_value_accessor->SaveFilterSlot(it.value().data())) {
+          if (_value_accessor->SaveFilterSlot(data)) {
             if (0 != write_channel_for_slot_feature->write_line(
                          paddle::string::format_string(
-                             "%lu %s", it.key(), format_value.c_str()))) {
+                             "%lu %s", key, format_value.c_str()))) {
               ++retry_num_for_slot_feature;
               is_write_failed_for_slot_feature = true;
               LOG(ERROR) << "MemorySparseTable save slot feature failed, retry "
                             "it! path:"
                          << channel_config_for_slot_feature.path
                          << " , retry_num=" << retry_num_for_slot_feature;
-              break;
+              return false;
             }
             ++feasign_size_for_slot_feature;
           }
         }
-      }
+        return true;
+      });
       write_channel->close();
       write_channel_for_slot_feature->close();
       if (err_no == -1) {
@@ -662,14 +1088,8 @@ int32_t MemorySparseTable::Save_v2(const std::string &dirname,
 
     feasign_size_all += feasign_size;
     feasign_size_all_for_slot_feature += feasign_size_for_slot_feature;
-    if (!_use_gpu_graph) {
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        _value_accessor->UpdateStatAfterSave(it.value().data(), save_param);
-      }
-    } else if (save_param != 3) {
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        _value_accessor->UpdateStatAfterSave(it.value().data(), save_param);
-      }
+    if (!_use_gpu_graph || save_param != 3) {
+      UpdateStatAfterSave();
     }
     LOG(INFO) << "MemorySparseTable save prefix&feature success, path: "
               << channel_config.path << " feasign_size: " << feasign_size
@@ -683,6 +1103,11 @@ int32_t MemorySparseTable::Save_v2(const std::string &dirname,
 #endif
 
 int32_t MemorySparseTable::SavePatch(const std::string &path, int save_param) {
+  PADDLE_ENFORCE_EQ(_use_concurrent_shard,
+                    false,
+                    common::errors::Unimplemented(
+                        "SavePatch is not supported by MemorySparseTable with "
+                        "concurrent shard."));
   if (!_config.enable_revert()) {
     LOG(INFO) << "MemorySparseTable should be enabled revert.";
     return 0;
@@ -780,6 +1205,11 @@ int64_t MemorySparseTable::CacheShuffle(
     ::paddle::framework::Channel<std::pair<uint64_t, std::string>>
         &shuffled_channel,
     const std::vector<Table *> &table_ptrs) {
+  PADDLE_ENFORCE_EQ(_use_concurrent_shard,
+                    false,
+                    common::errors::Unimplemented(
+                        "CacheShuffle is not supported by MemorySparseTable "
+                        "with concurrent shard."));
   LOG(INFO) << "cache shuffle with cache threshold: " << cache_threshold;
   int save_param = atoi(param.c_str());  // batch_model:0  xbox:1
   if (!_config.enable_sparse_table_cache() || cache_threshold < 0) {
@@ -936,7 +1366,8 @@ int32_t MemorySparseTable::SaveCache(
 int64_t MemorySparseTable::LocalSize() {
   int64_t local_size = 0;
   for (int i = 0; i < _real_local_shard_num; ++i) {
-    local_size += _local_shards[i].size();
+    local_size += _use_concurrent_shard ? _concurrent_shards[i].size()
+                                        : _local_shards[i].size();
   }
   return local_size;
 }
@@ -949,13 +1380,13 @@ int64_t MemorySparseTable::LocalMFSize() {
     tasks[shard_id] =
         _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
             [this, shard_id, &size_arr]() -> int {
-              auto &local_shard = _local_shards[shard_id];
-              for (auto it = local_shard.begin(); it != local_shard.end();
-                   ++it) {
-                if (_value_accessor->HasMF(it.value().size())) {
-                  size_arr[shard_id] += 1;
-                }
-              }
+              ForEachValue(shard_id,
+                           [&](uint64_t key, float *data, size_t size) {
+                             if (_value_accessor->HasMF(size)) {
+                               size_arr[shard_id] += 1;
+                             }
+                             return true;
+                           });
               return 0;
             });
   }
@@ -974,6 +1405,30 @@ std::pair<int64_t, int64_t> MemorySparseTable::PrintTableStat() {
   return {feasign_size, mf_size};
 }
 
+std::pair<int64_t, int64_t> MemorySparseTable::PrintTableMemoryStat() {
+  int64_t reserved_bytes = 0;
+  int64_t used_bytes = 0;
+  size_t value_bytes = _value_accessor->GetAccessorInfo().size;
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    if (_use_concurrent_shard) {
+      reserved_bytes += _concurrent_shards[i].memory_size();
+      used_bytes += _concurrent_shards[i].size() * value_bytes;
+      continue;
+    }
+    auto *arena = _local_shards[i].value_arena();
+    if (arena == nullptr) {
+      continue;
+    }
+    auto stat = arena->Stat();
+    reserved_bytes += stat.reserved_bytes + stat.fallback_bytes;
+    used_bytes += stat.used_bytes + stat.fallback_bytes;
+  }
+  VLOG(0) << "MemorySparseTable memory stat, table_id: " << _config.table_id()
+          << " reserved_bytes: " << reserved_bytes
+          << " used_bytes: " << used_bytes;
+  return {reserved_bytes, used_bytes};
+}
+
 int32_t MemorySparseTable::Pull(TableContext &context) {
   PADDLE_ENFORCE_EQ(
       context.value_type,
@@ -1012,6 +1467,9 @@ int32_t MemorySparseTable::Push(TableContext &context) {
 
 int32_t MemorySparseTable::PullSparse(float *pull_values,
                                       const PullSparseValue &pull_value) {
+  if (_use_concurrent_shard) {
+    return PullSparseConcurrent(pull_values, pull_value);
+  }
   CostTimer timer("pserver_sparse_select_all");
   std::vector<std::future<int>> tasks(_real_local_shard_num);
 
@@ -1087,11 +1545,139 @@ int32_t MemorySparseTable::PullSparse(float *pull_values,
   return 0;
 }
 
+// With concurrent shards any pool thread may serve any key, so a request is
+// cut into contiguous chunks instead of being routed by shard. Small
+// requests run on the calling thread.
+static void RunChunked(
+    const std::vector<std::shared_ptr<::ThreadPool>> &task_pool,
+    size_t num,
+    const std::function<void(size_t, size_t)> &fn) {
+  size_t min_keys = std::max(FLAGS_pserver_concurrent_min_keys_per_task, 1);
+  size_t task_num =
+      std::min(task_pool.size(), (num + min_keys - 1) / min_keys);
+  if (task_num <= 1) {
+    fn(0, num);
+    return;
+  }
+  size_t chunk = (num + task_num - 1) / task_num;
+  size_t pool_offset = local_random_engine()() % task_pool.size();
+  std::vector<std::future<void>> tasks;
+  tasks.reserve(task_num);
+  for (size_t begin = 0, i = 0; begin < num; begin += chunk, ++i) {
+    size_t end = std::min(begin + chunk, num);
+    tasks.push_back(task_pool[(pool_offset + i) % task_pool.size()]->enqueue(
+        [&fn, begin, end]() { fn(begin, end); }));
+  }
+  for (auto &task : tasks) {
+    task.wait();
+  }
+}
+
+int32_t MemorySparseTable::PullSparseConcurrent(
+    float *pull_values, const PullSparseValue &pull_value) {
+  CostTimer timer("pserver_sparse_select_all");
+  const size_t value_size =
+      _value_accessor->GetAccessorInfo().size / sizeof(float);
+  size_t mf_value_size =
+      _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
+  size_t select_value_size =
+      _value_accessor->GetAccessorInfo().select_size / sizeof(float);
+
+  RunChunked(
+      _shards_task_pool, pull_value.numel_, [&](size_t begin, size_t end) {
+        float data_buffer[value_size];  // NOLINT
+        float *data_buffer_ptr = data_buffer;
+        for (size_t i = begin; i < end; ++i) {
+          uint64_t key = pull_value.feasigns_[i];
+          int shard_id =
+              (key % _sparse_table_shard_num) % _avg_local_shard_num;
+          auto &local_shard = _concurrent_shards[shard_id];
+          int data_size = local_shard.Find(key, data_buffer);
+          if (data_size < 0) {
+            data_size = static_cast<int>(value_size - mf_value_size);
+            if (FLAGS_pserver_create_value_when_push) {
+              memset(data_buffer, 0, sizeof(float) * data_size);
+            } else {
+              local_shard.Upsert(
+                  key,
+                  [&](float *data) -> uint32_t {
+                    _value_accessor->Create(&data, 1);
+                    return data_size;
+                  },
+                  [&](float *data, uint32_t *size) {
+                    data_size = *size;
+                    memcpy(data_buffer, data, data_size * sizeof(float));
+                  });
+            }
+          }
+          for (size_t mf_idx = data_size; mf_idx < value_size; ++mf_idx) {
+            data_buffer[mf_idx] = 0.0;
+          }
+          float *select_data = pull_values + select_value_size * i;
+          _value_accessor->Select(
+              &select_data, (const float **)&data_buffer_ptr, 1);
+        }
+      });
+  return 0;
+}
+
+template <class GetUpdateData>
+int32_t MemorySparseTable::PushSparseConcurrent(
+    const uint64_t *keys, size_t num, GetUpdateData get_update_data) {
+  CostTimer timer("pserver_sparse_update_all");
+  const size_t value_col =
+      _value_accessor->GetAccessorInfo().size / sizeof(float);
+  size_t mf_value_col =
+      _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
+
+  RunChunked(_shards_task_pool, num, [&](size_t begin, size_t end) {
+    float data_buffer[value_col];  // NOLINT
+    float *data_buffer_ptr = data_buffer;
+    for (size_t i = begin; i < end; ++i) {
+      uint64_t key = keys[i];
+      const float *update_data = get_update_data(i);
+      int shard_id = (key % _sparse_table_shard_num) % _avg_local_shard_num;
+      _concurrent_shards[shard_id].Upsert(
+          key,
+          [&](float *data) -> uint32_t {
+            if (FLAGS_pserver_enable_create_feasign_randomly &&
+                !_value_accessor->CreateValue(1, update_data)) {
+              return 0;
+            }
+            _value_accessor->Create(&data, 1);
+            return value_col - mf_value_col;
+          },
+          [&](float *value_data, uint32_t *value_size) {
+            if (*value_size == value_col) {  // 已拓展到最大size, 则就地update
+              _value_accessor->Update(&value_data, &update_data, 1);
+              return;
+            }
+            // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
+            memcpy(data_buffer_ptr, value_data, *value_size * sizeof(float));
+            _value_accessor->Update(&data_buffer_ptr, &update_data, 1);
+            if (_value_accessor->NeedExtendMF(data_buffer)) {
+              _value_accessor->Create(&value_data, 1);
+              memcpy(value_data, data_buffer_ptr, *value_size * sizeof(float));
+              *value_size = value_col;
+            } else {
+              memcpy(value_data, data_buffer_ptr, *value_size * sizeof(float));
+            }
+          });
+    }
+  });
+  return 0;
+}
+
 int32_t MemorySparseTable::PullSparsePtr(int shard_id,  // fake num
                                          char **pull_values,
                                          const uint64_t *keys,
                                          size_t num,
                                          uint16_t pass_id) {
+  PADDLE_ENFORCE_EQ(_use_concurrent_shard,
+                    false,
+                    common::errors::Unimplemented(
+                        "PullSparsePtr is not supported by MemorySparseTable "
+                        "with concurrent shard, values are stored inline."));
   CostTimer timer("pscore_sparse_select_all");
   size_t value_size = _value_accessor->GetAccessorInfo().size / sizeof(float);
   size_t mf_value_size =
@@ -1149,6 +1735,14 @@ int32_t MemorySparseTable::PullSparsePtr(int shard_id,  // fake num
 int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
                                       const float *values,
                                       size_t num) {
+  if (_use_concurrent_shard) {
+    size_t update_value_col =
+        _value_accessor->GetAccessorInfo().update_size / sizeof(float);
+    return PushSparseConcurrent(
+        keys, num, [values, update_value_col](size_t idx) {
+          return values + idx * update_value_col;
+        });
+  }
   CostTimer timer("pserver_sparse_update_all");
   std::vector<std::future<int>> tasks(_real_local_shard_num);
   std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
@@ -1179,6 +1773,7 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
           auto &local_shard_new = _local_shards_new[shard_id];
           float data_buffer[value_col];  // NOLINT
           float *data_buffer_ptr = data_buffer;
+          ValueUpdateBatcher batcher(_value_accessor.get());
           for (auto &item : keys) {
             uint64_t key = item.first;
             uint64_t push_data_idx = item.second;
@@ -1205,7 +1800,7 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
             size_t value_size = feature_value.size();
 
             if (value_size == value_col) {  // 已拓展到最大size, 则就地update
-              _value_accessor->Update(&value_data, &update_data, 1);
+              batcher.Add(value_data, update_data);
             } else {
               // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
               memcpy(data_buffer_ptr, value_data, value_size * sizeof(float));
@@ -1218,7 +1813,9 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
               }
               memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
             }
+            local_shard.touch(&feature_value);
             if (_config.enable_revert()) {
+              batcher.Flush();
               FixedFeatureValue *feature_value_new = &(local_shard_new[key]);
               auto new_size = feature_value.size();
               feature_value_new->resize(new_size);
@@ -1240,6 +1837,10 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
 int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
                                       const float **values,
                                       size_t num) {
+  if (_use_concurrent_shard) {
+    return PushSparseConcurrent(
+        keys, num, [values](size_t idx) { return values[idx]; });
+  }
   std::vector<std::future<int>> tasks(_real_local_shard_num);
   std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
       _real_local_shard_num);
@@ -1259,6 +1860,7 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
           auto &local_shard = _local_shards[shard_id];
           float data_buffer[value_col];  // NOLINT
           float *data_buffer_ptr = data_buffer;
+          ValueUpdateBatcher batcher(_value_accessor.get());
           for (auto &item : keys) {
             uint64_t key = item.first;
             uint64_t push_data_idx = item.second;
@@ -1282,7 +1884,7 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
             float *value_data = feature_value.data();
             size_t value_size = feature_value.size();
             if (value_size == value_col) {  // 已拓展到最大size, 则就地update
-              _value_accessor->Update(&value_data, &update_data, 1);
+              batcher.Add(value_data, update_data);
             } else {
               // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
               memcpy(data_buffer_ptr, value_data, value_size * sizeof(float));
@@ -1294,6 +1896,7 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
               }
               memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
             }
+            local_shard.touch(&feature_value);
           }
           return 0;
         });
@@ -1310,25 +1913,36 @@ int32_t MemorySparseTable::Flush() { return 0; }
 int32_t MemorySparseTable::Shrink(const std::string &param) {
   VLOG(0) << "MemorySparseTable::Shrink";
   std::atomic<uint32_t> shrink_size_all{0};
+  std::atomic<uint64_t> released_bytes_all{0};
   int thread_num = _real_local_shard_num;
   omp_set_num_threads(thread_num);
 #pragma omp parallel for schedule(dynamic)
   for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
     // Shrink
     int feasign_size = 0;
+    if (_use_concurrent_shard) {
+      shrink_size_all += _concurrent_shards[shard_id].EraseIf(
+          [this](uint64_t key, float *data, size_t size) {
+            return _value_accessor->Shrink(data);
+          });
+      continue;
+    }
     auto &shard = _local_shards[shard_id];
     for (auto it = shard.begin(); it != shard.end();) {
       if (_value_accessor->Shrink(it.value().data())) {
         it = shard.erase(it);
         ++feasign_size;
       } else {
+        // decayed, so the next delta save writes it
+        shard.touch(it.value_ptr());
         ++it;
       }
     }
     shrink_size_all += feasign_size;
+    released_bytes_all += shard.compact_values();
   }
   VLOG(0) << "MemorySparseTable::Shrink success, shrink size:"
-          << shrink_size_all;
+          << shrink_size_all << ", released bytes:" << released_bytes_all;
   return 0;
 }
 
@@ -28,6 +28,7 @@
 #include "Eigen/Dense"
 #include "paddle/fluid/distributed/ps/table/accessor.h"
 #include "paddle/fluid/distributed/ps/table/common_table.h"
+#include "paddle/fluid/distributed/ps/table/depends/concurrent_sparse_shard.h"
 #include "paddle/fluid/distributed/ps/table/depends/feature_value.h"
 #include "paddle/utils/string/string_helper.h"
 
@@ -39,6 +40,7 @@ namespace distributed {
 class MemorySparseTable : public Table {
  public:
   typedef SparseTableShard<uint64_t, FixedFeatureValue> shard_type;
+  typedef ConcurrentSparseTableShard concurrent_shard_type;
   MemorySparseTable() {}
   virtual ~MemorySparseTable() {}
 
@@ -91,6 +93,7 @@ class MemorySparseTable : public Table {
   int64_t LocalMFSize();
 
   std::pair<int64_t, int64_t> PrintTableStat() override;
+  std::pair<int64_t, int64_t> PrintTableMemoryStat() override;
   int32_t PullSparse(float* values, const PullSparseValue& pull_value);
 
   int32_t PullSparsePtr(int shard_id,
@@ -118,6 +121,38 @@ class MemorySparseTable : public Table {
   virtual int32_t SavePatch(const std::string& path, int save_param);
   virtual int32_t LoadPatch(const std::vector<std::string>& file_list,
                             int save_param);
+  // bulk loads a binary shard file written by a binary_checkpoint save or
+  // a delta save, values of size 0 in a delta erase their key
+  void LoadBinaryShard(int shard_id,
+                       const FsChannelConfig& channel_config,
+                       uint64_t* mem_count,
+                       uint64_t* mem_mf_count);
+  // save mode 6, writes the values changed and the keys erased since the
+  // last base (mode 0) or delta save into the base's directory
+  int32_t SaveDelta(const std::string& dirname);
+
+  // concurrent shard mode, see ConcurrentSparseTableShard
+  int32_t PullSparseConcurrent(float* pull_values,
+                               const PullSparseValue& pull_value);
+  template <class GetUpdateData>
+  int32_t PushSparseConcurrent(const uint64_t* keys,
+                               size_t num,
+                               GetUpdateData get_update_data);
+  // visits (key, data, size) of one local shard in either shard mode,
+  // stops once fn returns false
+  template <class Fn>
+  void ForEachValue(int shard_id, Fn&& fn);
+  // like ForEachValue, fn(key, value, data, size) also gets the value
+  // object for its dirty epoch, nullptr in concurrent shard mode
+  template <class Fn>
+  void ForEachStampedValue(int shard_id, Fn&& fn);
+  // runs fn on data and marks the value dirty if fn changed it
+  template <class Fn>
+  void TouchIfChanged(int shard_id,
+                      FixedFeatureValue* value,
+                      float* data,
+                      size_t size,
+                      Fn&& fn);
 
   int _task_pool_size = 24;
   int _avg_local_shard_num;
@@ -125,6 +160,14 @@ class MemorySparseTable : public Table {
   int _sparse_table_shard_num;
   std::vector<std::shared_ptr<::ThreadPool>> _shards_task_pool;
   std::unique_ptr<shard_type[]> _local_shards;
+  bool _use_concurrent_shard = false;
+  std::unique_ptr<concurrent_shard_type[]> _concurrent_shards;
+
+  // delta save, see SparseTableShard::advance_epoch
+  bool _use_delta_save = false;
+  std::vector<uint32_t> _saved_epoch;  // closed by the last base/delta
+  std::string _delta_base_dir;
+  int _delta_seq = 0;
 
   // for patch model
   int _m_avg_local_shard_num;
@@ -0,0 +1,49 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel.h"
+
+#include "glog/logging.h"
+#include "paddle/common/flags.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
+
+PD_DEFINE_bool(pserver_sparse_sgd_simd,
+               true,
+               "use the avx2/avx512 kernels of the sparse sgd rules when the "
+               "cpu supports them");
+
+namespace paddle::distributed {
+
+const SparseSgdKernels* GetSparseSgdKernels() {
+  static const SparseSgdKernels* kernels = []() -> const SparseSgdKernels* {
+    if (!FLAGS_pserver_sparse_sgd_simd) {
+      return nullptr;
+    }
+    const SparseSgdKernels* best = nullptr;
+    if (phi::backends::cpu::MayIUse(phi::backends::cpu::avx512f)) {
+      best = GetSparseSgdKernelsAVX512();
+    }
+    if (best == nullptr &&
+        phi::backends::cpu::MayIUse(phi::backends::cpu::avx2)) {
+      best = GetSparseSgdKernelsAVX2();
+    }
+    if (best != nullptr) {
+      VLOG(0) << "sparse sgd rules use " << best->name << " kernels";
+    }
+    return best;
+  }();
+  return kernels;
+}
+
+}  // namespace paddle::distributed
@@ -0,0 +1,107 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+namespace paddle {
+namespace distributed {
+
+// Vectorized element loops of the sparse sgd rules. Every kernel clips the
+// updated weights into [min_bound, max_bound] the same way
+// SparseValueSGDRule::BoundValue does, a NaN weight becomes min_bound. As in
+// the scalar rules, a gradient is scaled by dividing it by scale, and the
+// squares of the scaled gradients are summed in double.
+struct SparseSgdKernels {
+  const char* name;
+  // sg = g[i] / scale
+  // w[i] = bound(w[i] + a * sg)
+  void (*axpy_bound)(float* w,
+                     const float* g,
+                     float a,
+                     float scale,
+                     float min_bound,
+                     float max_bound,
+                     size_t n);
+  // axpy_bound that also returns sum(sg * sg)
+  double (*axpy_bound_square_sum)(float* w,
+                                  const float* g,
+                                  float a,
+                                  float scale,
+                                  float min_bound,
+                                  float max_bound,
+                                  size_t n);
+  // returns sum((g[i] / scale)^2)
+  double (*square_sum)(const float* g, float scale, size_t n);
+  // sg = g[i] / scale
+  // w[i] = bound(w[i] - lr * sg * sqrt(initial_g2sum / (initial_g2sum +
+  //        g2sum[i])))
+  // g2sum[i] += sg * sg
+  void (*std_adagrad)(float* w,
+                      float* g2sum,
+                      const float* g,
+                      float lr,
+                      float scale,
+                      float initial_g2sum,
+                      float min_bound,
+                      float max_bound,
+                      size_t n);
+  // gsum[i] = beta1 * gsum[i] + (1 - beta1) * g[i]
+  // g2sum[i] = beta2 * g2sum[i] + (1 - beta2) * g[i]^2
+  // w[i] = bound(w[i] - lr * gsum[i] / (sqrt(g2sum[i]) + epsilon))
+  void (*adam)(float* w,
+               float* gsum,
+               float* g2sum,
+               const float* g,
+               float beta1,
+               float beta2,
+               float lr,
+               float epsilon,
+               float min_bound,
+               float max_bound,
+               size_t n);
+  // adam with one moment pair shared by all elements,
+  // new_gsum = beta1 * gsum + (1 - beta1) * g[i]
+  // new_g2sum = beta2 * g2sum + (1 - beta2) * g[i]^2
+  // w[i] = bound(w[i] - lr * new_gsum / (sqrt(new_g2sum) + epsilon))
+  // and accumulates new_gsum and new_g2sum into sum_gsum and sum_g2sum
+  void (*shared_adam)(float* w,
+                      const float* g,
+                      float gsum,
+                      float g2sum,
+                      float beta1,
+                      float beta2,
+                      float lr,
+                      float epsilon,
+                      float min_bound,
+                      float max_bound,
+                      size_t n,
+                      double* sum_gsum,
+                      double* sum_g2sum);
+};
+
+// nullptr when the kernels were not built or the cpu lacks the isa
+const SparseSgdKernels* GetSparseSgdKernelsAVX2();
+const SparseSgdKernels* GetSparseSgdKernelsAVX512();
+
+// Best kernels for the running cpu, or nullptr if only the scalar rules
+// should run (no simd build or FLAGS_pserver_sparse_sgd_simd is off).
+const SparseSgdKernels* GetSparseSgdKernels();
+
+// Embeddings narrower than this keep the scalar rules.
+constexpr size_t kSparseSgdSimdMinDim = 16;
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,73 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Built with AVX2_FLAG when the compiler supports it, see CMakeLists.txt.
+
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel_impl.h"
+#endif
+
+namespace paddle::distributed {
+
+#ifdef __AVX2__
+namespace {
+struct AVX2Vec {
+  typedef __m256 reg;
+  static constexpr size_t kWidth = 8;
+  static inline reg Load(const float* p) { return _mm256_loadu_ps(p); }
+  static inline void Store(float* p, reg v) { _mm256_storeu_ps(p, v); }
+  static inline reg Set1(float x) { return _mm256_set1_ps(x); }
+  static inline reg Add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static inline reg Sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+  static inline reg Mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+  static inline reg Div(reg a, reg b) { return _mm256_div_ps(a, b); }
+  static inline reg Sqrt(reg a) { return _mm256_sqrt_ps(a); }
+  static inline reg Max(reg a, reg b) { return _mm256_max_ps(a, b); }
+  static inline reg Min(reg a, reg b) { return _mm256_min_ps(a, b); }
+  // sums are kept in double, like the scalar rules
+  typedef __m256d dreg;
+  static inline dreg ZeroD() { return _mm256_setzero_pd(); }
+  static inline dreg AddD(dreg acc, reg v) {
+    __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+    __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+    return _mm256_add_pd(acc, _mm256_add_pd(lo, hi));
+  }
+  static inline dreg AddSquareD(dreg acc, reg v) {
+    __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+    __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(lo, lo));
+    return _mm256_add_pd(acc, _mm256_mul_pd(hi, hi));
+  }
+  static inline double ReduceAddD(dreg v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    lo = _mm_hadd_pd(lo, lo);
+    return _mm_cvtsd_f64(lo);
+  }
+};
+}  // namespace
+
+const SparseSgdKernels* GetSparseSgdKernelsAVX2() {
+  return SparseSgdKernelImpl<AVX2Vec>::Get("avx2");
+}
+#else
+const SparseSgdKernels* GetSparseSgdKernelsAVX2() { return nullptr; }
+#endif
+
+}  // namespace paddle::distributed
@@ -0,0 +1,69 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Built with AVX512F_FLAG when the compiler supports it, see CMakeLists.txt.
+
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel_impl.h"
+#endif
+
+namespace paddle::distributed {
+
+#ifdef __AVX512F__
+namespace {
+struct AVX512Vec {
+  typedef __m512 reg;
+  static constexpr size_t kWidth = 16;
+  static inline reg Load(const float* p) { return _mm512_loadu_ps(p); }
+  static inline void Store(float* p, reg v) { _mm512_storeu_ps(p, v); }
+  static inline reg Set1(float x) { return _mm512_set1_ps(x); }
+  static inline reg Add(reg a, reg b) { return _mm512_add_ps(a, b); }
+  static inline reg Sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+  static inline reg Mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+  static inline reg Div(reg a, reg b) { return _mm512_div_ps(a, b); }
+  static inline reg Sqrt(reg a) { return _mm512_sqrt_ps(a); }
+  static inline reg Max(reg a, reg b) { return _mm512_max_ps(a, b); }
+  static inline reg Min(reg a, reg b) { return _mm512_min_ps(a, b); }
+  // sums are kept in double, like the scalar rules
+  typedef __m512d dreg;
+  static inline dreg ZeroD() { return _mm512_setzero_pd(); }
+  static inline dreg AddD(dreg acc, reg v) {
+    __m512d lo = _mm512_cvtps_pd(_mm512_castps512_ps256(v));
+    __m512d hi = _mm512_cvtps_pd(_mm256_castpd_ps(
+        _mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+    return _mm512_add_pd(acc, _mm512_add_pd(lo, hi));
+  }
+  static inline dreg AddSquareD(dreg acc, reg v) {
+    __m512d lo = _mm512_cvtps_pd(_mm512_castps512_ps256(v));
+    __m512d hi = _mm512_cvtps_pd(_mm256_castpd_ps(
+        _mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+    acc = _mm512_add_pd(acc, _mm512_mul_pd(lo, lo));
+    return _mm512_add_pd(acc, _mm512_mul_pd(hi, hi));
+  }
+  static inline double ReduceAddD(dreg v) { return _mm512_reduce_add_pd(v); }
+};
+}  // namespace
+
+const SparseSgdKernels* GetSparseSgdKernelsAVX512() {
+  return SparseSgdKernelImpl<AVX512Vec>::Get("avx512f");
+}
+#else
+const SparseSgdKernels* GetSparseSgdKernelsAVX512() { return nullptr; }
+#endif
+
+}  // namespace paddle::distributed
@@ -0,0 +1,253 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <math.h>
+
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel.h"
+
+namespace paddle {
+namespace distributed {
+
+// Sparse sgd kernels written once against a vector trait V, which provides
+// reg, kWidth, Load, Store, Set1, Add, Sub, Mul, Div, Sqrt, Max, Min and
+// the double accumulator dreg, ZeroD, AddD, AddSquareD and ReduceAddD. Only
+// include this from a translation unit compiled for the isa of V.
+template <class V>
+struct SparseSgdKernelImpl {
+  typedef typename V::reg reg;
+  typedef typename V::dreg dreg;
+
+  static inline float Bound1(float w, float min_bound, float max_bound) {
+    if (!(w >= min_bound)) {
+      return min_bound;
+    } else if (!(w <= max_bound)) {
+      return max_bound;
+    }
+    return w;
+  }
+
+  // max(w, min) returns min when w is NaN, which matches BoundValue
+  static inline reg BoundV(reg w, reg min_v, reg max_v) {
+    return V::Min(V::Max(w, min_v), max_v);
+  }
+
+  template <bool kSquareSum>
+  static inline double AxpyBoundImpl(float* w,
+                                     const float* g,
+                                     float a,
+                                     float scale,
+                                     float min_bound,
+                                     float max_bound,
+                                     size_t n) {
+    reg a_v = V::Set1(a);
+    reg scale_v = V::Set1(scale);
+    reg min_v = V::Set1(min_bound);
+    reg max_v = V::Set1(max_bound);
+    dreg sum_v = V::ZeroD();
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+      reg sg_v = V::Div(V::Load(g + i), scale_v);
+      reg w_v = V::Add(V::Load(w + i), V::Mul(a_v, sg_v));
+      V::Store(w + i, BoundV(w_v, min_v, max_v));
+      if (kSquareSum) {
+        sum_v = V::AddSquareD(sum_v, sg_v);
+      }
+    }
+    double sum = kSquareSum ? V::ReduceAddD(sum_v) : 0;
+    for (; i < n; ++i) {
+      float sg = g[i] / scale;
+      w[i] = Bound1(w[i] + a * sg, min_bound, max_bound);
+      if (kSquareSum) {
+        sum += static_cast<double>(sg) * sg;
+      }
+    }
+    return sum;
+  }
+
+  static void AxpyBound(float* w,
+                        const float* g,
+                        float a,
+                        float scale,
+                        float min_bound,
+                        float max_bound,
+                        size_t n) {
+    AxpyBoundImpl<false>(w, g, a, scale, min_bound, max_bound, n);
+  }
+
+  static double AxpyBoundSquareSum(float* w,
+                                   const float* g,
+                                   float a,
+                                   float scale,
+                                   float min_bound,
+                                   float max_bound,
+                                   size_t n) {
+    return AxpyBoundImpl<true>(w, g, a, scale, min_bound, max_bound, n);
+  }
+
+  static double SquareSum(const float* g, float scale, size_t n) {
+    reg scale_v = V::Set1(scale);
+    dreg sum_v = V::ZeroD();
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+      sum_v = V::AddSquareD(sum_v, V::Div(V::Load(g + i), scale_v));
+    }
+    double sum = V::ReduceAddD(sum_v);
+    for (; i < n; ++i) {
+      double sg = g[i] / scale;
+      sum += sg * sg;
+    }
+    return sum;
+  }
+
+  static void StdAdaGrad(float* w,
+                         float* g2sum,
+                         const float* g,
+                         float lr,
+                         float scale,
+                         float initial_g2sum,
+                         float min_bound,
+                         float max_bound,
+                         size_t n) {
+    reg lr_v = V::Set1(lr);
+    reg scale_v = V::Set1(scale);
+    reg init_v = V::Set1(initial_g2sum);
+    reg min_v = V::Set1(min_bound);
+    reg max_v = V::Set1(max_bound);
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+      reg sg_v = V::Div(V::Load(g + i), scale_v);
+      reg g2_v = V::Load(g2sum + i);
+      reg ratio_v = V::Sqrt(V::Div(init_v, V::Add(init_v, g2_v)));
+      reg w_v = V::Sub(V::Load(w + i), V::Mul(V::Mul(lr_v, sg_v), ratio_v));
+      V::Store(w + i, BoundV(w_v, min_v, max_v));
+      V::Store(g2sum + i, V::Add(g2_v, V::Mul(sg_v, sg_v)));
+    }
+    for (; i < n; ++i) {
+      float sg = g[i] / scale;
+      w[i] -= lr * sg * sqrtf(initial_g2sum / (initial_g2sum + g2sum[i]));
+      w[i] = Bound1(w[i], min_bound, max_bound);
+      g2sum[i] += sg * sg;
+    }
+  }
+
+  static void Adam(float* w,
+                   float* gsum,
+                   float* g2sum,
+                   const float* g,
+                   float beta1,
+                   float beta2,
+                   float lr,
+                   float epsilon,
+                   float min_bound,
+                   float max_bound,
+                   size_t n) {
+    reg beta1_v = V::Set1(beta1);
+    reg beta2_v = V::Set1(beta2);
+    reg one_minus_beta1_v = V::Set1(1 - beta1);
+    reg one_minus_beta2_v = V::Set1(1 - beta2);
+    reg lr_v = V::Set1(lr);
+    reg eps_v = V::Set1(epsilon);
+    reg min_v = V::Set1(min_bound);
+    reg max_v = V::Set1(max_bound);
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+      reg g_v = V::Load(g + i);
+      reg gsum_v = V::Add(V::Mul(beta1_v, V::Load(gsum + i)),
+                          V::Mul(one_minus_beta1_v, g_v));
+      reg g2sum_v = V::Add(V::Mul(beta2_v, V::Load(g2sum + i)),
+                           V::Mul(one_minus_beta2_v, V::Mul(g_v, g_v)));
+      reg step_v =
+          V::Div(V::Mul(lr_v, gsum_v), V::Add(V::Sqrt(g2sum_v), eps_v));
+      V::Store(w + i, BoundV(V::Sub(V::Load(w + i), step_v), min_v, max_v));
+      V::Store(gsum + i, gsum_v);
+      V::Store(g2sum + i, g2sum_v);
+    }
+    for (; i < n; ++i) {
+      gsum[i] = beta1 * gsum[i] + (1 - beta1) * g[i];
+      g2sum[i] = beta2 * g2sum[i] + (1 - beta2) * g[i] * g[i];
+      w[i] = Bound1(w[i] - lr * (gsum[i] / (sqrtf(g2sum[i]) + epsilon)),
+                    min_bound,
+                    max_bound);
+    }
+  }
+
+  static void SharedAdam(float* w,
+                         const float* g,
+                         float gsum,
+                         float g2sum,
+                         float beta1,
+                         float beta2,
+                         float lr,
+                         float epsilon,
+                         float min_bound,
+                         float max_bound,
+                         size_t n,
+                         double* sum_gsum,
+                         double* sum_g2sum) {
+    float gsum_base = beta1 * gsum;
+    float g2sum_base = beta2 * g2sum;
+    reg gsum_base_v = V::Set1(gsum_base);
+    reg g2sum_base_v = V::Set1(g2sum_base);
+    reg one_minus_beta1_v = V::Set1(1 - beta1);
+    reg one_minus_beta2_v = V::Set1(1 - beta2);
+    reg lr_v = V::Set1(lr);
+    reg eps_v = V::Set1(epsilon);
+    reg min_v = V::Set1(min_bound);
+    reg max_v = V::Set1(max_bound);
+    dreg sum_gsum_v = V::ZeroD();
+    dreg sum_g2sum_v = V::ZeroD();
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+      reg g_v = V::Load(g + i);
+      reg new_gsum_v = V::Add(gsum_base_v, V::Mul(one_minus_beta1_v, g_v));
+      reg new_g2sum_v =
+          V::Add(g2sum_base_v, V::Mul(one_minus_beta2_v, V::Mul(g_v, g_v)));
+      reg step_v = V::Div(V::Mul(lr_v, new_gsum_v),
+                          V::Add(V::Sqrt(new_g2sum_v), eps_v));
+      V::Store(w + i, BoundV(V::Sub(V::Load(w + i), step_v), min_v, max_v));
+      sum_gsum_v = V::AddD(sum_gsum_v, new_gsum_v);
+      sum_g2sum_v = V::AddD(sum_g2sum_v, new_g2sum_v);
+    }
+    double sum_gsum_s = V::ReduceAddD(sum_gsum_v);
+    double sum_g2sum_s = V::ReduceAddD(sum_g2sum_v);
+    for (; i < n; ++i) {
+      float new_gsum = gsum_base + (1 - beta1) * g[i];
+      float new_g2sum = g2sum_base + (1 - beta2) * g[i] * g[i];
+      w[i] = Bound1(w[i] - lr * (new_gsum / (sqrtf(new_g2sum) + epsilon)),
+                    min_bound,
+                    max_bound);
+      sum_gsum_s += new_gsum;
+      sum_g2sum_s += new_g2sum;
+    }
+    *sum_gsum += sum_gsum_s;
+    *sum_g2sum += sum_g2sum_s;
+  }
+
+  static const SparseSgdKernels* Get(const char* name) {
+    static const SparseSgdKernels kernels = {
+        name,
+        AxpyBound,
+        AxpyBoundSquareSum,
+        SquareSum,
+        StdAdaGrad,
+        Adam,
+        SharedAdam};
+    return &kernels;
+  }
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -91,6 +91,7 @@ void SparseAdaGradSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
     _min_bound = adagrad_param.weight_bounds(0);
     _max_bound = adagrad_param.weight_bounds(1);
   }
+  InitSimdKernels();
 }
 
 void SparseAdaGradSGDRule::UpdateValueWork(float *w,
@@ -100,12 +101,23 @@ void SparseAdaGradSGDRule::UpdateValueWork(float *w,
   float &g2sum = sgd[G2SumIndex()];
   double add_g2sum = 0;
 
-  for (size_t i = 0; i < _embedding_dim; i++) {
-    double scaled_grad = grad[i] / scale;
-    w[i] -= learning_rate_ * scaled_grad *
-            sqrt(_initial_g2sum / (_initial_g2sum + g2sum));
-    BoundValue(w[i]);
-    add_g2sum += scaled_grad * scaled_grad;
+  if (_simd != nullptr) {
+    double ratio = sqrt(_initial_g2sum / (_initial_g2sum + g2sum));
+    add_g2sum = _simd->axpy_bound_square_sum(w,
+                                             grad,
+                                             -learning_rate_ * ratio,
+                                             scale,
+                                             _min_bound,
+                                             _max_bound,
+                                             _embedding_dim);
+  } else {
+    for (size_t i = 0; i < _embedding_dim; i++) {
+      double scaled_grad = grad[i] / scale;
+      w[i] -= learning_rate_ * scaled_grad *
+              sqrt(_initial_g2sum / (_initial_g2sum + g2sum));
+      BoundValue(w[i]);
+      add_g2sum += scaled_grad * scaled_grad;
+    }
   }
 
   g2sum += add_g2sum / _embedding_dim;
@@ -150,12 +162,25 @@ void StdAdaGradSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
     _min_bound = adagrad_param.weight_bounds(0);
     _max_bound = adagrad_param.weight_bounds(1);
   }
+  InitSimdKernels();
 }
 
 void StdAdaGradSGDRule::UpdateValueWork(float *w,
                                         float *sgd,
                                         const float *grad,
                                         float scale) {
+  if (_simd != nullptr) {
+    _simd->std_adagrad(w,
+                       sgd + G2SumIndex(),
+                       grad,
+                       learning_rate_,
+                       scale,
+                       _initial_g2sum,
+                       _min_bound,
+                       _max_bound,
+                       _embedding_dim);
+    return;
+  }
   for (size_t i = 0; i < _embedding_dim; i++) {
     float &g2sum = sgd[G2SumIndex() + i];
     double scaled_grad = grad[i] / scale;
@@ -206,6 +231,7 @@ void SparseAdamSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
     _min_bound = adam_param.weight_bounds(0);
     _max_bound = adam_param.weight_bounds(1);
   }
+  InitSimdKernels();
 }
 
 void SparseAdamSGDRule::UpdateValueWork(float *w,
@@ -223,13 +249,27 @@ void SparseAdamSGDRule::UpdateValueWork(float *w,
   float beta2_pow_ = *beta2_pow;
 
   lr *= sqrt(1 - beta2_pow_) / (1 - beta1_pow_);
-  for (size_t i = 0; i < _embedding_dim; i++) {
-    // Calculation
-    gsum[i] = _beta1_decay_rate * gsum[i] + (1 - _beta1_decay_rate) * g[i];
-    g2sum[i] =
-        _beta2_decay_rate * g2sum[i] + (1 - _beta2_decay_rate) * g[i] * g[i];
-    w[i] = w[i] - lr * (gsum[i] / (sqrt(g2sum[i]) + _ada_epsilon));
-    BoundValue(w[i]);
+  if (_simd != nullptr) {
+    _simd->adam(w,
+                gsum,
+                g2sum,
+                g,
+                _beta1_decay_rate,
+                _beta2_decay_rate,
+                lr,
+                _ada_epsilon,
+                _min_bound,
+                _max_bound,
+                _embedding_dim);
+  } else {
+    for (size_t i = 0; i < _embedding_dim; i++) {
+      // Calculation
+      gsum[i] = _beta1_decay_rate * gsum[i] + (1 - _beta1_decay_rate) * g[i];
+      g2sum[i] =
+          _beta2_decay_rate * g2sum[i] + (1 - _beta2_decay_rate) * g[i] * g[i];
+      w[i] = w[i] - lr * (gsum[i] / (sqrt(g2sum[i]) + _ada_epsilon));
+      BoundValue(w[i]);
+    }
   }
   // update beta_pow_decay
   (*beta1_pow) *= _beta1_decay_rate;
@@ -282,6 +322,7 @@ void SparseSharedAdamSGDRule::LoadConfig(
     _min_bound = adam_param.weight_bounds(0);
     _max_bound = adam_param.weight_bounds(1);
   }
+  InitSimdKernels();
 }
 
 void SparseSharedAdamSGDRule::UpdateValueWork(float *w,
@@ -303,16 +344,32 @@ void SparseSharedAdamSGDRule::UpdateValueWork(float *w,
   lr *= sqrt(1 - beta2_pow_) / (1 - beta1_pow_);
   double sum_gsum = 0.0;
   double sum_g2sum = 0.0;
-  for (size_t i = 0; i < _embedding_dim; i++) {
-    // Calculation
-    double new_gsum =
-        _beta1_decay_rate * gsum_ + (1 - _beta1_decay_rate) * g[i];
-    double new_g2sum =
-        _beta2_decay_rate * g2sum_ + (1 - _beta2_decay_rate) * g[i] * g[i];
-    w[i] = w[i] - lr * (new_gsum / (sqrt(new_g2sum) + _ada_epsilon));
-    BoundValue(w[i]);
-    sum_gsum += new_gsum;
-    sum_g2sum += new_g2sum;
+  if (_simd != nullptr) {
+    _simd->shared_adam(w,
+                       g,
+                       gsum_,
+                       g2sum_,
+                       _beta1_decay_rate,
+                       _beta2_decay_rate,
+                       lr,
+                       _ada_epsilon,
+                       _min_bound,
+                       _max_bound,
+                       _embedding_dim,
+                       &sum_gsum,
+                       &sum_g2sum);
+  } else {
+    for (size_t i = 0; i < _embedding_dim; i++) {
+      // Calculation
+      double new_gsum =
+          _beta1_decay_rate * gsum_ + (1 - _beta1_decay_rate) * g[i];
+      double new_g2sum =
+          _beta2_decay_rate * g2sum_ + (1 - _beta2_decay_rate) * g[i] * g[i];
+      w[i] = w[i] - lr * (new_gsum / (sqrt(new_g2sum) + _ada_epsilon));
+      BoundValue(w[i]);
+      sum_gsum += new_gsum;
+      sum_g2sum += new_g2sum;
+    }
   }
   // update beta_pow_decay
   (*gsum) = sum_gsum / _embedding_dim;
@@ -366,6 +423,7 @@ void SparseAdaGradV2SGDRule::LoadConfig(
     _min_bound = adagrad_param.weight_bounds(0);
     _max_bound = adagrad_param.weight_bounds(1);
   }
+  InitSimdKernels();
 }
 
 void SparseAdaGradV2SGDRule::UpdateValueWork(float *w,
@@ -376,6 +434,19 @@ void SparseAdaGradV2SGDRule::UpdateValueWork(float *w,
   double add_g2sum = 0;
   float epsilon = 1e-8;
 
+  if (_simd != nullptr) {
+    add_g2sum = _simd->square_sum(grad, scale, _embedding_dim);
+    g2sum += add_g2sum / _embedding_dim;
+    _simd->axpy_bound(w,
+                      grad,
+                      -learning_rate_ / (sqrt(g2sum) + epsilon),
+                      scale,
+                      _min_bound,
+                      _max_bound,
+                      _embedding_dim);
+    return;
+  }
+
   for (size_t i = 0; i < _embedding_dim; i++) {
     double scaled_grad = grad[i] / scale;
     add_g2sum += scaled_grad * scaled_grad;
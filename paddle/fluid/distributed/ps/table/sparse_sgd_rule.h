@@ -21,6 +21,7 @@
 #include "glog/logging.h"                                  // for CHECK
 #include "paddle/fluid/distributed/common/local_random.h"  // for local_uniform_real_distribution
 #include "paddle/fluid/distributed/common/registerer.h"
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel.h"
 #include "paddle/fluid/distributed/the_one_ps.pb.h"
 
 namespace paddle {
@@ -51,6 +52,17 @@ class SparseValueSGDRule {
                    float scale = 1) {
     UpdateValueWork(w, sgd, push_value, scale);
   }
+  // Updates num keys at once, w[k], sgd[k], push_values[k] and scales[k]
+  // are the arguments of the k-th UpdateValue.
+  virtual void UpdateValueBatch(float** w,
+                                float** sgd,
+                                const float** push_values,
+                                const float* scales,
+                                size_t num) {
+    for (size_t k = 0; k < num; ++k) {
+      UpdateValueWork(w[k], sgd[k], push_values[k], scales[k]);
+    }
+  }
   template <class T>
   void BoundValue(T& w) {  // NOLINT
     if (!(w >= _min_bound)) {
@@ -61,12 +73,35 @@ class SparseValueSGDRule {
   }
   float& MinBound() { return _min_bound; }
   float& MaxBound() { return _max_bound; }
+  // nullptr forces the scalar loops
+  void SetSimdKernels(const SparseSgdKernels* kernels) { _simd = kernels; }
 
  protected:
+  // picks the simd kernels once the embedding dim is known
+  void InitSimdKernels() {
+    _simd = _embedding_dim >= kSparseSgdSimdMinDim ? GetSparseSgdKernels()
+                                                   : nullptr;
+  }
+
+  // the batch loop of a rule, the qualified call lets the compiler inline
+  // Rule::UpdateValueWork instead of dispatching once per key
+  template <class Rule>
+  void UpdateValueBatchOf(float** w,
+                          float** sgd,
+                          const float** push_values,
+                          const float* scales,
+                          size_t num) {
+    auto* rule = static_cast<Rule*>(this);
+    for (size_t k = 0; k < num; ++k) {
+      rule->Rule::UpdateValueWork(w[k], sgd[k], push_values[k], scales[k]);
+    }
+  }
+
   float _min_bound;
   float _max_bound;
   float _initial_range;
   size_t _embedding_dim;
+  const SparseSgdKernels* _simd = nullptr;
 
  private:
   std::string _name;
@@ -97,6 +132,13 @@ class SparseAdaGradSGDRule : public SparseValueSGDRule {
                                float* sgd,
                                const float* push_value,
                                float scale);
+  virtual void UpdateValueBatch(float** w,
+                                float** sgd,
+                                const float** push_values,
+                                const float* scales,
+                                size_t num) {
+    UpdateValueBatchOf<SparseAdaGradSGDRule>(w, sgd, push_values, scales, num);
+  }
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return 1; }
   size_t G2SumIndex() { return 0; }
@@ -134,6 +176,13 @@ class StdAdaGradSGDRule : public SparseValueSGDRule {
                                float* sgd,
                                const float* push_value,
                                float scale);
+  virtual void UpdateValueBatch(float** w,
+                                float** sgd,
+                                const float** push_values,
+                                const float* scales,
+                                size_t num) {
+    UpdateValueBatchOf<StdAdaGradSGDRule>(w, sgd, push_values, scales, num);
+  }
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return _embedding_dim; }
   size_t G2SumIndex() { return 0; }
@@ -151,6 +200,13 @@ class SparseAdamSGDRule : public SparseValueSGDRule {
                                float* sgd,
                                const float* push_value,
                                float scale);
+  virtual void UpdateValueBatch(float** w,
+                                float** sgd,
+                                const float** push_values,
+                                const float* scales,
+                                size_t num) {
+    UpdateValueBatchOf<SparseAdamSGDRule>(w, sgd, push_values, scales, num);
+  }
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return _embedding_dim * 2 + 2; }
   size_t GSumIndex() { return 0; }
@@ -173,6 +229,14 @@ class SparseSharedAdamSGDRule : public SparseValueSGDRule {
                                float* sgd,
                                const float* push_value,
                                float scale);
+  virtual void UpdateValueBatch(float** w,
+                                float** sgd,
+                                const float** push_values,
+                                const float* scales,
+                                size_t num) {
+    UpdateValueBatchOf<SparseSharedAdamSGDRule>(
+        w, sgd, push_values, scales, num);
+  }
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return 4; }
   size_t GSumIndex() { return 0; }
@@ -25,6 +25,22 @@ PD_DECLARE_bool(pserver_create_value_when_push);
 PD_DECLARE_bool(pserver_enable_create_feasign_randomly);
 PD_DEFINE_bool(pserver_open_strict_check, false, "pserver_open_strict_check");
 PD_DEFINE_int32(pserver_load_batch_size, 5000, "load batch size for ssd");
+PD_DEFINE_int64(pserver_ssd_mem_capacity,
+                0,
+                "max feasigns kept in memory by one shard of SSDSparseTable, "
+                "the least frequent ones are moved to ssd in the background; "
+                "0 keeps every pulled feasign in memory");
+PD_DEFINE_int32(pserver_ssd_admission_min_freq,
+                2,
+                "min recent access count for a feasign read from ssd to move "
+                "into a full memory shard of SSDSparseTable");
+PD_DEFINE_int32(pserver_ssd_tier_interval_ms,
+                1000,
+                "interval of the SSDSparseTable demotion and compaction loop");
+PD_DEFINE_int64(pserver_ssd_compact_deletes,
+                1000000,
+                "compact a rocksdb column of SSDSparseTable after this many "
+                "feasigns moved out of it");
 PHI_DEFINE_EXPORTED_string(rocksdb_path,
                            "database",
                            "path of sparse table rocksdb file");
@@ -32,9 +48,32 @@ PHI_DEFINE_EXPORTED_string(rocksdb_path,
 namespace paddle::distributed {
 
 int32_t SSDSparseTable::Initialize() {
+  PADDLE_ENFORCE_EQ(_config.enable_concurrent_shard(),
+                    false,
+                    common::errors::InvalidArgument(
+                        "SSDSparseTable does not support concurrent shard."));
   MemorySparseTable::Initialize();
   _db = ::paddle::distributed::RocksDBHandler::GetInstance();
   _db->initialize(FLAGS_rocksdb_path, _real_local_shard_num);
+  _mem_capacity = FLAGS_pserver_ssd_mem_capacity > 0
+                      ? static_cast<size_t>(FLAGS_pserver_ssd_mem_capacity)
+                      : 0;
+  _sketches.reset(new FrequencySketch[_real_local_shard_num]);
+  _demote_bucket.assign(_real_local_shard_num, 0);
+  _ssd_deletes.reset(new std::atomic<uint64_t>[_real_local_shard_num]);
+  _shard_mutex.reset(new std::mutex[_real_local_shard_num]);
+  _shard_pinned.reset(new bool[_real_local_shard_num]);
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    _ssd_deletes[i] = 0;
+    _shard_pinned[i] = false;
+  }
+  if (_mem_capacity > 0) {
+    for (int i = 0; i < _real_local_shard_num; ++i) {
+      _sketches[i].Init(_mem_capacity);
+    }
+    _tier_thread = std::thread(&SSDSparseTable::TierLoop, this);
+    VLOG(0) << "SSDSparseTable mem capacity per shard: " << _mem_capacity;
+  }
   VLOG(0) << "initialize SSDSparseTable succ";
   VLOG(0) << "SSD FLAGS_pserver_print_missed_key_num_every_push:"
           << FLAGS_pserver_print_missed_key_num_every_push;
@@ -51,6 +90,8 @@ int32_t SSDSparseTable::Initialize() {
   return 0;
 }
 
+SSDSparseTable::~SSDSparseTable() { StopTierThread(); }
+
 int32_t SSDSparseTable::InitializeShard() { return 0; }
 
 void SSDSparseTable::SetDayId(int day_id) { _day_id = day_id; }
@@ -122,63 +163,99 @@ int32_t SSDSparseTable::PullSparse(float* pull_values,
                &missed_keys]() -> int {
                 auto& keys = task_keys[shard_id];
                 auto& local_shard = _local_shards[shard_id];
+                auto& sketch = _sketches[shard_id];
                 float data_buffer[value_size];  // NOLINT
                 float* data_buffer_ptr = data_buffer;
+                auto select = [&](size_t data_size, int pull_data_idx) {
+                  for (size_t mf_idx = data_size; mf_idx < value_size;
+                       ++mf_idx) {
+                    data_buffer[mf_idx] = 0.0;
+                  }
+                  float* select_data =
+                      pull_values + pull_data_idx * select_value_size;
+                  _value_accessor->Select(
+                      &select_data, (const float**)&data_buffer_ptr, 1);
+                };
+                // keys missing in mem are read from ssd with one MultiGet
+                std::vector<uint64_t> miss_keys;
+                std::vector<int> miss_index;
+                uint64_t mem_hit = 0;
                 for (size_t i = 0; i < keys.size(); ++i) {
                   uint64_t key = keys[i].first;
+                  sketch.Increment(key);
                   auto itr = local_shard.find(key);
-                  size_t data_size = value_size - mf_value_size;
                   if (itr == local_shard.end()) {
-                    // pull rocksdb
-                    std::string tmp_string("");
-                    if (_db->get(shard_id,
-                                 reinterpret_cast<char*>(&key),
-                                 sizeof(uint64_t),
-                                 tmp_string) > 0) {
-                      ++missed_keys;
-                      if (FLAGS_pserver_create_value_when_push) {
-                        memset(data_buffer, 0, sizeof(float) * data_size);
-                      } else {
-                        auto& feature_value = local_shard[key];
-                        feature_value.resize(data_size);
-                        float* data_ptr =
-                            const_cast<float*>(feature_value.data());
-                        _value_accessor->Create(&data_buffer_ptr, 1);
-                        memcpy(data_ptr,
-                               data_buffer_ptr,
-                               data_size * sizeof(float));
-                      }
+                    miss_keys.push_back(key);
+                    miss_index.push_back(keys[i].second);
+                    continue;
+                  }
+                  ++mem_hit;
+                  size_t data_size = itr.value().size();
+                  memcpy(data_buffer_ptr,
+                         itr.value().data(),
+                         data_size * sizeof(float));
+                  select(data_size, keys[i].second);
+                }
+                _tier_stat.mem_hit += mem_hit;
+                if (miss_keys.empty()) {
+                  return 0;
+                }
+
+                std::vector<std::string> ssd_values;
+                MultiGetSSD(shard_id, miss_keys, &ssd_values);
+                std::vector<uint64_t> promoted_keys;
+                uint64_t ssd_hit = 0;
+                uint64_t miss = 0;
+                for (size_t i = 0; i < miss_keys.size(); ++i) {
+                  uint64_t key = miss_keys[i];
+                  size_t data_size = value_size - mf_value_size;
+                  // a key pulled twice may be in mem by now
+                  auto itr = local_shard.find(key);
+                  if (itr != local_shard.end()) {
+                    data_size = itr.value().size();
+                    memcpy(data_buffer_ptr,
+                           itr.value().data(),
+                           data_size * sizeof(float));
+                  } else if (ssd_values[i].empty()) {
+                    ++miss;
+                    if (FLAGS_pserver_create_value_when_push) {
+                      memset(data_buffer, 0, sizeof(float) * data_size);
                     } else {
-                      data_size = tmp_string.size() / sizeof(float);
-                      memcpy(data_buffer_ptr,
-                             ::paddle::string::str_to_float(tmp_string),
-                             data_size * sizeof(float));
+                      auto& feature_value = local_shard[key];
+                      feature_value.resize(data_size);
+                      float* data_ptr =
+                          const_cast<float*>(feature_value.data());
+                      _value_accessor->Create(&data_buffer_ptr, 1);
+                      memcpy(
+                          data_ptr, data_buffer_ptr, data_size * sizeof(float));
+                    }
+                  } else {
+                    ++ssd_hit;
+                    data_size = ssd_values[i].size() / sizeof(float);
+                    memcpy(data_buffer_ptr,
+                           ssd_values[i].data(),
+                           data_size * sizeof(float));
+                    if (AdmitToMem(shard_id, key)) {
                       // from rocksdb to mem
                       auto& feature_value = local_shard[key];
                       feature_value.resize(data_size);
                       memcpy(const_cast<float*>(feature_value.data()),
                              data_buffer_ptr,
                              data_size * sizeof(float));
-                      _db->del_data(shard_id,
-                                    reinterpret_cast<char*>(&key),
-                                    sizeof(uint64_t));
+                      promoted_keys.push_back(key);
                     }
-                  } else {
-                    data_size = itr.value().size();
-                    memcpy(data_buffer_ptr,
-                           itr.value().data(),
-                           data_size * sizeof(float));
                   }
-                  for (size_t mf_idx = data_size; mf_idx < value_size;
-                       ++mf_idx) {
-                    data_buffer[mf_idx] = 0.0;
-                  }
-                  int pull_data_idx = keys[i].second;
-                  float* select_data =
-                      pull_values + pull_data_idx * select_value_size;
-                  _value_accessor->Select(
-                      &select_data, (const float**)&data_buffer_ptr, 1);
+                  select(data_size, miss_index[i]);
+                }
+                if (!promoted_keys.empty()) {
+                  _db->del_batch(shard_id, promoted_keys);
+                  _ssd_deletes[shard_id] += promoted_keys.size();
                 }
+                missed_keys += miss;
+                _tier_stat.miss += miss;
+                _tier_stat.ssd_hit += ssd_hit;
+                _tier_stat.promoted += promoted_keys.size();
+                _tier_stat.rejected += ssd_hit - promoted_keys.size();
                 return 0;
               });
     }
@@ -203,6 +280,10 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
   size_t mf_value_size =
       _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
 
+  // the returned pointers are kept by the caller for the whole pass, so the
+  // shard is not demoted until CacheTable
+  std::lock_guard<std::mutex> shard_lock(_shard_mutex[shard_id]);
+  _shard_pinned[shard_id] = true;
   {  // 从table取值 or create
     RocksDBCtx context;
     std::vector<std::future<int>> tasks;
@@ -215,6 +296,7 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
 
     for (size_t i = 0; i < num; ++i) {
       uint64_t key = pull_keys[i];
+      _sketches[shard_id].Increment(key);
       auto itr = local_shard.find(key);
       if (itr == local_shard.end()) {
         cur_ctx->batch_index.push_back(i);
@@ -240,6 +322,7 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
               uint64_t cur_key = *(reinterpret_cast<uint64_t*>(
                   const_cast<char*>(cur_ctx->batch_keys[idx].data())));
               if (cur_ctx->status[idx].IsNotFound()) {
+                ++_tier_stat.miss;
                 auto& feature_value = local_shard[cur_key];
                 int init_size = value_size - mf_value_size;
                 feature_value.resize(init_size);
@@ -261,6 +344,9 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
                 _db->del_data(shard_id,
                               reinterpret_cast<char*>(&cur_key),
                               sizeof(uint64_t));
+                ++_ssd_deletes[shard_id];
+                ++_tier_stat.ssd_hit;
+                ++_tier_stat.promoted;
                 ret = &feature_value;
               }
 
@@ -277,6 +363,7 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
           tasks.push_back(std::move(fut));
         }
       } else {
+        ++_tier_stat.mem_hit;
         ret = itr.value_ptr();
         // int pull_data_idx = keys[i].second;
         _value_accessor->UpdateTimeDecay(ret->data(), true);
@@ -310,6 +397,7 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
         uint64_t cur_key = *(reinterpret_cast<uint64_t*>(
             const_cast<char*>(cur_ctx->batch_keys[idx].data())));
         if (cur_ctx->status[idx].IsNotFound()) {
+          ++_tier_stat.miss;
           auto& feature_value = local_shard[cur_key];
           int init_size = value_size - mf_value_size;
           feature_value.resize(init_size);
@@ -329,6 +417,9 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
               data_size * sizeof(float));
           _db->del_data(
               shard_id, reinterpret_cast<char*>(&cur_key), sizeof(uint64_t));
+          ++_ssd_deletes[shard_id];
+          ++_tier_stat.ssd_hit;
+          ++_tier_stat.promoted;
           ret = &feature_value;
         }
         _value_accessor->UpdateTimeDecay(ret->data(), true);
@@ -374,14 +465,82 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                &task_keys]() -> int {
                 auto& keys = task_keys[shard_id];
                 auto& local_shard = _local_shards[shard_id];
-                float data_buffer[value_col];  // NOLINT
+                float data_buffer[value_col];    // NOLINT
+                float extend_buffer[value_col];  // NOLINT
                 float* data_buffer_ptr = data_buffer;
+                float* extend_buffer_ptr = extend_buffer;
+                // with a mem capacity a pulled key may have been left on ssd
+                // by the admission policy, it is promoted now or updated on
+                // ssd
+                std::vector<uint64_t> ssd_keys;
+                std::vector<std::string> ssd_values;
+                std::vector<bool> ssd_dirty;
+                std::unordered_map<uint64_t, size_t> ssd_index;
+                if (_mem_capacity > 0) {
+                  for (auto& key_pair : keys) {
+                    uint64_t key = key_pair.first;
+                    if (local_shard.find(key) == local_shard.end() &&
+                        ssd_index.emplace(key, ssd_keys.size()).second) {
+                      ssd_keys.push_back(key);
+                    }
+                  }
+                }
+                if (!ssd_keys.empty()) {
+                  MultiGetSSD(shard_id, ssd_keys, &ssd_values);
+                  ssd_dirty.assign(ssd_keys.size(), false);
+                  std::vector<uint64_t> promoted_keys;
+                  for (size_t j = 0; j < ssd_keys.size(); ++j) {
+                    if (ssd_values[j].empty() ||
+                        !AdmitToMem(shard_id, ssd_keys[j])) {
+                      continue;
+                    }
+                    auto& feature_value = local_shard[ssd_keys[j]];
+                    feature_value.resize(ssd_values[j].size() / sizeof(float));
+                    memcpy(const_cast<float*>(feature_value.data()),
+                           ssd_values[j].data(),
+                           ssd_values[j].size());
+                    ssd_values[j].clear();
+                    promoted_keys.push_back(ssd_keys[j]);
+                  }
+                  if (!promoted_keys.empty()) {
+                    _db->del_batch(shard_id, promoted_keys);
+                    _ssd_deletes[shard_id] += promoted_keys.size();
+                    _tier_stat.promoted += promoted_keys.size();
+                  }
+                }
+                ValueUpdateBatcher batcher(_value_accessor.get());
                 for (size_t i = 0; i < keys.size(); ++i) {
                   uint64_t key = keys[i].first;
                   uint64_t push_data_idx = keys[i].second;
                   const float* update_data =
                       values + push_data_idx * update_value_col;
                   auto itr = local_shard.find(key);
+                  auto ssd_itr = itr == local_shard.end() ? ssd_index.find(key)
+                                                          : ssd_index.end();
+                  if (ssd_itr != ssd_index.end() &&
+                      !ssd_values[ssd_itr->second].empty()) {
+                    // update the value kept on ssd in the buffer
+                    std::string& ssd_value = ssd_values[ssd_itr->second];
+                    size_t value_size = ssd_value.size() / sizeof(float);
+                    memcpy(data_buffer_ptr, ssd_value.data(), ssd_value.size());
+                    _value_accessor->Update(&data_buffer_ptr, &update_data, 1);
+                    if (value_size < value_col &&
+                        _value_accessor->NeedExtendMF(data_buffer)) {
+                      _value_accessor->Create(&extend_buffer_ptr, 1);
+                      memcpy(extend_buffer_ptr,
+                             data_buffer_ptr,
+                             value_size * sizeof(float));
+                      ssd_value.assign(
+                          reinterpret_cast<const char*>(extend_buffer_ptr),
+                          value_col * sizeof(float));
+                    } else {
+                      ssd_value.assign(
+                          reinterpret_cast<const char*>(data_buffer_ptr),
+                          value_size * sizeof(float));
+                    }
+                    ssd_dirty[ssd_itr->second] = true;
+                    continue;
+                  }
                   if (itr == local_shard.end()) {
                     if (FLAGS_pserver_enable_create_feasign_randomly &&
                         !_value_accessor->CreateValue(1, update_data)) {
@@ -402,7 +561,7 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
 
                   if (value_size ==
                       value_col) {  // 已拓展到最大size, 则就地update
-                    _value_accessor->Update(&value_data, &update_data, 1);
+                    batcher.Add(value_data, update_data);
                   } else {
                     // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
                     memcpy(data_buffer_ptr,
@@ -419,6 +578,24 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                            value_size * sizeof(float));
                   }
                 }
+                batcher.Flush();
+                // write the updated ssd values back
+                std::vector<std::pair<char*, int>> put_keys;
+                std::vector<std::pair<char*, int>> put_values;
+                for (size_t j = 0; j < ssd_dirty.size(); ++j) {
+                  if (ssd_dirty[j]) {
+                    put_keys.emplace_back(
+                        reinterpret_cast<char*>(&ssd_keys[j]),
+                        sizeof(uint64_t));
+                    put_values.emplace_back(
+                        const_cast<char*>(ssd_values[j].data()),
+                        ssd_values[j].size());
+                  }
+                }
+                if (!put_keys.empty()) {
+                  _db->put_batch(
+                      shard_id, put_keys, put_values, put_keys.size());
+                }
                 return 0;
               });
     }
@@ -475,13 +652,81 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                   -> int {
                 auto& keys = task_keys[shard_id];
                 auto& local_shard = _local_shards[shard_id];
-                float data_buffer[value_col];  // NOLINT
+                float data_buffer[value_col];    // NOLINT
+                float extend_buffer[value_col];  // NOLINT
                 float* data_buffer_ptr = data_buffer;
+                float* extend_buffer_ptr = extend_buffer;
+                // with a mem capacity a pulled key may have been left on ssd
+                // by the admission policy, it is promoted now or updated on
+                // ssd
+                std::vector<uint64_t> ssd_keys;
+                std::vector<std::string> ssd_values;
+                std::vector<bool> ssd_dirty;
+                std::unordered_map<uint64_t, size_t> ssd_index;
+                if (_mem_capacity > 0) {
+                  for (auto& key_pair : keys) {
+                    uint64_t key = key_pair.first;
+                    if (local_shard.find(key) == local_shard.end() &&
+                        ssd_index.emplace(key, ssd_keys.size()).second) {
+                      ssd_keys.push_back(key);
+                    }
+                  }
+                }
+                if (!ssd_keys.empty()) {
+                  MultiGetSSD(shard_id, ssd_keys, &ssd_values);
+                  ssd_dirty.assign(ssd_keys.size(), false);
+                  std::vector<uint64_t> promoted_keys;
+                  for (size_t j = 0; j < ssd_keys.size(); ++j) {
+                    if (ssd_values[j].empty() ||
+                        !AdmitToMem(shard_id, ssd_keys[j])) {
+                      continue;
+                    }
+                    auto& feature_value = local_shard[ssd_keys[j]];
+                    feature_value.resize(ssd_values[j].size() / sizeof(float));
+                    memcpy(const_cast<float*>(feature_value.data()),
+                           ssd_values[j].data(),
+                           ssd_values[j].size());
+                    ssd_values[j].clear();
+                    promoted_keys.push_back(ssd_keys[j]);
+                  }
+                  if (!promoted_keys.empty()) {
+                    _db->del_batch(shard_id, promoted_keys);
+                    _ssd_deletes[shard_id] += promoted_keys.size();
+                    _tier_stat.promoted += promoted_keys.size();
+                  }
+                }
+                ValueUpdateBatcher batcher(_value_accessor.get());
                 for (size_t i = 0; i < keys.size(); ++i) {
                   uint64_t key = keys[i].first;
                   uint64_t push_data_idx = keys[i].second;
                   const float* update_data = values[push_data_idx];
                   auto itr = local_shard.find(key);
+                  auto ssd_itr = itr == local_shard.end() ? ssd_index.find(key)
+                                                          : ssd_index.end();
+                  if (ssd_itr != ssd_index.end() &&
+                      !ssd_values[ssd_itr->second].empty()) {
+                    // update the value kept on ssd in the buffer
+                    std::string& ssd_value = ssd_values[ssd_itr->second];
+                    size_t value_size = ssd_value.size() / sizeof(float);
+                    memcpy(data_buffer_ptr, ssd_value.data(), ssd_value.size());
+                    _value_accessor->Update(&data_buffer_ptr, &update_data, 1);
+                    if (value_size < value_col &&
+                        _value_accessor->NeedExtendMF(data_buffer)) {
+                      _value_accessor->Create(&extend_buffer_ptr, 1);
+                      memcpy(extend_buffer_ptr,
+                             data_buffer_ptr,
+                             value_size * sizeof(float));
+                      ssd_value.assign(
+                          reinterpret_cast<const char*>(extend_buffer_ptr),
+                          value_col * sizeof(float));
+                    } else {
+                      ssd_value.assign(
+                          reinterpret_cast<const char*>(data_buffer_ptr),
+                          value_size * sizeof(float));
+                    }
+                    ssd_dirty[ssd_itr->second] = true;
+                    continue;
+                  }
                   if (itr == local_shard.end()) {
                     if (FLAGS_pserver_enable_create_feasign_randomly &&
                         !_value_accessor->CreateValue(1, update_data)) {
@@ -502,7 +747,7 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
 
                   if (value_size ==
                       value_col) {  // 已拓展到最大size, 则就地update
-                    _value_accessor->Update(&value_data, &update_data, 1);
+                    batcher.Add(value_data, update_data);
                   } else {
                     // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
                     memcpy(data_buffer_ptr,
@@ -519,6 +764,24 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                            value_size * sizeof(float));
                   }
                 }
+                batcher.Flush();
+                // write the updated ssd values back
+                std::vector<std::pair<char*, int>> put_keys;
+                std::vector<std::pair<char*, int>> put_values;
+                for (size_t j = 0; j < ssd_dirty.size(); ++j) {
+                  if (ssd_dirty[j]) {
+                    put_keys.emplace_back(
+                        reinterpret_cast<char*>(&ssd_keys[j]),
+                        sizeof(uint64_t));
+                    put_values.emplace_back(
+                        const_cast<char*>(ssd_values[j].data()),
+                        ssd_values[j].size());
+                  }
+                }
+                if (!put_keys.empty()) {
+                  _db->put_batch(
+                      shard_id, put_keys, put_values, put_keys.size());
+                }
                 return 0;
               });
     }
@@ -530,6 +793,7 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
 }
 
 int32_t SSDSparseTable::Shrink(const std::string& param) {
+  std::lock_guard<std::mutex> guard(_table_mutex);
   int thread_num = _real_local_shard_num < 20 ? _real_local_shard_num : 20;
   omp_set_num_threads(thread_num);
 #pragma omp parallel for schedule(dynamic)
@@ -570,6 +834,7 @@ int32_t SSDSparseTable::Shrink(const std::string& param) {
 }
 
 int32_t SSDSparseTable::UpdateTable() {
+  std::lock_guard<std::mutex> guard(_table_mutex);
   int count = 0;
   for (int i = 0; i < _real_local_shard_num; ++i) {
     auto& shard = _local_shards[i];
@@ -2580,6 +2845,7 @@ int32_t SSDSparseTable::SaveCache(
 
 int32_t SSDSparseTable::Load(const std::string& path,
                              const std::string& param) {
+  std::lock_guard<std::mutex> guard(_table_mutex);
   VLOG(0) << "LOAD FLAGS_rocksdb_path:" << FLAGS_rocksdb_path;
   std::string table_path = TableDir(path);
   auto file_list = _afs_client.list(::paddle::string::format_string(
@@ -3046,9 +3312,162 @@ int32_t SSDSparseTable::LoadWithBinary(const std::string& path, int param) {
 
 std::pair<int64_t, int64_t> SSDSparseTable::PrintTableStat() {
   int64_t feasign_size = LocalSize();
+  uint64_t mem_hit = _tier_stat.mem_hit.load();
+  uint64_t ssd_hit = _tier_stat.ssd_hit.load();
+  uint64_t miss = _tier_stat.miss.load();
+  uint64_t total = mem_hit + ssd_hit + miss;
+  if (total > 0) {
+    LOG(INFO) << "SSDSparseTable pull keys: " << total
+              << ", mem hit ratio: " << static_cast<double>(mem_hit) / total
+              << ", ssd hit ratio: " << static_cast<double>(ssd_hit) / total
+              << ", miss ratio: " << static_cast<double>(miss) / total
+              << ", promoted: " << _tier_stat.promoted.load()
+              << ", rejected: " << _tier_stat.rejected.load()
+              << ", demoted: " << _tier_stat.demoted.load();
+  }
   return {feasign_size, -1};
 }
 
+bool SSDSparseTable::AdmitToMem(int shard_id, uint64_t key) {
+  if (_mem_capacity == 0 || _local_shards[shard_id].size() < _mem_capacity) {
+    return true;
+  }
+  return _sketches[shard_id].Estimate(key) >=
+         static_cast<uint32_t>(FLAGS_pserver_ssd_admission_min_freq);
+}
+
+void SSDSparseTable::MultiGetSSD(int shard_id,
+                                 const std::vector<uint64_t>& keys,
+                                 std::vector<std::string>* values) {
+  size_t num = keys.size();
+  std::vector<rocksdb::Slice> batch_keys;
+  batch_keys.reserve(num);
+  for (auto& key : keys) {
+    batch_keys.emplace_back(reinterpret_cast<const char*>(&key),
+                            sizeof(uint64_t));
+  }
+  std::vector<rocksdb::PinnableSlice> batch_values(num);
+  std::vector<rocksdb::Status> status(num);
+  _db->multi_get(shard_id,
+                 num,
+                 batch_keys.data(),
+                 batch_values.data(),
+                 status.data(),
+                 false);
+  values->resize(num);
+  for (size_t i = 0; i < num; ++i) {
+    if (status[i].ok()) {
+      (*values)[i].assign(batch_values[i].data(), batch_values[i].size());
+    } else {
+      (*values)[i].clear();
+    }
+  }
+}
+
+void SSDSparseTable::DemoteShard(int shard_id) {
+  // PullSparsePtr holds the lock while it waits for reads queued on this
+  // task pool, so a held lock skips the round instead of waiting
+  std::unique_lock<std::mutex> shard_lock(_shard_mutex[shard_id],
+                                          std::try_to_lock);
+  if (!shard_lock.owns_lock() || _shard_pinned[shard_id]) {
+    return;
+  }
+  auto& shard = _local_shards[shard_id];
+  size_t size = shard.size();
+  if (size <= _mem_capacity) {
+    return;
+  }
+  // demote below the capacity, so a shard does not demote on every round
+  size_t target = size - _mem_capacity * 9 / 10;
+  // pick the least frequent keys among a few buckets
+  auto& sketch = _sketches[shard_id];
+  size_t& bucket = _demote_bucket[shard_id];
+  std::vector<std::pair<uint32_t, uint64_t>> candidates;
+  for (size_t scanned = 0;
+       scanned < shard.bucket_count() && candidates.size() < target * 4;
+       ++scanned) {
+    for (auto it = shard.begin(bucket); it != shard.end(bucket); ++it) {
+      candidates.emplace_back(sketch.Estimate(it.key()), it.key());
+    }
+    bucket = (bucket + 1) % shard.bucket_count();
+  }
+  target = std::min(target, candidates.size());
+  std::nth_element(
+      candidates.begin(), candidates.begin() + target, candidates.end());
+  candidates.resize(target);
+
+  std::vector<std::pair<char*, int>> ssd_keys;
+  std::vector<std::pair<char*, int>> ssd_values;
+  ssd_keys.reserve(target);
+  ssd_values.reserve(target);
+  for (auto& candidate : candidates) {
+    auto& value = shard.find(candidate.second).value();
+    ssd_keys.emplace_back(reinterpret_cast<char*>(&candidate.second),
+                          sizeof(uint64_t));
+    ssd_values.emplace_back(reinterpret_cast<char*>(value.data()),
+                            value.size() * sizeof(float));
+  }
+  if (!ssd_keys.empty()) {
+    _db->put_batch(shard_id, ssd_keys, ssd_values, ssd_keys.size());
+  }
+  for (auto& candidate : candidates) {
+    shard.erase(candidate.second);
+  }
+  _tier_stat.demoted += target;
+  VLOG(1) << "SSDSparseTable demote shard " << shard_id << " keys " << target
+          << ", mem size " << shard.size();
+}
+
+void SSDSparseTable::TierLoop() {
+  std::unique_lock<std::mutex> lock(_tier_mutex);
+  while (!_tier_stop) {
+    _tier_cond.wait_for(
+        lock, std::chrono::milliseconds(FLAGS_pserver_ssd_tier_interval_ms));
+    if (_tier_stop) {
+      break;
+    }
+    lock.unlock();
+    {
+      // save, load, shrink and cache walk the shards themselves, skip the
+      // round while one of them runs
+      std::unique_lock<std::mutex> table_lock(_table_mutex, std::try_to_lock);
+      if (table_lock.owns_lock()) {
+        std::vector<std::future<int>> tasks;
+        for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+          tasks.push_back(
+              _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
+                  [this, shard_id]() -> int {
+                    DemoteShard(shard_id);
+                    return 0;
+                  }));
+        }
+        for (auto& task : tasks) {
+          task.wait();
+        }
+      }
+    }
+    for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+      if (_ssd_deletes[shard_id].load() >=
+          static_cast<uint64_t>(FLAGS_pserver_ssd_compact_deletes)) {
+        _ssd_deletes[shard_id] = 0;
+        _db->compact_range(shard_id);
+      }
+    }
+    lock.lock();
+  }
+}
+
+void SSDSparseTable::StopTierThread() {
+  {
+    std::lock_guard<std::mutex> lock(_tier_mutex);
+    _tier_stop = true;
+  }
+  _tier_cond.notify_all();
+  if (_tier_thread.joinable()) {
+    _tier_thread.join();
+  }
+}
+
 int32_t SSDSparseTable::CacheTable(uint16_t pass_id) {
   std::lock_guard<std::mutex> guard(_table_mutex);
   VLOG(0) << "cache_table";
@@ -3197,6 +3616,11 @@ int32_t SSDSparseTable::CacheTable(uint16_t pass_id) {
     tasks[i].wait();
   }
   tasks.clear();
+  // the pass is over, pointers from PullSparsePtr are no longer used
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    std::lock_guard<std::mutex> shard_lock(_shard_mutex[i]);
+    _shard_pinned[i] = false;
+  }
 
   VLOG(0) << "Table>> cache ssd count: " << count.load();
   VLOG(0) << "Table>> after update, mem feasign size:" << LocalSize();
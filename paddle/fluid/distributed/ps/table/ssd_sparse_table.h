@@ -14,7 +14,11 @@
 
 #pragma once
 
+#include <condition_variable>  // NOLINT
+#include <thread>              // NOLINT
+
 #include "paddle/common/flags.h"
+#include "paddle/fluid/distributed/ps/table/depends/frequency_sketch.h"
 #include "paddle/fluid/distributed/ps/table/depends/rocksdb_warpper.h"
 #include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
 
@@ -60,11 +64,21 @@ class MemRegion {
   char* _buf;
 };
 
+// Hit counters of the mem and ssd tiers of a SSDSparseTable.
+struct SSDTierStat {
+  std::atomic<uint64_t> mem_hit{0};
+  std::atomic<uint64_t> ssd_hit{0};
+  std::atomic<uint64_t> miss{0};      // found in neither tier
+  std::atomic<uint64_t> promoted{0};  // moved from ssd to mem
+  std::atomic<uint64_t> rejected{0};  // read from ssd but left there
+  std::atomic<uint64_t> demoted{0};   // moved from mem to ssd
+};
+
 class SSDSparseTable : public MemorySparseTable {
  public:
   typedef SparseTableShard<uint64_t, FixedFeatureValue> shard_type;
   SSDSparseTable() {}
-  virtual ~SSDSparseTable() {}
+  virtual ~SSDSparseTable();
 
   int32_t Initialize() override;
   int32_t InitializeShard() override;
@@ -135,6 +149,39 @@ class SSDSparseTable : public MemorySparseTable {
   void SetDayId(int day_id) override;
 
  private:
+  // Whether a key read from ssd should move into the mem tier of its shard.
+  // Always true without a mem capacity, otherwise a full shard only admits
+  // keys the frequency sketch has seen often enough.
+  bool AdmitToMem(int shard_id, uint64_t key);
+  // Reads keys from the ssd tier of a shard with one MultiGet, values[i] is
+  // empty when keys[i] is not on ssd.
+  void MultiGetSSD(int shard_id,
+                   const std::vector<uint64_t>& keys,
+                   std::vector<std::string>* values);
+  // Writes the least frequent keys of a shard over its mem capacity to ssd,
+  // runs on the task pool of the shard. Shards whose value pointers were
+  // handed out by PullSparsePtr are skipped until CacheTable ends the pass,
+  // as is a shard PullSparsePtr is running on.
+  void DemoteShard(int shard_id);
+  // Background loop demoting shards over capacity and compacting ssd
+  // columns with many deleted keys.
+  void TierLoop();
+  void StopTierThread();
+
+  size_t _mem_capacity = 0;  // max feasigns in mem per shard, 0 no limit
+  std::unique_ptr<FrequencySketch[]> _sketches;
+  std::vector<size_t> _demote_bucket;  // next bucket to scan per shard
+  std::unique_ptr<std::atomic<uint64_t>[]> _ssd_deletes;
+  // PullSparsePtr runs on the caller thread, this orders it with
+  // DemoteShard on the mem tier of a shard. The sketches are thread safe.
+  std::unique_ptr<std::mutex[]> _shard_mutex;
+  std::unique_ptr<bool[]> _shard_pinned;  // guarded by _shard_mutex
+  SSDTierStat _tier_stat;
+  std::thread _tier_thread;
+  std::mutex _tier_mutex;
+  std::condition_variable _tier_cond;
+  bool _tier_stop = false;
+
   RocksDBHandler* _db;
   int64_t _cache_tk_size;
   double _local_show_threshold{0.0};
@@ -157,6 +157,8 @@ class Table {
 
   virtual void *GetShard(size_t shard_idx) = 0;
   virtual std::pair<int64_t, int64_t> PrintTableStat() { return {0, 0}; }
+  // {reserved bytes, used bytes} of the value storage
+  virtual std::pair<int64_t, int64_t> PrintTableMemoryStat() { return {0, 0}; }
   virtual int32_t CacheTable(uint16_t pass_id UNUSED) { return 0; }
 
   // for patch model
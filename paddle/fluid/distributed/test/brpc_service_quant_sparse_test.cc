@@ -0,0 +1,200 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <unistd.h>
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/service/brpc_ps_client.h"
+#include "paddle/fluid/distributed/ps/service/brpc_ps_server.h"
+#include "paddle/fluid/distributed/ps/service/env.h"
+#include "paddle/fluid/distributed/ps/table/ctr_quant_accessor.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+namespace framework = paddle::framework;
+
+namespace paddle::distributed {
+
+const int kEmbedxDim = 8;
+const int kKeyNum = 10;
+// table 0 keeps fp16 weights, table 1 int8 weights
+const int kQuantBits[] = {16, 8};
+
+void GetQuantSparseTableProto(TableParameter* sparse_table_proto,
+                              int table_id) {
+  sparse_table_proto->set_table_id(table_id);
+  sparse_table_proto->set_table_class("MemorySparseTable");
+  sparse_table_proto->set_shard_num(10);
+  TableAccessorParameter* accessor_config =
+      sparse_table_proto->mutable_accessor();
+  accessor_config->set_accessor_class("CtrQuantAccessor");
+  accessor_config->set_fea_dim(kEmbedxDim + 3);
+  accessor_config->set_embedx_dim(kEmbedxDim);
+  accessor_config->set_embedx_threshold(0);
+  auto* ctr_param = accessor_config->mutable_ctr_accessor_param();
+  ctr_param->set_nonclk_coeff(0.2);
+  ctr_param->set_click_coeff(1);
+  ctr_param->set_base_threshold(0.5);
+  ctr_param->set_delta_threshold(0.2);
+  ctr_param->set_delta_keep_days(16);
+  ctr_param->set_show_click_decay_rate(0.99);
+  ctr_param->set_embedx_quant_bits(kQuantBits[table_id]);
+  for (auto* sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseNaiveSGDRule");
+    auto* naive_param = sgd_param->mutable_naive();
+    naive_param->set_learning_rate(1.0);
+    naive_param->set_initial_range(0.3);
+    naive_param->add_weight_bounds(-10.0);
+    naive_param->add_weight_bounds(10.0);
+  }
+}
+
+void GetQuantServerParameter(ServerParameter* server_proto) {
+  DownpourServerParameter* downpour_server_proto =
+      server_proto->mutable_downpour_server_param();
+  ServerServiceParameter* server_service_proto =
+      downpour_server_proto->mutable_service_param();
+  server_service_proto->set_service_class("BrpcPsService");
+  server_service_proto->set_server_class("BrpcPsServer");
+  server_service_proto->set_client_class("BrpcPsClient");
+  server_service_proto->set_start_server_port(0);
+  server_service_proto->set_server_thread_num(12);
+  for (int table_id = 0; table_id < 2; ++table_id) {
+    GetQuantSparseTableProto(
+        downpour_server_proto->add_downpour_table_param(), table_id);
+  }
+}
+
+std::string quant_ip_ = "127.0.0.1";  // NOLINT
+uint32_t quant_port_ = 4210;
+std::vector<std::string> quant_host_sign_list_;
+std::shared_ptr<PSServer> quant_server_ptr_;
+std::shared_ptr<PSClient> quant_worker_ptr_;
+
+void RunQuantServer() {
+  PSParameter server_proto;
+  GetQuantServerParameter(server_proto.mutable_server_param());
+  PaddlePSEnvironment ps_env;
+  ps_env.SetPsServers(&quant_host_sign_list_, 1);
+  quant_server_ptr_ =
+      std::shared_ptr<PSServer>(PSServerFactory::Create(server_proto));
+  std::vector<framework::ProgramDesc> empty_vec(1);
+  quant_server_ptr_->Configure(server_proto, ps_env, 0, empty_vec);
+  quant_server_ptr_->Start(quant_ip_, quant_port_);
+}
+
+void RunQuantClient() {
+  PSParameter worker_proto;
+  auto* downpour_worker_proto =
+      worker_proto.mutable_worker_param()->mutable_downpour_worker_param();
+  for (int table_id = 0; table_id < 2; ++table_id) {
+    GetQuantSparseTableProto(downpour_worker_proto->add_downpour_table_param(),
+                             table_id);
+  }
+  GetQuantServerParameter(worker_proto.mutable_server_param());
+  PaddlePSEnvironment ps_env;
+  ps_env.SetPsServers(&quant_host_sign_list_, quant_host_sign_list_.size());
+  std::map<uint64_t, std::vector<Region>> dense_regions;
+  quant_worker_ptr_ =
+      std::shared_ptr<PSClient>(PSClientFactory::Create(worker_proto));
+  quant_worker_ptr_->Configure(worker_proto, dense_regions, ps_env, 0);
+}
+
+// pulls the values of all keys of table_id, decoded by the client
+std::vector<float> PullQuantValues(int table_id) {
+  const size_t select_dim = 3 + kEmbedxDim;
+  std::vector<uint64_t> keys(kKeyNum);
+  std::vector<float> values(kKeyNum * select_dim);
+  std::vector<float*> value_ptr(kKeyNum);
+  for (int i = 0; i < kKeyNum; ++i) {
+    keys[i] = i;
+    value_ptr[i] = values.data() + i * select_dim;
+  }
+  auto status = quant_worker_ptr_->PullSparse(
+      value_ptr.data(), table_id, keys.data(), kKeyNum, true);
+  status.wait();
+  EXPECT_EQ(status.get(), 0);
+  return values;
+}
+
+// pushes a gradient of 0.5 for the weights of all keys of table_id, encoded
+// by the client
+void PushQuantGradient(int table_id) {
+  const size_t push_dim = 4 + kEmbedxDim;
+  std::vector<uint64_t> keys(kKeyNum);
+  std::vector<float> grads(kKeyNum * push_dim, 0.5);
+  std::vector<const float*> grad_ptr(kKeyNum);
+  for (int i = 0; i < kKeyNum; ++i) {
+    keys[i] = i;
+    float* grad = grads.data() + i * push_dim;
+    grad[CtrCommonAccessor::CtrCommonPushValue::SlotIndex()] = 1;
+    grad[CtrCommonAccessor::CtrCommonPushValue::ShowIndex()] = 1;
+    grad[CtrCommonAccessor::CtrCommonPushValue::ClickIndex()] = 0;
+    grad_ptr[i] = grad;
+  }
+  auto* closure = new DownpourBrpcClosure(1, [](void* done) {
+    auto* closure = reinterpret_cast<DownpourBrpcClosure*>(done);
+    closure->set_promise_value(
+        closure->check_response(0, PS_PUSH_SPARSE_TABLE) != 0 ? -1 : 0);
+  });
+  auto status = quant_worker_ptr_->PushSparseRawGradient(
+      table_id, keys.data(), grad_ptr.data(), kKeyNum, closure);
+  status.wait();
+  EXPECT_EQ(status.get(), 0);
+}
+
+// The pull values go through EncodeSelect on the server and DecodeSelect on
+// the client, the push values through EncodeUpdate and DecodeUpdate.
+TEST(RunBrpcQuantSparse, Run) {
+  setenv("http_proxy", "", 1);
+  setenv("https_proxy", "", 1);
+  auto ph_host = PSHost(quant_ip_, quant_port_, 0);
+  quant_host_sign_list_.push_back(ph_host.SerializeToString());
+  std::thread server_thread(RunQuantServer);
+  sleep(1);
+  RunQuantClient();
+
+  const size_t select_dim = 3 + kEmbedxDim;
+  for (int table_id = 0; table_id < 2; ++table_id) {
+    float tolerance = kQuantBits[table_id] == 16 ? 1e-3 : 2.0 / 127;
+    std::vector<float> before = PullQuantValues(table_id);
+    PushQuantGradient(table_id);
+    std::vector<float> after = PullQuantValues(table_id);
+    for (int i = 0; i < kKeyNum; ++i) {
+      const float* old_value = before.data() + i * select_dim;
+      const float* new_value = after.data() + i * select_dim;
+      using PullValue = CtrCommonAccessor::CtrCommonPullValue;
+      EXPECT_FLOAT_EQ(new_value[PullValue::ShowIndex()], 1);
+      EXPECT_FLOAT_EQ(new_value[PullValue::ClickIndex()], 0);
+      EXPECT_FLOAT_EQ(new_value[PullValue::EmbedWIndex()],
+                      old_value[PullValue::EmbedWIndex()] - 0.5);
+      for (int j = 0; j < kEmbedxDim; ++j) {
+        int index = PullValue::EmbedxWIndex() + j;
+        EXPECT_NEAR(new_value[index], old_value[index] - 0.5, tolerance)
+            << "table " << table_id << " key " << i << " dim " << j;
+      }
+    }
+  }
+
+  quant_worker_ptr_->StopServer();
+  quant_worker_ptr_->FinalizeWorker();
+  server_thread.join();
+}
+
+}  // namespace paddle::distributed
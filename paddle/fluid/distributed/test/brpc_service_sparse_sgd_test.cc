@@ -14,6 +14,7 @@ limitations under the License. */
 
 #include <unistd.h>
 
+#include <atomic>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -26,8 +27,11 @@ limitations under the License. */
 #include "paddle/phi/common/place.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
 
+PD_DECLARE_bool(pserver_sparse_attachment_payload);
+
 namespace paddle {
 namespace distributed {
+PD_DECLARE_bool(pserver_pull_sparse_coalesce);
 class DownpourBrpcClosure;
 class PSClient;
 class PSServer;
@@ -301,6 +305,87 @@ void RunBrpcPushSparse() {
     EXPECT_FLOAT_EQ(fea_temp_values[idx], fea_values[idx] - 1.0);
   }
 
+  /*-----------------------Test Coalesced Pull-------------------------------*/
+  LOG(INFO) << "Run coalesced pull_sparse";
+  paddle::distributed::FLAGS_pserver_pull_sparse_coalesce = true;
+  const size_t pull_thread_num = 4;
+  std::vector<std::vector<float>> coalesced_values(
+      pull_thread_num, std::vector<float>(fea_temp_values.size()));
+  std::vector<std::thread> pull_threads;
+  std::atomic<size_t> ready_num(0);
+  for (size_t t = 0; t < pull_thread_num; ++t) {
+    pull_threads.emplace_back([&, t] {
+      // every thread pulls the same keys, the merged request dedups them
+      std::vector<float*> value_ptr(fea_keys.size());
+      for (size_t idx = 0; idx < fea_keys.size(); ++idx) {
+        value_ptr[idx] = coalesced_values[t].data() + idx * 10;
+      }
+      // start the pulls together so they queue on the same batch
+      ready_num.fetch_add(1);
+      while (ready_num.load() < pull_thread_num) {
+        std::this_thread::yield();
+      }
+      auto status = worker_ptr_->PullSparse(
+          value_ptr.data(), 0, fea_keys.data(), fea_keys.size(), false);
+      status.wait();
+      EXPECT_EQ(status.get(), 0);
+    });
+  }
+  for (auto& t : pull_threads) {
+    t.join();
+  }
+  paddle::distributed::FLAGS_pserver_pull_sparse_coalesce = false;
+  uint64_t coalesced_call_num = 0;
+  uint64_t coalesced_request_num = 0;
+  dynamic_cast<paddle::distributed::BrpcPsClient*>(worker_ptr_.get())
+      ->GetPullSparseCoalesceStat(
+          0, false, &coalesced_call_num, &coalesced_request_num);
+  EXPECT_EQ(coalesced_call_num, pull_thread_num);
+  EXPECT_GE(coalesced_request_num, 1UL);
+  EXPECT_LT(coalesced_request_num, coalesced_call_num);
+  for (size_t t = 0; t < pull_thread_num; ++t) {
+    for (size_t idx = 0; idx < fea_temp_values.size(); ++idx) {
+      EXPECT_FLOAT_EQ(coalesced_values[t][idx], fea_temp_values[idx]);
+    }
+  }
+
+  /*-----------------------Test Attachment Payload---------------------------*/
+  LOG(INFO) << "Run push_sparse_grad and pull_sparse with attachment payload";
+  FLAGS_pserver_sparse_attachment_payload = true;
+  paddle::distributed::DownpourBrpcClosure* closure_push_grad2 =
+      new paddle::distributed::DownpourBrpcClosure(1, [&](void* done) {
+        int ret = 0;
+        auto* closure = (paddle::distributed::DownpourBrpcClosure*)done;
+        if (closure->check_response(
+                0, paddle::distributed::PS_PUSH_SPARSE_TABLE) != 0) {
+          ret = -1;
+        }
+        closure->set_promise_value(ret);
+      });
+  push_grad_status =
+      worker_ptr_->PushSparseRawGradient(0,
+                                         fea_keys.data(),
+                                         (const float**)push_g_vec.data(),
+                                         fea_keys.size(),
+                                         closure_push_grad2);
+  push_grad_status.wait();
+  EXPECT_EQ(push_grad_status.get(), 0);
+
+  std::vector<float> attachment_values(fea_temp_values.size());
+  std::vector<float*> attachment_value_ptr(fea_keys.size());
+  for (size_t idx = 0; idx < fea_keys.size(); ++idx) {
+    attachment_value_ptr[idx] = attachment_values.data() + idx * 10;
+  }
+  auto attachment_status = worker_ptr_->PullSparse(
+      attachment_value_ptr.data(), 0, fea_keys.data(), fea_keys.size(), true);
+  attachment_status.wait();
+  EXPECT_EQ(attachment_status.get(), 0);
+  FLAGS_pserver_sparse_attachment_payload = false;
+  // the push went through the server, so the values moved by one more step
+  for (size_t idx = 0; idx < fea_temp_values.size(); ++idx) {
+    EXPECT_FLOAT_EQ(attachment_values[idx], fea_temp_values[idx] - 1.0);
+  }
+
   LOG(INFO) << "Run stop_server";
   worker_ptr_->StopServer();
   LOG(INFO) << "Run finalize_worker";
@@ -0,0 +1,105 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/table/depends/concurrent_sparse_shard.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle::distributed {
+
+TEST(ConcurrentSparseTableShard, UpsertFind) {
+  ConcurrentSparseTableShard shard;
+  shard.Init(8, 16);
+  float out[8];
+  ASSERT_EQ(shard.Find(1, out), -1);
+
+  std::vector<float> vec = {0.0, 0.1, 0.2, 0.3};
+  ASSERT_TRUE(shard.Upsert(
+      1,
+      [&](float* data) -> uint32_t {
+        memcpy(data, vec.data(), vec.size() * sizeof(float));
+        return vec.size();
+      },
+      [](float* data, uint32_t* size) { data[0] += 1.0; }));
+  ASSERT_EQ(shard.Find(1, out), 4);
+  ASSERT_FLOAT_EQ(out[0], 1.0);
+  ASSERT_FLOAT_EQ(out[3], 0.3);
+
+  // create returning 0 skips the insert
+  ASSERT_FALSE(shard.Upsert(
+      2,
+      [](float* data) -> uint32_t { return 0; },
+      [](float* data, uint32_t* size) {}));
+  ASSERT_EQ(shard.Find(2, out), -1);
+  ASSERT_EQ(shard.size(), 1UL);
+}
+
+TEST(ConcurrentSparseTableShard, MultiThread) {
+  const int thread_num = 8;
+  const uint64_t key_num = 20000;
+  ConcurrentSparseTableShard shard;
+  shard.Init(8, 16);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&shard, key_num]() {
+      float out[8];
+      for (uint64_t key = 0; key < key_num; ++key) {
+        shard.Upsert(
+            key,
+            [](float* data) -> uint32_t {
+              memset(data, 0, 4 * sizeof(float));
+              return 4;
+            },
+            [key](float* data, uint32_t* size) {
+              data[0] += 1.0;
+              if (*size == 4) {
+                for (int i = 4; i < 8; ++i) data[i] = key;
+                *size = 8;
+              }
+            });
+        shard.Find(key / 2, out);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(shard.size(), key_num);
+  float out[8];
+  for (uint64_t key = 0; key < key_num; ++key) {
+    ASSERT_EQ(shard.Find(key, out), 8);
+    ASSERT_FLOAT_EQ(out[0], thread_num);
+    ASSERT_FLOAT_EQ(out[7], key);
+  }
+
+  size_t erased = shard.EraseIf(
+      [](uint64_t key, float* data, size_t size) { return key % 2 == 0; });
+  ASSERT_EQ(erased, key_num / 2);
+  ASSERT_EQ(shard.size(), key_num / 2);
+  ASSERT_EQ(shard.Find(2, out), -1);
+  ASSERT_EQ(shard.Find(3, out), 8);
+
+  size_t visited = 0;
+  shard.ForEach([&visited](uint64_t key, float* data, size_t size) {
+    ++visited;
+    return true;
+  });
+  ASSERT_EQ(visited, key_num / 2);
+}
+
+}  // namespace paddle::distributed
@@ -0,0 +1,219 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/ctr_quant_accessor.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/common/registerer.h"
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+namespace paddle::distributed {
+REGISTER_PSCORE_CLASS(SparseValueSGDRule, StdAdaGradSGDRule);
+REGISTER_PSCORE_CLASS(SparseValueSGDRule, SparseNaiveSGDRule);
+
+TableAccessorParameter gen_quant_param(int bits) {
+  TableAccessorParameter param;
+  param.set_accessor_class("CtrQuantAccessor");
+  param.set_fea_dim(11);
+  param.set_embedx_dim(8);
+  param.mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  param.mutable_ctr_accessor_param()->set_click_coeff(1);
+  param.mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  param.mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  param.mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  param.mutable_ctr_accessor_param()->set_show_click_decay_rate(0.99);
+  param.mutable_ctr_accessor_param()->set_embedx_quant_bits(bits);
+
+  param.mutable_embed_sgd_param()->set_name("StdAdaGradSGDRule");
+  auto* adagrad_param = param.mutable_embed_sgd_param()->mutable_adagrad();
+  adagrad_param->set_learning_rate(0.1);
+  adagrad_param->set_initial_range(0.3);
+  adagrad_param->set_initial_g2sum(0.0);
+  adagrad_param->add_weight_bounds(-10.0);
+  adagrad_param->add_weight_bounds(10.0);
+
+  param.mutable_embedx_sgd_param()->set_name("SparseNaiveSGDRule");
+  auto* naive_param = param.mutable_embedx_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+  return param;
+}
+
+// largest error of a weight quantized with bits, for weights in [-1, 1]
+float quant_tolerance(int bits) { return bits == 16 ? 1e-3 : 1.0 / 127; }
+
+TEST(CtrQuantAccessor, QuantRoundTrip) {
+  const int dim = 9;
+  std::vector<float> w(dim);
+  for (int i = 0; i < dim; ++i) {
+    w[i] = std::sin(i + 1.0);
+  }
+  for (int bits : {16, 8}) {
+    int slots = CtrQuantAccessor::QuantSlots(bits, dim);
+    ASSERT_EQ(slots, bits == 16 ? 5 : 4);
+    std::vector<float> packed(slots);
+    std::vector<float> out(dim);
+    CtrQuantAccessor::Quantize(bits, w.data(), dim, packed.data());
+    CtrQuantAccessor::Dequantize(bits, packed.data(), dim, out.data());
+    for (int i = 0; i < dim; ++i) {
+      ASSERT_NEAR(out[i], w[i], quant_tolerance(bits));
+    }
+  }
+}
+
+// Updates far below the quantization step still move the weight, as the
+// requantization rounds stochastically instead of to the nearest.
+TEST(CtrQuantAccessor, SmallUpdatesAccumulate) {
+  const int dim = 4;
+  for (int bits : {16, 8}) {
+    std::vector<float> w = {1.0, 0.0, -0.5, 0.25};
+    std::vector<float> packed(CtrQuantAccessor::QuantSlots(bits, dim));
+    CtrQuantAccessor::Quantize(bits, w.data(), dim, packed.data());
+    const int steps = 4000;
+    for (int step = 0; step < steps; ++step) {
+      CtrQuantAccessor::Dequantize(bits, packed.data(), dim, w.data());
+      w[1] += 1e-4;
+      w[3] += 1e-4;
+      CtrQuantAccessor::Quantize(bits, w.data(), dim, packed.data(), true);
+    }
+    CtrQuantAccessor::Dequantize(bits, packed.data(), dim, w.data());
+    // rounded to the nearest, both would have stayed where they started
+    EXPECT_NEAR(w[1], 0.4, 0.25) << "bits " << bits;
+    EXPECT_NEAR(w[3], 0.65, 0.25) << "bits " << bits;
+    EXPECT_FLOAT_EQ(w[0], 1.0);
+  }
+}
+
+TEST(CtrQuantAccessor, UpdateMatchesCtrCommonAccessor) {
+  for (int bits : {16, 8}) {
+    TableAccessorParameter parameter = gen_quant_param(bits);
+    CtrQuantAccessor quant_acc;
+    ASSERT_EQ(quant_acc.Configure(parameter), 0);
+    ASSERT_EQ(quant_acc.Initialize(), 0);
+    CtrCommonAccessor common_acc;
+    ASSERT_EQ(common_acc.Configure(parameter), 0);
+    ASSERT_EQ(common_acc.Initialize(), 0);
+
+    auto quant_info = quant_acc.GetAccessorInfo();
+    auto common_info = common_acc.GetAccessorInfo();
+    ASSERT_LT(quant_info.dim, common_info.dim);
+    ASSERT_EQ(quant_info.select_dim, common_info.select_dim);
+    ASSERT_EQ(quant_info.update_dim, common_info.update_dim);
+    ASSERT_LT(quant_acc.SelectWireSize(), quant_info.select_size);
+    ASSERT_LT(quant_acc.UpdateWireSize(), quant_info.update_size);
+
+    // the same value in both layouts
+    std::vector<float> quant_value(quant_info.dim);
+    float* quant_ptr = quant_value.data();
+    ASSERT_EQ(quant_acc.Create(&quant_ptr, 1), 0);
+    std::vector<float> select(quant_info.select_dim);
+    float* select_ptr = select.data();
+    ASSERT_EQ(
+        quant_acc.Select(&select_ptr, (const float**)&quant_ptr, 1),  // NOLINT
+        0);
+    auto& quant_fv = quant_acc.common_feature_value;
+    auto& common_fv = common_acc.common_feature_value;
+    std::vector<float> common_value(common_info.dim);
+    memcpy(common_value.data(),
+           quant_ptr,
+           quant_fv.EmbedxWIndex() * sizeof(float));
+    memcpy(common_value.data() + common_fv.EmbedxWIndex(),
+           CtrCommonAccessor::CtrCommonPullValue::EmbedxW(select.data()),
+           8 * sizeof(float));
+    memcpy(common_value.data() + common_fv.EmbedxG2SumIndex(),
+           quant_ptr + quant_fv.EmbedxG2SumIndex(),
+           common_fv.embedx_sgd_dim * sizeof(float));
+    float* common_ptr = common_value.data();
+
+    // the push value goes through the wire encoding first
+    std::vector<float> push(quant_info.update_dim);
+    for (size_t i = 0; i < push.size(); ++i) {
+      push[i] = 0.05 * std::cos(i + 1.0);
+    }
+    push[CtrCommonAccessor::CtrCommonPushValue::ShowIndex()] = 1;
+    push[CtrCommonAccessor::CtrCommonPushValue::ClickIndex()] = 0;
+    std::vector<char> wire(quant_acc.UpdateWireSize());
+    quant_acc.EncodeUpdate(wire.data(), push.data());
+    std::vector<float> decoded(quant_info.update_dim);
+    quant_acc.DecodeUpdate(decoded.data(), wire.data());
+    const float* push_ptr = decoded.data();
+
+    ASSERT_EQ(quant_acc.Update(&quant_ptr, &push_ptr, 1), 0);
+    ASSERT_EQ(common_acc.Update(&common_ptr, &push_ptr, 1), 0);
+
+    std::vector<float> quant_select(quant_info.select_dim);
+    std::vector<float> common_select(common_info.select_dim);
+    float* quant_select_ptr = quant_select.data();
+    float* common_select_ptr = common_select.data();
+    quant_acc.Select(
+        &quant_select_ptr, (const float**)&quant_ptr, 1);  // NOLINT
+    common_acc.Select(
+        &common_select_ptr, (const float**)&common_ptr, 1);  // NOLINT
+    for (size_t i = 0; i < quant_select.size(); ++i) {
+      ASSERT_NEAR(quant_select[i], common_select[i], quant_tolerance(bits));
+    }
+
+    // pull values survive the wire encoding
+    std::vector<char> select_wire(quant_acc.SelectWireSize());
+    quant_acc.EncodeSelect(select_wire.data(), quant_select.data());
+    std::vector<float> decoded_select(quant_info.select_dim);
+    quant_acc.DecodeSelect(decoded_select.data(), select_wire.data());
+    for (size_t i = 0; i < quant_select.size(); ++i) {
+      ASSERT_NEAR(decoded_select[i], quant_select[i], quant_tolerance(bits));
+    }
+  }
+}
+
+TEST(CtrQuantAccessor, ParseRoundTrip) {
+  for (int bits : {16, 8}) {
+    TableAccessorParameter parameter = gen_quant_param(bits);
+    parameter.set_embedx_threshold(0);
+    CtrQuantAccessor acc;
+    ASSERT_EQ(acc.Configure(parameter), 0);
+    ASSERT_EQ(acc.Initialize(), 0);
+    auto info = acc.GetAccessorInfo();
+
+    std::vector<float> value(info.dim);
+    float* value_ptr = value.data();
+    acc.Create(&value_ptr, 1);
+    acc.common_feature_value.Show(value_ptr) = 3;
+    acc.common_feature_value.Click(value_ptr) = 1;
+    std::string str = acc.ParseToString(value_ptr, info.dim);
+
+    std::vector<float> parsed(info.dim);
+    float* parsed_ptr = parsed.data();
+    ASSERT_EQ(acc.ParseFromString(str, parsed_ptr),
+              static_cast<int>(info.dim));
+
+    std::vector<float> select(info.select_dim);
+    std::vector<float> parsed_select(info.select_dim);
+    float* select_ptr = select.data();
+    float* parsed_select_ptr = parsed_select.data();
+    acc.Select(&select_ptr, (const float**)&value_ptr, 1);  // NOLINT
+    acc.Select(
+        &parsed_select_ptr, (const float**)&parsed_ptr, 1);  // NOLINT
+    for (size_t i = 0; i < select.size(); ++i) {
+      ASSERT_NEAR(parsed_select[i], select[i], quant_tolerance(bits));
+    }
+  }
+}
+
+}  // namespace paddle::distributed
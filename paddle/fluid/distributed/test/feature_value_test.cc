@@ -14,6 +14,7 @@ limitations under the License. */
 
 #include "paddle/fluid/distributed/ps/table/depends/feature_value.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -45,4 +46,103 @@ TEST(BENCHMARK, LargeScaleKV) {
   ASSERT_FLOAT_EQ(value_data[3], 0.3);
 }
 
+TEST(SlabArena, ShardValueArena) {
+  typedef SparseTableShard<uint64_t, FixedFeatureValue> shard_type;
+  shard_type shard;
+  shard.init_value_arena(8);
+  const uint64_t key_num = 50000;
+  for (uint64_t key = 0; key < key_num; ++key) {
+    auto& feature_value = shard[key];
+    feature_value.resize(key % 2 ? 4 : 8);
+    for (size_t i = 0; i < feature_value.size(); ++i) {
+      feature_value.data()[i] = key;
+    }
+  }
+  auto stat = shard.value_arena()->Stat();
+  ASSERT_EQ(stat.used_bytes, key_num / 2 * (4 + 8) * sizeof(float));
+
+  // grow keeps the leading values and zero fills the rest
+  auto& grown = shard[1];
+  grown.resize(8);
+  ASSERT_FLOAT_EQ(grown.data()[3], 1.0);
+  ASSERT_FLOAT_EQ(grown.data()[4], 0.0);
+  grown.resize(4);
+
+  for (auto it = shard.begin(); it != shard.end();) {
+    if (it.key() % 10 != 0) {
+      it = shard.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  size_t released = shard.compact_values();
+  ASSERT_GT(released, 0UL);
+  auto compact_stat = shard.value_arena()->Stat();
+  ASSERT_LT(compact_stat.reserved_bytes, stat.reserved_bytes);
+  ASSERT_EQ(shard.size(), key_num / 10);
+  for (auto it = shard.begin(); it != shard.end(); ++it) {
+    ASSERT_EQ(it.value().size(), 8UL);
+    for (size_t i = 0; i < it.value().size(); ++i) {
+      ASSERT_FLOAT_EQ(it.value().data()[i], it.key());
+    }
+  }
+}
+
+TEST(SparseTableShard, DirtyTracking) {
+  typedef SparseTableShard<uint64_t, FixedFeatureValue> shard_type;
+  shard_type shard;
+  shard.set_track_erased(true);
+  for (uint64_t key = 0; key < 100; ++key) {
+    shard[key].resize(4);
+  }
+  uint32_t saved = shard.advance_epoch();
+  std::vector<uint64_t> erased;
+  shard.take_erased_keys(&erased);
+  ASSERT_TRUE(erased.empty());
+
+  shard.touch(&shard[3]);
+  shard[200].resize(4);
+  shard.erase(5);
+  shard.erase(7);
+  shard[7].resize(4);
+  std::vector<uint64_t> dirty;
+  for (auto it = shard.begin(); it != shard.end(); ++it) {
+    if (it.value().epoch() > saved) {
+      dirty.push_back(it.key());
+    }
+  }
+  std::sort(dirty.begin(), dirty.end());
+  ASSERT_EQ(dirty, std::vector<uint64_t>({3, 7, 200}));
+  shard.take_erased_keys(&erased);
+  ASSERT_EQ(erased, std::vector<uint64_t>({5, 7}));
+
+  saved = shard.advance_epoch();
+  for (auto it = shard.begin(); it != shard.end(); ++it) {
+    ASSERT_LE(it.value().epoch(), saved);
+  }
+  shard.take_erased_keys(&erased);
+  ASSERT_TRUE(erased.empty());
+}
+
+TEST(SparseTableShard, ErasedKeysOverflow) {
+  typedef SparseTableShard<uint64_t, FixedFeatureValue> shard_type;
+  shard_type shard;
+  shard.set_track_erased(true);
+  // churn on a small shard, the record must not grow past its bound
+  for (uint64_t key = 0; key < 100000; ++key) {
+    shard[key].resize(4);
+    shard.erase(key);
+  }
+  ASSERT_TRUE(shard.erased_overflow());
+  std::vector<uint64_t> erased;
+  shard.take_erased_keys(&erased);
+  ASSERT_TRUE(erased.empty());
+  ASSERT_FALSE(shard.erased_overflow());
+
+  shard[1].resize(4);
+  shard.erase(1);
+  shard.take_erased_keys(&erased);
+  ASSERT_EQ(erased, std::vector<uint64_t>({1}));
+}
+
 }  // namespace paddle::distributed
@@ -0,0 +1,94 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/table/depends/frequency_sketch.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle::distributed {
+
+TEST(FrequencySketch, Estimate) {
+  FrequencySketch sketch(1024);
+  ASSERT_EQ(sketch.Estimate(7), 0u);
+  for (int i = 0; i < 5; ++i) {
+    sketch.Increment(7);
+  }
+  ASSERT_EQ(sketch.Estimate(7), 5u);
+  for (int i = 0; i < 100; ++i) {
+    sketch.Increment(8);
+  }
+  ASSERT_EQ(sketch.Estimate(8), FrequencySketch::kMaxCount);
+
+  // keys seen once stay cold next to hot keys
+  for (uint64_t key = 1000; key < 1500; ++key) {
+    sketch.Increment(key);
+  }
+  size_t cold = 0;
+  for (uint64_t key = 1000; key < 1500; ++key) {
+    if (sketch.Estimate(key) <= 2) {
+      ++cold;
+    }
+  }
+  ASSERT_GT(cold, 450u);
+  ASSERT_GE(sketch.Estimate(7), 5u);
+}
+
+TEST(FrequencySketch, Aging) {
+  FrequencySketch sketch(64);
+  for (int i = 0; i < 8; ++i) {
+    sketch.Increment(1);
+  }
+  ASSERT_EQ(sketch.Estimate(1), 8u);
+  sketch.Reset();
+  ASSERT_EQ(sketch.Estimate(1), 4u);
+
+  // the sketch ages itself, so counters do not all stay saturated
+  FrequencySketch busy(64);
+  for (uint64_t key = 0; key < 100 * busy.sample_size(); ++key) {
+    busy.Increment(key % 4096);
+  }
+  size_t saturated = 0;
+  for (uint64_t key = 0; key < 4096; ++key) {
+    if (busy.Estimate(key) == FrequencySketch::kMaxCount) {
+      ++saturated;
+    }
+  }
+  ASSERT_LT(saturated, 4096u);
+}
+
+// pull tasks and PullSparsePtr of SSDSparseTable share the sketch of a shard
+TEST(FrequencySketch, ConcurrentIncrement) {
+  FrequencySketch sketch(1024);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&sketch] {
+      for (int j = 0; j < 3; ++j) {
+        sketch.Increment(1);
+      }
+      for (uint64_t key = 100; key < 200; ++key) {
+        sketch.Increment(key);
+        sketch.Estimate(key);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(sketch.Estimate(1), 12u);
+}
+
+}  // namespace paddle::distributed
@@ -17,6 +17,7 @@ limitations under the License. */
 #include <ThreadPool.h>
 #include <unistd.h>
 
+#include <filesystem>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -151,4 +152,203 @@ TEST(MemorySparseTable, SGD) {
   }
 }
 
+TEST(MemorySparseTable, BinaryCheckpoint) {
+  int emb_dim = 8;
+  auto make_table = [&]() {
+    TableParameter table_config;
+    table_config.set_table_class("MemorySparseTable");
+    table_config.set_shard_num(10);
+    table_config.set_binary_checkpoint(true);
+    TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+    accessor_config->set_accessor_class("CtrCommonAccessor");
+    accessor_config->set_fea_dim(11);
+    accessor_config->set_embedx_dim(emb_dim);
+    accessor_config->set_embedx_threshold(0);
+    for (auto *sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                            accessor_config->mutable_embedx_sgd_param()}) {
+      sgd_param->set_name("SparseNaiveSGDRule");
+      auto *naive_param = sgd_param->mutable_naive();
+      naive_param->set_learning_rate(0.1);
+      naive_param->set_initial_range(0.3);
+      naive_param->add_weight_bounds(-10.0);
+      naive_param->add_weight_bounds(10.0);
+    }
+    FsClientParameter fs_config;
+    Table *table = new MemorySparseTable();
+    table->SetShard(0, 1);
+    EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+    return std::unique_ptr<Table>(table);
+  };
+  auto pull = [&](Table *table, const std::vector<uint64_t> &keys) {
+    std::vector<uint32_t> fres(keys.size(), 1);
+    std::vector<float> values(keys.size() * (emb_dim + 3));
+    TableContext table_context;
+    table_context.value_type = Sparse;
+    table_context.pull_context.pull_value =
+        PullSparseValue(keys, fres, emb_dim);
+    table_context.pull_context.values = values.data();
+    table->Pull(table_context);
+    return values;
+  };
+
+  std::vector<uint64_t> keys;
+  for (uint64_t key = 0; key < 100; ++key) {
+    keys.push_back(key * 7);
+  }
+  auto table = make_table();
+  pull(table.get(), keys);
+  // push once so the embedx part is created
+  std::vector<float> grads;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    grads.push_back(0);  // slot
+    grads.push_back(1);  // show
+    grads.push_back(1);  // click
+    for (int j = 0; j < emb_dim + 1; ++j) {
+      grads.push_back(0.01 * (i + j));
+    }
+  }
+  TableContext push_context;
+  push_context.value_type = Sparse;
+  push_context.push_context.keys = keys.data();
+  push_context.push_context.values = grads.data();
+  push_context.num = keys.size();
+  table->Push(push_context);
+
+  std::string dirname =
+      (std::filesystem::temp_directory_path() / "binary_checkpoint_test")
+          .string();
+  std::filesystem::remove_all(dirname);
+  ASSERT_EQ(table->Save(dirname, "0"), 0);
+  auto expected = pull(table.get(), keys);
+
+  auto loaded = make_table();
+  ASSERT_EQ(loaded->Load(dirname, "0"), 0);
+  auto values = pull(loaded.get(), keys);
+  ASSERT_EQ(values.size(), expected.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_FLOAT_EQ(values[i], expected[i]);
+  }
+  std::filesystem::remove_all(dirname);
+}
+
+TEST(MemorySparseTable, DeltaCheckpoint) {
+  int emb_dim = 8;
+  auto make_table = [&]() {
+    TableParameter table_config;
+    table_config.set_table_class("MemorySparseTable");
+    table_config.set_shard_num(10);
+    table_config.set_binary_checkpoint(true);
+    table_config.set_enable_delta_save(true);
+    TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+    accessor_config->set_accessor_class("CtrCommonAccessor");
+    accessor_config->set_fea_dim(11);
+    accessor_config->set_embedx_dim(emb_dim);
+    accessor_config->set_embedx_threshold(0);
+    for (auto *sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                            accessor_config->mutable_embedx_sgd_param()}) {
+      sgd_param->set_name("SparseNaiveSGDRule");
+      auto *naive_param = sgd_param->mutable_naive();
+      naive_param->set_learning_rate(0.1);
+      naive_param->set_initial_range(0.3);
+      naive_param->add_weight_bounds(-10.0);
+      naive_param->add_weight_bounds(10.0);
+    }
+    FsClientParameter fs_config;
+    Table *table = new MemorySparseTable();
+    table->SetShard(0, 1);
+    EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+    return std::unique_ptr<Table>(table);
+  };
+  auto pull = [&](Table *table, const std::vector<uint64_t> &keys) {
+    std::vector<uint32_t> fres(keys.size(), 1);
+    std::vector<float> values(keys.size() * (emb_dim + 3));
+    TableContext table_context;
+    table_context.value_type = Sparse;
+    table_context.pull_context.pull_value =
+        PullSparseValue(keys, fres, emb_dim);
+    table_context.pull_context.values = values.data();
+    table->Pull(table_context);
+    return values;
+  };
+  auto push = [&](Table *table,
+                  const std::vector<uint64_t> &keys,
+                  float scale,
+                  float click) {
+    std::vector<float> grads;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      grads.push_back(0);  // slot
+      grads.push_back(1);  // show
+      grads.push_back(click);
+      for (int j = 0; j < emb_dim + 1; ++j) {
+        grads.push_back(scale * (i + j));
+      }
+    }
+    TableContext table_context;
+    table_context.value_type = Sparse;
+    table_context.push_context.keys = keys.data();
+    table_context.push_context.values = grads.data();
+    table_context.num = keys.size();
+    table->Push(table_context);
+  };
+  auto expect_same = [](const std::vector<float> &values,
+                        const std::vector<float> &expected) {
+    ASSERT_EQ(values.size(), expected.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      ASSERT_FLOAT_EQ(values[i], expected[i]);
+    }
+  };
+
+  std::vector<uint64_t> keys;
+  for (uint64_t key = 0; key < 200; ++key) {
+    keys.push_back(key * 3);
+  }
+  std::vector<uint64_t> pushed_keys(keys.begin(), keys.begin() + 150);
+  // never clicked, erased by shrink
+  std::vector<uint64_t> cold_keys(keys.begin() + 150, keys.end());
+  std::vector<uint64_t> changed_keys(keys.begin(), keys.begin() + 20);
+  std::vector<uint64_t> new_keys = {1000001, 1000002, 1000003};
+
+  auto table = make_table();
+  auto *memory_table = dynamic_cast<MemorySparseTable *>(table.get());
+  pull(table.get(), keys);
+  push(table.get(), pushed_keys, 0.01, 1);
+  push(table.get(), cold_keys, 0.01, 0);
+  std::string dirname =
+      (std::filesystem::temp_directory_path() / "delta_checkpoint_test")
+          .string();
+  std::filesystem::remove_all(dirname);
+  ASSERT_EQ(table->Save(dirname, "0"), 0);
+
+  // delta 1: a few changed and new keys
+  push(table.get(), changed_keys, 0.02, 1);
+  push(table.get(), new_keys, 0.03, 1);
+  ASSERT_EQ(table->Save(dirname, "6"), 0);
+  // delta 2: the cold keys are shrunk away
+  ASSERT_EQ(table->Shrink(""), 0);
+  ASSERT_EQ(memory_table->LocalSize(),
+            static_cast<int64_t>(pushed_keys.size() + new_keys.size()));
+  push(table.get(), changed_keys, 0.04, 1);
+  push(table.get(), {cold_keys[0]}, 0.04, 1);
+  ASSERT_EQ(table->Save(dirname, "6"), 0);
+
+  std::vector<uint64_t> all_keys(keys);
+  all_keys.insert(all_keys.end(), new_keys.begin(), new_keys.end());
+  auto expected = pull(table.get(), all_keys);
+
+  auto loaded = make_table();
+  ASSERT_EQ(loaded->Load(dirname, "0"), 0);
+  EXPECT_EQ(dynamic_cast<MemorySparseTable *>(loaded.get())->LocalSize(),
+            memory_table->LocalSize());
+  expect_same(pull(loaded.get(), all_keys), expected);
+
+  // the loaded table keeps appending deltas to the same base
+  push(loaded.get(), changed_keys, 0.05, 1);
+  ASSERT_EQ(loaded->Save(dirname, "6"), 0);
+  expected = pull(loaded.get(), all_keys);
+  auto reloaded = make_table();
+  ASSERT_EQ(reloaded->Load(dirname, "0"), 0);
+  expect_same(pull(reloaded.get(), all_keys), expected);
+  std::filesystem::remove_all(dirname);
+}
+
 }  // namespace paddle::distributed
@@ -16,8 +16,11 @@ limitations under the License. */
 
 #include <cmath>
 #include <iostream>
+#include <random>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel.h"
 #include "paddle/fluid/distributed/the_one_ps.pb.h"
 
 namespace paddle::distributed {
@@ -204,4 +207,97 @@ TEST(downpour_sparse_adam_test, test_init_and_update) {
     ASSERT_FLOAT_EQ(value[i], label[i]) << "i is " << i;
   }
 }
+
+// Runs the same pushes through the simd kernels and the scalar loops of a
+// rule at a high embedding dim and checks they agree.
+template <class Rule>
+void CompareSimdWithScalar(const SparseCommonSGDRuleParameter& param) {
+  const SparseSgdKernels* kernels = GetSparseSgdKernels();
+  if (kernels == nullptr) {
+    LOG(INFO) << "no simd kernels for " << param.name() << ", skip";
+    return;
+  }
+  const size_t embed_dim = 64;
+  const size_t key_num = 256;
+  const int round_num = 50;
+  Rule simd_rule;
+  Rule scalar_rule;
+  simd_rule.LoadConfig(param, embed_dim);
+  scalar_rule.LoadConfig(param, embed_dim);
+  simd_rule.SetSimdKernels(kernels);
+  scalar_rule.SetSimdKernels(nullptr);
+  const size_t value_dim = embed_dim + simd_rule.Dim();
+
+  std::mt19937 rng(2024);
+  std::uniform_real_distribution<float> dist(-1.0, 1.0);
+  std::vector<float> simd_values(key_num * value_dim);
+  std::vector<float> grads(key_num * embed_dim);
+  for (size_t k = 0; k < key_num; ++k) {
+    simd_rule.InitValue(&simd_values[k * value_dim],
+                        &simd_values[k * value_dim + embed_dim],
+                        false);
+  }
+  std::vector<float> scalar_values = simd_values;
+
+  std::vector<float*> simd_w(key_num), simd_sgd(key_num);
+  std::vector<float*> scalar_w(key_num), scalar_sgd(key_num);
+  std::vector<const float*> push_values(key_num);
+  std::vector<float> scales(key_num, 2.0);
+  for (size_t k = 0; k < key_num; ++k) {
+    simd_w[k] = &simd_values[k * value_dim];
+    simd_sgd[k] = simd_w[k] + embed_dim;
+    scalar_w[k] = &scalar_values[k * value_dim];
+    scalar_sgd[k] = scalar_w[k] + embed_dim;
+    push_values[k] = &grads[k * embed_dim];
+  }
+
+  for (int round = 0; round < round_num; ++round) {
+    for (auto& g : grads) {
+      g = dist(rng);
+    }
+    simd_rule.UpdateValueBatch(simd_w.data(),
+                               simd_sgd.data(),
+                               push_values.data(),
+                               scales.data(),
+                               key_num);
+    scalar_rule.UpdateValueBatch(scalar_w.data(),
+                                 scalar_sgd.data(),
+                                 push_values.data(),
+                                 scales.data(),
+                                 key_num);
+  }
+  for (size_t i = 0; i < simd_values.size(); ++i) {
+    ASSERT_NEAR(simd_values[i],
+                scalar_values[i],
+                1e-4 * std::max(1.0f, std::fabs(scalar_values[i])))
+        << param.name() << " differs at " << i;
+  }
+}
+
+TEST(sparse_sgd_simd_test, compare_with_scalar) {
+  SparseCommonSGDRuleParameter adagrad;
+  adagrad.set_name("adagrad");
+  auto* adagrad_param = adagrad.mutable_adagrad();
+  adagrad_param->set_learning_rate(0.1);
+  adagrad_param->set_initial_g2sum(3.0);
+  adagrad_param->set_initial_range(0.3);
+  adagrad_param->add_weight_bounds(-0.5);
+  adagrad_param->add_weight_bounds(0.5);
+  CompareSimdWithScalar<SparseAdaGradSGDRule>(adagrad);
+  CompareSimdWithScalar<StdAdaGradSGDRule>(adagrad);
+  CompareSimdWithScalar<SparseAdaGradV2SGDRule>(adagrad);
+
+  SparseCommonSGDRuleParameter adam;
+  adam.set_name("adam");
+  auto* adam_param = adam.mutable_adam();
+  adam_param->set_learning_rate(0.1);
+  adam_param->set_initial_range(0.3);
+  adam_param->set_beta1_decay_rate(0.9);
+  adam_param->set_beta2_decay_rate(0.999);
+  adam_param->set_ada_epsilon(1e-08);
+  adam_param->add_weight_bounds(-0.5);
+  adam_param->add_weight_bounds(0.5);
+  CompareSimdWithScalar<SparseAdamSGDRule>(adam);
+  CompareSimdWithScalar<SparseSharedAdamSGDRule>(adam);
+}
 }  // namespace paddle::distributed
@@ -0,0 +1,146 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/ssd_sparse_table.h"
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <filesystem>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/common/flags.h"
+#include "paddle/fluid/distributed/ps/table/table.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+PD_DECLARE_int64(pserver_ssd_mem_capacity);
+PD_DECLARE_int32(pserver_ssd_tier_interval_ms);
+PD_DECLARE_string(rocksdb_path);
+
+namespace paddle::distributed {
+
+const int kEmbDim = 8;
+const int kShardNum = 10;
+
+std::unique_ptr<SSDSparseTable> MakeSSDTable() {
+  TableParameter table_config;
+  table_config.set_table_class("SSDSparseTable");
+  table_config.set_shard_num(kShardNum);
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(11);
+  accessor_config->set_embedx_dim(kEmbDim);
+  accessor_config->set_embedx_threshold(0);
+  for (auto *sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseNaiveSGDRule");
+    auto *naive_param = sgd_param->mutable_naive();
+    naive_param->set_learning_rate(0.1);
+    naive_param->set_initial_range(0.3);
+    naive_param->add_weight_bounds(-10.0);
+    naive_param->add_weight_bounds(10.0);
+  }
+  FsClientParameter fs_config;
+  auto *table = new SSDSparseTable();
+  Table *base = table;  // SSDSparseTable::Initialize() hides the config one
+  base->SetShard(0, 1);
+  EXPECT_EQ(base->Initialize(table_config, fs_config), 0);
+  return std::unique_ptr<SSDSparseTable>(table);
+}
+
+// A pass pulls value pointers of shard 0 and keeps them while other keys
+// are pulled and the tier thread demotes shards over their capacity. The
+// pointers must stay valid and unchanged until the pass ends.
+TEST(SSDSparseTable, PullPtrWhileDemoting) {
+  FLAGS_pserver_ssd_mem_capacity = 64;
+  FLAGS_pserver_ssd_tier_interval_ms = 1;
+  std::filesystem::path db_path =
+      std::filesystem::temp_directory_path() / "ssd_sparse_table_test_db";
+  std::filesystem::remove_all(db_path);
+  FLAGS_rocksdb_path = db_path.string();
+  auto table = MakeSSDTable();
+
+  std::vector<uint64_t> ptr_keys;
+  for (uint64_t i = 1; i <= 256; ++i) {
+    ptr_keys.push_back(i * kShardNum);  // all of them in shard 0
+  }
+  std::vector<char *> ptr_values(ptr_keys.size());
+  TableContext ptr_context;
+  ptr_context.value_type = Sparse;
+  ptr_context.use_ptr = true;
+  ptr_context.shard_id = 0;
+  ptr_context.pass_id = 1;
+  ptr_context.pull_context.keys = ptr_keys.data();
+  ptr_context.pull_context.ptr_values = ptr_values.data();
+  ptr_context.num = ptr_keys.size();
+  ASSERT_EQ(table->Pull(ptr_context), 0);
+  std::vector<std::vector<float>> snapshot;
+  for (auto *ptr : ptr_values) {
+    auto *value = reinterpret_cast<FixedFeatureValue *>(ptr);
+    snapshot.emplace_back(value->data(), value->data() + value->size());
+  }
+
+  // keys of the other shards, far more than their capacity
+  std::atomic<bool> stop{false};
+  std::thread puller([&] {
+    uint64_t next = 1;
+    std::vector<float> values(512 * (kEmbDim + 3));
+    while (!stop) {
+      std::vector<uint64_t> keys;
+      while (keys.size() < 512) {
+        if (next % kShardNum != 0) {
+          keys.push_back(next);
+        }
+        ++next;
+      }
+      std::vector<uint32_t> fres(keys.size(), 1);
+      TableContext context;
+      context.value_type = Sparse;
+      context.pull_context.pull_value = PullSparseValue(keys, fres, kEmbDim);
+      context.pull_context.values = values.data();
+      table->Pull(context);
+    }
+  });
+
+  for (int round = 0; round < 20; ++round) {
+    // pulling the pass keys again runs concurrently with the demotion too
+    ASSERT_EQ(table->Pull(ptr_context), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    for (size_t i = 0; i < ptr_values.size(); ++i) {
+      auto *value = reinterpret_cast<FixedFeatureValue *>(ptr_values[i]);
+      ASSERT_EQ(value->size(), snapshot[i].size());
+      for (size_t j = 0; j < snapshot[i].size(); ++j) {
+        ASSERT_EQ(value->data()[j], snapshot[i][j]) << "key " << ptr_keys[i];
+      }
+    }
+  }
+  stop = true;
+  puller.join();
+
+  // the other shards were still demoted, shard 0 kept its pass keys
+  bool demoted = false;
+  for (int wait = 0; wait < 200 && !demoted; ++wait) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    demoted = table->LocalSize() <=
+              static_cast<int64_t>((kShardNum - 1) * 64 + ptr_keys.size());
+  }
+  EXPECT_TRUE(demoted) << "mem size " << table->LocalSize();
+  EXPECT_GE(table->LocalSize(), static_cast<int64_t>(ptr_keys.size()));
+  table.reset();
+  std::filesystem::remove_all(db_path);
+}
+
+}  // namespace paddle::distributed
@@ -22,11 +22,13 @@
 #include <glog/logging.h>
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <deque>
 #include <limits>
 #include <memory>
-#include <mutex>  // NOLINT
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -36,6 +38,322 @@
 namespace paddle {
 namespace framework {
 
+// Unbounded multi-producer multi-consumer queue behind a lock-free
+// ChannelObject. Items live in a linked list of fixed size segments. A
+// writer reserves a range of the tail segment and a reader a range of the
+// head segment with one CAS each, and both move their items outside of any
+// lock, so threads moving blocks do not serialize on each other. Only
+// waiting on an empty (or, with a capacity, full) channel takes the mutex.
+// Drained segments are freed by epoch based reclamation.
+template <class T>
+class LockFreeChannelQueue {
+ public:
+  LockFreeChannelQueue(const std::atomic<bool>* closed,
+                       const std::atomic<size_t>* capacity)
+      : closed_(closed), capacity_(capacity) {
+    head_ = tail_ = new Segment();
+  }
+  ~LockFreeChannelQueue() { FreeAll(); }
+
+  size_t Size() {
+    int64_t size = size_.load();
+    return size > 0 ? size : 0;
+  }
+
+  // returns less than n if the channel is closed
+  size_t Write(size_t n, const T* p) {
+    return Push(n, [p](T* item, size_t i) { *item = p[i]; });
+  }
+  size_t WriteMove(size_t n, T* p) {
+    return Push(n, [p](T* item, size_t i) { *item = std::move(p[i]); });
+  }
+
+  // returns less than n only if the channel is closed and empty, or once is
+  // set and some items were read
+  size_t Read(size_t n, T* p, bool once) {
+    size_t finished = 0;
+    while (finished < n) {
+      size_t m = 0;
+      {
+        EpochGuard guard(this);
+        m = TryRead(n - finished, p + finished);
+      }
+      if (m > 0) {
+        finished += m;
+        WakeWriters();
+        if (once) {
+          break;
+        }
+        continue;
+      }
+      if (size_.load() > 0) {
+        // items are reserved by other threads and not yet through
+        std::this_thread::yield();
+        continue;
+      }
+      // waits outside of the epoch, so a blocked reader does not hold back
+      // the reclamation
+      if (!WaitForRead()) {
+        break;
+      }
+    }
+    return finished;
+  }
+
+  // wakes all waiters after the channel is opened, closed or resized
+  void Notify() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    empty_cond_.notify_all();
+    full_cond_.notify_all();
+  }
+
+  // not safe against concurrent reads and writes
+  void Clear() {
+    FreeAll();
+    head_ = tail_ = new Segment();
+    size_ = 0;
+  }
+
+  // moves all items to data in order, not safe against concurrent reads and
+  // writes
+  void MoveTo(std::deque<T>* data) {
+    for (Segment* seg = head_.load(); seg != nullptr; seg = seg->next.load()) {
+      size_t end = (std::min)(seg->write_pos.load(), kSegmentSize);
+      for (size_t i = seg->read_pos.load(); i < end; ++i) {
+        data->push_back(std::move(seg->items[i]));
+      }
+    }
+    Clear();
+  }
+
+ private:
+  static constexpr size_t kSegmentSize = 1024;
+
+  struct Segment {
+    Segment()
+        : items(new T[kSegmentSize]),
+          ready(new std::atomic<bool>[kSegmentSize]) {
+      for (size_t i = 0; i < kSegmentSize; ++i) {
+        ready[i].store(false, std::memory_order_relaxed);
+      }
+    }
+    std::unique_ptr<T[]> items;
+    std::unique_ptr<std::atomic<bool>[]> ready;
+    std::atomic<size_t> write_pos{0};
+    std::atomic<size_t> read_pos{0};
+    std::atomic<Segment*> next{nullptr};
+    uint64_t retire_epoch = 0;
+  };
+
+  // Registers a step of an operation in the current epoch. The epoch only
+  // advances from e to e + 1 once no step of epoch e - 1 is left, so when a
+  // segment retired in epoch e is seen in epoch e + 2, every step that could
+  // have loaded it before it was unlinked is over.
+  struct EpochGuard {
+    explicit EpochGuard(LockFreeChannelQueue* queue) : queue(queue) {
+      while (true) {
+        epoch = queue->epoch_.load();
+        queue->active_[epoch & 1].fetch_add(1);
+        if (queue->epoch_.load() == epoch) {
+          break;
+        }
+        queue->active_[epoch & 1].fetch_sub(1);
+      }
+    }
+    ~EpochGuard() {
+      queue->active_[epoch & 1].fetch_sub(1);
+      queue->ReclaimRetired();
+    }
+    LockFreeChannelQueue* queue;
+    uint64_t epoch;
+  };
+
+  // reads up to n items available now, 0 if there is none
+  size_t TryRead(size_t n, T* p) {
+    while (true) {
+      Segment* seg = head_.load();
+      size_t pos = seg->read_pos.load();
+      size_t avail = (std::min)(seg->write_pos.load(), kSegmentSize);
+      if (pos < avail) {
+        size_t m = (std::min)(n, avail - pos);
+        if (!seg->read_pos.compare_exchange_weak(pos, pos + m)) {
+          continue;
+        }
+        for (size_t i = 0; i < m; ++i) {
+          // the writer of a reserved item may still be moving it in
+          while (!seg->ready[pos + i].load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+          }
+          p[i] = std::move(seg->items[pos + i]);
+        }
+        size_.fetch_sub(m);
+        return m;
+      }
+      Segment* next = seg->next.load();
+      if (pos < kSegmentSize || next == nullptr) {
+        return 0;
+      }
+      Segment* tail = seg;
+      tail_.compare_exchange_strong(tail, next);
+      if (head_.compare_exchange_strong(seg, next)) {
+        Retire(seg);
+      }
+    }
+  }
+
+  template <class Func>
+  size_t Push(size_t n, Func move_in) {
+    size_t finished = 0;
+    // waits for room outside of the epoch
+    while (finished < n && WaitForWrite()) {
+      EpochGuard guard(this);
+      Segment* seg = tail_.load();
+      size_t pos = seg->write_pos.load();
+      if (pos >= kSegmentSize) {
+        AdvanceTail(seg);
+        continue;
+      }
+      size_t m = (std::min)(n - finished, kSegmentSize - pos);
+      int64_t room = Capacity() - size_.load();
+      if (room > 0 && static_cast<size_t>(room) < m) {
+        m = room;
+      }
+      if (!seg->write_pos.compare_exchange_weak(pos, pos + m)) {
+        continue;
+      }
+      size_.fetch_add(m);
+      for (size_t i = 0; i < m; ++i) {
+        move_in(&seg->items[pos + i], finished + i);
+        seg->ready[pos + i].store(true, std::memory_order_release);
+      }
+      finished += m;
+      WakeReaders();
+    }
+    return finished;
+  }
+
+  void AdvanceTail(Segment* seg) {
+    Segment* next = seg->next.load();
+    if (next == nullptr) {
+      Segment* fresh = new Segment();
+      if (seg->next.compare_exchange_strong(next, fresh)) {
+        next = fresh;
+      } else {
+        delete fresh;
+      }
+    }
+    tail_.compare_exchange_strong(seg, next);
+  }
+
+  // zero capacity channels hand over one item at a time
+  int64_t Capacity() {
+    return (std::max)(static_cast<int64_t>(capacity_->load()), int64_t(1));
+  }
+
+  bool WaitForRead() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++empty_waiters_;
+    while (size_.load() <= 0 && !closed_->load()) {
+      empty_cond_.wait(lock);
+    }
+    --empty_waiters_;
+    return size_.load() > 0;
+  }
+
+  bool WaitForWrite() {
+    if (size_.load() < Capacity() || closed_->load()) {
+      return !closed_->load();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++full_waiters_;
+    while (size_.load() >= Capacity() && !closed_->load()) {
+      full_cond_.wait(lock);
+    }
+    --full_waiters_;
+    return !closed_->load();
+  }
+
+  void WakeReaders() {
+    if (empty_waiters_.load() != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      empty_cond_.notify_all();
+    }
+  }
+
+  void WakeWriters() {
+    if (full_waiters_.load() != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      full_cond_.notify_all();
+    }
+  }
+
+  // called after seg is unlinked from head_ and tail_
+  void Retire(Segment* seg) {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    seg->retire_epoch = epoch_.load();
+    retired_.push_back(seg);
+    has_retired_ = true;
+  }
+
+  // advances the epoch when the steps of the previous one are over and
+  // frees the segments retired two epochs ago
+  void ReclaimRetired() {
+    if (!has_retired_.load() || !retired_mutex_.try_lock()) {
+      return;
+    }
+    uint64_t epoch = epoch_.load();
+    if (active_[(epoch + 1) & 1].load() == 0 &&
+        epoch_.compare_exchange_strong(epoch, epoch + 1)) {
+      ++epoch;
+    }
+    size_t kept = 0;
+    for (auto* seg : retired_) {
+      if (seg->retire_epoch + 2 <= epoch) {
+        delete seg;
+      } else {
+        retired_[kept++] = seg;
+      }
+    }
+    retired_.resize(kept);
+    has_retired_ = kept != 0;
+    retired_mutex_.unlock();
+  }
+
+  void FreeAll() {
+    Segment* seg = head_.load();
+    while (seg != nullptr) {
+      Segment* next = seg->next.load();
+      delete seg;
+      seg = next;
+    }
+    for (auto* retired : retired_) {
+      delete retired;
+    }
+    retired_.clear();
+    has_retired_ = false;
+  }
+
+  const std::atomic<bool>* closed_;
+  const std::atomic<size_t>* capacity_;
+  std::atomic<Segment*> head_{nullptr};
+  std::atomic<Segment*> tail_{nullptr};
+  // items reserved by writers and not yet taken by readers
+  std::atomic<int64_t> size_{0};
+
+  std::mutex mutex_;
+  std::atomic<int> empty_waiters_{0};
+  std::atomic<int> full_waiters_{0};
+  std::condition_variable empty_cond_;
+  std::condition_variable full_cond_;
+
+  // steps in flight, by the parity of the epoch they registered in
+  std::atomic<uint64_t> epoch_{0};
+  std::atomic<int> active_[2] = {{0}, {0}};
+  std::mutex retired_mutex_;
+  std::vector<Segment*> retired_;
+  std::atomic<bool> has_retired_{false};
+};
+
 template <class T>
 class ChannelObject {
  public:
@@ -46,13 +364,33 @@ class ChannelObject {
     capacity_ = (std::min)(MaxCapacity(), capacity);
   }
 
-  const std::deque<T>& GetData() const { return data_; }
+  // A lock-free channel is switched back to the deque, as there is no deque
+  // to expose otherwise. The channel must be idle.
+  const std::deque<T>& GetData() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SetLockFreeUnlocked(false);
+    return data_;
+  }
   void Clear() {
     std::unique_lock<std::mutex> lock(mutex_);
+    if (queue_ != nullptr) {
+      queue_->Clear();
+      return;
+    }
     data_.clear();
     data_.shrink_to_fit();
   }
 
+  // Switches the channel between the mutex guarded deque and a
+  // LockFreeChannelQueue. The channel must be idle, and empty to switch to
+  // the lock-free mode.
+  void SetLockFree(bool lock_free) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SetLockFreeUnlocked(lock_free);
+  }
+
+  bool LockFree() { return queue_ != nullptr; }
+
   size_t Capacity() {
     return capacity_;  // atomic
   }
@@ -83,6 +421,7 @@ class ChannelObject {
     std::lock_guard<std::mutex> lock(mutex_);
     capacity_ = other->Capacity();
     block_size_ = other->BlockSize();
+    SetLockFreeUnlocked(other->LockFree());
   }
 
   bool Closed() {
@@ -104,11 +443,17 @@ class ChannelObject {
   }
 
   size_t Size() {
+    if (queue_ != nullptr) {
+      return queue_->Size();
+    }
     std::lock_guard<std::mutex> lock(mutex_);
     return data_.size();
   }
 
   bool Empty() {
+    if (queue_ != nullptr) {
+      return queue_->Size() == 0;
+    }
     std::lock_guard<std::mutex> lock(mutex_);
     return EmptyUnlocked();
   }
@@ -122,6 +467,9 @@ class ChannelObject {
     if (n == 0) {
       return 0;
     }
+    if (queue_ != nullptr) {
+      return queue_->Read(n, p, false);
+    }
 
     std::unique_lock<std::mutex> lock(mutex_);
     size_t finished = Read(n, p, lock);
@@ -141,6 +489,9 @@ class ChannelObject {
     if (n == 0) {
       return 0;
     }
+    if (queue_ != nullptr) {
+      return queue_->Write(n, p);
+    }
     std::unique_lock<std::mutex> lock(mutex_);
     size_t finished = Write(n, p, lock);
     Notify();
@@ -152,6 +503,9 @@ class ChannelObject {
     if (n == 0) {
       return 0;
     }
+    if (queue_ != nullptr) {
+      return queue_->WriteMove(n, p);
+    }
     std::unique_lock<std::mutex> lock(mutex_);
     size_t finished = WriteMove(n, p, lock);
     Notify();
@@ -170,6 +524,12 @@ class ChannelObject {
     if (size == 0) {
       return 0;
     }
+    if (queue_ != nullptr) {
+      p.resize(size);
+      size_t finished = queue_->Read(size, &p[0], true);
+      p.resize(finished);
+      return finished;
+    }
     std::unique_lock<std::mutex> lock(mutex_);
     p.resize(size);
     size_t finished = Read(size, &p[0], lock, true);
@@ -200,10 +560,12 @@ class ChannelObject {
   size_t Write(std::vector<T>&& p) { return WriteMove(p.size(), &p[0]); }
 
  private:
-  size_t capacity_ = MaxCapacity();
+  std::atomic<size_t> capacity_{MaxCapacity()};
   size_t block_size_ = 1024;
-  bool closed_ = false;
+  std::atomic<bool> closed_{false};
   std::mutex mutex_;
+  // set in lock-free mode, which then bypasses data_ and the members below
+  std::unique_ptr<LockFreeChannelQueue<T>> queue_;
   // use deque to store data
   std::deque<T> data_;
   size_t reading_count_ = 0;
@@ -216,7 +578,28 @@ class ChannelObject {
     return (std::numeric_limits<size_t>::max)() / 2;
   }
 
+  void SetLockFreeUnlocked(bool lock_free) {
+    if (lock_free == (queue_ != nullptr)) {
+      return;
+    }
+    if (!lock_free) {
+      queue_->MoveTo(&data_);
+      queue_.reset();
+      return;
+    }
+    PADDLE_ENFORCE_EQ(EmptyUnlocked(),
+                      true,
+                      common::errors::PreconditionNotMet(
+                          "The channel must be empty to switch to the "
+                          "lock-free mode."));
+    queue_ = std::make_unique<LockFreeChannelQueue<T>>(&closed_, &capacity_);
+  }
+
   void Notify() {
+    if (queue_ != nullptr) {
+      queue_->Notify();
+      return;
+    }
     if (empty_waiters_ != 0 && (!EmptyUnlocked() || closed_)) {
       empty_cond_.notify_one();
     }
@@ -21,6 +21,7 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/fleet/ps_gpu_wrapper.h"
 #ifdef _LINUX
+#include <fcntl.h>
 #include <stdio_ext.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -32,6 +33,7 @@ limitations under the License. */
 
 USE_INT_STAT(STAT_total_feasign_num_in_mem);
 COMMON_DECLARE_bool(enable_ins_parser_file);
+COMMON_DECLARE_bool(enable_slotrecord_columnar_input);
 namespace paddle::framework {
 
 DLManager& global_dlmanager_pool() {
@@ -2213,6 +2215,8 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemory() {
   VLOG(3) << "SlotRecord LoadIntoMemory() begin, thread_id=" << thread_id_;
   if (!so_parser_name_.empty()) {
     LoadIntoMemoryByLib();
+  } else if (FLAGS_enable_slotrecord_columnar_input) {
+    LoadIntoMemoryByColumnar();
   } else {
     LoadIntoMemoryByCommand();
   }
@@ -2500,16 +2504,13 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
   SlotRecord& rec = (*ins);
   // parse line
   const char* str = line.c_str();
+  const char* str_end = str + line.size();
   char* endptr = const_cast<char*>(str);
   int pos = 0;
 
-  thread_local std::vector<std::vector<float>> slot_float_feasigns;
-  thread_local std::vector<std::vector<uint64_t>> slot_uint64_feasigns;
-  slot_float_feasigns.resize(float_use_slot_size_);
-  slot_uint64_feasigns.resize(uint64_use_slot_size_);
-
   if (parse_ins_id_) {
-    int num = static_cast<int>(strtol(&str[pos], &endptr, 10));
+    int num =
+        static_cast<int>(parse_uint64_feasign(&str[pos], str_end, &endptr));
     PADDLE_ENFORCE_EQ(num == 1,
                       true,
                       common::errors::InvalidArgument(
@@ -2523,7 +2524,8 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
     pos += static_cast<int>(len + 1);
   }
   if (parse_logkey_) {
-    int num = static_cast<int>(strtol(&str[pos], &endptr, 10));
+    int num =
+        static_cast<int>(parse_uint64_feasign(&str[pos], str_end, &endptr));
     PADDLE_ENFORCE_EQ(num == 1,
                       true,
                       common::errors::InvalidArgument(
@@ -2547,11 +2549,20 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
     pos += static_cast<int>(len + 1);
   }
 
-  int float_total_slot_num = 0;
-  int uint64_total_slot_num = 0;
+  // the used slots of a type come in slot_value_idx order, so feasigns are
+  // appended to the record values directly
+  auto& slot_float_feasigns = rec->slot_float_feasigns_;
+  auto& slot_uint64_feasigns = rec->slot_uint64_feasigns_;
+  slot_float_feasigns.clear(false);
+  slot_uint64_feasigns.clear(false);
+  slot_float_feasigns.slot_offsets.resize(float_use_slot_size_ + 1);
+  slot_uint64_feasigns.slot_offsets.resize(uint64_use_slot_size_ + 1);
+  auto& float_values = slot_float_feasigns.slot_values;
+  auto& uint64_values = slot_uint64_feasigns.slot_values;
 
   for (auto& info : all_slots_info_) {
-    int num = static_cast<int>(strtol(&str[pos], &endptr, 10));
+    int num =
+        static_cast<int>(parse_uint64_feasign(&str[pos], str_end, &endptr));
     PADDLE_ENFORCE(num,
                    "The number of ids can not be zero, you need padding "
                    "it in data generator; or if there is something wrong with "
@@ -2560,24 +2571,24 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
                    str);
     if (info.used_idx != -1) {
       if (info.type[0] == 'f') {  // float
-        auto& slot_fea = slot_float_feasigns[info.slot_value_idx];
-        slot_fea.clear();
+        slot_float_feasigns.slot_offsets[info.slot_value_idx] =
+            static_cast<uint32_t>(float_values.size());
+        bool dense = used_slots_info_[info.used_idx].dense;
         for (int j = 0; j < num; ++j) {
-          float feasign = strtof(endptr, &endptr);
-          if (fabs(feasign) < 1e-6 && !used_slots_info_[info.used_idx].dense) {
+          float feasign = parse_float_feasign(endptr, str_end, &endptr);
+          if (fabs(feasign) < 1e-6 && !dense) {
             continue;
           }
-          slot_fea.push_back(feasign);
-          ++float_total_slot_num;
+          float_values.push_back(feasign);
         }
       } else if (info.type[0] == 'u') {  // uint64
-        auto& slot_fea = slot_uint64_feasigns[info.slot_value_idx];
-        slot_fea.clear();
+        slot_uint64_feasigns.slot_offsets[info.slot_value_idx] =
+            static_cast<uint32_t>(uint64_values.size());
+        size_t offset = uint64_values.size();
+        uint64_values.resize(offset + num);
+        uint64_t* feasigns = uint64_values.data() + offset;
         for (int j = 0; j < num; ++j) {
-          uint64_t feasign =
-              static_cast<uint64_t>(strtoull(endptr, &endptr, 10));
-          slot_fea.push_back(feasign);
-          ++uint64_total_slot_num;
+          feasigns[j] = parse_uint64_feasign(endptr, str_end, &endptr);
         }
       }
       pos = static_cast<int>(endptr - str);
@@ -2590,12 +2601,422 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
       }
     }
   }
-  rec->slot_float_feasigns_.add_slot_feasigns(slot_float_feasigns,
-                                              float_total_slot_num);
-  rec->slot_uint64_feasigns_.add_slot_feasigns(slot_uint64_feasigns,
-                                               uint64_total_slot_num);
+  slot_float_feasigns.slot_offsets[float_use_slot_size_] =
+      static_cast<uint32_t>(float_values.size());
+  slot_uint64_feasigns.slot_offsets[uint64_use_slot_size_] =
+      static_cast<uint32_t>(uint64_values.size());
+
+  return (!uint64_values.empty());
+}
+
+bool SlotRecordInMemoryDataFeed::ParseOneColumnarInstance(
+    const SlotRecordColumnarReader& reader, size_t ins_idx, SlotRecord* ins) {
+  SlotRecord& rec = (*ins);
+  const SlotRecordColumnarHeader& header = reader.header();
+  if (parse_ins_id_ || parse_logkey_) {
+    const uint64_t* ins_id_offsets = reader.ins_id_offsets();
+    rec->ins_id_.assign(reader.ins_ids() + ins_id_offsets[ins_idx],
+                        ins_id_offsets[ins_idx + 1] - ins_id_offsets[ins_idx]);
+    if (parse_logkey_) {
+      parser_log_key(rec->ins_id_, &rec->search_id, &rec->cmatch, &rec->rank);
+    }
+  }
+
+  // the same rules as ParseOneInstance, the values of a used slot are one
+  // range of the file
+  auto& slot_float_feasigns = rec->slot_float_feasigns_;
+  auto& slot_uint64_feasigns = rec->slot_uint64_feasigns_;
+  slot_float_feasigns.clear(false);
+  slot_uint64_feasigns.clear(false);
+  slot_float_feasigns.slot_offsets.resize(float_use_slot_size_ + 1);
+  slot_uint64_feasigns.slot_offsets.resize(uint64_use_slot_size_ + 1);
+  auto& float_values = slot_float_feasigns.slot_values;
+  auto& uint64_values = slot_uint64_feasigns.slot_values;
+  const uint64_t* uint64_offsets =
+      reader.uint64_offsets() + ins_idx * header.uint64_slot_num;
+  const uint64_t* float_offsets =
+      reader.float_offsets() + ins_idx * header.float_slot_num;
+
+  int uint64_slot = 0;
+  int float_slot = 0;
+  for (auto& info : all_slots_info_) {
+    const uint64_t* offsets = nullptr;
+    if (info.type[0] == 'f') {  // float
+      offsets = float_offsets + float_slot++;
+    } else if (info.type[0] == 'u') {  // uint64
+      offsets = uint64_offsets + uint64_slot++;
+    } else {
+      continue;
+    }
+    PADDLE_ENFORCE_NE(offsets[0],
+                      offsets[1],
+                      common::errors::InvalidArgument(
+                          "The number of ids can not be zero, you need "
+                          "padding it in data generator. Slot %s of instance "
+                          "%d is empty.",
+                          info.slot,
+                          ins_idx));
+    if (info.used_idx == -1) {
+      continue;
+    }
+    if (info.type[0] == 'f') {
+      slot_float_feasigns.slot_offsets[info.slot_value_idx] =
+          static_cast<uint32_t>(float_values.size());
+      const float* begin = reader.float_values() + offsets[0];
+      const float* end = reader.float_values() + offsets[1];
+      if (used_slots_info_[info.used_idx].dense) {
+        float_values.insert(float_values.end(), begin, end);
+        continue;
+      }
+      for (const float* feasign = begin; feasign != end; ++feasign) {
+        if (fabs(*feasign) >= 1e-6) {
+          float_values.push_back(*feasign);
+        }
+      }
+    } else {
+      slot_uint64_feasigns.slot_offsets[info.slot_value_idx] =
+          static_cast<uint32_t>(uint64_values.size());
+      uint64_values.insert(uint64_values.end(),
+                           reader.uint64_values() + offsets[0],
+                           reader.uint64_values() + offsets[1]);
+    }
+  }
+  slot_float_feasigns.slot_offsets[float_use_slot_size_] =
+      static_cast<uint32_t>(float_values.size());
+  slot_uint64_feasigns.slot_offsets[uint64_use_slot_size_] =
+      static_cast<uint32_t>(uint64_values.size());
+
+  return (!uint64_values.empty());
+}
+
+void SlotRecordInMemoryDataFeed::LoadIntoMemoryByColumnar() {
+  int uint64_slot_num = 0;
+  int float_slot_num = 0;
+  for (auto& info : all_slots_info_) {
+    if (info.type[0] == 'u') {
+      ++uint64_slot_num;
+    } else if (info.type[0] == 'f') {
+      ++float_slot_num;
+    }
+  }
+  std::default_random_engine random_engine(std::random_device{}());
+  std::uniform_real_distribution<float> uniform_distribution(0.0f, 1.0f);
+  bool sample = std::abs(sample_rate_ - 1.0f) >= 1e-5f;
+  // local files without a converter are mmaped, the rest read through
+  // fs_open_read like the text lines
+  bool has_converter = !pipe_command_.empty() && pipe_command_ != "cat";
+
+  std::string filename;
+  while (this->PickOneFile(&filename)) {
+    VLOG(3) << "PickOneFile, filename=" << filename
+            << ", thread_id=" << thread_id_;
+    platform::Timer timeline;
+    timeline.Start();
+    SlotRecordColumnarReader reader;
+    if (!has_converter && fs_select_internal(filename) == 0) {
+      reader.Open(filename);
+    } else {
+      int err_no = 0;
+      auto fp = fs_open_read(filename, &err_no, pipe_command_, true);
+      PADDLE_ENFORCE_EQ(fp != nullptr,
+                        true,
+                        common::errors::InvalidArgument(
+                            "This fp should not be null, please check!"));
+      reader.Read(fp.get(), filename);
+    }
+    const SlotRecordColumnarHeader& header = reader.header();
+    PADDLE_ENFORCE_EQ(
+        header.uint64_slot_num == static_cast<uint32_t>(uint64_slot_num) &&
+            header.float_slot_num == static_cast<uint32_t>(float_slot_num),
+        true,
+        common::errors::InvalidArgument(
+            "Columnar file %s has %d uint64 and %d float slots, but the data "
+            "feed desc has %d and %d.",
+            filename,
+            header.uint64_slot_num,
+            header.float_slot_num,
+            uint64_slot_num,
+            float_slot_num));
+    PADDLE_ENFORCE_EQ(
+        header.has_ins_id != 0 || !(parse_ins_id_ || parse_logkey_),
+        true,
+        common::errors::InvalidArgument(
+            "Columnar file %s has no ins_id, which parse_ins_id or "
+            "parse_logkey needs.",
+            filename));
+
+    std::vector<SlotRecord> record_vec;
+    SlotRecordPool().get(&record_vec, OBJPOOL_BLOCK_SIZE);
+    int offset = 0;
+    size_t lines = 0;
+    for (uint64_t i = 0; i < header.ins_num; ++i) {
+      if (sample && uniform_distribution(random_engine) >= sample_rate_) {
+        continue;
+      }
+      if (!ParseOneColumnarInstance(reader, i, &record_vec[offset])) {
+        continue;
+      }
+      ++lines;
+      if (++offset >= OBJPOOL_BLOCK_SIZE) {
+        input_channel_->Write(std::move(record_vec));
+        record_vec.clear();
+        SlotRecordPool().get(&record_vec, OBJPOOL_BLOCK_SIZE);
+        offset = 0;
+      }
+    }
+    if (offset > 0) {
+      input_channel_->WriteMove(offset, &record_vec[0]);
+      if (offset < OBJPOOL_BLOCK_SIZE) {
+        SlotRecordPool().put(&record_vec[offset],
+                             (OBJPOOL_BLOCK_SIZE - offset));
+      }
+    } else {
+      SlotRecordPool().put(&record_vec);
+    }
+    record_vec.clear();
+    record_vec.shrink_to_fit();
+    timeline.Pause();
+    VLOG(3) << "LoadIntoMemoryByColumnar() read all instances, file="
+            << filename << ", ins_num=" << header.ins_num
+            << ", loaded=" << lines << ", filesize="
+            << reader.file_size() / 1024.0 / 1024.0
+            << "MB, cost time=" << timeline.ElapsedSec()
+            << " seconds, thread_id=" << thread_id_;
+  }
+}
 
-  return (uint64_total_slot_num > 0);
+static const uint64_t kSlotRecordColumnarMagic = 0x524c4f43444c5350ULL;
+static const uint32_t kSlotRecordColumnarVersion = 1;
+
+// section sizes are padded to 8 bytes
+static size_t columnar_aligned(size_t bytes) {
+  return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+SlotRecordColumnarWriter::SlotRecordColumnarWriter(int uint64_slot_num,
+                                                   int float_slot_num,
+                                                   bool has_ins_id) {
+  header_.magic = kSlotRecordColumnarMagic;
+  header_.version = kSlotRecordColumnarVersion;
+  header_.has_ins_id = has_ins_id ? 1 : 0;
+  header_.uint64_slot_num = uint64_slot_num;
+  header_.float_slot_num = float_slot_num;
+  header_.ins_num = 0;
+  uint64_offsets_.push_back(0);
+  float_offsets_.push_back(0);
+  ins_id_offsets_.push_back(0);
+}
+
+void SlotRecordColumnarWriter::AddInstance(
+    const std::vector<std::vector<uint64_t>>& slot_uint64_feasigns,
+    const std::vector<std::vector<float>>& slot_float_feasigns,
+    const std::string& ins_id) {
+  PADDLE_ENFORCE_EQ(slot_uint64_feasigns.size() == header_.uint64_slot_num &&
+                        slot_float_feasigns.size() == header_.float_slot_num,
+                    true,
+                    common::errors::InvalidArgument(
+                        "An instance needs %d uint64 and %d float slots, but "
+                        "received %d and %d.",
+                        header_.uint64_slot_num,
+                        header_.float_slot_num,
+                        slot_uint64_feasigns.size(),
+                        slot_float_feasigns.size()));
+  for (auto& feasigns : slot_uint64_feasigns) {
+    uint64_values_.insert(
+        uint64_values_.end(), feasigns.begin(), feasigns.end());
+    uint64_offsets_.push_back(uint64_values_.size());
+  }
+  for (auto& feasigns : slot_float_feasigns) {
+    float_values_.insert(float_values_.end(), feasigns.begin(), feasigns.end());
+    float_offsets_.push_back(float_values_.size());
+  }
+  if (header_.has_ins_id) {
+    ins_ids_.append(ins_id);
+    ins_id_offsets_.push_back(ins_ids_.size());
+  }
+  ++header_.ins_num;
+}
+
+void SlotRecordColumnarWriter::Save(const std::string& path) {
+  std::ofstream fout(path, std::ios::binary);
+  PADDLE_ENFORCE_EQ(
+      fout.good(),
+      true,
+      common::errors::Unavailable("Cannot open file %s to write.", path));
+  static const char kPadding[8] = {0};
+  auto write_section = [&fout](const void* data, size_t bytes) {
+    fout.write(reinterpret_cast<const char*>(data), bytes);
+    fout.write(kPadding, columnar_aligned(bytes) - bytes);
+  };
+  write_section(&header_, sizeof(header_));
+  write_section(uint64_offsets_.data(),
+                uint64_offsets_.size() * sizeof(uint64_t));
+  write_section(uint64_values_.data(),
+                uint64_values_.size() * sizeof(uint64_t));
+  write_section(float_offsets_.data(),
+                float_offsets_.size() * sizeof(uint64_t));
+  write_section(float_values_.data(), float_values_.size() * sizeof(float));
+  if (header_.has_ins_id) {
+    write_section(ins_id_offsets_.data(),
+                  ins_id_offsets_.size() * sizeof(uint64_t));
+    write_section(ins_ids_.data(), ins_ids_.size());
+  }
+  fout.close();
+  PADDLE_ENFORCE_EQ(
+      fout.good(),
+      true,
+      common::errors::Unavailable("Failed to write file %s.", path));
+}
+
+void SlotRecordColumnarReader::Open(const std::string& path) {
+  Close();
+#ifdef _LINUX
+  int fd = open(path.c_str(), O_RDONLY);
+  PADDLE_ENFORCE_NE(
+      fd,
+      -1,
+      common::errors::Unavailable("Fail to open columnar file: %s.", path));
+  struct stat sb = {};
+  fstat(fd, &sb);
+  size_ = static_cast<size_t>(sb.st_size);
+  if (size_ < sizeof(SlotRecordColumnarHeader)) {
+    close(fd);
+  }
+  PADDLE_ENFORCE_GE(
+      size_,
+      sizeof(SlotRecordColumnarHeader),
+      common::errors::InvalidArgument(
+          "Columnar file %s is too small: %d bytes.", path, size_));
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  PADDLE_ENFORCE_NE(
+      data,
+      MAP_FAILED,
+      common::errors::Unavailable(
+          "Memory map failed for columnar file %s, error number is %s.",
+          path,
+          strerror(errno)));
+  data_ = reinterpret_cast<char*>(data);
+  mapped_ = true;
+  madvise(data_, size_, MADV_SEQUENTIAL);
+  ParseSections(path);
+#else
+  FILE* fp = fopen(path.c_str(), "rb");
+  PADDLE_ENFORCE_NOT_NULL(
+      fp, common::errors::Unavailable("Fail to open columnar file: %s.", path));
+  Read(fp, path);
+  fclose(fp);
+#endif
+}
+
+void SlotRecordColumnarReader::Read(FILE* fp, const std::string& path) {
+  Close();
+  const size_t kChunkBytes = 1 << 20;
+  while (true) {
+    buffer_.resize(columnar_aligned(size_ + kChunkBytes) / sizeof(uint64_t));
+    char* begin = reinterpret_cast<char*>(buffer_.data());
+    size_t bytes = fread(begin + size_, 1, kChunkBytes, fp);
+    size_ += bytes;
+    if (bytes < kChunkBytes) {
+      break;
+    }
+  }
+  PADDLE_ENFORCE_EQ(
+      ferror(fp),
+      0,
+      common::errors::Unavailable("Failed to read columnar file %s.", path));
+  PADDLE_ENFORCE_GE(
+      size_,
+      sizeof(SlotRecordColumnarHeader),
+      common::errors::InvalidArgument(
+          "Columnar file %s is too small: %d bytes.", path, size_));
+  data_ = reinterpret_cast<char*>(buffer_.data());
+  ParseSections(path);
+}
+
+// checks the header, that each section is inside the file and that the
+// offsets of every instance are in order
+void SlotRecordColumnarReader::ParseSections(const std::string& path) {
+  memcpy(&header_, data_, sizeof(header_));
+  PADDLE_ENFORCE_EQ(
+      header_.magic == kSlotRecordColumnarMagic &&
+          header_.version == kSlotRecordColumnarVersion,
+      true,
+      common::errors::InvalidArgument(
+          "%s is not a SlotRecord columnar file of version %d.",
+          path,
+          kSlotRecordColumnarVersion));
+
+  size_t offset = columnar_aligned(sizeof(header_));
+  auto section = [this, &offset, &path](uint64_t num, size_t type_size) {
+    PADDLE_ENFORCE_EQ(offset <= size_ && num <= (size_ - offset) / type_size,
+                      true,
+                      common::errors::InvalidArgument(
+                          "Columnar file %s is truncated.", path));
+    const char* ptr = data_ + offset;
+    offset += columnar_aligned(num * type_size);
+    return ptr;
+  };
+  // the offsets of a section start at 0 and never decrease, so the values
+  // of every slot are inside the values that follow
+  auto offset_section = [&section, &path](uint64_t num) {
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(
+        section(num + 1, sizeof(uint64_t)));
+    PADDLE_ENFORCE_EQ(offsets[0] == 0,
+                      true,
+                      common::errors::InvalidArgument(
+                          "Columnar file %s has a corrupted offset.", path));
+    for (uint64_t i = 0; i < num; ++i) {
+      PADDLE_ENFORCE_LE(offsets[i],
+                        offsets[i + 1],
+                        common::errors::InvalidArgument(
+                            "Columnar file %s has a corrupted offset %d.",
+                            path,
+                            i + 1));
+    }
+    return offsets;
+  };
+  // every offset section has more than ins_num * slot_num offsets, which
+  // keeps the products below from overflowing
+  uint64_t ins_num = header_.ins_num;
+  uint64_t max_slot_num = std::max<uint64_t>(
+      1, std::max(header_.uint64_slot_num, header_.float_slot_num));
+  PADDLE_ENFORCE_LE(
+      ins_num,
+      size_ / sizeof(uint64_t) / max_slot_num,
+      common::errors::InvalidArgument("Columnar file %s is truncated.", path));
+  uint64_t uint64_num = ins_num * header_.uint64_slot_num;
+  uint64_offsets_ = offset_section(uint64_num);
+  uint64_values_ = reinterpret_cast<const uint64_t*>(
+      section(uint64_offsets_[uint64_num], sizeof(uint64_t)));
+  uint64_t float_num = ins_num * header_.float_slot_num;
+  float_offsets_ = offset_section(float_num);
+  float_values_ = reinterpret_cast<const float*>(
+      section(float_offsets_[float_num], sizeof(float)));
+  if (header_.has_ins_id) {
+    ins_id_offsets_ = offset_section(ins_num);
+    ins_ids_ = section(ins_id_offsets_[ins_num], 1);
+  }
+}
+
+void SlotRecordColumnarReader::Close() {
+#ifdef _LINUX
+  if (mapped_) {
+    munmap(data_, size_);
+  }
+#endif
+  mapped_ = false;
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  data_ = nullptr;
+  size_ = 0;
+  header_ = {};
+  uint64_offsets_ = nullptr;
+  uint64_values_ = nullptr;
+  float_offsets_ = nullptr;
+  float_values_ = nullptr;
+  ins_id_offsets_ = nullptr;
+  ins_ids_ = nullptr;
 }
 
 void SlotRecordInMemoryDataFeed::AssignFeedVar(const Scope& scope) {
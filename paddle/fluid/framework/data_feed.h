@@ -19,6 +19,9 @@ limitations under the License. */
 #define _LINUX
 #endif
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <future>  // NOLINT
 #include <memory>
@@ -385,6 +388,182 @@ inline SlotObjPool& SlotRecordPool() {
   static SlotObjPool pool;
   return pool;
 }
+
+// Number parsers of the slot text format, used in place of strtoull and
+// strtof. They read eight digits at a time while the line has them and
+// fall back to libc for anything else (signs on ids, exponents, hex, long
+// mantissas), so the results and end pointers are the same. end is the end
+// of the line.
+inline bool is_eight_digits(uint64_t chunk) {
+  return ((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+          (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >>
+           4)) == 0x3333333333333333ULL;
+}
+
+inline uint64_t parse_eight_digits(uint64_t chunk) {
+  chunk = (chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+  chunk = (chunk & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+  return (chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32;
+}
+
+// appends the digits at *str to *value, returns how many were read
+inline int read_feasign_digits(const char** str,
+                               const char* end,
+                               uint64_t* value) {
+  const char* p = *str;
+  uint64_t v = *value;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t chunk = 0;
+  while (end - p >= 8) {
+    memcpy(&chunk, p, sizeof(chunk));
+    if (!is_eight_digits(chunk)) {
+      break;
+    }
+    v = v * 100000000ULL + parse_eight_digits(chunk);
+    p += 8;
+  }
+#endif
+  while (p < end && static_cast<unsigned char>(*p - '0') < 10) {
+    v = v * 10 + (*p - '0');
+    ++p;
+  }
+  int num = static_cast<int>(p - *str);
+  *str = p;
+  *value = v;
+  return num;
+}
+
+inline uint64_t parse_uint64_feasign(const char* str,
+                                     const char* end,
+                                     char** endptr) {
+  const char* p = str;
+  while (p < end && *p == ' ') {
+    ++p;
+  }
+  uint64_t value = 0;
+  int num = read_feasign_digits(&p, end, &value);
+  // 19 digits never overflow
+  if (num == 0 || num > 19) {
+    return static_cast<uint64_t>(strtoull(str, endptr, 10));
+  }
+  *endptr = const_cast<char*>(p);
+  return value;
+}
+
+inline float parse_float_feasign(const char* str,
+                                 const char* end,
+                                 char** endptr) {
+  static const float kPow10[] = {
+      1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  const char* p = str;
+  while (p < end && *p == ' ') {
+    ++p;
+  }
+  bool negative = (p < end && *p == '-');
+  if (negative) {
+    ++p;
+  }
+  uint64_t mantissa = 0;
+  int int_num = read_feasign_digits(&p, end, &mantissa);
+  int frac_num = 0;
+  if (p < end && *p == '.') {
+    ++p;
+    frac_num = read_feasign_digits(&p, end, &mantissa);
+  }
+  // an exact mantissa divided by an exact power of ten rounds once, which
+  // gives the same float as strtof
+  if (int_num + frac_num == 0 || int_num + frac_num > 19 || frac_num > 10 ||
+      mantissa > (1ULL << 24) ||
+      (p < end && (*p == 'e' || *p == 'E' || *p == 'x' || *p == 'X'))) {
+    return strtof(str, endptr);
+  }
+  *endptr = const_cast<char*>(p);
+  float value = static_cast<float>(mantissa) / kPow10[frac_num];
+  return negative ? -value : value;
+}
+
+// Columnar binary input of SlotRecordInMemoryDataFeed, loaded instead of
+// text lines when FLAGS_enable_slotrecord_columnar_input is set. A file is
+//   SlotRecordColumnarHeader
+//   uint64 offsets  uint64_t[ins_num * uint64_slot_num + 1]
+//   uint64 values   uint64_t[last uint64 offset]
+//   float offsets   uint64_t[ins_num * float_slot_num + 1]
+//   float values    float[last float offset]
+//   ins_id offsets  uint64_t[ins_num + 1], if has_ins_id
+//   ins_id chars    char[last ins_id offset], if has_ins_id
+// with every section starting 8 byte aligned. The slots of each type are
+// those of the data feed desc in desc order, used or not. Offsets count
+// from the start of the values, so the values of an instance are one range
+// per type and are copied into the pooled SlotRecordObject without parsing.
+struct SlotRecordColumnarHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t has_ins_id;
+  uint32_t uint64_slot_num;
+  uint32_t float_slot_num;
+  uint64_t ins_num;
+};
+
+class SlotRecordColumnarWriter {
+ public:
+  SlotRecordColumnarWriter(int uint64_slot_num,
+                           int float_slot_num,
+                           bool has_ins_id);
+  // slot_uint64_feasigns and slot_float_feasigns hold every slot of the type
+  void AddInstance(
+      const std::vector<std::vector<uint64_t>>& slot_uint64_feasigns,
+      const std::vector<std::vector<float>>& slot_float_feasigns,
+      const std::string& ins_id = "");
+  void Save(const std::string& path);
+
+ private:
+  SlotRecordColumnarHeader header_;
+  std::vector<uint64_t> uint64_offsets_;
+  std::vector<uint64_t> uint64_values_;
+  std::vector<uint64_t> float_offsets_;
+  std::vector<float> float_values_;
+  std::vector<uint64_t> ins_id_offsets_;
+  std::string ins_ids_;
+};
+
+// reads a columnar file and checks every offset in it, the sections point
+// into the input. A local file is mmaped read only, other input such as the
+// output of a pipe command or a file on hdfs is read into a buffer.
+class SlotRecordColumnarReader {
+ public:
+  SlotRecordColumnarReader() = default;
+  ~SlotRecordColumnarReader() { Close(); }
+  void Open(const std::string& path);
+  // reads fp to the end, path only names the input in errors
+  void Read(FILE* fp, const std::string& path);
+  void Close();
+
+  const SlotRecordColumnarHeader& header() const { return header_; }
+  const uint64_t* uint64_offsets() const { return uint64_offsets_; }
+  const uint64_t* uint64_values() const { return uint64_values_; }
+  const uint64_t* float_offsets() const { return float_offsets_; }
+  const float* float_values() const { return float_values_; }
+  const uint64_t* ins_id_offsets() const { return ins_id_offsets_; }
+  const char* ins_ids() const { return ins_ids_; }
+  size_t file_size() const { return size_; }
+
+ private:
+  SlotRecordColumnarHeader header_ = {};
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  const uint64_t* uint64_offsets_ = nullptr;
+  const uint64_t* uint64_values_ = nullptr;
+  const uint64_t* float_offsets_ = nullptr;
+  const float* float_values_ = nullptr;
+  const uint64_t* ins_id_offsets_ = nullptr;
+  const char* ins_ids_ = nullptr;
+  bool mapped_ = false;
+  // holds input that is read, in uint64_t for the alignment of the sections
+  std::vector<uint64_t> buffer_;
+
+  void ParseSections(const std::string& path);
+};
+
 struct PvInstanceObject {
   std::vector<Record*> ads;
   void merge_instance(Record* ins) { ads.push_back(ins); }
@@ -1988,10 +2167,14 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
   virtual void LoadIntoMemoryByLib(void);
   virtual void LoadIntoMemoryByLine(void);
   virtual void LoadIntoMemoryByFile(void);
+  virtual void LoadIntoMemoryByColumnar(void);
   void SetInputChannel(void* channel) override {
     input_channel_ = static_cast<ChannelObject<SlotRecord>*>(channel);
   }
   bool ParseOneInstance(const std::string& line, SlotRecord* rec);
+  bool ParseOneColumnarInstance(const SlotRecordColumnarReader& reader,
+                                size_t ins_idx,
+                                SlotRecord* rec);
   void PutToFeedVec(const SlotRecord* ins_vec, int num) override;
   void AssignFeedVar(const Scope& scope) override;
   std::vector<std::string> GetInputVarNames() override {
@@ -81,6 +81,7 @@ DatasetImpl<T>::DatasetImpl()
   merge_by_insid_ = false;
   merge_by_sid_ = true;
   enable_pv_merge_ = false;
+  lock_free_channel_ = false;
   merge_size_ = 2;
   parse_ins_id_ = false;
   parse_content_ = false;
@@ -211,6 +212,30 @@ void DatasetImpl<T>::SetEnablePvMerge(bool enable_pv_merge) {
   enable_pv_merge_ = enable_pv_merge;
 }
 
+// channels created before the switch must still be empty
+template <typename T>
+void DatasetImpl<T>::SetLockFreeChannel(bool lock_free) {
+  lock_free_channel_ = lock_free;
+  if (input_channel_ != nullptr) {
+    input_channel_->SetLockFree(lock_free);
+  }
+  if (input_pv_channel_ != nullptr) {
+    input_pv_channel_->SetLockFree(lock_free);
+  }
+  for (auto& chan : multi_output_channel_) {
+    chan->SetLockFree(lock_free);
+  }
+  for (auto& chan : multi_consume_channel_) {
+    chan->SetLockFree(lock_free);
+  }
+  for (auto& chan : multi_pv_output_) {
+    chan->SetLockFree(lock_free);
+  }
+  for (auto& chan : multi_pv_consume_) {
+    chan->SetLockFree(lock_free);
+  }
+}
+
 template <typename T>
 void DatasetImpl<T>::SetGenerateUniqueFeasign(bool gen_uni_feasigns) {
   gen_uni_feasigns_ = gen_uni_feasigns;
@@ -245,36 +270,48 @@ std::vector<paddle::framework::DataFeed*> DatasetImpl<T>::GetReaders() {
   return ret;
 }
 
+// channels of a dataset follow its lock-free setting
+template <typename U>
+static paddle::framework::Channel<U> MakeDatasetChannel(bool lock_free) {
+  paddle::framework::Channel<U> chan = paddle::framework::MakeChannel<U>();
+  chan->SetLockFree(lock_free);
+  return chan;
+}
+
 template <typename T>
 void DatasetImpl<T>::CreateChannel() {
   if (input_channel_ == nullptr) {
-    input_channel_ = paddle::framework::MakeChannel<T>();
+    input_channel_ = MakeDatasetChannel<T>(lock_free_channel_);
   }
   if (multi_output_channel_.empty()) {
     multi_output_channel_.reserve(channel_num_);
     for (int i = 0; i < channel_num_; ++i) {
-      multi_output_channel_.push_back(paddle::framework::MakeChannel<T>());
+      multi_output_channel_.push_back(
+          MakeDatasetChannel<T>(lock_free_channel_));
     }
   }
   if (multi_consume_channel_.empty()) {
     multi_consume_channel_.reserve(channel_num_);
     for (int i = 0; i < channel_num_; ++i) {
-      multi_consume_channel_.push_back(paddle::framework::MakeChannel<T>());
+      multi_consume_channel_.push_back(
+          MakeDatasetChannel<T>(lock_free_channel_));
     }
   }
   if (input_pv_channel_ == nullptr) {
-    input_pv_channel_ = paddle::framework::MakeChannel<PvInstance>();
+    input_pv_channel_ = MakeDatasetChannel<PvInstance>(lock_free_channel_);
   }
   if (multi_pv_output_.empty()) {
     multi_pv_output_.reserve(channel_num_);
     for (int i = 0; i < channel_num_; ++i) {
-      multi_pv_output_.push_back(paddle::framework::MakeChannel<PvInstance>());
+      multi_pv_output_.push_back(
+          MakeDatasetChannel<PvInstance>(lock_free_channel_));
     }
   }
   if (multi_pv_consume_.empty()) {
     multi_pv_consume_.reserve(channel_num_);
     for (int i = 0; i < channel_num_; ++i) {
-      multi_pv_consume_.push_back(paddle::framework::MakeChannel<PvInstance>());
+      multi_pv_consume_.push_back(
+          MakeDatasetChannel<PvInstance>(lock_free_channel_));
     }
   }
 }
@@ -856,6 +893,65 @@ void MultiSlotDataset::TDMSample(const std::string tree_name,
   return;
 }
 
+size_t MultiSlotDataset::ShuffleClientId(const Record& data) {
+  if (merge_by_insid_) {
+    return XXH64(data.ins_id_.data(), data.ins_id_.length(), 0) % trainer_num_;
+  } else if (shuffle_by_uid_) {
+    return XXH64(data.uid_.data(), data.uid_.length(), 0) % trainer_num_;
+  }
+#ifdef PADDLE_WITH_PSCORE
+  auto fleet_ptr = distributed::FleetWrapper::GetInstance();
+#else
+  auto fleet_ptr = framework::FleetWrapper::GetInstance();
+#endif
+  return fleet_ptr->LocalRandomEngine()() % trainer_num_;
+}
+
+std::future<int32_t> MultiSlotDataset::SendShuffleMsg(int client_id,
+                                                      const std::string& msg) {
+  if (shuffle_send_func_) {
+    return shuffle_send_func_(client_id, msg);
+  }
+#ifdef PADDLE_WITH_PSCORE
+  auto fleet_ptr = distributed::FleetWrapper::GetInstance();
+#else
+  auto fleet_ptr = framework::FleetWrapper::GetInstance();
+#endif
+  return fleet_ptr->SendClientToClientMsg(0, client_id, msg);
+}
+
+void MultiSlotDataset::SendShuffleData(
+    std::vector<Record>* data, std::vector<std::future<int32_t>>* status) {
+#ifdef PADDLE_WITH_PSCORE
+  auto fleet_ptr = distributed::FleetWrapper::GetInstance();
+#else
+  auto fleet_ptr = framework::FleetWrapper::GetInstance();
+#endif
+  std::vector<paddle::framework::BinaryArchive> ars(trainer_num_);
+  for (auto& t : *data) {
+    auto client_id = ShuffleClientId(t);
+    ars[client_id] << t;
+  }
+  std::vector<int> send_index(trainer_num_);
+  for (int i = 0; i < trainer_num_; ++i) {
+    send_index[i] = i;
+  }
+  std::shuffle(
+      send_index.begin(), send_index.end(), fleet_ptr->LocalRandomEngine());
+  for (int index = 0; index < trainer_num_; ++index) {
+    int i = send_index[index];
+    if (ars[i].Length() == 0) {
+      continue;
+    }
+    std::string msg(ars[i].Buffer(), ars[i].Length());
+    status->push_back(SendShuffleMsg(i, msg));
+  }
+  ars.clear();
+  ars.shrink_to_fit();
+  data->clear();
+  data->shrink_to_fit();
+}
+
 void MultiSlotDataset::GlobalShuffle(int thread_num) {
   VLOG(3) << "MultiSlotDataset::GlobalShuffle() begin";
   platform::Timer timeline;
@@ -886,55 +982,14 @@ void MultiSlotDataset::GlobalShuffle(int thread_num) {
   VLOG(3) << "MultiSlotDataset::GlobalShuffle() input_channel_ size "
           << input_channel_->Size();
 
-  auto get_client_id = [this, fleet_ptr](const Record& data) -> size_t {
-    if (this->merge_by_insid_) {
-      return XXH64(data.ins_id_.data(), data.ins_id_.length(), 0) %
-             this->trainer_num_;
-    } else if (this->shuffle_by_uid_) {
-      return XXH64(data.uid_.data(), data.uid_.length(), 0) %
-             this->trainer_num_;
-    } else {
-      return fleet_ptr->LocalRandomEngine()() % this->trainer_num_;
-    }
-  };
-
-  auto global_shuffle_func = [this, get_client_id]() {
-#ifdef PADDLE_WITH_PSCORE
-    auto fleet_ptr = distributed::FleetWrapper::GetInstance();
-#else
-    auto fleet_ptr = framework::FleetWrapper::GetInstance();
-#endif
-    // auto fleet_ptr = framework::FleetWrapper::GetInstance();
+  auto global_shuffle_func = [this]() {
     std::vector<Record> data;
     while (this->input_channel_->Read(data)) {
-      std::vector<paddle::framework::BinaryArchive> ars(this->trainer_num_);
-      for (auto& t : data) {
-        auto client_id = get_client_id(t);
-        ars[client_id] << t;
-      }
       std::vector<std::future<int32_t>> total_status;
-      std::vector<int> send_index(this->trainer_num_);
-      for (int i = 0; i < this->trainer_num_; ++i) {
-        send_index[i] = i;
-      }
-      std::shuffle(
-          send_index.begin(), send_index.end(), fleet_ptr->LocalRandomEngine());
-      for (int index = 0; index < this->trainer_num_; ++index) {
-        int i = send_index[index];
-        if (ars[i].Length() == 0) {
-          continue;
-        }
-        std::string msg(ars[i].Buffer(), ars[i].Length());
-        auto ret = fleet_ptr->SendClientToClientMsg(0, i, msg);
-        total_status.push_back(std::move(ret));
-      }
+      this->SendShuffleData(&data, &total_status);
       for (auto& t : total_status) {
         t.wait();
       }
-      ars.clear();
-      ars.shrink_to_fit();
-      data.clear();
-      data.shrink_to_fit();
       // currently we find bottleneck is server not able to handle large data
       // in time, so we can remove this sleep and set fleet_send_batch_size to
       // 1024, and set server thread to 24.
@@ -963,6 +1018,86 @@ void MultiSlotDataset::GlobalShuffle(int thread_num) {
           << timeline.ElapsedSec() << " seconds";
 }
 
+void MultiSlotDataset::StartGlobalShuffle(int thread_num) {
+  VLOG(3) << "MultiSlotDataset::StartGlobalShuffle() begin";
+  PADDLE_ENFORCE_EQ(streaming_shuffle_threads_.empty(),
+                    true,
+                    common::errors::PreconditionNotMet(
+                        "StartGlobalShuffle is called while the previous "
+                        "global shuffle is not done, call "
+                        "WaitGlobalShuffleDone first."));
+  PADDLE_ENFORCE_NOT_NULL(input_channel_,
+                          common::errors::PreconditionNotMet(
+                              "Input channel is not created, call "
+                              "CreateChannel before StartGlobalShuffle."));
+  if (thread_num == -1) {
+    thread_num = thread_num_;
+  }
+  // bound the input channel so that loaders wait for the senders instead of
+  // holding the whole pass in memory. every sender may wait for a full batch,
+  // so the capacity must cover one batch per sender.
+  size_t batch_size = static_cast<size_t>(fleet_send_batch_size_);
+  input_channel_capacity_ = input_channel_->Capacity();
+  input_channel_->SetCapacity(
+      (std::min)(input_channel_capacity_, batch_size * thread_num * 2));
+
+  auto streaming_shuffle_func = [this, batch_size]() {
+    std::vector<Record> data;
+    // sends of the previous batch are waited only after the next batch is
+    // sent, so at most two batches per thread are in flight
+    std::vector<std::future<int32_t>> pending_status;
+    std::vector<std::future<int32_t>> total_status;
+    while (true) {
+      data.resize(batch_size);
+      size_t n = this->input_channel_->Read(batch_size, data.data());
+      if (n == 0) {
+        break;
+      }
+      data.resize(n);
+      this->SendShuffleData(&data, &total_status);
+      for (auto& t : pending_status) {
+        t.wait();
+      }
+      pending_status.clear();
+      pending_status.swap(total_status);
+    }
+    for (auto& t : pending_status) {
+      t.wait();
+    }
+  };
+
+  VLOG(3) << "start streaming global shuffle threads, num = " << thread_num;
+  for (int i = 0; i < thread_num; ++i) {
+    streaming_shuffle_threads_.emplace_back(streaming_shuffle_func);
+  }
+  VLOG(3) << "MultiSlotDataset::StartGlobalShuffle() end";
+}
+
+void MultiSlotDataset::WaitGlobalShuffleDone() {
+  VLOG(3) << "MultiSlotDataset::WaitGlobalShuffleDone() begin";
+  if (streaming_shuffle_threads_.empty()) {
+    VLOG(3) << "MultiSlotDataset::WaitGlobalShuffleDone() end, not started";
+    return;
+  }
+  PADDLE_ENFORCE_EQ(input_channel_->Closed(),
+                    true,
+                    common::errors::PreconditionNotMet(
+                        "Input channel is still open, call LoadIntoMemory "
+                        "or WaitPreLoadDone before WaitGlobalShuffleDone."));
+  platform::Timer timeline;
+  timeline.Start();
+  for (std::thread& t : streaming_shuffle_threads_) {
+    t.join();
+  }
+  streaming_shuffle_threads_.clear();
+  streaming_shuffle_threads_.shrink_to_fit();
+  input_channel_->SetCapacity(input_channel_capacity_);
+  input_channel_->Clear();
+  timeline.Pause();
+  VLOG(3) << "MultiSlotDataset::WaitGlobalShuffleDone() end, wait time="
+          << timeline.ElapsedSec() << " seconds";
+}
+
 template <typename T>
 void DatasetImpl<T>::DynamicAdjustChannelNum(int channel_num,
                                              bool discard_remaining_ins) {
@@ -1079,12 +1214,13 @@ void DatasetImpl<T>::DynamicAdjustChannelNum(int channel_num,
   for (int i = 0; i < channel_num; ++i) {
     local_vec.clear();
     total_data_channel->Read(local_vec);
-    new_other_channels.push_back(paddle::framework::MakeChannel<T>());
-    new_channels.push_back(paddle::framework::MakeChannel<T>());
+    new_other_channels.push_back(MakeDatasetChannel<T>(lock_free_channel_));
+    new_channels.push_back(MakeDatasetChannel<T>(lock_free_channel_));
     new_channels[i]->Write(std::move(local_vec));
     new_other_pv_channels.push_back(
-        paddle::framework::MakeChannel<PvInstance>());
-    new_pv_channels.push_back(paddle::framework::MakeChannel<PvInstance>());
+        MakeDatasetChannel<PvInstance>(lock_free_channel_));
+    new_pv_channels.push_back(
+        MakeDatasetChannel<PvInstance>(lock_free_channel_));
   }
 
   total_data_channel->Clear();
@@ -1985,7 +2121,7 @@ void MultiSlotDataset::SlotsShuffle(
 template class DatasetImpl<SlotRecord>;
 void SlotRecordDataset::CreateChannel() {
   if (input_channel_ == nullptr) {
-    input_channel_ = paddle::framework::MakeChannel<SlotRecord>();
+    input_channel_ = MakeDatasetChannel<SlotRecord>(lock_free_channel_);
   }
 }
 void SlotRecordDataset::CreateReaders() {
@@ -17,6 +17,8 @@
 #include <ThreadPool.h>
 
 #include <fstream>
+#include <functional>
+#include <future>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <set>
@@ -85,6 +87,8 @@ class Dataset {
   virtual void SetParseLogKey(bool parse_logkey) = 0;
   virtual void SetEnablePvMerge(bool enable_pv_merge) = 0;
   virtual bool EnablePvMerge() = 0;
+  // move records through lock-free channels
+  virtual void SetLockFreeChannel(bool lock_free) = 0;
   virtual void SetMergeBySid(bool is_merge) = 0;
   virtual void SetShuffleByUid(bool enable_shuffle_uid) = 0;
   // set merge by ins id
@@ -127,6 +131,11 @@ class Dataset {
   virtual void LocalShuffle() = 0;
   // global shuffle data
   virtual void GlobalShuffle(int thread_num = -1) = 0;
+  // start global shuffle in background, records are sent to other trainers
+  // while they are still being loaded
+  virtual void StartGlobalShuffle(int thread_num = -1) = 0;
+  // wait background global shuffle done, call after load done
+  virtual void WaitGlobalShuffleDone() = 0;
   virtual void SlotsShuffle(const std::set<std::string>& slots_to_replace) = 0;
   // create readers
   virtual void CreateReaders() = 0;
@@ -214,6 +223,7 @@ class DatasetImpl : public Dataset {
   virtual void SetParseContent(bool parse_content);
   virtual void SetParseLogKey(bool parse_logkey);
   virtual void SetEnablePvMerge(bool enable_pv_merge);
+  virtual void SetLockFreeChannel(bool lock_free);
   virtual void SetMergeBySid(bool is_merge);
   virtual void SetShuffleByUid(bool enable_shuffle_uid);
 
@@ -248,6 +258,8 @@ class DatasetImpl : public Dataset {
   virtual void ReleaseMemory();
   virtual void LocalShuffle();
   virtual void GlobalShuffle(int thread_num UNUSED = -1) {}
+  virtual void StartGlobalShuffle(int thread_num UNUSED = -1) {}
+  virtual void WaitGlobalShuffleDone() {}
   virtual void SlotsShuffle(
       const std::set<std::string>& slots_to_replace UNUSED) {}
   virtual const std::vector<T>& GetSlotsOriginalData() {
@@ -356,6 +368,7 @@ class DatasetImpl : public Dataset {
   bool shuffle_by_uid_;
   bool parse_uid_;
   bool enable_pv_merge_;  // True means to merge pv
+  bool lock_free_channel_;
   int current_phase_;     // 1 join, 0 update
   size_t merge_size_;
   bool slots_shuffle_fea_eval_ = false;
@@ -414,15 +427,42 @@ class MultiSlotDataset : public DatasetImpl<Record> {
   virtual void GetRandomData(
       const std::unordered_set<uint16_t>& slots_to_replace,
       std::vector<Record>* result);
-  virtual ~MultiSlotDataset() {}
+  virtual ~MultiSlotDataset() {
+    if (!streaming_shuffle_threads_.empty()) {
+      input_channel_->Close();
+      WaitGlobalShuffleDone();
+    }
+  }
   virtual void GlobalShuffle(int thread_num = -1);
+  virtual void StartGlobalShuffle(int thread_num = -1);
+  virtual void WaitGlobalShuffleDone();
   virtual void DynamicAdjustReadersNum(int thread_num);
   virtual void PrepareTrain();
 
+  // transport used by global shuffle to send a message to another trainer,
+  // defaults to FleetWrapper::SendClientToClientMsg
+  typedef std::function<std::future<int32_t>(int client_id,
+                                             const std::string& msg)>
+      ShuffleSendFunc;
+  void SetShuffleSendFunc(ShuffleSendFunc func) {
+    shuffle_send_func_ = std::move(func);
+  }
+
  protected:
   virtual int ReceiveFromClient(int msg_type,
                                 int client_id,
                                 const std::string& msg);
+  size_t ShuffleClientId(const Record& data);
+  // serialize records by destination and send them, keeps the futures of
+  // unfinished sends in status
+  void SendShuffleData(std::vector<Record>* data,
+                       std::vector<std::future<int32_t>>* status);
+  std::future<int32_t> SendShuffleMsg(int client_id, const std::string& msg);
+
+  ShuffleSendFunc shuffle_send_func_;
+  std::vector<std::thread> streaming_shuffle_threads_;
+  // input channel capacity before streaming shuffle bounds it
+  size_t input_channel_capacity_ = 0;
 };
 class SlotRecordDataset : public DatasetImpl<SlotRecord> {
  public:
@@ -61,6 +61,10 @@ class AsyncWorkQueue {
     return queue_group_->QueueNumThreads(idx);
   }
 
+  std::vector<WorkerStats> QueueWorkerStats(size_t idx) {
+    return queue_group_->QueueWorkerStats(idx);
+  }
+
  private:
   size_t host_num_thread_;
   std::unique_ptr<WorkQueueGroup> queue_group_;
@@ -0,0 +1,350 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpreter/static_memory_plan.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "paddle/fluid/framework/new_executor/instruction/instruction_base.h"
+#include "paddle/fluid/framework/new_executor/pir_adaptor/pir_adaptor_util.h"
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/core/memory/malloc.h"
+
+namespace paddle::framework::interpreter {
+
+namespace {
+
+inline size_t AlignedSize(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+inline bool IsOverlapped(const TensorLifetime& a, const TensorLifetime& b) {
+  return a.first_step <= b.last_step && b.first_step <= a.last_step;
+}
+
+// A slice of the arena, which is released with the arena rather than by
+// itself.
+class ArenaSliceAllocation : public phi::Allocation {
+ public:
+  ArenaSliceAllocation(std::shared_ptr<phi::Allocation> arena,
+                       size_t offset,
+                       size_t size)
+      : phi::Allocation(static_cast<uint8_t*>(arena->ptr()) + offset,
+                        size,
+                        arena->place()),
+        arena_(std::move(arena)) {}
+
+ private:
+  std::shared_ptr<phi::Allocation> arena_;
+};
+
+phi::DenseTensor* GetDenseTensor(Variable* var) {
+  if (var == nullptr || !var->IsType<phi::DenseTensor>()) {
+    return nullptr;
+  }
+  return var->GetMutable<phi::DenseTensor>();
+}
+
+void CollectVarIds(
+    const std::unordered_map<::pir::Value, std::vector<int>>& values,
+    std::vector<size_t>* var_ids) {
+  for (auto& item : values) {
+    for (int var_id : item.second) {
+      if (var_id >= 0) {
+        var_ids->push_back(static_cast<size_t>(var_id));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+size_t PlanStaticMemoryOffsets(const std::vector<TensorLifetime>& lifetimes,
+                               size_t alignment,
+                               std::vector<size_t>* offsets) {
+  PADDLE_ENFORCE_GT(
+      alignment,
+      0,
+      common::errors::InvalidArgument(
+          "Alignment should be larger than 0, but got %d", alignment));
+  offsets->assign(lifetimes.size(), 0);
+
+  std::vector<size_t> order(lifetimes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return lifetimes[a].size > lifetimes[b].size;
+  });
+
+  // The placed tensors sorted by offset.
+  std::vector<size_t> placed;
+  placed.reserve(lifetimes.size());
+  size_t arena_size = 0;
+  for (size_t i : order) {
+    size_t size = AlignedSize(lifetimes[i].size, alignment);
+    size_t best_offset = std::numeric_limits<size_t>::max();
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    size_t prev_end = 0;
+    for (size_t j : placed) {
+      if (!IsOverlapped(lifetimes[i], lifetimes[j])) {
+        continue;
+      }
+      size_t offset = (*offsets)[j];
+      if (offset >= prev_end) {
+        size_t gap = offset - prev_end;
+        if (gap >= size && gap < best_gap) {
+          best_offset = prev_end;
+          best_gap = gap;
+        }
+      }
+      size_t end = offset + AlignedSize(lifetimes[j].size, alignment);
+      prev_end = std::max(prev_end, end);
+    }
+    if (best_offset == std::numeric_limits<size_t>::max()) {
+      best_offset = prev_end;
+    }
+    (*offsets)[i] = best_offset;
+    arena_size = std::max(arena_size, best_offset + size);
+
+    auto pos = std::upper_bound(placed.begin(),
+                                placed.end(),
+                                best_offset,
+                                [&](size_t offset, size_t j) {
+                                  return offset < (*offsets)[j];
+                                });
+    placed.insert(pos, i);
+  }
+  return arena_size;
+}
+
+int64_t ShapeBucketDim(int64_t dim, int64_t granularity) {
+  if (dim <= 0) {
+    return dim;
+  }
+  if (granularity > 0) {
+    return (dim + granularity - 1) / granularity * granularity;
+  }
+  int64_t bound = 1;
+  while (bound < dim) {
+    bound <<= 1;
+  }
+  return bound;
+}
+
+StaticMemoryPlanner::StaticMemoryPlanner(
+    const phi::Place& place, const ValueExecutionInfo* value_exe_info)
+    : place_(place),
+      value_exe_info_(value_exe_info),
+      records_(value_exe_info->GetVarList().size()) {}
+
+void StaticMemoryPlanner::Touch(size_t var_id) {
+  if (var_id >= records_.size()) {
+    records_.resize(var_id + 1);
+  }
+  VarRecord& record = records_[var_id];
+  if (!record.touched) {
+    record.touched = true;
+    record.first_step = step_;
+  }
+  record.last_step = step_;
+}
+
+std::vector<size_t> StaticMemoryPlanner::OutputVarIds(
+    const InstructionBase& instr) const {
+  std::vector<size_t> var_ids;
+  CollectVarIds(instr.Outputs(), &var_ids);
+  return var_ids;
+}
+
+void StaticMemoryPlanner::BeforeRun(const InstructionBase& instr) {
+  holders_before_run_.clear();
+  const auto& var_list = value_exe_info_->GetVarList();
+  for (size_t var_id : OutputVarIds(instr)) {
+    auto* tensor = var_id < var_list.size() ? GetDenseTensor(var_list[var_id])
+                                            : nullptr;
+    holders_before_run_[var_id] =
+        tensor != nullptr ? tensor->Holder().get() : nullptr;
+  }
+}
+
+void StaticMemoryPlanner::AfterRun(const InstructionBase& instr) {
+  const auto& var_list = value_exe_info_->GetVarList();
+
+  auto register_owner = [&](size_t var_id, const phi::Allocation* holder) {
+    auto iter = allocation_owner_.find(holder);
+    if (iter != allocation_owner_.end() && iter->second != var_id) {
+      // The address of a freed allocation may be reused, so it is shared only
+      // if the previous owner still holds it.
+      auto* owner = GetDenseTensor(var_list[iter->second]);
+      if (owner != nullptr && owner->Holder().get() == holder) {
+        VLOG(6) << "StaticMemoryPlanner: var " << var_id
+                << " shares memory with var " << iter->second;
+        records_[var_id].plannable = false;
+        records_[iter->second].plannable = false;
+        return;
+      }
+    }
+    allocation_owner_[holder] = var_id;
+  };
+
+  std::vector<size_t> input_ids;
+  CollectVarIds(instr.Inputs(), &input_ids);
+  for (size_t var_id : input_ids) {
+    Touch(var_id);
+    auto* tensor = GetDenseTensor(var_list[var_id]);
+    if (tensor == nullptr) {
+      records_[var_id].plannable = false;
+      continue;
+    }
+    if (tensor->Holder() != nullptr) {
+      register_owner(var_id, tensor->Holder().get());
+    }
+  }
+
+  for (size_t var_id : OutputVarIds(instr)) {
+    Touch(var_id);
+    VarRecord& record = records_[var_id];
+    auto* tensor = GetDenseTensor(var_list[var_id]);
+    if (tensor == nullptr) {
+      record.plannable = false;
+      continue;
+    }
+    const phi::Allocation* holder = tensor->Holder().get();
+    if (holder == nullptr) {
+      continue;
+    }
+    if (holder != holders_before_run_[var_id]) {
+      if (record.produced_step >= 0) {
+        // Allocated by more than one instruction.
+        record.plannable = false;
+      } else {
+        record.produced_step = static_cast<int64_t>(step_);
+        record.size = holder->size();
+        record.place = holder->place();
+      }
+    }
+    register_owner(var_id, holder);
+  }
+  ++step_;
+}
+
+void StaticMemoryPlanner::Plan(
+    const std::unordered_set<size_t>& candidate_var_ids) {
+  is_profiling_ = false;
+  holders_before_run_.clear();
+  allocation_owner_.clear();
+  planned_.assign(records_.size(), false);
+
+  const auto& var_list = value_exe_info_->GetVarList();
+  std::vector<size_t> var_ids;
+  std::vector<TensorLifetime> lifetimes;
+  size_t total_size = 0;
+  for (size_t var_id = 0; var_id < records_.size(); ++var_id) {
+    const VarRecord& record = records_[var_id];
+    if (!candidate_var_ids.count(var_id) || !record.touched ||
+        !record.plannable || record.size == 0 ||
+        record.produced_step != static_cast<int64_t>(record.first_step) ||
+        record.place != place_ || GetDenseTensor(var_list[var_id]) == nullptr) {
+      continue;
+    }
+    size_t size = record.size;
+    auto reserved = reserved_sizes_.find(var_id);
+    if (reserved != reserved_sizes_.end()) {
+      size = std::max(size, reserved->second);
+    }
+    var_ids.push_back(var_id);
+    lifetimes.push_back({size, record.first_step, record.last_step});
+    total_size += size;
+  }
+  records_.clear();
+  reserved_sizes_.clear();
+  if (var_ids.empty()) {
+    VLOG(4) << "StaticMemoryPlanner: no variable to plan";
+    return;
+  }
+
+  std::vector<size_t> offsets;
+  size_t arena_size = PlanStaticMemoryOffsets(lifetimes, kAlignment, &offsets);
+  arena_ = memory::AllocShared(place_, arena_size);
+  for (size_t i = 0; i < var_ids.size(); ++i) {
+    auto slice = std::make_shared<ArenaSliceAllocation>(
+        arena_, offsets[i], lifetimes[i].size);
+    GetDenseTensor(var_list[var_ids[i]])->ResetHolder(slice);
+    slices_[var_ids[i]] = slice;
+    planned_sizes_[var_ids[i]] = lifetimes[i].size;
+    planned_[var_ids[i]] = true;
+  }
+  VLOG(1) << "StaticMemoryPlanner: planned " << var_ids.size()
+          << " variables of " << total_size << " bytes into an arena of "
+          << arena_size << " bytes on " << place_;
+}
+
+void StaticMemoryPlanner::CheckAfterRun() {
+  const auto& var_list = value_exe_info_->GetVarList();
+  for (auto iter = slices_.begin(); iter != slices_.end();) {
+    auto* tensor = GetDenseTensor(var_list[iter->first]);
+    if (tensor == nullptr || tensor->Holder() != iter->second) {
+      VLOG(4) << "StaticMemoryPlanner: var " << iter->first
+              << " is reallocated, fall back to garbage collection";
+      if (tensor != nullptr && tensor->Holder() != nullptr) {
+        size_t& size = planned_sizes_[iter->first];
+        size = std::max(size, tensor->Holder()->size());
+      }
+      is_outgrown_ = true;
+      planned_[iter->first] = false;
+      iter = slices_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+void StaticMemoryPlanner::ReserveSizes(
+    const std::unordered_map<size_t, size_t>& sizes) {
+  for (auto& item : sizes) {
+    size_t& size = reserved_sizes_[item.first];
+    size = std::max(size, item.second);
+  }
+}
+
+void StaticMemoryPlanner::Detach() {
+  const auto& var_list = value_exe_info_->GetVarList();
+  for (auto& item : slices_) {
+    auto* tensor = GetDenseTensor(var_list[item.first]);
+    if (tensor != nullptr && tensor->Holder() == item.second) {
+      tensor->MoveMemoryHolder();
+    }
+  }
+}
+
+void StaticMemoryPlanner::Apply() {
+  const auto& var_list = value_exe_info_->GetVarList();
+  for (auto& item : slices_) {
+    Variable* var = var_list[item.first];
+    // The variables of a new scope may not be typed before their first run.
+    if (var == nullptr ||
+        (var->IsInitialized() && !var->IsType<phi::DenseTensor>())) {
+      continue;
+    }
+    auto* tensor = var->GetMutable<phi::DenseTensor>();
+    if (tensor->Holder() != item.second) {
+      // The meta may be left by a larger shape, which the kernel resets.
+      tensor->MoveMemoryHolder();
+      tensor->ResetHolder(item.second);
+    }
+  }
+}
+
+}  // namespace paddle::framework::interpreter
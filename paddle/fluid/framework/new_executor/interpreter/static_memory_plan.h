@@ -0,0 +1,148 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "paddle/phi/common/place.h"
+#include "paddle/phi/core/allocator.h"
+
+namespace paddle {
+namespace framework {
+
+class InstructionBase;
+class ValueExecutionInfo;
+
+namespace interpreter {
+
+// The size of a tensor and the steps of the first and the last instruction
+// touching it, both inclusive.
+struct TensorLifetime {
+  size_t size;
+  size_t first_step;
+  size_t last_step;
+};
+
+// Assigns each tensor an offset in one arena so that tensors with overlapping
+// lifetimes never overlap in memory, and returns the size of the arena.
+//
+// Tensors are placed from the largest to the smallest, each into the smallest
+// gap left between the already placed tensors alive at the same time, or
+// above all of them if no gap fits. Offsets are multiples of `alignment`.
+size_t PlanStaticMemoryOffsets(const std::vector<TensorLifetime>& lifetimes,
+                               size_t alignment,
+                               std::vector<size_t>* offsets);
+
+// Rounds a dimension of an input up to the bound of its shape bucket, a
+// multiple of `granularity` if it is positive, or else a power of 2. Unknown
+// and zero dimensions are kept.
+int64_t ShapeBucketDim(int64_t dim, int64_t granularity);
+
+// Plans the memory of the intermediate tensors of a program run by trace mode.
+//
+// During the first run, it records the instructions producing and touching
+// each DenseTensor variable. Plan() then places the variables, which are
+// produced by one instruction, never share memory with others and are
+// garbage collected anyway, into one arena. Planned variables keep their slice
+// of the arena across runs, so their kernels reuse it instead of allocating,
+// and the interpreter skips garbage collecting them.
+//
+// If a kernel reallocates a planned variable later, e.g. the shape grows, the
+// variable falls back to normal allocation and garbage collection, and the
+// planner is marked outgrown so that the interpreter may plan again.
+class StaticMemoryPlanner {
+ public:
+  static constexpr size_t kAlignment = 256;
+
+  StaticMemoryPlanner(const phi::Place& place,
+                      const ValueExecutionInfo* value_exe_info);
+
+  bool IsProfiling() const { return is_profiling_; }
+
+  bool IsPlanned(size_t var_id) const {
+    return var_id < planned_.size() && planned_[var_id];
+  }
+
+  // Called around each instruction in the profiling run.
+  void BeforeRun(const InstructionBase& instr);
+  void AfterRun(const InstructionBase& instr);
+
+  // Finishes profiling and places the variables in `candidate_var_ids`
+  // which are safe to plan into the arena.
+  void Plan(const std::unordered_set<size_t>& candidate_var_ids);
+
+  // Called after each planned run, unplans the variables whose slice was
+  // replaced by their kernels.
+  void CheckAfterRun();
+
+  bool IsOutgrown() const { return is_outgrown_; }
+
+  // The bytes each planned variable has needed so far, including the ones
+  // which outgrew their slice.
+  const std::unordered_map<size_t, size_t>& PlannedSizes() const {
+    return planned_sizes_;
+  }
+
+  // Makes Plan() reserve at least `sizes` bytes for the variables, so that a
+  // new plan also covers the sizes seen by an older one.
+  void ReserveSizes(const std::unordered_map<size_t, size_t>& sizes);
+
+  // Used to switch between the plans of one program, or to move a plan to
+  // the variables of a new scope. Detach() takes the slices out of the
+  // variables still holding them, and Apply() gives the planned variables
+  // their slices back.
+  void Detach();
+  void Apply();
+
+ private:
+  struct VarRecord {
+    size_t first_step{0};
+    size_t last_step{0};
+    // The step which allocated its memory, -1 for none.
+    int64_t produced_step{-1};
+    size_t size{0};
+    phi::Place place;
+    bool touched{false};
+    bool plannable{true};
+  };
+
+  void Touch(size_t var_id);
+  std::vector<size_t> OutputVarIds(const InstructionBase& instr) const;
+
+  phi::Place place_;
+  const ValueExecutionInfo* value_exe_info_;
+  bool is_profiling_{true};
+  bool is_outgrown_{false};
+  size_t step_{0};
+
+  std::vector<VarRecord> records_;
+  // The holders of outputs before the current instruction runs.
+  std::unordered_map<size_t, const phi::Allocation*> holders_before_run_;
+  // Which variable owns each allocation seen, to detect shared memory.
+  std::unordered_map<const phi::Allocation*, size_t> allocation_owner_;
+
+  std::shared_ptr<phi::Allocation> arena_;
+  std::vector<bool> planned_;
+  std::unordered_map<size_t, std::shared_ptr<phi::Allocation>> slices_;
+  std::unordered_map<size_t, size_t> planned_sizes_;
+  std::unordered_map<size_t, size_t> reserved_sizes_;
+};
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
@@ -38,6 +38,7 @@
 #include "paddle/phi/core/platform/device_event.h"
 
 COMMON_DECLARE_bool(new_executor_serial_run);
+COMMON_DECLARE_bool(new_executor_locality_aware_schedule);
 PD_DECLARE_bool(new_executor_static_build);
 PD_DECLARE_bool(new_executor_use_inplace);
 PD_DECLARE_bool(new_executor_use_local_scope);
@@ -23,6 +23,11 @@ PHI_DEFINE_EXPORTED_bool(
     new_executor_serial_run,
     false,
     "Enable serial execution for standalone executor, used for debug.");
+PHI_DEFINE_EXPORTED_bool(
+    new_executor_locality_aware_schedule,
+    false,
+    "Bind host worker threads to cpus, steal tasks from the workers sharing "
+    "caches first and keep a ready successor of an op on the same worker.");
 PHI_DEFINE_EXPORTED_bool(
     new_executor_static_build,
     false,
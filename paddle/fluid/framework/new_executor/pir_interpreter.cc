@@ -14,12 +14,14 @@
 
 #include "paddle/fluid/framework/new_executor/pir_interpreter.h"
 
+#include <algorithm>
 #include <chrono>
 #include <unordered_set>
 
 #include "paddle/common/flags.h"
 
 #include "paddle/fluid/framework/details/nan_inf_utils.h"
+#include "paddle/fluid/framework/new_executor/garbage_collector/fast_garbage_collector.h"
 #include "paddle/fluid/framework/new_executor/interpreter/interpreter_util.h"
 #include "paddle/fluid/framework/new_executor/interpreter/static_build.h"
 #include "paddle/fluid/framework/operator.h"
@@ -89,6 +91,10 @@ COMMON_DECLARE_bool(enable_pir_in_executor_trace_run);
 COMMON_DECLARE_bool(enable_collect_shape);
 COMMON_DECLARE_int32(low_precision_op_list);
 COMMON_DECLARE_bool(pir_interpreter_record_stream_for_gc_cache);
+COMMON_DECLARE_bool(pir_interpreter_static_memory_plan);
+COMMON_DECLARE_bool(pir_interpreter_shape_bucket_plan);
+COMMON_DECLARE_int64(pir_interpreter_shape_bucket_granularity);
+COMMON_DECLARE_bool(pir_interpreter_sequential_run);
 
 #define CREATE_INSTR(instr_name)                                   \
   vec_instruction_base_.emplace_back(std::make_unique<instr_name>( \
@@ -111,6 +117,14 @@ void RecordLowPrecisionOp(const InstructionBase* instr_node) {
   }
 }
 
+// Limits of the programs run by PirInterpreter::SequentialRunImpl.
+constexpr size_t kSequentialRunMaxInstrNum = 256;
+constexpr double kSequentialRunMaxParallelism = 1.5;
+
+// Limits of the memory plans kept by PirInterpreter::SelectShapeBucketPlan.
+constexpr size_t kShapeBucketMaxPlanNum = 8;
+constexpr size_t kShapeBucketMaxReplanNum = 4;
+
 bool UseTraceRun(const ExecutionConfig& execution_config,
                  size_t onednn_op_num,
                  size_t sync_op_num) {
@@ -350,6 +364,13 @@ const VariableScope* PirInterpreter::GetVariableScope() const {
 }
 
 void PirInterpreter::reset_scope(Scope* new_scope) {
+  // The planned tensors of the old scope give their slices back, the plan
+  // keeps working on the variables of the new scope.
+  bool apply_memory_plan =
+      static_memory_planner_ && !static_memory_planner_->IsProfiling();
+  if (apply_memory_plan) {
+    static_memory_planner_->Detach();
+  }
   var_scope_.SetScope(new_scope);
   scope_ = new_scope;
   for (size_t i = 0; i < value_exe_info_->GetVarList().size(); i++) {
@@ -366,6 +387,15 @@ void PirInterpreter::reset_scope(Scope* new_scope) {
        i++) {
     refs_[i]->ResetVariable(value_exe_info_->GetVarList()[i]);
   }
+  // The plans of the other shape buckets are kept, they are detached and
+  // apply to the current variables when their bucket comes back.
+  if (apply_memory_plan) {
+    static_memory_planner_->Apply();
+  } else if (static_memory_planner_) {
+    // A run stopped while profiling, profile again in the new scope.
+    static_memory_planner_ = std::make_unique<interpreter::StaticMemoryPlanner>(
+        place_, value_exe_info_.get());
+  }
 }
 
 const Scope* PirInterpreter::local_scope() const { return local_scope_; }
@@ -488,6 +518,155 @@ void PirInterpreter::ClearDenseTensorArrayInLocalScope() {
   }
 }
 
+void PirInterpreter::PrepareStaticMemoryPlan() {
+  static_memory_planner_.reset();
+  shape_bucket_var_names_.clear();
+  shape_bucket_plans_.clear();
+  if (!FLAGS_pir_interpreter_static_memory_plan ||
+      FLAGS_new_executor_use_cuda_graph ||
+      !UseTraceRun(execution_config_, onednn_op_num_, sync_op_num_) ||
+      onednn_op_num_ > 0) {
+    return;
+  }
+  // The plan relies on the instructions running in the same order on one
+  // stream in every run, which control flow and multiple streams break.
+  const phi::DeviceContext* dev_ctx = nullptr;
+  for (auto& instr : vec_instruction_base_) {
+    if (instr->Operation()->num_regions() > 0) {
+      VLOG(4) << "Skip static memory plan for control flow op "
+              << instr->Name();
+      return;
+    }
+    if (instr->KernelType() == OpFuncType::kCpuSync) {
+      continue;
+    }
+    if (dev_ctx == nullptr) {
+      dev_ctx = &instr->DeviceContext();
+    } else if (dev_ctx != &instr->DeviceContext()) {
+      VLOG(4) << "Skip static memory plan for multiple streams";
+      return;
+    }
+  }
+  static_memory_planner_ = std::make_unique<interpreter::StaticMemoryPlanner>(
+      place_, value_exe_info_.get());
+
+  if (FLAGS_pir_interpreter_shape_bucket_plan) {
+    for (auto& op : *ir_block_) {
+      if (!op.HasAttribute("op_name") || op.num_results() == 0) {
+        continue;
+      }
+      auto op_name = op.attribute<::pir::StrAttribute>("op_name").AsString();
+      if (op_name != "pd_op.data" && op_name != "pd_op.feed") {
+        continue;
+      }
+      shape_bucket_var_names_.push_back(
+          op.attribute<::pir::StrAttribute>("name").AsString());
+    }
+    shape_bucket_plans_.emplace_back();
+    shape_bucket_plans_.front().key = ShapeBucketKey();
+  }
+}
+
+void PirInterpreter::BuildStaticMemoryPlan() {
+  if (!static_memory_planner_ || !static_memory_planner_->IsProfiling()) {
+    return;
+  }
+  // Only the vars which would be garbage collected are planned, others may be
+  // read after the run.
+  std::unordered_set<std::string> fetch_var_names(fetch_var_names_.begin(),
+                                                  fetch_var_names_.end());
+  std::unordered_set<size_t> candidate_var_ids;
+  for (auto& instr : vec_instruction_base_) {
+    for (size_t var_id : instr->GCCheckVars()) {
+      const std::string& var_name =
+          value_exe_info_->GetNameById(static_cast<int>(var_id));
+      if (parameter_var_names_.count(var_name) ||
+          fetch_var_names.count(var_name)) {
+        continue;
+      }
+      candidate_var_ids.insert(var_id);
+    }
+  }
+  static_memory_planner_->Plan(candidate_var_ids);
+}
+
+std::vector<int64_t> PirInterpreter::ShapeBucketKey() const {
+  // The inputs are looked up by name like FeedInput does, so the key sees
+  // the tensors fed to this run.
+  std::vector<int64_t> key;
+  for (const auto& var_name : shape_bucket_var_names_) {
+    Variable* var = InnerScope()->FindVar(var_name);
+    if (var == nullptr || !var->IsType<phi::DenseTensor>()) {
+      key.push_back(-1);
+      continue;
+    }
+    const auto& dims = var->Get<phi::DenseTensor>().dims();
+    key.push_back(dims.size());
+    for (int i = 0; i < dims.size(); ++i) {
+      key.push_back(interpreter::ShapeBucketDim(
+          dims[i], FLAGS_pir_interpreter_shape_bucket_granularity));
+    }
+  }
+  return key;
+}
+
+// Selects the memory plan of the bucket of the current input shapes before a
+// run. A new bucket, or one whose plan was outgrown, gets a new planner which
+// profiles the run.
+void PirInterpreter::SelectShapeBucketPlan() {
+  if (!static_memory_planner_ || shape_bucket_plans_.empty()) {
+    return;
+  }
+  std::vector<int64_t> key = ShapeBucketKey();
+  if (key != shape_bucket_plans_.front().key) {
+    static_memory_planner_->Detach();
+    shape_bucket_plans_.front().planner = std::move(static_memory_planner_);
+    auto iter = std::find_if(
+        shape_bucket_plans_.begin(),
+        shape_bucket_plans_.end(),
+        [&](const ShapeBucketPlan& plan) { return plan.key == key; });
+    if (iter != shape_bucket_plans_.end()) {
+      shape_bucket_plans_.splice(
+          shape_bucket_plans_.begin(), shape_bucket_plans_, iter);
+      static_memory_planner_ = std::move(shape_bucket_plans_.front().planner);
+      static_memory_planner_->Apply();
+    } else {
+      VLOG(4) << "Profile the memory plan of a new shape bucket";
+      shape_bucket_plans_.emplace_front();
+      shape_bucket_plans_.front().key = std::move(key);
+      static_memory_planner_ =
+          std::make_unique<interpreter::StaticMemoryPlanner>(
+              place_, value_exe_info_.get());
+      if (shape_bucket_plans_.size() > kShapeBucketMaxPlanNum) {
+        shape_bucket_plans_.pop_back();
+      }
+    }
+  }
+
+  ShapeBucketPlan& plan = shape_bucket_plans_.front();
+  if (static_memory_planner_->IsOutgrown() &&
+      plan.replan_num < kShapeBucketMaxReplanNum) {
+    VLOG(4) << "Profile the memory plan of an outgrown shape bucket";
+    ++plan.replan_num;
+    auto sizes = static_memory_planner_->PlannedSizes();
+    static_memory_planner_->Detach();
+    static_memory_planner_ = std::make_unique<interpreter::StaticMemoryPlanner>(
+        place_, value_exe_info_.get());
+    static_memory_planner_->ReserveSizes(sizes);
+  }
+}
+
+void PirInterpreter::FinishStaticMemoryPlan() {
+  if (!static_memory_planner_) {
+    return;
+  }
+  if (static_memory_planner_->IsProfiling()) {
+    BuildStaticMemoryPlan();
+  } else {
+    static_memory_planner_->CheckAfterRun();
+  }
+}
+
 std::string PirInterpreter::GetDepsString() const {
   std::stringstream ss;
   auto downstream_map = ir_dependency_builder_.OpDownstreamMap();
@@ -517,6 +696,11 @@ std::string PirInterpreter::GetNameByValue(::pir::Value value) const {
   return value_exe_info_->GetVarName(value);
 }
 
+bool PirInterpreter::IsStaticMemoryPlanned(::pir::Value value) const {
+  return static_memory_planner_ && value_exe_info_->HasValue(value) &&
+         static_memory_planner_->IsPlanned(value_exe_info_->GetVarId(value));
+}
+
 void PirInterpreter::UpdateSyncOpNum() {
   int64_t sync_op_num = 0;
   for (auto& ins : vec_instruction_base_) {
@@ -1251,6 +1435,10 @@ void PirInterpreter::RecordStreamForGC(InstructionBase* instr) {
       continue;
     }
 
+    if (static_memory_planner_ && static_memory_planner_->IsPlanned(var_id)) {
+      continue;
+    }
+
     paddle::framework::Variable* var = value_exe_info_->GetVarList()[var_id];
     if (var == nullptr) {
       continue;
@@ -1317,6 +1505,13 @@ void PirInterpreter::CheckGC(InstructionBase* instr) {
       continue;
     }
 
+    // planned var keeps its slice of the arena across runs
+    if (static_memory_planner_ && static_memory_planner_->IsPlanned(var_id)) {
+      VLOG(4) << value_exe_info_->GetNameById(static_cast<int>(var_id))
+              << " is planned in the arena, skip gc";
+      continue;
+    }
+
     if (is_ready) {
       VLOG(6) << "Async delete variable with name : "
               << value_exe_info_->GetNameById(static_cast<int>(var_id));
@@ -1526,21 +1721,32 @@ paddle::framework::FetchList PirInterpreter::Run(
 
     if (UseTraceRun(execution_config_, onednn_op_num_, sync_op_num_)) {
       LOG_FIRST_N(INFO, 1) << "pir interpreter is running by trace mode ...";
+      PrepareStaticMemoryPlan();
       TraceRunImpl();
+      BuildStaticMemoryPlan();
     } else {
       LOG_FIRST_N(INFO, 1)
           << "pir interpreter is running by multi-thread mode ...";
       MultiThreadRunImpl();
     }
 
+    PrepareSequentialRun();
+
     is_build_ = true;
     is_shared_results_build_ = true;
   } else {
-    if (UseTraceRun(execution_config_, onednn_op_num_, sync_op_num_)) {
+    SelectShapeBucketPlan();
+    // The memory is profiled by the instructions run by trace mode.
+    bool profile_memory =
+        static_memory_planner_ && static_memory_planner_->IsProfiling();
+    if (UseSequentialRun() && !profile_memory) {
+      SequentialRunImpl();
+    } else if (UseTraceRun(execution_config_, onednn_op_num_, sync_op_num_)) {
       TraceRunImpl();
     } else {
       MultiThreadRunImpl();
     }
+    FinishStaticMemoryPlan();
   }
 
   if (HasLocalScope()) {
@@ -1605,21 +1811,32 @@ FetchList PirInterpreter::Run(const std::vector<std::string>& feed_names,
     // Run
     if (UseTraceRun(execution_config_, onednn_op_num_, sync_op_num_)) {
       LOG_FIRST_N(INFO, 1) << "pir interpreter is running by trace mode ...";
+      PrepareStaticMemoryPlan();
       TraceRunImpl();
+      BuildStaticMemoryPlan();
     } else {
       LOG_FIRST_N(INFO, 1)
           << "pir interpreter is running by multi-thread mode ...";
       MultiThreadRunImpl();
     }
 
+    PrepareSequentialRun();
+
     is_build_ = true;
     is_shared_results_build_ = true;
   } else {
-    if (UseTraceRun(execution_config_, onednn_op_num_, sync_op_num_)) {
+    SelectShapeBucketPlan();
+    // The memory is profiled by the instructions run by trace mode.
+    bool profile_memory =
+        static_memory_planner_ && static_memory_planner_->IsProfiling();
+    if (UseSequentialRun() && !profile_memory) {
+      SequentialRunImpl();
+    } else if (UseTraceRun(execution_config_, onednn_op_num_, sync_op_num_)) {
       TraceRunImpl();
     } else {
       MultiThreadRunImpl();
     }
+    FinishStaticMemoryPlan();
   }
 
   if (HasLocalScope()) {
@@ -1642,6 +1859,127 @@ FetchList PirInterpreter::Run(const std::vector<std::string>& feed_names,
   return fetch_res;
 }
 
+void PirInterpreter::PrepareSequentialRun() {
+  sequential_run_prepared_ = false;
+  sequential_instrs_.clear();
+  sequential_free_vars_.clear();
+  size_t instr_num = vec_instruction_base_.size();
+  if (!FLAGS_pir_interpreter_sequential_run || !phi::is_cpu_place(place_) ||
+      onednn_op_num_ > 0 || instr_num == 0 ||
+      instr_num > kSequentialRunMaxInstrNum ||
+      trace_execute_order_.size() != instr_num) {
+    return;
+  }
+  for (auto& instr : vec_instruction_base_) {
+    if (instr->Operation()->num_regions() > 0 ||
+        instr->KernelType() != OpFuncType::kCpuSync) {
+      return;
+    }
+  }
+
+  // Multi-thread mode only pays off if the program has enough independent
+  // instructions, estimated by the instruction number over the length of
+  // the longest dependency chain.
+  if (!UseTraceRun(execution_config_, onednn_op_num_, sync_op_num_)) {
+    const auto& downstream_map = ir_dependency_builder_.OpDownstreamMap();
+    std::vector<size_t> depth(instr_num, 1);
+    size_t critical_path_len = 0;
+    for (size_t instr_id : trace_execute_order_) {
+      critical_path_len = std::max(critical_path_len, depth[instr_id]);
+      auto iter = downstream_map.find(instr_id);
+      if (iter == downstream_map.end()) {
+        continue;
+      }
+      for (size_t next_id : iter->second) {
+        depth[next_id] = std::max(depth[next_id], depth[instr_id] + 1);
+      }
+    }
+    double parallelism = static_cast<double>(instr_num) /
+                         static_cast<double>(critical_path_len);
+    if (parallelism > kSequentialRunMaxParallelism) {
+      VLOG(4) << "Skip sequential run for parallelism " << parallelism;
+      return;
+    }
+  }
+
+  // A var is freed after the last of its last live instructions in the trace
+  // order, like refs_ does, unless an artificial instruction uses it.
+  std::unordered_map<size_t, size_t> free_steps;
+  std::unordered_set<size_t> never_free_vars;
+  for (size_t step = 0; step < instr_num; ++step) {
+    InstructionBase* instr =
+        vec_instruction_base_[trace_execute_order_[step]].get();
+    sequential_instrs_.push_back(instr);
+    for (size_t var_id : instr->GCCheckVars()) {
+      if (instr->IsArtificial()) {
+        never_free_vars.insert(var_id);
+      } else if (!parameter_var_names_.count(value_exe_info_->GetNameById(
+                     static_cast<int>(var_id)))) {
+        free_steps[var_id] = step;
+      }
+    }
+  }
+  sequential_free_vars_.resize(instr_num);
+  for (auto& item : free_steps) {
+    if (!never_free_vars.count(item.first)) {
+      sequential_free_vars_[item.second].push_back(item.first);
+    }
+  }
+  for (auto& var_ids : sequential_free_vars_) {
+    std::sort(var_ids.begin(), var_ids.end());
+  }
+  sequential_run_prepared_ = true;
+  VLOG(4) << "Prepared sequential run for " << instr_num << " instructions";
+}
+
+bool PirInterpreter::UseSequentialRun() const {
+  // Features hooked into RunInstructionBase are not supported.
+  return sequential_run_prepared_ && !enable_job_schedule_profiler_ &&
+         !FLAGS_enable_collect_shape && !FLAGS_low_precision_op_list &&
+         pir_input_hookfuncs_.empty() && pir_output_hookfuncs_.empty();
+}
+
+void PirInterpreter::SequentialRunImpl() {
+  if (!sequential_gc_) {
+    sequential_gc_ = std::make_unique<InterpreterCoreFastGarbageCollector>();
+  }
+  VLOG(4) << "Sequential Run Instruction List";
+
+  const auto& var_list = value_exe_info_->GetVarList();
+  for (size_t step = 0; step < sequential_instrs_.size(); ++step) {
+    InstructionBase* instr_node = sequential_instrs_[step];
+    if (!instr_node->IsArtificial()) {
+      phi::RecordEvent instruction_event(
+          instr_node->Name(), phi::TracerEventType::Operator, 1);
+      try {
+        instr_node->Run();
+      } catch (platform::EnforceNotMet& ex) {
+        auto* op = instr_node->Operation();
+        framework::InsertCallStackInfo(
+            op->name(),
+            interpreter::GetInstructionCallStack(op->name(), op->attributes()),
+            &ex);
+        throw;
+      }
+      if (FLAGS_check_nan_inf) {
+        CheckTensorHasNanOrInf(instr_node, scope_, value_exe_info_.get());
+      }
+    }
+
+    for (size_t var_id : sequential_free_vars_[step]) {
+      if (static_memory_planner_ && static_memory_planner_->IsPlanned(var_id)) {
+        continue;
+      }
+      sequential_gc_->Add(var_list[var_id], instr_node);
+    }
+    for (auto var : instr_node->EagerGCVars()) {
+      sequential_gc_->Add(var, instr_node);
+    }
+    instr_node->ClearEagerGCVars();
+  }
+  VLOG(4) << "Done Sequential Run Instruction List";
+}
+
 void PirInterpreter::TraceRunImpl() {
   // lazy initialization of gc, do not create gc is the program only run once
   if (!gc_) {
@@ -1672,6 +2010,15 @@ void PirInterpreter::MultiThreadRunImpl() {
   async_work_queue_ = GetWorkQueue();
   MultiThreadRunInstructionList(vec_instruction_base_);
   VLOG(4) << "Done MultiThreadRunInstructionList";
+  if (FLAGS_new_executor_locality_aware_schedule && VLOG_IS_ON(4)) {
+    auto stats = async_work_queue_->QueueWorkerStats(0);
+    for (size_t i = 0; i < stats.size(); ++i) {
+      VLOG(4) << "Host worker " << i << ": tasks " << stats[i].tasks
+              << ", local steals " << stats[i].local_steals
+              << ", global steals " << stats[i].global_steals
+              << ", idle waits " << stats[i].idle_waits;
+    }
+  }
 #ifdef PADDLE_WITH_CUSTOM_DEVICE
   if (phi::is_custom_place(place_)) {
     phi::DeviceContextPool::Instance().Get(place_)->Wait();
@@ -1876,17 +2223,30 @@ void PirInterpreter::RunNextInstructions(InstructionBase* instr,
     return deps_[next_id]->CheckAndDecrease();
   };
 
-  for (size_t next_instr_id : instr->NextInstrsInDifferenceThread()) {
+  for (size_t next_instr_id : instr->NextInstrsInSameThread()) {
     if (IsReady(next_instr_id)) {
-      async_work_queue_->AddTask(
-          vec_instruction_base_[next_instr_id]->KernelType(),
-          [this, next_instr_id]() { RunInstructionBaseAsync(next_instr_id); });
+      reserved_next_ops->push(next_instr_id);
     }
   }
 
-  for (size_t next_instr_id : instr->NextInstrsInSameThread()) {
+  // Continuation passing: if this worker has nothing left to run, keep one
+  // ready host successor instead of handing it to the queue, so that it runs
+  // while the outputs of instr are still in the cache of this worker.
+  bool keep_one = FLAGS_new_executor_locality_aware_schedule &&
+                  instr->KernelType() != OpFuncType::kGpuAsync &&
+                  reserved_next_ops->empty();
+  for (size_t next_instr_id : instr->NextInstrsInDifferenceThread()) {
     if (IsReady(next_instr_id)) {
-      reserved_next_ops->push(next_instr_id);
+      OpFuncType kernel_type =
+          vec_instruction_base_[next_instr_id]->KernelType();
+      if (keep_one && kernel_type != OpFuncType::kGpuAsync) {
+        reserved_next_ops->push(next_instr_id);
+        keep_one = false;
+        continue;
+      }
+      async_work_queue_->AddTask(kernel_type, [this, next_instr_id]() {
+        RunInstructionBaseAsync(next_instr_id);
+      });
     }
   }
 }
@@ -1937,6 +2297,11 @@ void PirInterpreter::RunInstructionBase(InstructionBase* instr_node) {
     }
 
     if (!instr_node->IsArtificial()) {
+      bool profile_memory = static_memory_planner_ != nullptr &&
+                            static_memory_planner_->IsProfiling();
+      if (profile_memory) {
+        static_memory_planner_->BeforeRun(*instr_node);
+      }
       {
         phi::RecordEvent record(
             "InstrRun", phi::TracerEventType::UserDefined, 10);
@@ -1964,6 +2329,9 @@ void PirInterpreter::RunInstructionBase(InstructionBase* instr_node) {
               << " runs on " << phi::GetCurrentThreadName() << "\n"
               << "After: " << cur_place << " "
               << instr_node->DebugStringEx(scope_, value_exe_info_.get());
+      if (profile_memory) {
+        static_memory_planner_->AfterRun(*instr_node);
+      }
       CheckGC(instr_node);
       VLOG(4) << "done CheckGC";
       memory::LogDeviceMemoryStats(cur_place, instr_node->Name());
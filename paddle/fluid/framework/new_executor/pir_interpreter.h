@@ -13,8 +13,10 @@
 // limitations under the License.
 
 #pragma once
+#include <list>
 #include <memory>
 #include "paddle/fluid/framework/new_executor/instruction/instruction_base.h"
+#include "paddle/fluid/framework/new_executor/interpreter/static_memory_plan.h"
 #include "paddle/fluid/framework/new_executor/interpreter_base_impl.h"
 #include "paddle/pir/include/core/value.h"
 
@@ -110,6 +112,18 @@ class PirInterpreter : public InterpreterBaseImpl {
 
   std::string GetNameByValue(::pir::Value value) const;
 
+  // Whether the runs after the first one execute the instructions in trace
+  // order on the calling thread, see PrepareSequentialRun.
+  bool UseSequentialRun() const;
+
+  // The memory plan in use, null if the program is not planned.
+  const interpreter::StaticMemoryPlanner* GetStaticMemoryPlanner() const {
+    return static_memory_planner_.get();
+  }
+
+  // Whether the memory plan in use gives the variable of `value` a slice.
+  bool IsStaticMemoryPlanned(::pir::Value value) const;
+
   // Only for debug
   Variable* DebugVar(const std::string& name) const override;
 
@@ -140,6 +154,17 @@ class PirInterpreter : public InterpreterBaseImpl {
   // gc
   void ClearDenseTensorArrayInLocalScope();
 
+  // static memory plan
+  void PrepareStaticMemoryPlan();
+  void BuildStaticMemoryPlan();
+  std::vector<int64_t> ShapeBucketKey() const;
+  void SelectShapeBucketPlan();
+  void FinishStaticMemoryPlan();
+
+  // sequential run
+  void PrepareSequentialRun();
+  void SequentialRunImpl();
+
   // cuda graph
   void CheckCUDAGraphBeforeRun(const std::vector<std::string>& feed_names);
   void PrepareForCUDAGraphCapture();
@@ -189,6 +214,30 @@ class PirInterpreter : public InterpreterBaseImpl {
 
   std::unique_ptr<InterpreterCoreGarbageCollector> gc_;
 
+  // not null only if FLAGS_pir_interpreter_static_memory_plan is enabled and
+  // the program can be planned, see PrepareStaticMemoryPlan
+  std::unique_ptr<interpreter::StaticMemoryPlanner> static_memory_planner_;
+
+  // used for shape bucket plans, see SelectShapeBucketPlan
+  struct ShapeBucketPlan {
+    std::vector<int64_t> key;
+    // null for the bucket in use, whose planner is static_memory_planner_
+    std::unique_ptr<interpreter::StaticMemoryPlanner> planner;
+    size_t replan_num{0};
+  };
+  // the names of the data and feed vars deciding the shape bucket
+  std::vector<std::string> shape_bucket_var_names_;
+  // the most recently used bucket first
+  std::list<ShapeBucketPlan> shape_bucket_plans_;
+
+  // used for sequential run, see PrepareSequentialRun
+  bool sequential_run_prepared_{false};
+  std::vector<InstructionBase*> sequential_instrs_;
+  // sequential_free_vars_[i] contains the id of vars which are last used by
+  // sequential_instrs_[i]
+  std::vector<std::vector<size_t>> sequential_free_vars_;
+  std::unique_ptr<InterpreterCoreGarbageCollector> sequential_gc_;
+
   // last_live_ops_[i] contains the id of operators that last access the i-th
   // var
   std::map<size_t, std::set<size_t>> last_live_ops_;
@@ -11,12 +11,14 @@
 
 #include <atomic>
 #include <cstdlib>
+#include <utility>
 #include <vector>
 
 #include "glog/logging.h"
 #include "paddle/fluid/framework/new_executor/workqueue/event_count.h"
 #include "paddle/fluid/framework/new_executor/workqueue/run_queue.h"
 #include "paddle/fluid/framework/new_executor/workqueue/thread_environment.h"
+#include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 #include "paddle/phi/core/os_info.h"
 #include "paddle/phi/core/platform/profiler/event_tracing.h"
 
@@ -33,10 +35,12 @@ class ThreadPoolTempl {
                   int num_threads,
                   bool allow_spinning,
                   bool always_spinning,
+                  bool locality_aware = false,
                   Environment env = Environment())
       : env_(env),
         allow_spinning_(allow_spinning),
         always_spinning_(always_spinning),
+        locality_aware_(locality_aware),
         global_steal_partition_(EncodePartition(0, num_threads)),
         blocked_(0),
         done_(false),
@@ -60,6 +64,12 @@ class ThreadPoolTempl {
     }
     for (int i = 0; i < num_threads_; i++) {
       SetStealPartition(i, EncodePartition(0, num_threads_));
+      thread_data_[i].domain_steal_partition = global_steal_partition_;
+    }
+    if (locality_aware_ && num_threads_ > 1) {
+      SetLocalityPartitions();
+    }
+    for (int i = 0; i < num_threads_; i++) {
       thread_data_[i].thread.reset(
           env_.CreateThread([this, i]() { WorkerLoop(i); }));
     }
@@ -156,6 +166,42 @@ class ThreadPoolTempl {
 
   size_t NumThreads() const { return num_threads_; }
 
+  // Counters are updated by the workers without synchronization, the result
+  // is a snapshot for profiling only.
+  std::vector<WorkerStats> GetWorkerStats() const {
+    std::vector<WorkerStats> stats(num_threads_);
+    for (int i = 0; i < num_threads_; i++) {
+      const ThreadData& td = thread_data_[i];
+      stats[i].tasks = td.tasks.load(std::memory_order_relaxed);
+      stats[i].local_steals = td.local_steals.load(std::memory_order_relaxed);
+      stats[i].global_steals = td.global_steals.load(std::memory_order_relaxed);
+      stats[i].idle_waits = td.idle_waits.load(std::memory_order_relaxed);
+    }
+    return stats;
+  }
+
+  // The workers [first, second) which worker i steals from before trying
+  // the whole pool, and the ones sharing its L3 cache, see
+  // SetLocalityPartitions.
+  std::pair<unsigned, unsigned> StealPartition(int i) const {
+    std::pair<unsigned, unsigned> partition;
+    DecodePartition(
+        thread_data_[i].steal_partition.load(std::memory_order_relaxed),
+        &partition.first,
+        &partition.second);
+    return partition;
+  }
+  std::pair<unsigned, unsigned> DomainStealPartition(int i) const {
+    std::pair<unsigned, unsigned> partition;
+    DecodePartition(thread_data_[i].domain_steal_partition,
+                    &partition.first,
+                    &partition.second);
+    return partition;
+  }
+
+  // The logical cpu worker i is bound to, -1 for none.
+  int WorkerCpu(int i) const { return thread_data_[i].cpu; }
+
   int CurrentThreadId() const {
     const PerThread* pt = const_cast<ThreadPoolTempl*>(this)->GetPerThread();
     if (pt->pool == this) {
@@ -180,7 +226,9 @@ class ThreadPoolTempl {
     return (start << kMaxPartitionBits) | limit;
   }
 
-  inline void DecodePartition(unsigned val, unsigned* start, unsigned* limit) {
+  inline void DecodePartition(unsigned val,
+                              unsigned* start,
+                              unsigned* limit) const {
     *limit = val & (kMaxThreads - 1);
     val >>= kMaxPartitionBits;
     *start = val;
@@ -229,12 +277,23 @@ class ThreadPoolTempl {
     constexpr ThreadData() : thread(), steal_partition(0), queue() {}
     std::unique_ptr<Thread> thread;
     std::atomic<unsigned> steal_partition;
+    // The workers sharing the L3 cache, only differs from the global
+    // partition if locality_aware_.
+    unsigned domain_steal_partition{0};
+    // The logical cpu the worker is bound to, -1 for none.
+    int cpu{-1};
     Queue queue;
+    // Only written by the worker itself.
+    std::atomic<uint64_t> tasks{0};
+    std::atomic<uint64_t> local_steals{0};
+    std::atomic<uint64_t> global_steals{0};
+    std::atomic<uint64_t> idle_waits{0};
   };
 
   Environment env_;
   const bool allow_spinning_;
   const bool always_spinning_;
+  const bool locality_aware_;
   std::vector<std::vector<unsigned>> all_coprimes_;
   unsigned global_steal_partition_;
   std::atomic<unsigned> blocked_;
@@ -254,7 +313,11 @@ class ThreadPoolTempl {
     pt->pool = this;
     pt->rand = GlobalThreadIdHash();
     pt->thread_id = thread_id;
-    Queue& q = thread_data_[thread_id].queue;
+    ThreadData& td = thread_data_[thread_id];
+    if (td.cpu >= 0 && !BindCurrentThreadToCpu(td.cpu)) {
+      VLOG(1) << thr_name << " failed to bind to cpu " << td.cpu;
+    }
+    Queue& q = td.queue;
     EventCount::Waiter* waiter = ec_.GetWaiter(thread_id);
     // TODO(dvyukov,rmlarsen): The time spent in NonEmptyQueueIndex() is
     // proportional to num_threads_ and we assume that new work is scheduled at
@@ -282,6 +345,7 @@ class ThreadPoolTempl {
           }
         }
         if (t.f) {
+          Increase(&td.tasks);
           env_.ExecuteTask(t);
         }
       }
@@ -290,9 +354,16 @@ class ThreadPoolTempl {
         Task t = q.PopFront();
         if (!t.f) {
           t = LocalSteal();
-          if (!t.f) {
+          if (!t.f && locality_aware_) {
+            t = DomainSteal();
+          }
+          if (t.f) {
+            Increase(&td.local_steals);
+          } else {
             t = GlobalSteal();
-            if (!t.f) {
+            if (t.f) {
+              Increase(&td.global_steals);
+            } else {
               if (allow_spinning_) {
                 for (int i = 0; i < spin_count && !t.f; i++) {
                   if (!cancelled_.load(std::memory_order_relaxed)) {
@@ -302,21 +373,70 @@ class ThreadPoolTempl {
                   }
                 }
               }
-              if (!t.f) {
-                if (!WaitForWork(waiter, &t)) {
-                  return;
-                }
+              if (t.f) {
+                Increase(&td.global_steals);
+              } else if (!WaitForWork(waiter, &t)) {
+                return;
               }
             }
           }
         }
         if (t.f) {
+          Increase(&td.tasks);
           env_.ExecuteTask(t);
         }
       }
     }
   }
 
+  static inline void Increase(std::atomic<uint64_t>* counter) {
+    counter->store(counter->load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+
+  // Binds the workers to adjacent logical cpus, so that neighboring workers
+  // share caches, then limits LocalSteal to the workers sharing the L2 cache
+  // and DomainSteal to those sharing the L3 cache. Pools take consecutive
+  // blocks of cpus, so that the pools of one process do not stack on the
+  // first cpus.
+  void SetLocalityPartitions() {
+    static std::atomic<size_t> next_cpu_index{0};
+    const CpuCacheTopology& topology = GetCpuCacheTopology();
+    const size_t num_cpus = topology.cpus.size();
+    const size_t first = next_cpu_index.fetch_add(num_threads_) % num_cpus;
+    std::vector<int> l2_domain(num_threads_), l3_domain(num_threads_);
+    for (int i = 0; i < num_threads_; i++) {
+      size_t index = (first + i) % num_cpus;
+      thread_data_[i].cpu = topology.cpus[index];
+      // Workers in different rounds over the cpus are never neighbors, even
+      // if they share a cpu.
+      int round = static_cast<int>((first + i) / num_cpus * num_cpus);
+      l2_domain[i] = round + topology.l2_domain[index];
+      l3_domain[i] = round + topology.l3_domain[index];
+    }
+    auto set_partitions = [&](const std::vector<int>& domain,
+                              std::vector<unsigned>* partitions) {
+      partitions->resize(num_threads_);
+      int start = 0;
+      for (int i = 1; i <= num_threads_; i++) {
+        if (i == num_threads_ || domain[i] != domain[start]) {
+          for (int j = start; j < i; j++) {
+            (*partitions)[j] = EncodePartition(start, i);
+          }
+          start = i;
+        }
+      }
+    };
+    std::vector<unsigned> l2_partitions, l3_partitions;
+    set_partitions(l2_domain, &l2_partitions);
+    set_partitions(l3_domain, &l3_partitions);
+    for (int i = 0; i < num_threads_; i++) {
+      SetStealPartition(i, l2_partitions[i]);
+      thread_data_[i].domain_steal_partition = l3_partitions[i];
+      VLOG(4) << name_ << " worker " << i << " on cpu " << thread_data_[i].cpu;
+    }
+  }
+
   // Steal tries to steal work from other worker threads in the range [start,
   // limit) in best-effort manner.
   Task Steal(unsigned start, unsigned limit) {
@@ -359,6 +479,22 @@ class ThreadPoolTempl {
     return Steal(start, limit);
   }
 
+  // Steals work within threads sharing the L3 cache, if it is not the same
+  // as the partition of LocalSteal or the whole pool.
+  Task DomainSteal() {
+    PerThread* pt = GetPerThread();
+    unsigned partition = thread_data_[pt->thread_id].domain_steal_partition;
+    if (global_steal_partition_ == partition ||
+        GetStealPartition(pt->thread_id) == partition) {
+      return Task();
+    }
+    unsigned start, limit;
+    DecodePartition(partition, &start, &limit);
+    AssertBounds(start, limit);
+
+    return Steal(start, limit);
+  }
+
   // Steals work from any other thread in the pool.
   Task GlobalSteal() { return Steal(0, num_threads_); }
 
@@ -423,6 +559,7 @@ class ThreadPoolTempl {
     // Wait for work
     phi::RecordEvent record(
         "WaitForWork", phi::TracerEventType::UserDefined, 10);
+    Increase(&thread_data_[GetPerThread()->thread_id].idle_waits);
     ec_.CommitWait(waiter);
     blocked_--;
     return true;
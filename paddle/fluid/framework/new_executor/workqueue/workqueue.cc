@@ -49,7 +49,8 @@ class WorkQueueImpl : public WorkQueue {
     queue_ = new NonblockingThreadPool(options_.name,
                                        static_cast<int>(options_.num_threads),
                                        options_.allow_spinning,
-                                       options_.always_spinning);
+                                       options_.always_spinning,
+                                       options_.locality_aware);
   }
 
   ~WorkQueueImpl() override {
@@ -80,6 +81,10 @@ class WorkQueueImpl : public WorkQueue {
 
   size_t NumThreads() const override { return queue_->NumThreads(); }
 
+  std::vector<WorkerStats> GetWorkerStats() const override {
+    return queue_->GetWorkerStats();
+  }
+
  private:
   NonblockingThreadPool* queue_{nullptr};
   TaskTracker* tracker_{nullptr};
@@ -100,6 +105,8 @@ class WorkQueueGroupImpl : public WorkQueueGroup {
 
   size_t QueueGroupNumThreads() const override;
 
+  std::vector<WorkerStats> QueueWorkerStats(size_t queue_idx) const override;
+
   void Cancel() override;
 
  private:
@@ -141,7 +148,8 @@ WorkQueueGroupImpl::WorkQueueGroupImpl(
         NonblockingThreadPool(options.name,
                               static_cast<int>(options.num_threads),
                               options.allow_spinning,
-                              options.always_spinning);
+                              options.always_spinning,
+                              options.locality_aware);
   }
 }
 
@@ -192,6 +200,15 @@ size_t WorkQueueGroupImpl::QueueGroupNumThreads() const {
   return total_num;
 }
 
+std::vector<WorkerStats> WorkQueueGroupImpl::QueueWorkerStats(
+    size_t queue_idx) const {
+  assert(queue_idx < queues_.size());
+  if (!queues_.at(queue_idx)) {
+    return {};
+  }
+  return queues_.at(queue_idx)->GetWorkerStats();
+}
+
 void WorkQueueGroupImpl::Cancel() {
   for (auto queue : queues_) {
     if (queue) {
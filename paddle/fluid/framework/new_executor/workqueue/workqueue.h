@@ -21,6 +21,7 @@
 #include <type_traits>
 #include <vector>
 
+#include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 #include "paddle/fluid/platform/enforce.h"
 
 namespace paddle {
@@ -102,6 +103,9 @@ struct WorkQueueOptions {
   // false and set events_waiter.
   bool detached{true};
   EventsWaiter* events_waiter{nullptr};  // not owned
+  // Bind worker threads to adjacent cpus and steal tasks from the workers
+  // sharing the L2 cache, then the L3 cache, before any other worker.
+  bool locality_aware{false};
 };
 
 class WorkQueue {
@@ -136,6 +140,8 @@ class WorkQueue {
 
   virtual size_t NumThreads() const = 0;
 
+  virtual std::vector<WorkerStats> GetWorkerStats() const = 0;
+
   virtual void Cancel() = 0;
 
  protected:
@@ -178,6 +184,8 @@ class WorkQueueGroup {
 
   virtual size_t QueueGroupNumThreads() const = 0;
 
+  virtual std::vector<WorkerStats> QueueWorkerStats(size_t queue_idx) const = 0;
+
   virtual void Cancel() = 0;
 
  protected:
@@ -14,8 +14,20 @@
 
 #include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
+#include <map>
+#include <thread>  // NOLINT
+#include <tuple>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "glog/logging.h"
 
 namespace paddle::framework {
 
@@ -55,4 +67,101 @@ void AlignedFree(void* mem_ptr) {
 #endif
 }
 
+namespace {
+
+#if defined(__linux__)
+// Returns the shared_cpu_list of the cache of the given level used by the cpu,
+// or an empty string if it is unknown.
+std::string ReadSharedCpuList(int cpu, int level) {
+  const std::string cache_dir =
+      "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+  for (int index = 0; index < 8; ++index) {
+    std::ifstream level_file(cache_dir + std::to_string(index) + "/level");
+    int cache_level = 0;
+    if (!(level_file >> cache_level)) {
+      break;
+    }
+    if (cache_level != level) {
+      continue;
+    }
+    std::ifstream list_file(cache_dir + std::to_string(index) +
+                            "/shared_cpu_list");
+    std::string shared_cpu_list;
+    if (list_file >> shared_cpu_list) {
+      return shared_cpu_list;
+    }
+  }
+  return "";
+}
+#endif
+
+CpuCacheTopology DetectCpuCacheTopology() {
+  std::vector<int> cpus;
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpu_set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    int num_cpus = std::max(1U, std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < num_cpus; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  // Cpus listing the same sharing cpus use the same cache.
+  std::map<std::string, int> l2_ids, l3_ids;
+  std::vector<std::tuple<int, int, int>> domains;
+  for (int cpu : cpus) {
+    std::string l2_key = std::to_string(cpu), l3_key;
+#if defined(__linux__)
+    std::string l2_list = ReadSharedCpuList(cpu, 2);
+    if (!l2_list.empty()) {
+      l2_key = l2_list;
+    }
+    l3_key = ReadSharedCpuList(cpu, 3);
+#endif
+    int l2_id = l2_ids.emplace(l2_key, l2_ids.size()).first->second;
+    int l3_id = l3_ids.emplace(l3_key, l3_ids.size()).first->second;
+    domains.emplace_back(l3_id, l2_id, cpu);
+  }
+  std::sort(domains.begin(), domains.end());
+
+  CpuCacheTopology topology;
+  for (auto& domain : domains) {
+    topology.l3_domain.push_back(std::get<0>(domain));
+    topology.l2_domain.push_back(std::get<1>(domain));
+    topology.cpus.push_back(std::get<2>(domain));
+  }
+  VLOG(4) << "Detected " << topology.cpus.size() << " cpus in "
+          << l2_ids.size() << " L2 domains and " << l3_ids.size()
+          << " L3 domains";
+  return topology;
+}
+
+}  // namespace
+
+const CpuCacheTopology& GetCpuCacheTopology() {
+  static const CpuCacheTopology topology = DetectCpuCacheTopology();
+  return topology;
+}
+
+bool BindCurrentThreadToCpu(int cpu) {
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+#else
+  return false;
+#endif
+}
+
 }  // namespace paddle::framework
@@ -17,10 +17,12 @@
 #include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "paddle/fluid/framework/new_executor/workqueue/events_waiter.h"
 #include "paddle/fluid/platform/enforce.h"
@@ -69,6 +71,37 @@ void* AlignedMalloc(size_t size, size_t alignment);
 
 void AlignedFree(void* memory_ptr);
 
+// Scheduling counters of a worker thread of a work queue.
+struct WorkerStats {
+  // tasks run by the worker
+  uint64_t tasks{0};
+  // tasks stolen from the steal partition of the worker before trying the
+  // whole pool, that is the workers sharing the L2 or the L3 cache if the
+  // queue is locality aware
+  uint64_t local_steals{0};
+  // tasks stolen from any other worker
+  uint64_t global_steals{0};
+  // times the worker blocked waiting for new tasks
+  uint64_t idle_waits{0};
+};
+
+// The logical cpus this process may run on, ordered so that the cpus sharing
+// an L2 cache are adjacent, and so are the L2 domains sharing an L3 cache.
+// l2_domain[i] and l3_domain[i] identify the caches used by cpus[i]. The cache
+// topology is only read on Linux, elsewhere each cpu is an L2 domain of its
+// own and all cpus share one L3 domain.
+struct CpuCacheTopology {
+  std::vector<int> cpus;
+  std::vector<int> l2_domain;
+  std::vector<int> l3_domain;
+};
+
+const CpuCacheTopology& GetCpuCacheTopology();
+
+// Binds the calling thread to the logical cpu, returns false if it is not
+// supported or fails.
+bool BindCurrentThreadToCpu(int cpu);
+
 template <typename Notifier>
 class TaskTracker {
  public:
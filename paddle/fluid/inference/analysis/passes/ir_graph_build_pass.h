@@ -43,7 +43,8 @@ class IrGraphBuildPass : public AnalysisPass {
       framework::Scope *scope,
       const phi::Place &place,
       bool model_from_memory,
-      bool skip_load_params);
+      bool skip_load_params,
+      bool mmap_params);
 
   std::string model_binary_str_;
 };
@@ -19,6 +19,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/ir/fuse_pass_base.h"
 #include "paddle/fluid/framework/ir/graph_helper.h"
 #include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/inference/io.h"
 
 namespace paddle::inference::analysis {
 
@@ -66,6 +67,7 @@ void SaveOptimizedModelPass::SaveOptimizedModel(Argument* argument) {
     framework::ProgramDesc save_program;
     auto* save_block = save_program.MutableBlock(0);
     std::unordered_set<std::string> save_var_set;
+    bool all_dense_tensors = true;
     for (size_t i = 0; i < optimized_program_desc.Size(); ++i) {
       const auto& global_block = optimized_program_desc.Block(i);
       for (framework::VarDesc* var : global_block.AllVars()) {
@@ -77,6 +79,8 @@ void SaveOptimizedModelPass::SaveOptimizedModel(Argument* argument) {
           new_var->SetLoDLevel(var->GetLoDLevel());
           new_var->SetPersistable(true);
           save_var_set.insert(new_var->Name());
+          all_dense_tensors &=
+              var->GetType() == framework::proto::VarType::DENSE_TENSOR;
         }
       }
     }
@@ -85,6 +89,17 @@ void SaveOptimizedModelPass::SaveOptimizedModel(Argument* argument) {
     std::vector<std::string> save_var_list(save_var_set.begin(),
                                            save_var_set.end());
     std::sort(save_var_list.begin(), save_var_list.end());
+    if (argument->mmap_params_valid() && argument->mmap_params() &&
+        all_dense_tensors) {
+      // Save the parameters aligned, so that they are mapped in place when
+      // the optimized model is loaded.
+      std::vector<const phi::DenseTensor*> tensors;
+      for (auto& name : save_var_list) {
+        tensors.push_back(&scope.FindVar(name)->Get<phi::DenseTensor>());
+      }
+      SaveCombinedParamsForMmap(save_params_path, tensors);
+      return;
+    }
     auto* op = save_block->AppendOp();
     op->SetType("save_combine");
     op->SetInput("X", save_var_list);
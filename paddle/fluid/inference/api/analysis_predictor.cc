@@ -50,6 +50,7 @@
 #include "paddle/fluid/inference/api/paddle_inference_api.h"
 #include "paddle/fluid/inference/api/paddle_inference_pass.h"
 #include "paddle/fluid/inference/api/resource_manager.h"
+#include "paddle/fluid/inference/io.h"
 #include "paddle/fluid/inference/utils/io_utils.h"
 #include "paddle/fluid/inference/utils/model_utils.h"
 #include "paddle/fluid/inference/utils/singleton.h"
@@ -1254,8 +1255,12 @@ bool AnalysisPredictor::SaveOrLoadPirParameters(bool for_save) {
         GetOptimizedModelPath() + "/" + "_optimized.pdiparams";
     std::vector<const phi::DenseTensor *> const_tensor_out(tensor_out.begin(),
                                                            tensor_out.end());
-    pir::SaveCombineFunction(
-        const_tensor_out, param_names, optimized_params, true, false, true);
+    if (config_.mmap_params_) {
+      inference::SaveCombinedParamsForMmap(optimized_params, const_tensor_out);
+    } else {
+      pir::SaveCombineFunction(
+          const_tensor_out, param_names, optimized_params, true, false, true);
+    }
     LOG(INFO) << "Optimized params saved to " << optimized_params;
   } else {
     if (load_separate_params_) {
@@ -1317,6 +1322,8 @@ bool AnalysisPredictor::SaveOrLoadPirParameters(bool for_save) {
             tensor_out.end(), local_tensor_out.begin(), local_tensor_out.end());
       }
 
+    } else if (config_.mmap_params_ && phi::is_cpu_place(place_)) {
+      inference::LoadCombinedParamsByMmap(config_.params_file(), tensor_out);
     } else {
       pir::LoadCombineFunction(config_.params_file(),
                                filter_param_names,
@@ -1930,6 +1937,7 @@ void AnalysisPredictor::PrepareArgument() {
   argument_->SetEnableIrOptim(config_.enable_ir_optim_);
   argument_->SetEnableMemoryOptim(config_.enable_memory_optim());
   argument_->SetModelFromMemory(config_.model_from_memory_);
+  argument_->SetMmapParams(config_.mmap_params_);
   argument_->SetUsePIR(config_.new_ir_enabled());
   // Analyze inference_program
   argument_->SetPredictorID(predictor_id_);
@@ -2970,10 +2978,13 @@ bool AnalysisPredictor::LoadParameters() {
       new framework::ProgramDesc());
   framework::BlockDesc *load_block = load_program->MutableBlock(0);
   std::vector<std::string> params;
+  bool all_dense_tensors = true;
 
   for (auto *var : global_block->AllVars()) {
     if (IsPersistable(var)) {
       VLOG(3) << "persistable variable's name: " << var->Name();
+      all_dense_tensors &=
+          var->GetType() == framework::proto::VarType::DENSE_TENSOR;
 
       framework::VarDesc *new_var = load_block->Var(var->Name());
       new_var->SetShape(var->GetShape());
@@ -2998,6 +3009,18 @@ bool AnalysisPredictor::LoadParameters() {
   if (!config_.params_file().empty()) {
     // sort paramlist to have consistent ordering
     std::sort(params.begin(), params.end());
+    // The mapped tensors live in host memory, other places load a copy.
+    if (config_.mmap_params_ && all_dense_tensors &&
+        phi::is_cpu_place(place_)) {
+      std::vector<phi::DenseTensor *> tensors;
+      for (auto &name : params) {
+        tensors.push_back(scope_->Var(name)->GetMutable<phi::DenseTensor>());
+      }
+      inference::LoadCombinedParamsByMmap(config_.params_file(), tensors);
+      VLOG(3) << "get " << scope_->LocalVarNames().size()
+              << " vars after load";
+      return true;
+    }
     // append just the load_combine op
     framework::OpDesc *op = load_block->AppendOp();
     op->SetType("load_combine");
@@ -0,0 +1,563 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+#include "glog/logging.h"
+#include "paddle/fluid/inference/api/paddle_inference_api.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/phi/common/bfloat16.h"
+#include "paddle/phi/common/float16.h"
+
+namespace paddle_infer::services {
+
+using paddle::PaddleTensor;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kLog2BucketNum = 32;
+
+size_t Log2Bucket(uint64_t value) {
+  size_t bucket = 0;
+  while (value > 0 && bucket + 1 < kLog2BucketNum) {
+    value >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+uint64_t MicrosecondsSince(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+      .count();
+}
+
+size_t SizeOfDataType(DataType dtype) {
+  switch (dtype) {
+    case DataType::FLOAT32:
+      return sizeof(float);
+    case DataType::FLOAT64:
+      return sizeof(double);
+    case DataType::INT64:
+      return sizeof(int64_t);
+    case DataType::INT32:
+      return sizeof(int32_t);
+    case DataType::UINT8:
+      return sizeof(uint8_t);
+    case DataType::INT8:
+      return sizeof(int8_t);
+    case DataType::FLOAT16:
+      return sizeof(phi::dtype::float16);
+    case DataType::BFLOAT16:
+      return sizeof(phi::dtype::bfloat16);
+    case DataType::BOOL:
+      return sizeof(bool);
+    default:
+      PADDLE_THROW(common::errors::Unimplemented(
+          "Unsupported data type (%d) for BatchingPredictorPool.",
+          static_cast<int>(dtype)));
+  }
+}
+
+void CopyFromCpu(Tensor* tensor, DataType dtype, const void* data) {
+  switch (dtype) {
+    case DataType::FLOAT32:
+      tensor->CopyFromCpu(static_cast<const float*>(data));
+      break;
+    case DataType::FLOAT64:
+      tensor->CopyFromCpu(static_cast<const double*>(data));
+      break;
+    case DataType::INT64:
+      tensor->CopyFromCpu(static_cast<const int64_t*>(data));
+      break;
+    case DataType::INT32:
+      tensor->CopyFromCpu(static_cast<const int32_t*>(data));
+      break;
+    case DataType::UINT8:
+      tensor->CopyFromCpu(static_cast<const uint8_t*>(data));
+      break;
+    case DataType::INT8:
+      tensor->CopyFromCpu(static_cast<const int8_t*>(data));
+      break;
+    case DataType::FLOAT16:
+      tensor->CopyFromCpu(static_cast<const phi::dtype::float16*>(data));
+      break;
+    case DataType::BFLOAT16:
+      tensor->CopyFromCpu(static_cast<const phi::dtype::bfloat16*>(data));
+      break;
+    case DataType::BOOL:
+      tensor->CopyFromCpu(static_cast<const bool*>(data));
+      break;
+    default:
+      PADDLE_THROW(common::errors::Unimplemented(
+          "Unsupported data type (%d) for BatchingPredictorPool.",
+          static_cast<int>(dtype)));
+  }
+}
+
+void CopyToCpu(const Tensor& tensor, void* data) {
+  switch (tensor.type()) {
+    case DataType::FLOAT32:
+      tensor.CopyToCpu(static_cast<float*>(data));
+      break;
+    case DataType::FLOAT64:
+      tensor.CopyToCpu(static_cast<double*>(data));
+      break;
+    case DataType::INT64:
+      tensor.CopyToCpu(static_cast<int64_t*>(data));
+      break;
+    case DataType::INT32:
+      tensor.CopyToCpu(static_cast<int32_t*>(data));
+      break;
+    case DataType::UINT8:
+      tensor.CopyToCpu(static_cast<uint8_t*>(data));
+      break;
+    case DataType::INT8:
+      tensor.CopyToCpu(static_cast<int8_t*>(data));
+      break;
+    case DataType::FLOAT16:
+      tensor.CopyToCpu(static_cast<phi::dtype::float16*>(data));
+      break;
+    case DataType::BFLOAT16:
+      tensor.CopyToCpu(static_cast<phi::dtype::bfloat16*>(data));
+      break;
+    case DataType::BOOL:
+      tensor.CopyToCpu(static_cast<bool*>(data));
+      break;
+    default:
+      PADDLE_THROW(common::errors::Unimplemented(
+          "Unsupported data type (%d) for BatchingPredictorPool.",
+          static_cast<int>(tensor.type())));
+  }
+}
+
+size_t NumElements(const std::vector<int>& shape, size_t begin = 0) {
+  size_t numel = 1;
+  for (size_t i = begin; i < shape.size(); ++i) {
+    numel *= static_cast<size_t>(shape[i]);
+  }
+  return numel;
+}
+
+struct Request {
+  // The inputs in the order of the inputs of the model.
+  std::vector<PaddleTensor> inputs;
+  int rows{0};
+  Clock::time_point submit_time;
+  std::promise<std::vector<PaddleTensor>> promise;
+};
+
+// Whether two requests can be concatenated into one batch.
+bool IsBatchable(const Request& a, const Request& b) {
+  for (size_t i = 0; i < a.inputs.size(); ++i) {
+    const auto& x = a.inputs[i];
+    const auto& y = b.inputs[i];
+    if (x.dtype != y.dtype || x.shape.size() != y.shape.size() ||
+        !std::equal(x.shape.begin() + 1, x.shape.end(), y.shape.begin() + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+class BatchingPredictorPool::Impl {
+ public:
+  Impl(const Config& config,
+       size_t size,
+       const BatchingConfig& batching_config)
+      : pool_(config, size),
+        max_batch_size_(std::max(batching_config.max_batch_size, 1)),
+        max_wait_(std::chrono::microseconds(
+            std::max<int64_t>(batching_config.max_wait_us, 0))) {
+    input_names_ = pool_.Retrieve(0)->GetInputNames();
+    output_names_ = pool_.Retrieve(0)->GetOutputNames();
+    stats_.batch_size_hist.assign(max_batch_size_ + 1, 0);
+    stats_.queue_depth_hist.assign(kLog2BucketNum, 0);
+    stats_.queue_latency_us_hist.assign(kLog2BucketNum, 0);
+    stats_.latency_us_hist.assign(kLog2BucketNum, 0);
+    for (size_t i = 0; i < size; ++i) {
+      workers_.emplace_back(&Impl::WorkerLoop, this, pool_.Retrieve(i));
+    }
+  }
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    idle_cv_.notify_all();
+    collect_cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  std::future<std::vector<PaddleTensor>> Submit(
+      std::vector<PaddleTensor> inputs) {
+    auto request = std::make_unique<Request>();
+    request->inputs = ArrangeInputs(std::move(inputs));
+    request->rows = request->inputs[0].shape[0];
+    request->submit_time = Clock::now();
+    auto future = request->promise.get_future();
+
+    bool collecting = false;
+    size_t queue_depth = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      PADDLE_ENFORCE_EQ(stop_,
+                        false,
+                        common::errors::PreconditionNotMet(
+                            "The BatchingPredictorPool has been stopped."));
+      queue_depth = queue_.size();
+      queue_.emplace_back(std::move(request));
+      collecting = collecting_;
+    }
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      ++stats_.request_num;
+      ++stats_.queue_depth_hist[Log2Bucket(queue_depth)];
+    }
+    // A worker collecting a batch may be waiting for this request, otherwise
+    // wake up an idle worker to collect one.
+    if (collecting) {
+      collect_cv_.notify_one();
+    } else {
+      idle_cv_.notify_one();
+    }
+    return future;
+  }
+
+  BatchingStats GetStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+  }
+
+ private:
+  std::vector<PaddleTensor> ArrangeInputs(std::vector<PaddleTensor> inputs) {
+    PADDLE_ENFORCE_EQ(input_names_.empty(),
+                      false,
+                      common::errors::Unimplemented(
+                          "BatchingPredictorPool needs a model with inputs."));
+    PADDLE_ENFORCE_EQ(
+        inputs.size(),
+        input_names_.size(),
+        common::errors::InvalidArgument(
+            "The model has %d inputs, but the request has %d inputs.",
+            input_names_.size(),
+            inputs.size()));
+    std::vector<PaddleTensor> arranged(inputs.size());
+    std::vector<bool> assigned(inputs.size(), false);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      size_t idx = i;
+      if (!inputs[i].name.empty()) {
+        auto iter = std::find(
+            input_names_.begin(), input_names_.end(), inputs[i].name);
+        PADDLE_ENFORCE_EQ(iter != input_names_.end(),
+                          true,
+                          common::errors::NotFound(
+                              "The model has no input named %s.",
+                              inputs[i].name));
+        idx = iter - input_names_.begin();
+      }
+      PADDLE_ENFORCE_EQ(assigned[idx],
+                        false,
+                        common::errors::InvalidArgument(
+                            "The input %s is given more than once.",
+                            input_names_[idx]));
+      assigned[idx] = true;
+      arranged[idx] = std::move(inputs[i]);
+    }
+
+    int rows = -1;
+    for (size_t i = 0; i < arranged.size(); ++i) {
+      const auto& input = arranged[i];
+      PADDLE_ENFORCE_EQ(
+          input.lod.empty(),
+          true,
+          common::errors::Unimplemented(
+              "The input %s has LoD, which BatchingPredictorPool does not "
+              "support, please use PredictorPool instead.",
+              input_names_[i]));
+      PADDLE_ENFORCE_EQ(input.shape.empty() || input.shape[0] <= 0,
+                        false,
+                        common::errors::InvalidArgument(
+                            "The input %s should have a positive first "
+                            "dimension to be batched.",
+                            input_names_[i]));
+      PADDLE_ENFORCE_GE(
+          input.data.length(),
+          NumElements(input.shape) * SizeOfDataType(input.dtype),
+          common::errors::InvalidArgument(
+              "The data of the input %s is smaller than its shape.",
+              input_names_[i]));
+      if (rows < 0) {
+        rows = input.shape[0];
+      }
+      PADDLE_ENFORCE_EQ(input.shape[0],
+                        rows,
+                        common::errors::InvalidArgument(
+                            "All inputs should have the same first dimension, "
+                            "but the input %s has %d while others have %d.",
+                            input_names_[i],
+                            input.shape[0],
+                            rows));
+    }
+    return arranged;
+  }
+
+  // Returns the number of samples in the queued requests which can be
+  // batched with the oldest one, up to max_batch_size_.
+  int ReadyRows() const {
+    const Request& front = *queue_.front();
+    int rows = front.rows;
+    for (auto iter = queue_.begin() + 1;
+         iter != queue_.end() && rows < max_batch_size_;
+         ++iter) {
+      if (rows + (*iter)->rows <= max_batch_size_ &&
+          IsBatchable(front, **iter)) {
+        rows += (*iter)->rows;
+      }
+    }
+    return rows;
+  }
+
+  // Takes the oldest request and the later ones batchable with it, in the
+  // order of submitting.
+  std::vector<std::unique_ptr<Request>> TakeBatch() {
+    std::vector<std::unique_ptr<Request>> batch;
+    batch.emplace_back(std::move(queue_.front()));
+    queue_.pop_front();
+    int rows = batch[0]->rows;
+    for (auto iter = queue_.begin();
+         iter != queue_.end() && rows < max_batch_size_;) {
+      if (rows + (*iter)->rows <= max_batch_size_ &&
+          IsBatchable(*batch[0], **iter)) {
+        rows += (*iter)->rows;
+        batch.emplace_back(std::move(*iter));
+        iter = queue_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    return batch;
+  }
+
+  // Only one worker collects a batch at a time, so that the requests are not
+  // scattered into small batches of the idle workers.
+  void WorkerLoop(Predictor* predictor) {
+    std::vector<char> buffer;
+    while (true) {
+      std::vector<std::unique_ptr<Request>> batch;
+      bool stopping = false;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_cv_.wait(lock, [this] {
+          return (stop_ && queue_.empty()) || (!collecting_ && !queue_.empty());
+        });
+        if (queue_.empty()) {
+          return;
+        }
+        collecting_ = true;
+        auto deadline = queue_.front()->submit_time + max_wait_;
+        collect_cv_.wait_until(lock, deadline, [this] {
+          return stop_ || ReadyRows() >= max_batch_size_;
+        });
+        batch = TakeBatch();
+        collecting_ = false;
+        stopping = stop_;
+      }
+      // When stopping, every waiting worker either collects the rest of the
+      // queue or exits, one notified worker exiting would leave the others
+      // waiting forever.
+      if (stopping) {
+        idle_cv_.notify_all();
+      } else {
+        idle_cv_.notify_one();
+      }
+      RunBatch(predictor, &batch, &buffer);
+    }
+  }
+
+  void RunBatch(Predictor* predictor,
+                std::vector<std::unique_ptr<Request>>* batch,
+                std::vector<char>* buffer) {
+    auto start = Clock::now();
+    int rows = 0;
+    for (auto& request : *batch) {
+      rows += request->rows;
+    }
+    VLOG(4) << "Run a batch of " << batch->size() << " requests and " << rows
+            << " samples";
+
+    std::vector<std::vector<PaddleTensor>> outputs(batch->size());
+    try {
+      for (size_t i = 0; i < input_names_.size(); ++i) {
+        const PaddleTensor& first = (*batch)[0]->inputs[i];
+        auto input = predictor->GetInputHandle(input_names_[i]);
+        std::vector<int> shape = first.shape;
+        shape[0] = rows;
+        input->Reshape(shape);
+        if (batch->size() == 1) {
+          CopyFromCpu(input.get(), first.dtype, first.data.data());
+          continue;
+        }
+        size_t row_bytes =
+            NumElements(first.shape, 1) * SizeOfDataType(first.dtype);
+        buffer->resize(row_bytes * rows);
+        char* dst = buffer->data();
+        for (auto& request : *batch) {
+          size_t bytes = row_bytes * request->rows;
+          std::memcpy(dst, request->inputs[i].data.data(), bytes);
+          dst += bytes;
+        }
+        CopyFromCpu(input.get(), first.dtype, buffer->data());
+      }
+
+      PADDLE_ENFORCE_EQ(
+          predictor->Run(),
+          true,
+          common::errors::PreconditionNotMet("Failed to run the predictor."));
+
+      for (const auto& name : output_names_) {
+        auto output = predictor->GetOutputHandle(name);
+        std::vector<int> shape = output->shape();
+        DataType dtype = output->type();
+        size_t bytes = NumElements(shape) * SizeOfDataType(dtype);
+        if (batch->size() == 1) {
+          PaddleTensor tensor;
+          tensor.name = name;
+          tensor.shape = shape;
+          tensor.dtype = dtype;
+          tensor.data.Resize(bytes);
+          CopyToCpu(*output, tensor.data.data());
+          outputs[0].emplace_back(std::move(tensor));
+          continue;
+        }
+        PADDLE_ENFORCE_EQ(
+            !shape.empty() && shape[0] == rows,
+            true,
+            common::errors::InvalidArgument(
+                "The output %s can not be split into the requests, its first "
+                "dimension should be the batch size %d.",
+                name,
+                rows));
+        buffer->resize(bytes);
+        CopyToCpu(*output, buffer->data());
+        size_t row_bytes = NumElements(shape, 1) * SizeOfDataType(dtype);
+        const char* src = buffer->data();
+        for (size_t i = 0; i < batch->size(); ++i) {
+          PaddleTensor tensor;
+          tensor.name = name;
+          tensor.shape = shape;
+          tensor.shape[0] = (*batch)[i]->rows;
+          tensor.dtype = dtype;
+          size_t request_bytes = row_bytes * (*batch)[i]->rows;
+          tensor.data.Resize(request_bytes);
+          std::memcpy(tensor.data.data(), src, request_bytes);
+          src += request_bytes;
+          outputs[i].emplace_back(std::move(tensor));
+        }
+      }
+    } catch (...) {
+      for (auto& request : *batch) {
+        request->promise.set_exception(std::current_exception());
+      }
+      return;
+    }
+
+    auto end = Clock::now();
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      ++stats_.batch_num;
+      ++stats_.batch_size_hist[std::min(rows, max_batch_size_)];
+      for (auto& request : *batch) {
+        ++stats_.queue_latency_us_hist[Log2Bucket(
+            MicrosecondsSince(request->submit_time, start))];
+        ++stats_.latency_us_hist[Log2Bucket(
+            MicrosecondsSince(request->submit_time, end))];
+      }
+    }
+    for (size_t i = 0; i < batch->size(); ++i) {
+      (*batch)[i]->promise.set_value(std::move(outputs[i]));
+    }
+  }
+
+  PredictorPool pool_;
+  const int max_batch_size_;
+  const Clock::duration max_wait_;
+  std::vector<std::string> input_names_;
+  std::vector<std::string> output_names_;
+
+  std::mutex mutex_;
+  std::condition_variable idle_cv_;
+  std::condition_variable collect_cv_;
+  std::deque<std::unique_ptr<Request>> queue_;
+  bool collecting_{false};
+  bool stop_{false};
+
+  mutable std::mutex stats_mutex_;
+  BatchingStats stats_;
+
+  std::vector<std::thread> workers_;
+};
+
+BatchingPredictorPool::BatchingPredictorPool(
+    const Config& config,
+    size_t size,
+    const BatchingConfig& batching_config)
+    : impl_(std::make_unique<Impl>(config, size, batching_config)) {}
+
+BatchingPredictorPool::~BatchingPredictorPool() = default;
+
+std::future<std::vector<PaddleTensor>> BatchingPredictorPool::Submit(
+    std::vector<PaddleTensor> inputs) {
+  return impl_->Submit(std::move(inputs));
+}
+
+bool BatchingPredictorPool::Run(const std::vector<PaddleTensor>& inputs,
+                                std::vector<PaddleTensor>* outputs) {
+  try {
+    // The caller waits for the outputs, so the inputs are referenced rather
+    // than copied.
+    std::vector<PaddleTensor> refs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      refs[i].name = inputs[i].name;
+      refs[i].shape = inputs[i].shape;
+      refs[i].dtype = inputs[i].dtype;
+      refs[i].lod = inputs[i].lod;
+      refs[i].data.Reset(inputs[i].data.data(), inputs[i].data.length());
+    }
+    *outputs = impl_->Submit(std::move(refs)).get();
+    return true;
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "BatchingPredictorPool failed to run: " << e.what();
+    return false;
+  }
+}
+
+BatchingStats BatchingPredictorPool::GetStats() const {
+  return impl_->GetStats();
+}
+
+}  // namespace paddle_infer::services
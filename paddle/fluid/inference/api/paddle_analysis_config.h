@@ -856,6 +856,23 @@ struct PD_INFER_DECL AnalysisConfig {
   ///
   void UseOptimizedModel(bool x = true) { use_optimized_model_ = x; }
 
+  ///
+  /// \brief Control whether to load the combined parameters file by mapping
+  /// it into memory. The parameters are used in place on CPU, so predictors
+  /// and processes loading the same file share its memory pages, a page is
+  /// only copied when a pass rewrites the parameters on it.
+  ///
+  /// \param x whether to map the parameters file.
+  ///
+  void EnableMmapParams(bool x = true) { mmap_params_ = x; }
+
+  ///
+  /// \brief A boolean state telling whether the parameters file is mapped.
+  ///
+  /// \return bool Whether the parameters file is mapped.
+  ///
+  bool mmap_params_enabled() const { return mmap_params_; }
+
   ///
   /// \brief Control whether to debug IR graph analysis phase.
   /// This will generate DOT files for visualizing the computation graph after
@@ -1252,6 +1269,7 @@ struct PD_INFER_DECL AnalysisConfig {
   std::unordered_set<std::string> mkldnn_enabled_op_types_;
 
   bool model_from_memory_{false};
+  bool mmap_params_{false};
 
   bool enable_ir_optim_{true};
   bool ir_debug_{false};
@@ -22,6 +22,7 @@ limitations under the License. */
 #pragma once
 
 #include <cassert>
+#include <future>  // NOLINT
 #include <map>
 #include <memory>
 #include <string>
@@ -272,6 +273,93 @@ class PD_INFER_DECL PredictorPool {
   std::shared_ptr<Predictor> main_pred_;
   std::vector<std::unique_ptr<Predictor>> preds_;
 };
+
+///
+/// \brief Options of BatchingPredictorPool.
+///
+struct PD_INFER_DECL BatchingConfig {
+  /// The max number of samples, i.e. the sum of the first dimension of the
+  /// requests, run in one batch. A larger request is run alone.
+  int max_batch_size{8};
+  /// How long the oldest request waits for others to fill its batch, in
+  /// microseconds.
+  int64_t max_wait_us{1000};
+};
+
+///
+/// \brief Statistics of BatchingPredictorPool.
+///
+/// The log2 histograms count 0 in bucket 0, and values in [2^(i-1), 2^i) in
+/// bucket i, the last bucket counts all the larger values.
+///
+struct PD_INFER_DECL BatchingStats {
+  uint64_t request_num{0};
+  uint64_t batch_num{0};
+  /// Bucket i counts the batches of i samples.
+  std::vector<uint64_t> batch_size_hist;
+  /// Log2 histogram of the queue depth seen by each request when submitted.
+  std::vector<uint64_t> queue_depth_hist;
+  /// Log2 histogram of the time from submitting to running, in microseconds.
+  std::vector<uint64_t> queue_latency_us_hist;
+  /// Log2 histogram of the time from submitting to finishing, in microseconds.
+  std::vector<uint64_t> latency_us_hist;
+};
+
+///
+/// \class BatchingPredictorPool
+///
+/// \brief BatchingPredictorPool accepts requests of single samples or small
+/// batches from any thread, and coalesces the pending requests into batches
+/// run by the predictors of a PredictorPool, one worker thread per predictor.
+///
+/// The requests in a batch must have the same data type and the same shape
+/// except the first dimension for each input. They are concatenated along the
+/// first dimension, and every output of the model is split back along its
+/// first dimension, so the outputs should be batch major as well. LoD is not
+/// supported.
+///
+/// Usage:
+///
+/// \code{cpp}
+///   services::BatchingPredictorPool pool(config, 4);
+///   std::future<std::vector<paddle::PaddleTensor>> outputs =
+///       pool.Submit(std::move(inputs));
+///   ...
+///   outputs.get();
+/// \endcode
+///
+class PD_INFER_DECL BatchingPredictorPool {
+ public:
+  BatchingPredictorPool() = delete;
+  BatchingPredictorPool(const BatchingPredictorPool&) = delete;
+  BatchingPredictorPool& operator=(const BatchingPredictorPool&) = delete;
+
+  /// \brief Construct the pool with \param size predictor instances.
+  BatchingPredictorPool(const Config& config,
+                        size_t size = 1,
+                        const BatchingConfig& batching_config = {});
+
+  /// \brief Run the pending requests and stop the workers.
+  ~BatchingPredictorPool();
+
+  /// \brief Submit a request. The inputs are matched to the inputs of the
+  /// model by name, or by position if the names are empty, and must have the
+  /// same first dimension.
+  /// \return The outputs in the order of Predictor::GetOutputNames().
+  std::future<std::vector<paddle::PaddleTensor>> Submit(
+      std::vector<paddle::PaddleTensor> inputs);
+
+  /// \brief Submit a request and wait for its outputs.
+  /// \return Whether the run succeeded.
+  bool Run(const std::vector<paddle::PaddleTensor>& inputs,
+           std::vector<paddle::PaddleTensor>* outputs);
+
+  BatchingStats GetStats() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
 }  // namespace services
 
 }  // namespace paddle_infer
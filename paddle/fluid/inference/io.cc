@@ -14,13 +14,24 @@ limitations under the License. */
 
 #include "paddle/fluid/inference/io.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <vector>
 
 #include "paddle/fluid/framework/block_desc.h"
+#include "paddle/fluid/framework/convert_utils.h"
+#include "paddle/fluid/framework/data_type.h"
 #include "paddle/fluid/framework/feed_fetch_type.h"
 #include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/tensor_util.h"
 #include "paddle/fluid/framework/version.h"
 #include "paddle/fluid/platform/enforce.h"
 #include "paddle/fluid/pybind/pybind.h"
@@ -76,12 +87,235 @@ bool IsPersistable(const framework::VarDesc* var) {
   return false;
 }
 
+namespace {
+
+// A parameters file mapped privately, the pages written are copied on write
+// and never go back to the file.
+class MappedParamsFile {
+ public:
+  explicit MappedParamsFile(const std::string& filename) {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    PADDLE_ENFORCE_NE(
+        fd,
+        -1,
+        common::errors::Unavailable("Failed to open file %s.", filename));
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0) {
+      size_ = static_cast<size_t>(file_stat.st_size);
+    }
+    if (size_ > 0) {
+      void* ptr = mmap(
+          nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      data_ = ptr == MAP_FAILED ? nullptr : static_cast<char*>(ptr);
+    }
+    close(fd);
+    PADDLE_ENFORCE_NOT_NULL(
+        data_,
+        common::errors::Unavailable("Failed to map file %s of %d bytes.",
+                                    filename,
+                                    size_));
+#else
+    ReadBinaryFile(filename, &buffer_);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+  }
+
+  ~MappedParamsFile() {
+#ifndef _WIN32
+    munmap(data_, size_);
+#endif
+  }
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  char* data_{nullptr};
+  size_t size_{0};
+#ifdef _WIN32
+  std::string buffer_;
+#endif
+};
+
+// The data of a parameter in the mapped file.
+class MappedParamAllocation : public phi::Allocation {
+ public:
+  MappedParamAllocation(std::shared_ptr<MappedParamsFile> file,
+                        size_t offset,
+                        size_t size)
+      : phi::Allocation(file->data() + offset, size, phi::CPUPlace()),
+        file_(std::move(file)) {}
+
+ private:
+  std::shared_ptr<MappedParamsFile> file_;
+};
+
+}  // namespace
+
+void LoadCombinedParamsByMmap(const std::string& param_filename,
+                              const std::vector<phi::DenseTensor*>& tensors) {
+  auto file = std::make_shared<MappedParamsFile>(param_filename);
+  size_t offset = 0;
+  auto next = [&](size_t size) {
+    PADDLE_ENFORCE_LE(
+        offset + size,
+        file->size(),
+        common::errors::InvalidArgument(
+            "The parameters file %s is truncated, maybe it is damaged.",
+            param_filename));
+    const char* ptr = file->data() + offset;
+    offset += size;
+    return ptr;
+  };
+  auto read = [&](void* dst, size_t size) {
+    std::memcpy(dst, next(size), size);
+  };
+
+  // The same layout as phi::SerializeToStream.
+  size_t mapped_num = 0;
+  for (auto* tensor : tensors) {
+    uint32_t version = 0;
+    read(&version, sizeof(version));
+    PADDLE_ENFORCE_EQ(
+        version,
+        0U,
+        common::errors::InvalidArgument(
+            "Deserialize to tensor failed, maybe the loaded file is "
+            "not a paddle model(expected file format: 0, but %u found).",
+            version));
+
+    uint64_t lod_level = 0;
+    read(&lod_level, sizeof(lod_level));
+    auto& lod = *tensor->mutable_lod();
+    lod.resize(lod_level);
+    for (uint64_t i = 0; i < lod_level; ++i) {
+      uint64_t size = 0;
+      read(&size, sizeof(size));
+      lod[i].resize(size / sizeof(size_t));
+      read(lod[i].data(), size);
+    }
+
+    read(&version, sizeof(version));
+    PADDLE_ENFORCE_EQ(
+        version,
+        0U,
+        common::errors::InvalidArgument(
+            "tensor version %u is not supported, Only version 0 is supported",
+            version));
+    int32_t desc_size = -1;
+    read(&desc_size, sizeof(desc_size));
+    PADDLE_ENFORCE_GE(desc_size,
+                      0,
+                      common::errors::InvalidArgument(
+                          "phi::DenseTensor desc size should >= 0"));
+    framework::proto::VarType::TensorDesc desc;
+    PADDLE_ENFORCE_EQ(
+        desc.ParseFromArray(next(desc_size), desc_size),
+        true,
+        common::errors::InvalidArgument("Cannot parse tensor desc"));
+
+    std::vector<int64_t> dims(desc.dims().begin(), desc.dims().end());
+    tensor->Resize(common::make_ddim(dims));
+    auto dtype = framework::TransToPhiDataType(desc.data_type());
+    size_t type_size = framework::SizeOfType(desc.data_type());
+    size_t size = tensor->numel() * type_size;
+    size_t data_offset = offset;
+    const char* data = next(size);
+    if (reinterpret_cast<uintptr_t>(data) % type_size == 0) {
+      tensor->ResetHolderWithType(
+          std::make_shared<MappedParamAllocation>(file, data_offset, size),
+          dtype);
+      ++mapped_num;
+    } else {
+      std::memcpy(tensor->mutable_data(phi::CPUPlace(), dtype), data, size);
+    }
+  }
+  PADDLE_ENFORCE_EQ(offset,
+                    file->size(),
+                    common::errors::Unavailable(
+                        "Not allowed to load partial data via "
+                        "load_combine_op, please use load_op instead."));
+  VLOG(3) << "Mapped " << mapped_num << " of " << tensors.size()
+          << " parameters from " << param_filename << ", the others are "
+          << "copied since they are not aligned";
+}
+
+void SaveCombinedParamsForMmap(
+    const std::string& param_filename,
+    const std::vector<const phi::DenseTensor*>& tensors) {
+  // An unknown field of TensorDesc, which is skipped by the parsers.
+  constexpr int kPaddingField = 15;
+  std::ofstream fout(param_filename, std::ios::binary);
+  PADDLE_ENFORCE_EQ(
+      static_cast<bool>(fout),
+      true,
+      common::errors::Unavailable("Cannot open %s to save variables.",
+                                  param_filename));
+  size_t offset = 0;
+  auto write = [&](const void* data, size_t size) {
+    fout.write(static_cast<const char*>(data), size);  // NOLINT
+    offset += size;
+  };
+
+  for (auto* tensor : tensors) {
+    phi::DenseTensor cpu_tensor;
+    if (!phi::is_cpu_place(tensor->place())) {
+      framework::TensorCopySync(*tensor, phi::CPUPlace(), &cpu_tensor);
+      tensor = &cpu_tensor;
+    }
+    uint32_t version = 0;
+    write(&version, sizeof(version));
+    uint64_t lod_level = tensor->lod().size();
+    write(&lod_level, sizeof(lod_level));
+    for (auto& each : tensor->lod()) {
+      uint64_t size = each.size() * sizeof(size_t);
+      write(&size, sizeof(size));
+      write(each.data(), size);
+    }
+
+    write(&version, sizeof(version));
+    framework::proto::VarType::TensorDesc desc;
+    desc.set_data_type(framework::TransToProtoVarType(tensor->dtype()));
+    for (int i = 0; i < tensor->dims().size(); ++i) {
+      desc.add_dims(tensor->dims()[i]);
+    }
+    std::string desc_str = desc.SerializeAsString();
+    size_t data_offset = offset + sizeof(int32_t) + desc_str.size();
+    size_t padding =
+        (kMmapParamsAlignment - data_offset % kMmapParamsAlignment) %
+        kMmapParamsAlignment;
+    if (padding > 0) {
+      // The padding field takes one byte of tag and one byte of length.
+      if (padding < 2) {
+        padding += kMmapParamsAlignment;
+      }
+      desc_str.push_back(static_cast<char>(kPaddingField << 3 | 2));
+      desc_str.push_back(static_cast<char>(padding - 2));
+      desc_str.append(padding - 2, '\0');
+    }
+    int32_t desc_size = static_cast<int32_t>(desc_str.size());
+    write(&desc_size, sizeof(desc_size));
+    write(desc_str.data(), desc_str.size());
+    if (tensor->numel() > 0) {
+      write(tensor->data(), tensor->numel() * phi::SizeOf(tensor->dtype()));
+    }
+  }
+  PADDLE_ENFORCE_EQ(
+      static_cast<bool>(fout),
+      true,
+      common::errors::Unavailable("Failed to save variables to %s.",
+                                  param_filename));
+}
+
 void LoadCombinePersistables(framework::Executor* executor,
                              framework::Scope* scope,
                              const framework::ProgramDesc& main_program,
                              const std::string& dirname,
                              const std::string& param_filename,
-                             bool model_from_memory = false) {
+                             bool model_from_memory = false,
+                             bool mmap_params = false) {
   if (param_filename.empty()) {
     VLOG(4)
         << "param_filename is empty when load combine params. Return directly.";
@@ -92,6 +326,7 @@ void LoadCombinePersistables(framework::Executor* executor,
   auto load_program = std::make_unique<framework::ProgramDesc>();
   auto load_block = load_program->MutableBlock(0);
   std::vector<std::string> param_list;
+  bool all_dense_tensors = true;
 
   for (auto* var : global_block.AllVars()) {
     if (IsPersistable(var)) {
@@ -111,11 +346,20 @@ void LoadCombinePersistables(framework::Executor* executor,
 
       new_var->SetPersistable(true);
       param_list.push_back(new_var->Name());
+      all_dense_tensors &= var_type == framework::proto::VarType::DENSE_TENSOR;
     }
   }
 
   // sort param_list to have consistent ordering
   std::sort(param_list.begin(), param_list.end());
+  if (mmap_params && !model_from_memory && all_dense_tensors) {
+    std::vector<phi::DenseTensor*> tensors;
+    for (auto& name : param_list) {
+      tensors.push_back(scope->Var(name)->GetMutable<phi::DenseTensor>());
+    }
+    LoadCombinedParamsByMmap(param_filename, tensors);
+    return;
+  }
   // append just the load_combine op
   framework::OpDesc* op = load_block->AppendOp();
   op->SetType("load_combine");
@@ -226,7 +470,8 @@ std::unique_ptr<framework::ProgramDesc> Load(framework::Executor* executor,
                                              framework::Scope* scope,
                                              const std::string& prog_filename,
                                              const std::string& param_filename,
-                                             bool load_params) {
+                                             bool load_params,
+                                             bool mmap_params) {
   std::string program_desc_str;
   ReadBinaryFile(prog_filename, &program_desc_str);
 
@@ -239,7 +484,8 @@ std::unique_ptr<framework::ProgramDesc> Load(framework::Executor* executor,
                             *main_program,
                             "",
                             param_filename,
-                            false /* model_from_memory */);
+                            false /* model_from_memory */,
+                            mmap_params);
   }
   return main_program;
 }
@@ -43,7 +43,8 @@ std::unique_ptr<framework::ProgramDesc> Load(framework::Executor* executor,
                                              framework::Scope* scope,
                                              const std::string& prog_filename,
                                              const std::string& param_filename,
-                                             bool load_params = true);
+                                             bool load_params = true,
+                                             bool mmap_params = false);
 
 std::unique_ptr<framework::ProgramDesc> LoadFromMemory(
     framework::Executor* executor,
@@ -51,6 +52,23 @@ std::unique_ptr<framework::ProgramDesc> LoadFromMemory(
     const std::string& prog_buffer,
     const std::string& param_buffer);
 
+// Load the tensors of a combined parameters file, in the order they were
+// saved, by mapping the file into memory privately. The data of a tensor
+// which is aligned to its element size is used in place, so the instances
+// loading the same file share its pages in the page cache, and a page is only
+// copied when it is written. The other tensors are copied out of the mapping.
+void LoadCombinedParamsByMmap(const std::string& param_filename,
+                              const std::vector<phi::DenseTensor*>& tensors);
+
+// Save the tensors as a combined parameters file like save_combine, but pad
+// the tensor descs so that the data of every tensor is aligned to
+// kMmapParamsAlignment bytes and used in place by LoadCombinedParamsByMmap.
+// The file is still readable by load_combine.
+constexpr size_t kMmapParamsAlignment = 64;
+void SaveCombinedParamsForMmap(
+    const std::string& param_filename,
+    const std::vector<const phi::DenseTensor*>& tensors);
+
 // Save the variables from a scope to disk.
 void SaveVars(const framework::Scope& scope,
               const std::vector<std::string>& vars,
@@ -278,6 +278,12 @@ void BindDataset(py::module *m) {
       .def("global_shuffle",
            &framework::Dataset::GlobalShuffle,
            py::call_guard<py::gil_scoped_release>())
+      .def("start_global_shuffle",
+           &framework::Dataset::StartGlobalShuffle,
+           py::call_guard<py::gil_scoped_release>())
+      .def("wait_global_shuffle_done",
+           &framework::Dataset::WaitGlobalShuffleDone,
+           py::call_guard<py::gil_scoped_release>())
       .def("get_memory_data_size",
            &framework::Dataset::GetMemoryDataSize,
            py::call_guard<py::gil_scoped_release>())
@@ -323,6 +329,9 @@ void BindDataset(py::module *m) {
       .def("set_enable_pv_merge",
            &framework::Dataset::SetEnablePvMerge,
            py::call_guard<py::gil_scoped_release>())
+      .def("set_lock_free_channel",
+           &framework::Dataset::SetLockFreeChannel,
+           py::call_guard<py::gil_scoped_release>())
 
       .def("set_merge_by_lineid",
            &framework::Dataset::SetMergeByInsId,
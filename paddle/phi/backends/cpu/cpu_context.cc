@@ -14,16 +14,57 @@
 
 #include "paddle/phi/backends/cpu/cpu_context.h"
 
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "paddle/common/flags.h"
 #include "paddle/phi/common/place.h"
 #include "paddle/phi/core/enforce.h"
+#include "paddle/phi/core/threadpool.h"
 
 // NOTE: The paddle framework should add WITH_EIGEN option to support compile
 // without eigen.
 #include "paddle/phi/core/device_context.h"
 #include "unsupported/Eigen/CXX11/Tensor"
 
+COMMON_DECLARE_int32(cpu_intra_op_num_threads);
+
 namespace phi {
 
+namespace {
+
+// a ParallelFor task smaller than this runs on the calling thread
+constexpr int64_t kMinCostPerTask = 32768;
+
+// set while a thread runs a range of ParallelFor
+thread_local bool in_parallel_for = false;
+
+struct ParallelForGuard {
+  ParallelForGuard() { in_parallel_for = true; }
+  ~ParallelForGuard() { in_parallel_for = false; }
+};
+
+int MaxIntraOpNumThreads() {
+  static const int max_num_threads =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  return max_num_threads;
+}
+
+// One pool serves all CPU contexts. It is created on first use with a
+// worker per core but the calling one, as much as any context may ask for,
+// and the calling thread runs one range itself.
+ThreadPool* IntraOpThreadPool() {
+  static std::unique_ptr<ThreadPool> pool =
+      std::make_unique<ThreadPool>(MaxIntraOpNumThreads() - 1);
+  return pool.get();
+}
+
+}  // namespace
+
 struct CPUContext::Impl {
   Impl() : place_(CPUPlace()) {}
 
@@ -51,6 +92,8 @@ struct CPUContext::Impl {
   bool owned_{false};
   Eigen::DefaultDevice* eigen_device_{nullptr};
   Place place_;
+  // -1 means following FLAGS_cpu_intra_op_num_threads
+  int intra_op_num_threads_{-1};
 };
 
 CPUContext::CPUContext()
@@ -75,6 +118,75 @@ Eigen::DefaultDevice* CPUContext::eigen_device() const {
 
 const Place& CPUContext::GetPlace() const { return impl_->place_; }
 
+int CPUContext::GetIntraOpNumThreads() const {
+  int num_threads = impl_->intra_op_num_threads_ >= 0
+                        ? impl_->intra_op_num_threads_
+                        : FLAGS_cpu_intra_op_num_threads;
+  return std::min(std::max(num_threads, 1), MaxIntraOpNumThreads());
+}
+
+void CPUContext::SetIntraOpNumThreads(int num_threads) {
+  PADDLE_ENFORCE_GE(num_threads,
+                    0,
+                    common::errors::InvalidArgument(
+                        "The intra-op thread number must be greater than or "
+                        "equal to 0, but got %d.",
+                        num_threads));
+  impl_->intra_op_num_threads_ = num_threads;
+}
+
+void CPUContext::ParallelFor(
+    int64_t n,
+    int64_t cost_per_unit,
+    const std::function<void(int64_t, int64_t)>& fn) const {
+  if (n <= 0) {
+    return;
+  }
+  int64_t num_tasks = GetIntraOpNumThreads();
+  if (num_tasks > 1 && !in_parallel_for) {
+    cost_per_unit = std::max<int64_t>(cost_per_unit, 1);
+    int64_t total_cost =
+        n > std::numeric_limits<int64_t>::max() / cost_per_unit
+            ? std::numeric_limits<int64_t>::max()
+            : n * cost_per_unit;
+    int64_t max_tasks = std::max<int64_t>(total_cost / kMinCostPerTask, 1);
+    num_tasks = std::min({num_tasks, max_tasks, n});
+  }
+  if (num_tasks <= 1 || in_parallel_for) {
+    fn(0, n);
+    return;
+  }
+
+  ThreadPool* pool = IntraOpThreadPool();
+  int64_t block = (n + num_tasks - 1) / num_tasks;
+  std::vector<std::future<void>> futures;
+  for (int64_t begin = block; begin < n; begin += block) {
+    int64_t end = std::min(n, begin + block);
+    futures.emplace_back(pool->Run([&fn, begin, end]() {
+      ParallelForGuard guard;
+      fn(begin, end);
+    }));
+  }
+  // the other ranges refer to fn, so they are waited before any exception
+  // of this range is rethrown
+  std::exception_ptr ex = nullptr;
+  try {
+    ParallelForGuard guard;
+    fn(0, std::min(n, block));
+  } catch (...) {
+    ex = std::current_exception();
+  }
+  for (auto& f : futures) {
+    f.wait();
+  }
+  if (ex != nullptr) {
+    std::rethrow_exception(ex);
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+}
+
 void CPUContext::SetEigenDevice(Eigen::DefaultDevice* device) {
   impl_->eigen_device_ = device;
 }
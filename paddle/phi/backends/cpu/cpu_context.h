@@ -14,6 +14,8 @@ limitations under the License. */
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 
 #include "paddle/phi/backends/cpu/forwards.h"
@@ -35,6 +37,20 @@ class PADDLE_API CPUContext : public DeviceContext,
   Eigen::DefaultDevice* eigen_device() const;
   const Place& GetPlace() const override;
 
+  // Number of threads a kernel may use through ParallelFor. It follows
+  // FLAGS_cpu_intra_op_num_threads unless set by SetIntraOpNumThreads,
+  // 0 or 1 means kernels run on the calling thread only.
+  int GetIntraOpNumThreads() const;
+  void SetIntraOpNumThreads(int num_threads);
+
+  // Calls fn(begin, end) on disjoint ranges covering [0, n), using the
+  // intra-op threads when the total cost is large enough. cost_per_unit is
+  // the rough number of scalar operations for one index. Nested calls run
+  // on the calling thread.
+  void ParallelFor(int64_t n,
+                   int64_t cost_per_unit,
+                   const std::function<void(int64_t, int64_t)>& fn) const;
+
   static const char* name() { return "CPUContext"; }
 
  protected:
@@ -26,7 +26,9 @@
 #include "paddle/phi/core/memory/allocation/cpu_allocator.h"
 #include "paddle/phi/core/memory/allocation/naive_best_fit_allocator.h"
 #include "paddle/phi/core/memory/allocation/retry_allocator.h"
+#include "paddle/phi/core/memory/allocation/segregated_fit_allocator.h"
 #include "paddle/phi/core/memory/allocation/stat_allocator.h"
+#include "paddle/phi/core/memory/allocation/thread_local_cpu_allocator.h"
 #include "paddle/phi/core/platform/device_context.h"
 
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
@@ -111,6 +113,32 @@ PHI_DEFINE_EXPORTED_bool(
     "Whether to use AutoGrowthBestFitAllocatorV2 for auto_growth "
     "strategy");
 
+PHI_DEFINE_EXPORTED_bool(
+    use_segregated_fit_allocator,
+    false,
+    "Whether to use SegregatedFitAllocator instead of "
+    "AutoGrowthBestFitAllocator for auto_growth strategy, and as the backend "
+    "of ThreadLocalCPUAllocator.");
+
+PHI_DEFINE_EXPORTED_uint64(
+    segregated_fit_allocator_shard_num,
+    8ul,
+    "The number of shards of SegregatedFitAllocator, each shard has its own "
+    "free blocks and lock.");
+
+PHI_DEFINE_EXPORTED_bool(
+    use_thread_local_cpu_allocator,
+    false,
+    "Whether to use ThreadLocalCPUAllocator, which serves small CPU "
+    "allocations from per-thread size-class caches, for all allocator "
+    "strategies. It is always used by the thread_local strategy.");
+
+PHI_DEFINE_EXPORTED_uint64(
+    thread_local_cpu_cache_size_in_mb,
+    16ul,
+    "The maximum size (MB) of freed CPU memory cached by each thread in "
+    "ThreadLocalCPUAllocator.");
+
 COMMON_DECLARE_string(allocator_strategy);
 COMMON_DECLARE_uint64(auto_growth_chunk_size_in_mb);
 COMMON_DECLARE_bool(use_auto_growth_pinned_allocator);
@@ -212,7 +240,7 @@ class AllocatorFacadePrivate {
     VLOG(2) << "selected allocator strategy:" << int(strategy_) << std::endl;
     switch (strategy_) {
       case AllocatorStrategy::kNaiveBestFit: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #ifdef PADDLE_WITH_IPU
         for (int dev_id = 0; dev_id < platform::GetIPUDeviceCount(); ++dev_id) {
           InitNaiveBestFitIPUAllocator(phi::IPUPlace(dev_id));
@@ -243,7 +271,7 @@ class AllocatorFacadePrivate {
       }
 
       case AllocatorStrategy::kAutoGrowth: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
         allow_free_idle_chunk_ = allow_free_idle_chunk;
         for (int dev_id = 0; dev_id < platform::GetGPUDeviceCount(); ++dev_id) {
@@ -319,7 +347,7 @@ class AllocatorFacadePrivate {
       }
 
       case AllocatorStrategy::kThreadLocal: {
-        InitNaiveBestFitCPUAllocator();
+        InitThreadLocalCPUAllocator();
 #ifdef PADDLE_WITH_XPU
         for (int dev_id = 0; dev_id < platform::GetXPUDeviceCount(); ++dev_id) {
           InitNaiveBestFitXPUAllocator(phi::XPUPlace(dev_id));
@@ -822,6 +850,54 @@ class AllocatorFacadePrivate {
 
   const AllocatorMap& GetAllocatorMap() { return allocators_; }
 
+  void InitCPUAllocator() {
+    if (FLAGS_use_thread_local_cpu_allocator) {
+      InitThreadLocalCPUAllocator();
+    } else if (strategy_ == AllocatorStrategy::kAutoGrowth &&
+               FLAGS_use_segregated_fit_allocator) {
+      InitSegregatedFitCPUAllocator();
+    } else {
+      InitNaiveBestFitCPUAllocator();
+    }
+  }
+
+  // Blocks are carved from chunks of the largest size class of
+  // ThreadLocalCPUAllocator, so that a cache miss seldom reaches
+  // posix_memalign.
+  std::shared_ptr<Allocator> CreateCPUPoolAllocator() {
+    auto cpu_allocator = std::make_shared<CPUAllocator>();
+    if (FLAGS_use_segregated_fit_allocator) {
+      return std::make_shared<SegregatedFitAllocator>(
+          cpu_allocator,
+          CPUSizeClass::kMinSize,
+          CPUSizeClass::kMaxSize,
+          /*allow_free_idle_chunk=*/true,
+          FLAGS_segregated_fit_allocator_shard_num);
+    }
+    return std::make_shared<AutoGrowthBestFitAllocator>(
+        cpu_allocator, CPUSizeClass::kMinSize, CPUSizeClass::kMaxSize);
+  }
+
+  void InitSegregatedFitCPUAllocator() {
+#if defined(__APPLE__) && defined(__arm64__)
+    InitNaiveBestFitCPUAllocator();
+#else
+    allocators_[phi::CPUPlace()] = CreateCPUPoolAllocator();
+#endif
+  }
+
+  void InitThreadLocalCPUAllocator() {
+#if defined(__APPLE__) && defined(__arm64__)
+    // NOTE: CPUAllocator cannot be used on Mac OS m1 chip, see
+    // InitNaiveBestFitCPUAllocator.
+    InitNaiveBestFitCPUAllocator();
+#else
+    allocators_[phi::CPUPlace()] = std::make_shared<ThreadLocalCPUAllocator>(
+        CreateCPUPoolAllocator(),
+        FLAGS_thread_local_cpu_cache_size_in_mb << 20);
+#endif
+  }
+
   void InitNaiveBestFitCPUAllocator() {
 #if defined(__APPLE__) && defined(__arm64__)
     // NOTE(wuweilong): It is more efficient to use CPUAllocator directly,
@@ -942,6 +1018,13 @@ class AllocatorFacadePrivate {
               p,
               chunk_size,
               allow_free_idle_chunk_);
+    } else if (FLAGS_use_segregated_fit_allocator) {
+      cuda_allocators_[p][stream] = std::make_shared<SegregatedFitAllocator>(
+          cuda_allocator,
+          platform::GpuMinChunkSize(),
+          chunk_size,
+          allow_free_idle_chunk_,
+          FLAGS_segregated_fit_allocator_shard_num);
     } else {
       cuda_allocators_[p][stream] =
           std::make_shared<AutoGrowthBestFitAllocator>(
@@ -983,6 +1066,13 @@ class AllocatorFacadePrivate {
                 p,
                 /*chunk_size=*/chunk_size,
                 allow_free_idle_chunk_);
+      } else if (FLAGS_use_segregated_fit_allocator) {
+        cuda_allocators_[p][stream] = std::make_shared<SegregatedFitAllocator>(
+            cuda_allocator,
+            platform::GpuMinChunkSize(),
+            /*chunk_size=*/chunk_size,
+            allow_free_idle_chunk_,
+            FLAGS_segregated_fit_allocator_shard_num);
       } else {
         cuda_allocators_[p][stream] =
             std::make_shared<AutoGrowthBestFitAllocator>(
@@ -1033,6 +1123,13 @@ class AllocatorFacadePrivate {
               p,
               chunk_size,
               allow_free_idle_chunk_);
+    } else if (FLAGS_use_segregated_fit_allocator) {
+      cuda_allocators_[p][stream] = std::make_shared<SegregatedFitAllocator>(
+          underlying_allocator,
+          alignment,
+          chunk_size,
+          allow_free_idle_chunk_,
+          FLAGS_segregated_fit_allocator_shard_num);
     } else {
       cuda_allocators_[p][stream] =
           std::make_shared<AutoGrowthBestFitAllocator>(underlying_allocator,
@@ -0,0 +1,326 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/core/memory/allocation/segregated_fit_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>  // NOLINT
+
+#include "paddle/common/flags.h"
+#include "paddle/phi/api/profiler/event_tracing.h"
+#include "paddle/phi/core/enforce.h"
+
+PD_DECLARE_bool(free_idle_chunk);
+PD_DECLARE_bool(free_when_no_cache_hit);
+
+namespace paddle::memory::allocation {
+
+namespace {
+
+inline size_t HighestBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(x);
+#else
+  size_t bit = 0;
+  while (x >>= 1) {
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+inline size_t LowestBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(x);
+#else
+  size_t bit = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+std::atomic<size_t> g_next_thread_ordinal{0};
+
+}  // namespace
+
+SegregatedFitAllocator::SegregatedFitAllocator(
+    std::shared_ptr<Allocator> underlying_allocator,
+    size_t alignment,
+    size_t chunk_size,
+    bool allow_free_idle_chunk,
+    size_t shard_num)
+    : underlying_allocator_(std::move(underlying_allocator)),
+      alignment_(alignment),
+      chunk_size_(std::max(AlignedSize(chunk_size, alignment), alignment)),
+      allow_free_idle_chunk_(allow_free_idle_chunk) {
+  PADDLE_ENFORCE_GT(
+      alignment_,
+      0,
+      common::errors::InvalidArgument(
+          "Alignment should be larger than 0, but got %d", alignment_));
+  shard_num = std::max<size_t>(shard_num, 1);
+  shards_.reserve(shard_num);
+  for (size_t i = 0; i < shard_num; ++i) {
+    shards_.emplace_back(std::make_unique<Shard>());
+  }
+  VLOG(4) << "chunk_size_:" << chunk_size_ << ", shard_num:" << shard_num;
+}
+
+SegregatedFitAllocator::~SegregatedFitAllocator() {
+  for (auto &shard : shards_) {
+    for (auto &chunk : shard->chunks_) {
+      Block *block = chunk.first_block_;
+      while (block != nullptr) {
+        Block *next = block->next_phys_;
+        delete block;
+        block = next;
+      }
+    }
+  }
+}
+
+void SegregatedFitAllocator::Mapping(size_t units, size_t *fl, size_t *sl) {
+  if (units < kSLCount) {
+    *fl = 0;
+    *sl = units;
+  } else {
+    size_t bit = HighestBit(units);
+    *fl = bit - kSLBits + 1;
+    *sl = (units >> (bit - kSLBits)) - kSLCount;
+  }
+}
+
+void SegregatedFitAllocator::InsertFreeBlock(Shard *shard, Block *block) {
+  size_t fl, sl;
+  Mapping(block->size_ / alignment_, &fl, &sl);
+  Block *head = shard->free_lists_[fl][sl];
+  block->is_free_ = true;
+  block->prev_free_ = nullptr;
+  block->next_free_ = head;
+  if (head != nullptr) {
+    head->prev_free_ = block;
+  }
+  shard->free_lists_[fl][sl] = block;
+  shard->fl_bitmap_ |= (1ULL << fl);
+  shard->sl_bitmap_[fl] |= (1U << sl);
+}
+
+void SegregatedFitAllocator::RemoveFreeBlock(Shard *shard, Block *block) {
+  size_t fl, sl;
+  Mapping(block->size_ / alignment_, &fl, &sl);
+  if (block->prev_free_ != nullptr) {
+    block->prev_free_->next_free_ = block->next_free_;
+  } else {
+    shard->free_lists_[fl][sl] = block->next_free_;
+    if (block->next_free_ == nullptr) {
+      shard->sl_bitmap_[fl] &= ~(1U << sl);
+      if (shard->sl_bitmap_[fl] == 0) {
+        shard->fl_bitmap_ &= ~(1ULL << fl);
+      }
+    }
+  }
+  if (block->next_free_ != nullptr) {
+    block->next_free_->prev_free_ = block->prev_free_;
+  }
+  block->is_free_ = false;
+  block->prev_free_ = nullptr;
+  block->next_free_ = nullptr;
+}
+
+SegregatedFitAllocator::Block *SegregatedFitAllocator::SplitBlock(
+    Shard *shard, Block *block, size_t size) {
+  size_t remaining_size = block->size_ - size;
+  if (remaining_size > 0) {
+    auto *remaining = new Block(reinterpret_cast<uint8_t *>(block->ptr_) + size,
+                                remaining_size,
+                                block->chunk_);
+    remaining->prev_phys_ = block;
+    remaining->next_phys_ = block->next_phys_;
+    if (block->next_phys_ != nullptr) {
+      block->next_phys_->prev_phys_ = remaining;
+    }
+    block->next_phys_ = remaining;
+    block->size_ = size;
+    InsertFreeBlock(shard, remaining);
+  }
+  block->is_free_ = false;
+  return block;
+}
+
+SegregatedFitAllocator::Block *SegregatedFitAllocator::AllocateFromShard(
+    Shard *shard, size_t size) {
+  // Round the request up to the next bin boundary, so that any block in the
+  // bin found below is large enough.
+  size_t units = size / alignment_;
+  if (units >= kSLCount) {
+    units += (1UL << (HighestBit(units) - kSLBits)) - 1;
+  }
+  size_t fl, sl;
+  Mapping(units, &fl, &sl);
+  if (fl >= kFLCount) {
+    return nullptr;
+  }
+
+  uint32_t sl_map = shard->sl_bitmap_[fl] & (~0U << sl);
+  if (sl_map == 0) {
+    uint64_t fl_map =
+        fl + 1 < kFLCount ? shard->fl_bitmap_ & (~0ULL << (fl + 1)) : 0;
+    if (fl_map == 0) {
+      return nullptr;
+    }
+    fl = LowestBit(fl_map);
+    sl_map = shard->sl_bitmap_[fl];
+  }
+  sl = LowestBit(sl_map);
+
+  Block *block = shard->free_lists_[fl][sl];
+  RemoveFreeBlock(shard, block);
+  VLOG(10) << "Allocate " << size << " bytes from free block size "
+           << block->size_;
+  return SplitBlock(shard, block, size);
+}
+
+SegregatedFitAllocator::Block *SegregatedFitAllocator::GrowShard(
+    size_t shard_id, size_t size) {
+  if (FLAGS_free_when_no_cache_hit) {
+    FreeIdleChunks();
+  }
+  size_t realloc_size = std::max(size, chunk_size_);
+
+  // Allocate from the underlying allocator out of the lock of the shard.
+  DecoratedAllocationPtr allocation;
+  try {
+    allocation = static_unique_ptr_cast<Allocation>(
+        underlying_allocator_->Allocate(realloc_size));
+  } catch (BadAlloc &ex) {
+    if (FLAGS_free_when_no_cache_hit) throw ex;
+    FreeIdleChunks();
+    allocation = static_unique_ptr_cast<Allocation>(
+        underlying_allocator_->Allocate(realloc_size));
+  }
+  realloc_size = allocation->size() / alignment_ * alignment_;
+  VLOG(2) << "Not found and reallocate " << realloc_size << "("
+          << allocation->ptr() << ") in shard " << shard_id;
+
+  Shard *shard = shards_[shard_id].get();
+  std::lock_guard<SpinLock> guard(shard->spinlock_);
+  shard->chunks_.emplace_back(std::move(allocation), shard_id);
+  Chunk *chunk = &shard->chunks_.back();
+  chunk->first_block_ =
+      new Block(chunk->allocation_->ptr(), realloc_size, chunk);
+  return SplitBlock(shard, chunk->first_block_, size);
+}
+
+size_t SegregatedFitAllocator::HomeShard() const {
+  static thread_local size_t thread_ordinal =
+      g_next_thread_ordinal.fetch_add(1, std::memory_order_relaxed);
+  return thread_ordinal % shards_.size();
+}
+
+phi::Allocation *SegregatedFitAllocator::AllocateImpl(size_t unaligned_size) {
+  phi::RecordEvent record("SegregatedFitAllocator::Allocate",
+                          phi::TracerEventType::UserDefined,
+                          9 /*level*/);
+  size_t size = std::max(AlignedSize(unaligned_size, alignment_), alignment_);
+  VLOG(10) << "Allocate " << unaligned_size << " bytes, aligned to " << size;
+
+  size_t home = HomeShard();
+  Block *block = nullptr;
+  for (size_t i = 0; i < shards_.size() && block == nullptr; ++i) {
+    Shard *shard = shards_[(home + i) % shards_.size()].get();
+    std::lock_guard<SpinLock> guard(shard->spinlock_);
+    block = AllocateFromShard(shard, size);
+  }
+  if (block == nullptr) {
+    block = GrowShard(home, size);
+  }
+  VLOG(10) << "Alloc " << block->size_ << " bytes, ptr = " << block->ptr_;
+  return new BlockAllocation(block);
+}
+
+void SegregatedFitAllocator::FreeImpl(phi::Allocation *allocation) {
+  phi::RecordEvent record("SegregatedFitAllocator::Free",
+                          phi::TracerEventType::UserDefined,
+                          9 /*level*/);
+  VLOG(10) << "Free " << allocation->size()
+           << " bytes, ptr = " << allocation->ptr();
+  Block *block = static_cast<BlockAllocation *>(allocation)->block_;
+  Shard *shard = shards_[block->chunk_->shard_id_].get();
+  {
+    std::lock_guard<SpinLock> guard(shard->spinlock_);
+    Block *prev = block->prev_phys_;
+    if (prev != nullptr && prev->is_free_) {
+      RemoveFreeBlock(shard, prev);
+      prev->size_ += block->size_;
+      prev->next_phys_ = block->next_phys_;
+      if (block->next_phys_ != nullptr) {
+        block->next_phys_->prev_phys_ = prev;
+      }
+      delete block;
+      block = prev;
+    }
+    Block *next = block->next_phys_;
+    if (next != nullptr && next->is_free_) {
+      RemoveFreeBlock(shard, next);
+      block->size_ += next->size_;
+      block->next_phys_ = next->next_phys_;
+      if (next->next_phys_ != nullptr) {
+        next->next_phys_->prev_phys_ = block;
+      }
+      delete next;
+    }
+    InsertFreeBlock(shard, block);
+  }
+  delete allocation;
+
+  if (FLAGS_free_idle_chunk) {
+    FreeIdleChunks();
+  }
+}
+
+uint64_t SegregatedFitAllocator::FreeIdleChunks(Shard *shard) {
+  uint64_t bytes = 0;
+  for (auto chunk_it = shard->chunks_.begin();
+       chunk_it != shard->chunks_.end();) {
+    Block *block = chunk_it->first_block_;
+    if (block->is_free_ && block->next_phys_ == nullptr) {
+      VLOG(2) << "Free chunk with size " << block->size_;
+      bytes += block->size_;
+      RemoveFreeBlock(shard, block);
+      delete block;
+      chunk_it = shard->chunks_.erase(chunk_it);
+    } else {
+      ++chunk_it;
+    }
+  }
+  return bytes;
+}
+
+uint64_t SegregatedFitAllocator::FreeIdleChunks() {
+  if (!allow_free_idle_chunk_) {
+    return 0;
+  }
+  uint64_t bytes = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<SpinLock> guard(shard->spinlock_);
+    bytes += FreeIdleChunks(shard.get());
+  }
+  return bytes;
+}
+
+}  // namespace paddle::memory::allocation
@@ -0,0 +1,148 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "paddle/phi/core/memory/allocation/allocator.h"
+#include "paddle/phi/core/memory/allocation/spin_lock.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// A segregated-fit variant of AutoGrowthBestFitAllocator.
+//
+// Free blocks are binned by size in two levels: the first level by the power
+// of two of the size, the second level splits each power of two into kSLCount
+// linear bins. Each level keeps a bitmap of non-empty bins, so finding a free
+// block that fits takes two bit scans instead of a tree lookup, and inserting
+// or removing a free block is O(1).
+//
+// The pool is split into shards, each with its own bins, chunks and lock. A
+// thread allocates from its home shard first, then from the other shards
+// before growing its home shard, so threads seldom contend on the same lock.
+// A block is always freed to the shard owning its chunk, where it is merged
+// with its free neighbors.
+class SegregatedFitAllocator : public Allocator {
+ public:
+  SegregatedFitAllocator(std::shared_ptr<Allocator> underlying_allocator,
+                         size_t alignment,
+                         size_t chunk_size = 0,
+                         bool allow_free_idle_chunk = true,
+                         size_t shard_num = 1);
+
+  ~SegregatedFitAllocator() override;
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+ protected:
+  phi::Allocation *AllocateImpl(size_t size) override;
+
+  void FreeImpl(phi::Allocation *allocation) override;
+
+  // Release the chunks which are not used in all shards.
+  uint64_t ReleaseImpl(const phi::Place &place) override {
+    return FreeIdleChunks();
+  }
+
+ private:
+  static constexpr size_t kSLBits = 4;
+  static constexpr size_t kSLCount = 1UL << kSLBits;
+  static constexpr size_t kFLCount = 64 - kSLBits + 1;
+
+  struct Chunk;
+
+  struct Block {
+    Block(void *ptr, size_t size, Chunk *chunk)
+        : ptr_(ptr), size_(size), chunk_(chunk) {}
+
+    void *ptr_;
+    size_t size_;
+    bool is_free_{true};
+    Chunk *chunk_;  // which chunk it is from
+    // Neighbors in address order inside the chunk.
+    Block *prev_phys_{nullptr};
+    Block *next_phys_{nullptr};
+    // Neighbors in the free list of its bin, only valid if is_free_.
+    Block *prev_free_{nullptr};
+    Block *next_free_{nullptr};
+  };
+
+  struct Chunk {
+    Chunk(DecoratedAllocationPtr allocation, size_t shard_id)
+        : allocation_(std::move(allocation)), shard_id_(shard_id) {}
+
+    DecoratedAllocationPtr allocation_;
+    size_t shard_id_;
+    Block *first_block_{nullptr};
+  };
+
+  struct Shard {
+    SpinLock spinlock_;
+    uint64_t fl_bitmap_{0};
+    std::array<uint32_t, kFLCount> sl_bitmap_{};
+    std::array<std::array<Block *, kSLCount>, kFLCount> free_lists_{};
+    std::list<Chunk> chunks_;
+  };
+
+  struct BlockAllocation : public Allocation {
+    explicit BlockAllocation(Block *block)
+        : Allocation(block->ptr_,
+                     block->chunk_->allocation_->base_ptr(),
+                     block->size_,
+                     block->chunk_->allocation_->place()),
+          block_(block) {}
+
+    Block *block_;
+  };
+
+  // Maps a size in units of alignment_ to its bin.
+  static void Mapping(size_t units, size_t *fl, size_t *sl);
+
+  void InsertFreeBlock(Shard *shard, Block *block);
+  void RemoveFreeBlock(Shard *shard, Block *block);
+
+  // Takes `size` bytes from the free block, the rest of which goes back to
+  // the bins. Requires the lock of the shard.
+  Block *SplitBlock(Shard *shard, Block *block, size_t size);
+
+  // Returns nullptr if no free block in the shard fits. Requires the lock of
+  // the shard.
+  Block *AllocateFromShard(Shard *shard, size_t size);
+
+  // Allocates a new chunk from the underlying allocator for the shard.
+  Block *GrowShard(size_t shard_id, size_t size);
+
+  uint64_t FreeIdleChunks();
+  uint64_t FreeIdleChunks(Shard *shard);
+
+  size_t HomeShard() const;
+
+  std::shared_ptr<Allocator> underlying_allocator_;
+  size_t alignment_;
+  size_t chunk_size_;
+  bool allow_free_idle_chunk_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
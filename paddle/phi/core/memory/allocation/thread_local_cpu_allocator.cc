@@ -0,0 +1,157 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/core/memory/allocation/thread_local_cpu_allocator.h"
+
+#include <atomic>
+#include <unordered_map>
+
+#include "paddle/phi/core/memory/stats.h"
+
+namespace paddle::memory::allocation {
+
+namespace {
+
+std::atomic<uint64_t> g_next_allocator_id{1};
+
+// Trivially destructible, so it is still readable after the registry below is
+// destroyed during thread exit.
+thread_local bool tls_cache_registry_destroyed = false;
+
+struct ThreadLocalCPUCacheRegistry {
+  ThreadLocalCPUCacheRegistry() {
+    // Thread local objects are destroyed in the reverse order of their
+    // construction. Touch the thread local memory stats first so that they
+    // outlive the caches, which update them when returning blocks on exit.
+    HOST_MEMORY_STAT_UPDATE(Allocated, 0, 0);
+    HOST_MEMORY_STAT_UPDATE(Reserved, 0, 0);
+  }
+
+  ~ThreadLocalCPUCacheRegistry() { tls_cache_registry_destroyed = true; }
+
+  std::unordered_map<uint64_t, std::unique_ptr<ThreadLocalCPUCache>> caches;
+  // Most processes have only one ThreadLocalCPUAllocator, remember the last
+  // lookup to skip the hash map on the hot path.
+  uint64_t last_id{0};
+  ThreadLocalCPUCache* last_cache{nullptr};
+};
+
+ThreadLocalCPUCacheRegistry& GetThreadLocalCPUCacheRegistry() {
+  static thread_local ThreadLocalCPUCacheRegistry registry;
+  return registry;
+}
+
+}  // namespace
+
+size_t ThreadLocalCPUCache::Release() {
+  size_t released = 0;
+  for (auto& head : free_lists_) {
+    while (head != nullptr) {
+      ThreadLocalCPUAllocation* allocation = head;
+      head = allocation->next_;
+      released += allocation->size();
+      delete allocation;
+    }
+  }
+  cached_bytes_ = 0;
+  VLOG(10) << "ThreadLocalCPUCache::Release " << released;
+  return released;
+}
+
+ThreadLocalCPUAllocator::ThreadLocalCPUAllocator(
+    std::shared_ptr<Allocator> backend, size_t cache_capacity)
+    : backend_(std::move(backend)),
+      cache_capacity_(cache_capacity),
+      id_(g_next_allocator_id.fetch_add(1)) {
+  PADDLE_ENFORCE_NOT_NULL(
+      backend_,
+      common::errors::InvalidArgument(
+          "The backend of ThreadLocalCPUAllocator should not be nullptr."));
+  VLOG(4) << "ThreadLocalCPUAllocator " << id_
+          << " cache_capacity: " << cache_capacity_;
+}
+
+ThreadLocalCPUAllocator::~ThreadLocalCPUAllocator() {
+  if (tls_cache_registry_destroyed) {
+    return;
+  }
+  auto& registry = GetThreadLocalCPUCacheRegistry();
+  if (registry.last_id == id_) {
+    registry.last_id = 0;
+    registry.last_cache = nullptr;
+  }
+  registry.caches.erase(id_);
+}
+
+ThreadLocalCPUCache* ThreadLocalCPUAllocator::GetThreadCache() {
+  if (tls_cache_registry_destroyed) {
+    return nullptr;
+  }
+  auto& registry = GetThreadLocalCPUCacheRegistry();
+  if (registry.last_id == id_) {
+    return registry.last_cache;
+  }
+  auto& cache = registry.caches[id_];
+  if (cache == nullptr) {
+    cache = std::make_unique<ThreadLocalCPUCache>(backend_, cache_capacity_);
+  }
+  registry.last_id = id_;
+  registry.last_cache = cache.get();
+  return cache.get();
+}
+
+phi::Allocation* ThreadLocalCPUAllocator::AllocateImpl(size_t size) {
+  if (size > CPUSizeClass::kMaxSize) {
+    return backend_->Allocate(size).release();
+  }
+  size_t index = CPUSizeClass::Index(size);
+  ThreadLocalCPUCache* cache = GetThreadCache();
+  if (cache != nullptr) {
+    ThreadLocalCPUAllocation* allocation = cache->Pop(index);
+    if (allocation != nullptr) {
+      return allocation;
+    }
+  }
+  size_t class_size = CPUSizeClass::Size(index);
+  VLOG(10) << "ThreadLocalCPUAllocator cache miss, size: " << size
+           << ", class size: " << class_size;
+  return new ThreadLocalCPUAllocation(
+      static_unique_ptr_cast<Allocation>(backend_->Allocate(class_size)),
+      class_size,
+      index);
+}
+
+void ThreadLocalCPUAllocator::FreeImpl(phi::Allocation* allocation) {
+  // Blocks larger than the biggest class come from the backend directly, and
+  // a ThreadLocalCPUAllocation is never larger than it.
+  if (allocation->size() > CPUSizeClass::kMaxSize) {
+    backend_->Free(allocation);
+    return;
+  }
+  auto* tl_allocation = static_cast<ThreadLocalCPUAllocation*>(allocation);
+  ThreadLocalCPUCache* cache = GetThreadCache();
+  if (cache == nullptr || !cache->Push(tl_allocation)) {
+    delete tl_allocation;
+  }
+}
+
+uint64_t ThreadLocalCPUAllocator::ReleaseImpl(const phi::Place& place) {
+  ThreadLocalCPUCache* cache = GetThreadCache();
+  if (cache != nullptr) {
+    cache->Release();
+  }
+  return backend_->Release(place);
+}
+
+}  // namespace paddle::memory::allocation
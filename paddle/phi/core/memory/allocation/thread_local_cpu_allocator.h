@@ -0,0 +1,173 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <utility>
+
+#include "paddle/phi/core/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// Size classes served by ThreadLocalCPUAllocator: one 64 bytes class, then 4
+// classes per power of two up to kMaxSize, which bounds the internal
+// fragmentation of a cached block by 25%.
+struct CPUSizeClass {
+  static constexpr size_t kMinShift = 6;
+  static constexpr size_t kMaxShift = 20;
+  static constexpr size_t kMinSize = 1UL << kMinShift;
+  static constexpr size_t kMaxSize = 1UL << kMaxShift;
+  static constexpr size_t kNumClasses = 1 + (kMaxShift - kMinShift) * 4;
+
+  // Returns the index of the smallest class that holds `size`, `size` must
+  // not be larger than kMaxSize.
+  static size_t Index(size_t size) {
+    if (size <= kMinSize) {
+      return 0;
+    }
+    size_t shift = HighestBit(size - 1);
+    size_t step = 1UL << (shift - 2);
+    size_t rounded = (size + step - 1) & ~(step - 1);
+    return 1 + (shift - kMinShift) * 4 + ((rounded >> (shift - 2)) - 5);
+  }
+
+  // Returns the block size of the class `index`.
+  static size_t Size(size_t index) {
+    if (index == 0) {
+      return kMinSize;
+    }
+    size_t shift = kMinShift + (index - 1) / 4;
+    return (1UL << shift) + ((index - 1) % 4 + 1) * (1UL << (shift - 2));
+  }
+
+ private:
+  static size_t HighestBit(size_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(static_cast<unsigned long long>(x));  // NOLINT
+#else
+    size_t bit = 0;
+    while (x >>= 1) {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+};
+
+class ThreadLocalCPUCache;
+
+class ThreadLocalCPUAllocation : public Allocation {
+ public:
+  ThreadLocalCPUAllocation(DecoratedAllocationPtr underlying_allocation,
+                           size_t size,
+                           size_t index)
+      : Allocation(underlying_allocation->ptr(),
+                   underlying_allocation->base_ptr(),
+                   size,
+                   underlying_allocation->place()),
+        underlying_allocation_(std::move(underlying_allocation)),
+        index_(index) {}
+
+ private:
+  DecoratedAllocationPtr underlying_allocation_;
+  size_t index_;
+  // Intrusive link of the free list while the block is cached by a thread.
+  ThreadLocalCPUAllocation* next_{nullptr};
+
+  friend class ThreadLocalCPUCache;
+};
+
+// Free lists of one thread, one list per size class. It is only touched by
+// its owner thread, so no lock is needed. Cached blocks go back to the shared
+// backend when the cache is released or the thread exits.
+class ThreadLocalCPUCache {
+ public:
+  ThreadLocalCPUCache(std::shared_ptr<Allocator> backend, size_t capacity)
+      : backend_(std::move(backend)), capacity_(capacity) {}
+
+  ~ThreadLocalCPUCache() { Release(); }
+
+  ThreadLocalCPUAllocation* Pop(size_t index) {
+    ThreadLocalCPUAllocation* allocation = free_lists_[index];
+    if (allocation != nullptr) {
+      free_lists_[index] = allocation->next_;
+      cached_bytes_ -= allocation->size();
+    }
+    return allocation;
+  }
+
+  // Returns false if the cache is full, the caller should free the block to
+  // the backend then.
+  bool Push(ThreadLocalCPUAllocation* allocation) {
+    if (cached_bytes_ + allocation->size() > capacity_) {
+      return false;
+    }
+    allocation->next_ = free_lists_[allocation->index_];
+    free_lists_[allocation->index_] = allocation;
+    cached_bytes_ += allocation->size();
+    return true;
+  }
+
+  // Returns all cached blocks to the backend and the bytes of them.
+  size_t Release();
+
+ private:
+  // Keeps the backend alive until the cached blocks are returned, since a
+  // thread may exit after the front-end allocator is destroyed.
+  std::shared_ptr<Allocator> backend_;
+  size_t capacity_;
+  size_t cached_bytes_{0};
+  std::array<ThreadLocalCPUAllocation*, CPUSizeClass::kNumClasses>
+      free_lists_{};
+};
+
+// A CPU allocator serving small requests from thread local size-class caches
+// in front of a shared best-fit backend, in the spirit of
+// ThreadLocalCUDAAllocator. Allocating and freeing a cached size class takes
+// no lock, the backend is only reached on a cache miss, when the cache of the
+// freeing thread is full, or for requests larger than CPUSizeClass::kMaxSize.
+// A block freed by another thread is cached by the freeing thread.
+class ThreadLocalCPUAllocator : public Allocator {
+ public:
+  ThreadLocalCPUAllocator(std::shared_ptr<Allocator> backend,
+                          size_t cache_capacity);
+
+  ~ThreadLocalCPUAllocator() override;
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+ protected:
+  phi::Allocation* AllocateImpl(size_t size) override;
+  void FreeImpl(phi::Allocation* allocation) override;
+  // Only the cache of the calling thread is flushed before releasing the
+  // backend, caches of other threads are left untouched.
+  uint64_t ReleaseImpl(const phi::Place& place) override;
+
+ private:
+  // Returns nullptr if the thread local caches have been destroyed, which
+  // happens when a block is freed during thread exit.
+  ThreadLocalCPUCache* GetThreadCache();
+
+  std::shared_ptr<Allocator> backend_;
+  size_t cache_capacity_;
+  uint64_t id_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -19,7 +19,9 @@
 #include "paddle/phi/kernels/funcs/axis_utils.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
 #include "paddle/phi/kernels/funcs/eigen/eigen_function.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 namespace phi {
 
@@ -51,6 +53,22 @@ struct LogSoftmaxFunctor {
     const int d = funcs::SizeFromAxis(axis, X->dims());
     phi::DDim dim_2d{n, d};
 
+    if (axis_dim == d) {
+      // the last axis, n independent rows of d
+      auto compute_log_softmax =
+          jit::KernelFuncs<jit::LogSoftmaxTuple<T>, phi::CPUPlace>::Cache().At(
+              d);
+      const T* in_data = X->data<T>();
+      T* out_data = Y->data<T>();
+      funcs::ParallelFor(context, n, d, [&](int64_t begin, int64_t end) {
+        compute_log_softmax(in_data + begin * d,
+                            out_data + begin * d,
+                            d,
+                            static_cast<int>(end - begin));
+      });
+      return;
+    }
+
     auto logits = EigenMatrixTemplate<T>::From(*X, dim_2d);
     auto log_softmax = EigenMatrixTemplate<T>::From(*Y, dim_2d);
 
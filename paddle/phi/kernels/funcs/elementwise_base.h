@@ -14,6 +14,9 @@ limitations under the License. */
 
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include "paddle/phi/backends/all_context.h"
 #include "paddle/phi/common/transform.h"
 #include "paddle/phi/core/dense_tensor.h"
@@ -193,82 +196,86 @@ class MidWiseTransformIterator<T, GPUContext>
 };
 #endif
 
-template <typename Functor,
-          typename T,
-          typename DeviceContext,
-          typename OutType = T>
-class TransformFunctor {
- public:
-  TransformFunctor(const DenseTensor &x,
-                   const DenseTensor &y,
-                   DenseTensor *z,
-                   const DeviceContext &ctx,
-                   Functor func,
-                   const bool is_xsize_larger = true)
-      : x_(x.data<T>()),
-        y_(y.data<T>()),
-        z_(ctx.template Alloc<OutType>(z)),
-        nx_(x.numel()),
-        ctx_(ctx),
-        func_(func),
-        is_xsize_larger_(is_xsize_larger) {
-    if (is_xsize_larger_ == false) {
-      nx_ = y.numel();
+// Merges adjacent dims of out whose broadcast pattern is the same for both
+// inputs and drops dims of size 1, then returns the merged out dims and the
+// element strides of x and y on them, which are 0 on broadcast dims.
+inline void SimplifyBroadcastDimsCPU(const int *x_dims_array,
+                                     const int *y_dims_array,
+                                     const int *out_dims_array,
+                                     int max_dim,
+                                     std::vector<int64_t> *out_dims,
+                                     std::vector<int64_t> *x_strides,
+                                     std::vector<int64_t> *y_strides) {
+  std::vector<bool> x_broadcast;
+  std::vector<bool> y_broadcast;
+  out_dims->clear();
+  for (int i = 0; i < max_dim; ++i) {
+    if (out_dims_array[i] == 1) {
+      continue;
     }
-  }
-
-  inline void Run() const {
-    phi::Transform<DeviceContext> trans;
-    trans(ctx_, x_, x_ + nx_, y_, z_, func_);
-  }
-
-  inline void RunRowWise(int n) const {
-    phi::Transform<DeviceContext> trans;
-    if (is_xsize_larger_) {
-      trans(ctx_,
-            x_,
-            x_ + nx_,
-            RowwiseTransformIterator<T, DeviceContext>(y_, n),
-            z_,
-            func_);
+    bool x_bcast = x_dims_array[i] == 1;
+    bool y_bcast = y_dims_array[i] == 1;
+    if (!out_dims->empty() && x_broadcast.back() == x_bcast &&
+        y_broadcast.back() == y_bcast) {
+      out_dims->back() *= out_dims_array[i];
     } else {
-      trans(ctx_,
-            y_,
-            y_ + nx_,
-            RowwiseTransformIterator<T, DeviceContext>(x_, n),
-            z_,
-            func_);
+      out_dims->push_back(out_dims_array[i]);
+      x_broadcast.push_back(x_bcast);
+      y_broadcast.push_back(y_bcast);
     }
   }
-
-  inline void RunMidWise(int n, int post) const {
-    phi::Transform<DeviceContext> trans;
-    if (is_xsize_larger_) {
-      trans(ctx_,
-            x_,
-            x_ + nx_,
-            MidWiseTransformIterator<T, DeviceContext>(y_, n, post),
-            z_,
-            func_);
-    } else {
-      trans(ctx_,
-            y_,
-            y_ + nx_,
-            MidWiseTransformIterator<T, DeviceContext>(x_, n, post),
-            z_,
-            func_);
+  if (out_dims->empty()) {
+    out_dims->push_back(1);
+    x_broadcast.push_back(false);
+    y_broadcast.push_back(false);
+  }
+
+  int rank = static_cast<int>(out_dims->size());
+  x_strides->resize(rank);
+  y_strides->resize(rank);
+  int64_t x_stride = 1;
+  int64_t y_stride = 1;
+  for (int i = rank - 1; i >= 0; --i) {
+    (*x_strides)[i] = x_broadcast[i] ? 0 : x_stride;
+    (*y_strides)[i] = y_broadcast[i] ? 0 : y_stride;
+    if (!x_broadcast[i]) {
+      x_stride *= (*out_dims)[i];
+    }
+    if (!y_broadcast[i]) {
+      y_stride *= (*out_dims)[i];
     }
   }
+}
 
- private:
-  const T *x_;
-  const T *y_;
-  OutType *z_;
-  int64_t nx_;
-  const DeviceContext &ctx_;
-  Functor func_;
-  bool is_xsize_larger_;
-};
+// out[i] = func(a[i * a_stride], b[i * b_stride]) with strides of 0 or 1.
+// A broadcast operand is loaded once so that the loops vectorize.
+template <typename Functor, typename T, typename OutType>
+inline void BroadcastInnerLoopCPU(const T *a,
+                                  int64_t a_stride,
+                                  const T *b,
+                                  int64_t b_stride,
+                                  OutType *out,
+                                  int64_t n,
+                                  Functor func) {
+  if (a_stride != 0 && b_stride != 0) {
+    for (int64_t i = 0; i < n; ++i) {
+      out[i] = func(a[i], b[i]);
+    }
+  } else if (a_stride != 0) {
+    const T b_value = *b;
+    for (int64_t i = 0; i < n; ++i) {
+      out[i] = func(a[i], b_value);
+    }
+  } else if (b_stride != 0) {
+    const T a_value = *a;
+    for (int64_t i = 0; i < n; ++i) {
+      out[i] = func(a_value, b[i]);
+    }
+  } else {
+    const OutType value = func(*a, *b);
+    std::fill(out, out + n, value);
+  }
+}
 
 template <typename Functor, typename T, typename OutType = T>
 void CommonForwardBroadcastCPU(const DenseTensor &x,
@@ -281,29 +288,75 @@ void CommonForwardBroadcastCPU(const DenseTensor &x,
                                const CPUContext &ctx,
                                Functor func,
                                const bool is_xsize_larger = true) {
-  std::vector<int> index_array(max_dim, 0);
+  OutType *out_data = ctx.Alloc<OutType>(z);
+  int64_t out_size = 1;
+  for (int i = 0; i < max_dim; ++i) {
+    out_size *= out_dims_array[i];
+  }
+  if (out_size <= 0) {
+    return;
+  }
   const T *x_data = x.data<T>();
   const T *y_data = y.data<T>();
   PADDLE_ENFORCE_NOT_NULL(
       x_data, errors::InvalidArgument("The input X should not be empty."));
   PADDLE_ENFORCE_NOT_NULL(
       y_data, errors::InvalidArgument("The input Y should not be empty."));
-  OutType *out_data = ctx.Alloc<OutType>(z);
 
-  const int out_size = std::accumulate(
-      out_dims_array, out_dims_array + max_dim, 1, std::multiplies<int>());
-  int x_index, y_index;
-  for (int out_index = 0; out_index < out_size; ++out_index) {
-    x_index = GetElementwiseIndex(x_dims_array, max_dim, index_array.data());
-    y_index = GetElementwiseIndex(y_dims_array, max_dim, index_array.data());
-    if (is_xsize_larger) {
-      out_data[out_index] = func(x_data[x_index], y_data[y_index]);
-    } else {
-      out_data[out_index] = func(y_data[y_index], x_data[x_index]);
+  std::vector<int64_t> out_dims;
+  std::vector<int64_t> x_strides;
+  std::vector<int64_t> y_strides;
+  SimplifyBroadcastDimsCPU(x_dims_array,
+                           y_dims_array,
+                           out_dims_array,
+                           max_dim,
+                           &out_dims,
+                           &x_strides,
+                           &y_strides);
+  // func takes the larger input first
+  const T *a_data = is_xsize_larger ? x_data : y_data;
+  const T *b_data = is_xsize_larger ? y_data : x_data;
+  const std::vector<int64_t> &a_strides =
+      is_xsize_larger ? x_strides : y_strides;
+  const std::vector<int64_t> &b_strides =
+      is_xsize_larger ? y_strides : x_strides;
+
+  // the innermost dim is a contiguous run, outer dims are walked with an
+  // index that is decomposed once per range
+  const int outer_rank = static_cast<int>(out_dims.size()) - 1;
+  const int64_t inner = out_dims.back();
+  const int64_t outer = out_size / inner;
+  ctx.ParallelFor(outer, inner, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> index(outer_rank, 0);
+    int64_t a_offset = 0;
+    int64_t b_offset = 0;
+    int64_t rest = begin;
+    for (int i = outer_rank - 1; i >= 0; --i) {
+      index[i] = rest % out_dims[i];
+      rest /= out_dims[i];
+      a_offset += index[i] * a_strides[i];
+      b_offset += index[i] * b_strides[i];
     }
-
-    UpdateElementwiseIndexArray(out_dims_array, max_dim, index_array.data());
-  }
+    for (int64_t o = begin; o < end; ++o) {
+      BroadcastInnerLoopCPU<Functor, T, OutType>(a_data + a_offset,
+                                                 a_strides[outer_rank],
+                                                 b_data + b_offset,
+                                                 b_strides[outer_rank],
+                                                 out_data + o * inner,
+                                                 inner,
+                                                 func);
+      for (int i = outer_rank - 1; i >= 0; --i) {
+        a_offset += a_strides[i];
+        b_offset += b_strides[i];
+        if (++index[i] < out_dims[i]) {
+          break;
+        }
+        a_offset -= a_strides[i] * out_dims[i];
+        b_offset -= b_strides[i] * out_dims[i];
+        index[i] = 0;
+      }
+    }
+  });
 }
 
 template <typename Functor, typename T, typename OutType = T>
@@ -356,13 +409,13 @@ void CommonElementwiseBroadcastForward(const CPUContext &dev_ctx,
 
 // It is a common CPU implementation to compute binary calculation with the
 // support of broadcast. Note:
-// 1. CPU implementation cannot support the case when x needs broadcast, thus
-//    this function need to be called with XxxFunctor and XxxInverseFunctor,
-//    like AddFunctor and InverseAddFunctor.
+// 1. func is called with the input of larger rank first, thus this function
+//    need to be called with XxxFunctor and XxxInverseFunctor, like AddFunctor
+//    and InverseAddFunctor.
 // 2. The corresponding GPU implementation supports all the broadcast cases,
 //    thus there is no need to define and call with XxxInverseFunctor.
-// TODO(liuyiqun): optimize the CPU implementation to support all broadcast
-// cases and avoid the need of XxxInverseFunctor.
+// All shapes go through CommonForwardBroadcastCPU, which runs contiguous
+// inner loops and splits outer loops across the intra-op threads.
 template <typename Functor, typename T, typename OutType = T>
 void ElementwiseCompute(const CPUContext &dev_ctx,
                         const DenseTensor &x,
@@ -379,10 +432,9 @@ void ElementwiseCompute(const CPUContext &dev_ctx,
     is_xsize_larger = false;
     max_dim = y_dims.size();
   }
-  TransformFunctor<Functor, T, CPUContext, OutType> functor(
-      x, y, z, dev_ctx, func, is_xsize_larger);
   if (x_dims == y_dims) {
-    functor.Run();
+    CommonElementwiseBroadcastForward<Functor, T, OutType>(
+        dev_ctx, x, y, z, x_dims, y_dims, func, 0, is_xsize_larger);
     return;
   }
 
@@ -401,43 +453,18 @@ void ElementwiseCompute(const CPUContext &dev_ctx,
           max_dim,
           axis));
 
-  int pre, n, post, is_run_common_broadcast, axis_trim = 0;
+  // trailing 1s of the smaller input may reach past the larger one, e.g.
+  // x=[2,3,4], y=[3,1,1] with axis=1, they are trimmed as they broadcast
   if (is_xsize_larger) {
     auto y_dims_trimed = TrimTrailingSingularDims(y_dims);
-    axis_trim = (y_dims_trimed.size() == 0) ? x_dims.size() : axis;
-    GetMidDims(x_dims,
-               y_dims_trimed,
-               axis_trim,
-               &pre,
-               &n,
-               &post,
-               &is_run_common_broadcast);
+    int axis_trim = (y_dims_trimed.size() == 0) ? x_dims.size() : axis;
+    CommonElementwiseBroadcastForward<Functor, T, OutType>(
+        dev_ctx, x, y, z, x_dims, y_dims_trimed, func, axis_trim, true);
   } else {
     auto x_dims_trimed = TrimTrailingSingularDims(x_dims);
-    axis_trim = (x_dims_trimed.size() == 0) ? y_dims.size() : axis;
-    GetMidDims(y_dims,
-               x_dims_trimed,
-               axis_trim,
-               &pre,
-               &n,
-               &post,
-               &is_run_common_broadcast);
-  }
-  // special case for common implementation.
-  // case 1: x=[2,3,1,5], y=[2,1,4,1]
-  // case 2: x=[2,3,4], y=[1,1,4]
-  if (is_run_common_broadcast == 1) {
+    int axis_trim = (x_dims_trimed.size() == 0) ? y_dims.size() : axis;
     CommonElementwiseBroadcastForward<Functor, T, OutType>(
-        dev_ctx, x, y, z, x_dims, y_dims, func, axis, is_xsize_larger);
-    return;
-  }
-
-  if (post == 1) {
-    functor.RunRowWise(n);
-    return;
-  } else {
-    functor.RunMidWise(n, post);
-    return;
+        dev_ctx, x, y, z, x_dims_trimed, y_dims, func, axis_trim, false);
   }
 }
 
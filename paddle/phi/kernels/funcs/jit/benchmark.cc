@@ -155,6 +155,21 @@ void BenchKernelXYZN() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelXYNBS() {
+  using T = typename KernelTuple::data_type;
+  const int bs = 64;
+  for (int d : TestSizes()) {
+    phi::DenseTensor x, y;
+    x.Resize({bs, d});
+    y.Resize({bs, d});
+    T* x_data = x.mutable_data<T>(PlaceType());
+    T* y_data = y.mutable_data<T>(PlaceType());
+    RandomVec<T>(bs * d, x_data);
+    BenchAllImpls<KernelTuple, PlaceType>(d, x.data<T>(), y_data, d, bs);
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void BenchKernelAXYN() {
   using T = typename KernelTuple::data_type;
@@ -488,6 +503,9 @@ void BenchKernelVBroadcast() {
 #define BenchKernelVTanh BenchKernelXYN
 #define BenchKernelVCopy BenchKernelXYN
 
+#define BenchKernelSoftmax BenchKernelXYNBS
+#define BenchKernelLogSoftmax BenchKernelXYNBS
+
 #define BenchKernelLSTMCtHt BenchKernelLSTM
 #define BenchKernelLSTMC1H1 BenchKernelLSTM
 
@@ -521,6 +539,10 @@ BENCH_FP32_CPU(VSigmoid);
 BENCH_FP32_CPU(VTanh);
 BENCH_FP32_CPU(VCopy);
 
+// xynbs
+BENCH_FP32_CPU(Softmax);
+BENCH_FP32_CPU(LogSoftmax);
+
 // LSTM
 BENCH_FP32_CPU(LSTMCtHt);
 BENCH_FP32_CPU(LSTMC1H1);
@@ -0,0 +1,131 @@
+/* Copyright (c) 2019 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+
+#include "paddle/phi/kernels/funcs/jit/gen/softmax.h"
+
+#include "paddle/phi/backends/cpu/cpu_info.h"
+#include "paddle/phi/kernels/funcs/jit/registry.h"
+
+namespace phi::jit::gen {
+
+void SoftmaxJitCode::reduce_ymm(operand_type type, const ymm_t& dst) {
+  xmm_t xmm_dst = xmm_t(dst.getIdx());
+  xmm_t xmm_tmp = xmm_t(ymm_tmp.getIdx());
+  auto op = [&](const xmm_t& x) {
+    if (type == operand_type::MAX) {
+      vmaxps(xmm_dst, xmm_dst, x);
+    } else {
+      vaddps(xmm_dst, xmm_dst, x);
+    }
+  };
+  vextractf128(xmm_tmp, dst, 1);
+  op(xmm_tmp);
+  vpermilps(xmm_tmp, xmm_dst, 0x4E);  // swap the 64 bits halves
+  op(xmm_tmp);
+  vpermilps(xmm_tmp, xmm_dst, 0xB1);  // swap the neighbouring lanes
+  op(xmm_tmp);
+  vinsertf128(dst, dst, xmm_dst, 1);
+}
+
+void SoftmaxJitCode::genCode() {
+  preCode();
+  const int num_block = w_ / YMM_FLOAT_BLOCK;
+  const size_t block_size = sizeof(float) * YMM_FLOAT_BLOCK;
+  const size_t row_size = sizeof(float) * w_;
+  Label l_next_row, l_max, l_exp, l_scal, l_end;
+
+  movsxd(reg_bs, Xbyak::Reg32(param_bs.getIdx()));
+  test(reg_bs, reg_bs);
+  jle(l_end, T_NEAR);
+  L(l_next_row);
+  {
+    // max of the row
+    vmovups(ymm_max, ptr[param_x]);
+    if (num_block > 1) {
+      lea(reg_ptr_x, ptr[param_x + block_size]);
+      mov(reg_cnt, num_block - 1);
+      L(l_max);
+      vmaxps(ymm_max, ymm_max, ptr[reg_ptr_x]);
+      add(reg_ptr_x, block_size);
+      dec(reg_cnt);
+      jnz(l_max, T_NEAR);
+    }
+    reduce_ymm(operand_type::MAX, ymm_max);
+
+    // y = exp(x - max), sum += y
+    vxorps(ymm_sum, ymm_sum, ymm_sum);
+    mov(reg_ptr_x, param_x);
+    mov(reg_ptr_y, param_y);
+    mov(reg_cnt, num_block);
+    L(l_exp);
+    vmovups(ymm_src, ptr[reg_ptr_x]);
+    vsubps(ymm_src, ymm_src, ymm_max);
+    exp_jmm<ymm_t>(ymm_dst, ymm_src);
+    vmovups(ptr[reg_ptr_y], ymm_dst);
+    vaddps(ymm_sum, ymm_sum, ymm_dst);
+    add(reg_ptr_x, block_size);
+    add(reg_ptr_y, block_size);
+    dec(reg_cnt);
+    jnz(l_exp, T_NEAR);
+    reduce_ymm(operand_type::ADD, ymm_sum);
+
+    // y *= 1 / sum
+    mov(rax, reinterpret_cast<size_t>(exp_float_consts));
+    vmovaps(ymm_tmp, ptr[rax + OFFSET_EXP_ONE]);
+    vdivps(ymm_sum, ymm_tmp, ymm_sum);
+    mov(reg_ptr_y, param_y);
+    mov(reg_cnt, num_block);
+    L(l_scal);
+    vmulps(ymm_dst, ymm_sum, ptr[reg_ptr_y]);
+    vmovups(ptr[reg_ptr_y], ymm_dst);
+    add(reg_ptr_y, block_size);
+    dec(reg_cnt);
+    jnz(l_scal, T_NEAR);
+
+    add(param_x, row_size);
+    add(param_y, row_size);
+    dec(reg_bs);
+    jnz(l_next_row, T_NEAR);
+  }
+  L(l_end);
+  postCode();
+}
+
+class SoftmaxCreator : public JitCodeCreator<int> {
+ public:
+  bool CanBeUsed(const int& w) const override {
+    // exp_jmm falls back to a shared scratch buffer without avx2
+    return phi::backends::cpu::MayIUse(phi::backends::cpu::avx2) && w > 0 &&
+           w % YMM_FLOAT_BLOCK == 0;
+  }
+  size_t CodeSize(const int& w UNUSED) const override {
+    // the blocks are looped, so the code size does not depend on w
+    return 96 + 160 * 8;
+  }
+  std::unique_ptr<GenBase> CreateJitCode(const int& w) const override {
+    PADDLE_ENFORCE_GT(
+        w,
+        0,
+        common::errors::InvalidArgument(
+            "The width of Softmax should be larger than 0. But w is %d.", w));
+    return make_unique<SoftmaxJitCode>(w, CodeSize(w));
+  }
+};
+
+}  // namespace phi::jit::gen
+
+namespace gen = phi::jit::gen;
+
+REGISTER_JITKERNEL_GEN(kSoftmax, gen::SoftmaxCreator);
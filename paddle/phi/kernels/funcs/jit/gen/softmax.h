@@ -0,0 +1,69 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+
+#pragma once
+
+#include <string>
+
+#include "glog/logging.h"
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/jit/gen/act.h"
+#include "paddle/phi/kernels/funcs/jit/gen/jitcode.h"
+
+namespace phi {
+namespace jit {
+namespace gen {
+
+// Softmax of bs rows of width w. Each row is read twice: once for the max,
+// once for the shifted exp which is stored and summed in the same pass, the
+// stored row is then scaled by the inverse sum.
+class SoftmaxJitCode : public VActFunc {
+ public:
+  explicit SoftmaxJitCode(int w,
+                          size_t code_size = 256 * 1024,
+                          void* code_ptr = nullptr)
+      : VActFunc(code_size, code_ptr), w_(w) {
+    this->genCode();
+  }
+
+  DECLARE_JIT_CODE(SoftmaxJitCode);
+  void genCode() override;
+
+ private:
+  // leaves the max or the sum of all lanes of dst in every lane
+  void reduce_ymm(operand_type type, const ymm_t& dst);
+
+  int w_;
+  reg64_t param_x{abi_param1};
+  reg64_t param_y{abi_param2};
+  reg64_t param_n{abi_param3};
+  reg64_t param_bs{abi_param4};
+
+  reg64_t reg_bs{r8};
+  reg64_t reg_ptr_x{r9};
+  reg64_t reg_ptr_y{r10};
+  reg64_t reg_cnt{r11};
+
+  // exp_jmm uses ymm11 to ymm15
+  ymm_t ymm_max = ymm_t(0);
+  ymm_t ymm_sum = ymm_t(1);
+  ymm_t ymm_src = ymm_t(2);
+  ymm_t ymm_dst = ymm_t(3);
+  ymm_t ymm_tmp = ymm_t(4);
+};
+
+}  // namespace gen
+}  // namespace jit
+}  // namespace phi
@@ -53,6 +53,10 @@ const char* to_string(KernelType kt) {
     ONE_CASE(kGRUHtPart2);
     ONE_CASE(kCRFDecoding);
     ONE_CASE(kLayerNorm);
+    ONE_CASE(kLogSoftmax);
+    ONE_CASE(kRMSNorm);
+    ONE_CASE(kResidualLayerNorm);
+    ONE_CASE(kSoftmax);
     ONE_CASE(kSeqPool);
     ONE_CASE(kMatMul);
     ONE_CASE(kAdam);
@@ -34,8 +34,12 @@ typedef enum {
   kLSTMCtHt,
   kLSTMC1H1,
   kLayerNorm,
+  kLogSoftmax,
   kMatMul,
+  kRMSNorm,
+  kResidualLayerNorm,
   kSeqPool,
+  kSoftmax,
   kVAdd,
   kVAddBias,
   kVAddRelu,
@@ -96,6 +100,14 @@ struct XRNSTuple {
   typedef void (*func_type)(const T*, T*, int, int);
 };
 
+// x, y, n, bs: bs rows of width n, Softmax can be done inplace
+template <typename T>
+struct XYNBSTuple {
+  typedef T data_type;
+  typedef int attr_type;
+  typedef void (*func_type)(const T*, T*, int, int);
+};
+
 #define DECLARE_KERNELTUPLE(kernel_tuple, type)        \
   template <typename T>                                \
   struct type##Tuple : public kernel_tuple<T> {        \
@@ -119,6 +131,9 @@ DECLARE_KERNELTUPLE(XYNTuple, VSigmoid);
 DECLARE_KERNELTUPLE(XYNTuple, VTanh);
 DECLARE_KERNELTUPLE(XYNTuple, VCopy);
 
+DECLARE_KERNELTUPLE(XYNBSTuple, Softmax);
+DECLARE_KERNELTUPLE(XYNBSTuple, LogSoftmax);
+
 typedef struct lstm_t {
   void* gates;  // gates: x_ch, x_ih, x_fh, x_oh
   const void* ct_1;
@@ -360,6 +375,42 @@ struct LayerNormTuple {
       T*, T*, T*, T*, const T*, const T*, int, const float, int);
 };
 
+typedef struct norm_s {
+  const void* x;
+  // optional, when residual is set the normalized input is
+  // x + residual_alpha * residual + bias and it is written to residual_out
+  const void* residual{nullptr};
+  const void* bias{nullptr};
+  void* residual_out{nullptr};
+  // optional, elementwise affine of the normalized rows
+  const void* scale{nullptr};
+  const void* norm_bias{nullptr};
+  void* out;
+  // optional, mean and 1 / sqrt(variance + epsilon) of each row
+  void* mean{nullptr};
+  void* var{nullptr};
+  int height;
+  float epsilon;
+  float residual_alpha{1.f};
+} norm_t;
+
+// norm_t*, attr is the width of one row
+template <typename T>
+struct RMSNormTuple {
+  static constexpr KernelType kernel_type = kRMSNorm;
+  typedef T data_type;
+  typedef int attr_type;
+  typedef void (*func_type)(const norm_t*, int);
+};
+
+template <typename T>
+struct ResidualLayerNormTuple {
+  static constexpr KernelType kernel_type = kResidualLayerNorm;
+  typedef T data_type;
+  typedef int attr_type;
+  typedef void (*func_type)(const norm_t*, int);
+};
+
 // Just for adding to kernel pool without template
 class Kernel {
  public:
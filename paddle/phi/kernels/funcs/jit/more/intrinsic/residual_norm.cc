@@ -0,0 +1,199 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+
+#include "paddle/phi/kernels/funcs/jit/more/intrinsic/residual_norm.h"
+
+#include <cmath>
+#include <type_traits>
+
+#include "paddle/phi/backends/cpu/cpu_info.h"
+#include "paddle/phi/kernels/funcs/jit/registry.h"
+
+namespace phi::jit::more::intrinsic {
+
+namespace {
+
+template <bool kTail>
+inline __m256 Load(const float* p, __m256i mask) {
+  return kTail ? _mm256_maskload_ps(p, mask) : _mm256_loadu_ps(p);
+}
+
+template <bool kTail>
+inline void Store(float* p, __m256i mask, __m256 v) {
+  if (kTail) {
+    _mm256_maskstore_ps(p, mask, v);
+  } else {
+    _mm256_storeu_ps(p, v);
+  }
+}
+
+inline float HSum(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v),
+                          _mm256_extractf128_ps(v, 1));
+  sum = _mm_hadd_ps(sum, sum);
+  sum = _mm_hadd_ps(sum, sum);
+  return _mm_cvtss_f32(sum);
+}
+
+struct NormRow {
+  const float* x;
+  const float* residual;
+  const float* bias;
+  float* residual_out;
+  __m256 alpha;
+  __m256i mask;
+
+  // x + alpha * residual + bias at column j, stored to residual_out
+  template <bool kTail>
+  __m256 Input(int j) const {
+    __m256 v = Load<kTail>(x + j, mask);
+    if (residual) {
+      v = _mm256_add_ps(
+          v, _mm256_mul_ps(alpha, Load<kTail>(residual + j, mask)));
+      if (bias) {
+        v = _mm256_add_ps(v, Load<kTail>(bias + j, mask));
+      }
+      Store<kTail>(residual_out + j, mask, v);
+    }
+    return v;
+  }
+
+  // the input after Input has run on the whole row
+  template <bool kTail>
+  __m256 Stored(int j) const {
+    return Load<kTail>((residual ? residual_out : x) + j, mask);
+  }
+};
+
+template <bool kCenter>
+void Norm(const norm_t* param, int width) {
+  constexpr int block = YMM_FLOAT_BLOCK;
+  const int rest = width % block;
+  const int end = width - rest;
+  const __m256 zero = _mm256_setzero_ps();
+  const float* scale = reinterpret_cast<const float*>(param->scale);
+  const float* norm_bias = reinterpret_cast<const float*>(param->norm_bias);
+  NormRow row;
+  row.bias = reinterpret_cast<const float*>(param->bias);
+  row.alpha = _mm256_set1_ps(param->residual_alpha);
+  row.mask = _mm256_setr_epi32(rest > 0 ? -1 : 0,
+                               rest > 1 ? -1 : 0,
+                               rest > 2 ? -1 : 0,
+                               rest > 3 ? -1 : 0,
+                               rest > 4 ? -1 : 0,
+                               rest > 5 ? -1 : 0,
+                               rest > 6 ? -1 : 0,
+                               0);
+  const __m256 mask_ps = _mm256_castsi256_ps(row.mask);
+
+  for (int i = 0; i < param->height; ++i) {
+    const size_t offset = static_cast<size_t>(i) * width;
+    row.x = reinterpret_cast<const float*>(param->x) + offset;
+    row.residual = nullptr;
+    row.residual_out = nullptr;
+    if (param->residual) {
+      row.residual = reinterpret_cast<const float*>(param->residual) + offset;
+      row.residual_out = reinterpret_cast<float*>(param->residual_out) + offset;
+    }
+    float* out = reinterpret_cast<float*>(param->out) + offset;
+
+    /* get mean, the masked lanes of the tail are loaded as 0 */
+    float mean = 0.f;
+    __m256 sum = zero;
+    int j = 0;
+    for (; j < end; j += block) {
+      __m256 v = row.Input<false>(j);
+      sum = kCenter ? _mm256_add_ps(sum, v)
+                    : _mm256_add_ps(sum, _mm256_mul_ps(v, v));
+    }
+    if (rest != 0) {
+      __m256 v = row.Input<true>(j);
+      sum = kCenter ? _mm256_add_ps(sum, v)
+                    : _mm256_add_ps(sum, _mm256_mul_ps(v, v));
+    }
+    __m256 square_sum = sum;
+    if (kCenter) {
+      mean = HSum(sum) / width;
+      const __m256 mean_vec = _mm256_set1_ps(mean);
+      square_sum = zero;
+      for (j = 0; j < end; j += block) {
+        __m256 v = _mm256_sub_ps(row.Stored<false>(j), mean_vec);
+        square_sum = _mm256_add_ps(square_sum, _mm256_mul_ps(v, v));
+      }
+      if (rest != 0) {
+        __m256 v = _mm256_sub_ps(row.Stored<true>(j), mean_vec);
+        v = _mm256_and_ps(v, mask_ps);
+        square_sum = _mm256_add_ps(square_sum, _mm256_mul_ps(v, v));
+      }
+    }
+
+    /* get variance */
+    const float rstd = 1.f / std::sqrt(HSum(square_sum) / width +
+                                       param->epsilon);
+    if (param->mean) {
+      reinterpret_cast<float*>(param->mean)[i] = mean;
+    }
+    if (param->var) {
+      reinterpret_cast<float*>(param->var)[i] = rstd;
+    }
+
+    /* (x - mean) * rstd * scale + norm_bias */
+    const __m256 mean_vec = _mm256_set1_ps(mean);
+    const __m256 rstd_vec = _mm256_set1_ps(rstd);
+    auto normalize = [&](auto tail) {
+      constexpr bool kTail = decltype(tail)::value;
+      __m256 v = _mm256_mul_ps(
+          _mm256_sub_ps(row.Stored<kTail>(j), mean_vec), rstd_vec);
+      if (scale) {
+        v = _mm256_mul_ps(v, Load<kTail>(scale + j, row.mask));
+      }
+      if (norm_bias) {
+        v = _mm256_add_ps(v, Load<kTail>(norm_bias + j, row.mask));
+      }
+      Store<kTail>(out + j, row.mask, v);
+    };
+    for (j = 0; j < end; j += block) {
+      normalize(std::false_type());
+    }
+    if (rest != 0) {
+      normalize(std::true_type());
+    }
+  }
+}
+
+}  // namespace
+
+void RMSNorm(const norm_t* param, int width) { Norm<false>(param, width); }
+
+void ResidualLayerNorm(const norm_t* param, int width) {
+  Norm<true>(param, width);
+}
+
+bool RMSNormKernel::CanBeUsed(const int& d) const {
+  return phi::backends::cpu::MayIUse(phi::backends::cpu::avx) && d > 0;
+}
+
+bool ResidualLayerNormKernel::CanBeUsed(const int& d) const {
+  return phi::backends::cpu::MayIUse(phi::backends::cpu::avx) && d > 0;
+}
+
+}  // namespace phi::jit::more::intrinsic
+
+namespace intrinsic = phi::jit::more::intrinsic;
+
+REGISTER_JITKERNEL_MORE(kRMSNorm, intrinsic, intrinsic::RMSNormKernel);
+REGISTER_JITKERNEL_MORE(kResidualLayerNorm,
+                        intrinsic,
+                        intrinsic::ResidualLayerNormKernel);
@@ -14,6 +14,9 @@
 
 #include "paddle/phi/kernels/funcs/jit/more/mix/mix.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "paddle/phi/kernels/funcs/jit/kernels.h"
 #include "paddle/phi/kernels/funcs/jit/registry.h"
 
@@ -46,6 +49,44 @@ void VTanh(const T* x, T* y, int n) {
   compute_addbias(&b, y, y, n);
 }
 
+void Softmax(const T* x, T* y, int n, int bs) {
+  auto compute_addbias = KernelFuncs<VAddBiasTuple<T>, CPUPlace>::Cache().At(n);
+  auto compute_exp = KernelFuncs<VExpTuple<T>, CPUPlace>::Cache().At(n);
+  auto compute_scal = KernelFuncs<VScalTuple<T>, CPUPlace>::Cache().At(n);
+  for (int i = 0; i < bs; ++i) {
+    T scalar = -*std::max_element(x, x + n);
+    compute_addbias(&scalar, x, y, n);
+    compute_exp(y, y, n);
+    scalar = 0;
+    for (int j = 0; j < n; ++j) {
+      scalar += y[j];
+    }
+    scalar = static_cast<T>(1) / scalar;
+    compute_scal(&scalar, y, y, n);
+    x += n;
+    y += n;
+  }
+}
+
+void LogSoftmax(const T* x, T* y, int n, int bs) {
+  auto compute_addbias = KernelFuncs<VAddBiasTuple<T>, CPUPlace>::Cache().At(n);
+  auto compute_exp = KernelFuncs<VExpTuple<T>, CPUPlace>::Cache().At(n);
+  for (int i = 0; i < bs; ++i) {
+    T scalar = -*std::max_element(x, x + n);
+    // y is the scratch of exp(x - max) before it gets the result
+    compute_addbias(&scalar, x, y, n);
+    compute_exp(y, y, n);
+    T sum = 0;
+    for (int j = 0; j < n; ++j) {
+      sum += y[j];
+    }
+    scalar -= std::log(sum);
+    compute_addbias(&scalar, x, y, n);
+    x += n;
+    y += n;
+  }
+}
+
 void (*getActFunc(KernelType type, int d))(const T*, T*, int) {  // NOLINT
   if (type == kVSigmoid) {
     return KernelFuncs<VSigmoidTuple<T>, CPUPlace>::Cache().At(d);
@@ -183,6 +224,10 @@ bool VSigmoidKernel::CanBeUsed(const int& d) const { return true; }
 
 bool VTanhKernel::CanBeUsed(const int& d) const { return true; }
 
+bool SoftmaxKernel::CanBeUsed(const int& d) const { return true; }
+
+bool LogSoftmaxKernel::CanBeUsed(const int& d) const { return true; }
+
 bool LSTMCtHtKernel::CanBeUsed(const lstm_attr_t& attr) const { return true; }
 
 bool LSTMC1H1Kernel::CanBeUsed(const lstm_attr_t& attr) const { return true; }
@@ -202,6 +247,8 @@ namespace mix = phi::jit::more::mix;
 
 REGISTER_MORE_KERNEL(VSigmoid);
 REGISTER_MORE_KERNEL(VTanh);
+REGISTER_MORE_KERNEL(Softmax);
+REGISTER_MORE_KERNEL(LogSoftmax);
 REGISTER_MORE_KERNEL(LSTMCtHt);
 REGISTER_MORE_KERNEL(LSTMC1H1);
 REGISTER_MORE_KERNEL(GRUH1);
@@ -38,6 +38,11 @@ REGISTER_REFER_KERNEL(VExp);
 REGISTER_REFER_KERNEL(VSigmoid);
 REGISTER_REFER_KERNEL(VTanh);
 
+REGISTER_REFER_KERNEL(Softmax);
+REGISTER_REFER_KERNEL(LogSoftmax);
+REGISTER_REFER_KERNEL(RMSNorm);
+REGISTER_REFER_KERNEL(ResidualLayerNorm);
+
 REGISTER_REFER_KERNEL(LSTMCtHt);
 REGISTER_REFER_KERNEL(LSTMC1H1);
 
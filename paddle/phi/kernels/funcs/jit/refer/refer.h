@@ -353,6 +353,121 @@ void LayerNorm(T* x,
   }
 }
 
+// online normalizer: the running sum is rescaled when a larger max is met,
+// so max and sum come out of a single read of the row
+template <typename T>
+void SoftmaxMaxSum(const T* x, int n, T* max, T* sum) {
+  T m = -std::numeric_limits<T>::infinity();
+  T s = 0;
+  for (int i = 0; i < n; ++i) {
+    if (x[i] > m) {
+      s = s * std::exp(m - x[i]) + static_cast<T>(1);
+      m = x[i];
+    } else {
+      s += std::exp(x[i] - m);
+    }
+  }
+  *max = m;
+  *sum = s;
+}
+
+template <typename T>
+void Softmax(const T* x, T* y, int n, int bs) {
+  for (int i = 0; i < bs; ++i) {
+    T max, sum;
+    SoftmaxMaxSum(x, n, &max, &sum);
+    T scalar = static_cast<T>(1) / sum;
+    for (int j = 0; j < n; ++j) {
+      y[j] = std::exp(x[j] - max) * scalar;
+    }
+    x += n;
+    y += n;
+  }
+}
+
+template <typename T>
+void LogSoftmax(const T* x, T* y, int n, int bs) {
+  for (int i = 0; i < bs; ++i) {
+    T max, sum;
+    SoftmaxMaxSum(x, n, &max, &sum);
+    T shift = max + std::log(sum);
+    for (int j = 0; j < n; ++j) {
+      y[j] = x[j] - shift;
+    }
+    x += n;
+    y += n;
+  }
+}
+
+// writes x + residual_alpha * residual + bias of row i to residual_out and
+// returns the row to normalize
+template <typename T>
+const T* NormInput(const norm_t* param, int i, int width) {
+  const T* x = reinterpret_cast<const T*>(param->x) + i * width;
+  if (param->residual == nullptr) {
+    return x;
+  }
+  const T* residual = reinterpret_cast<const T*>(param->residual) + i * width;
+  const T* bias = reinterpret_cast<const T*>(param->bias);
+  T* residual_out = reinterpret_cast<T*>(param->residual_out) + i * width;
+  const T alpha = static_cast<T>(param->residual_alpha);
+  for (int j = 0; j < width; ++j) {
+    residual_out[j] = x[j] + alpha * residual[j] + (bias ? bias[j] : 0);
+  }
+  return residual_out;
+}
+
+template <typename T>
+void NormOutput(
+    const norm_t* param, int i, const T* src, T mean, T rstd, int width) {
+  const T* scale = reinterpret_cast<const T*>(param->scale);
+  const T* norm_bias = reinterpret_cast<const T*>(param->norm_bias);
+  T* out = reinterpret_cast<T*>(param->out) + i * width;
+  for (int j = 0; j < width; ++j) {
+    out[j] = (src[j] - mean) * rstd * (scale ? scale[j] : 1) +
+             (norm_bias ? norm_bias[j] : 0);
+  }
+  if (param->mean) {
+    reinterpret_cast<T*>(param->mean)[i] = mean;
+  }
+  if (param->var) {
+    reinterpret_cast<T*>(param->var)[i] = rstd;
+  }
+}
+
+template <typename T>
+void RMSNorm(const norm_t* param, int width) {
+  for (int i = 0; i < param->height; ++i) {
+    const T* src = NormInput<T>(param, i, width);
+    T square_sum = 0;
+    for (int j = 0; j < width; ++j) {
+      square_sum += src[j] * src[j];
+    }
+    T rstd = static_cast<T>(1) /
+             std::sqrt(square_sum / width + static_cast<T>(param->epsilon));
+    NormOutput<T>(param, i, src, static_cast<T>(0), rstd, width);
+  }
+}
+
+template <typename T>
+void ResidualLayerNorm(const norm_t* param, int width) {
+  for (int i = 0; i < param->height; ++i) {
+    const T* src = NormInput<T>(param, i, width);
+    T sum = 0;
+    for (int j = 0; j < width; ++j) {
+      sum += src[j];
+    }
+    T mean = sum / width;
+    T square_sum = 0;
+    for (int j = 0; j < width; ++j) {
+      square_sum += (src[j] - mean) * (src[j] - mean);
+    }
+    T rstd = static_cast<T>(1) /
+             std::sqrt(square_sum / width + static_cast<T>(param->epsilon));
+    NormOutput<T>(param, i, src, mean, rstd, width);
+  }
+}
+
 template <typename T>
 void SeqPool(const T* x, T* y, const seq_pool_attr_t* attr) {
   for (int w = 0; w < attr->w; ++w) {
@@ -614,6 +729,14 @@ DECLARE_REFER_KERNEL(VTanh);
 DECLARE_REFER_KERNEL(VSquare);
 DECLARE_REFER_KERNEL(VCopy);
 
+// const T* x, T* y, int n, int bs
+DECLARE_REFER_KERNEL(Softmax);
+DECLARE_REFER_KERNEL(LogSoftmax);
+
+// const norm_t*, int width
+DECLARE_REFER_KERNEL(RMSNorm);
+DECLARE_REFER_KERNEL(ResidualLayerNorm);
+
 // lstm_t*, const lstm_attr_t*
 DECLARE_REFER_KERNEL(LSTMCtHt);
 DECLARE_REFER_KERNEL(LSTMC1H1);
@@ -487,6 +487,104 @@ void TestKernelLayerNorm() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void TestKernelXYNBS() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  for (int bs : {1, 3}) {
+    for (int n : TestSizes()) {
+      auto ref = jit::GetReferFunc<KernelTuple>();
+      EXPECT_TRUE(ref != nullptr);
+      const int sz = bs * n;
+      std::vector<T> x(sz), yref(sz);
+      RandomVec<T>(sz, x.data(), static_cast<T>(-10.f), static_cast<T>(10.f));
+      ref(x.data(), yref.data(), n, bs);
+
+      auto verifier = [](const typename KernelTuple::func_type tgt,
+                         const std::vector<T>& x,
+                         const std::vector<T>& yref,
+                         const int bs) {
+        EXPECT_TRUE(tgt != nullptr);
+        const int n = static_cast<int>(x.size()) / bs;
+        std::vector<T> ytgt(x.size());
+        tgt(x.data(), ytgt.data(), n, bs);
+        ExpectEQ<T>(ytgt.data(), yref.data(), x.size());
+        if (KernelTuple::kernel_type == jit::kSoftmax) {
+          std::vector<T> xinp(x);
+          tgt(xinp.data(), xinp.data(), n, bs);
+          ExpectEQ<T>(xinp.data(), yref.data(), x.size());
+        }
+      };
+      TestAllImpls<KernelTuple, PlaceType>(n, verifier, x, yref, bs);
+    }
+  }
+}
+
+template <typename KernelTuple, typename PlaceType>
+void TestKernelNorm() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  for (int height : {1, 9}) {
+    for (int width : TestSizes()) {
+      // bit 0: residual, bit 1: bias, bit 2: scale, bit 3: norm_bias
+      for (int inputs = 0; inputs < 16; ++inputs) {
+        auto ref = jit::GetReferFunc<KernelTuple>();
+        EXPECT_TRUE(ref != nullptr);
+        const int sz = height * width;
+        std::vector<T> x(sz), residual(sz), bias(width), scale(width),
+            norm_bias(width);
+        RandomVec<T>(sz, x.data());
+        RandomVec<T>(sz, residual.data());
+        RandomVec<T>(width, bias.data());
+        RandomVec<T>(width, scale.data());
+        RandomVec<T>(width, norm_bias.data());
+        std::vector<T> outref(sz), residual_outref(sz), meanref(height),
+            varref(height);
+
+        auto make_param = [&](T* out, T* residual_out, T* mean, T* var) {
+          jit::norm_t param;
+          param.x = x.data();
+          if (inputs & 1) {
+            param.residual = residual.data();
+            param.residual_out = residual_out;
+          }
+          param.bias = (inputs & 2) ? bias.data() : nullptr;
+          param.scale = (inputs & 4) ? scale.data() : nullptr;
+          param.norm_bias = (inputs & 8) ? norm_bias.data() : nullptr;
+          param.out = out;
+          param.mean = mean;
+          param.var = var;
+          param.height = height;
+          param.epsilon = 1e-5f;
+          param.residual_alpha = 0.5f;
+          return param;
+        };
+        jit::norm_t param = make_param(outref.data(),
+                                       residual_outref.data(),
+                                       meanref.data(),
+                                       varref.data());
+        ref(&param, width);
+
+        auto verifier = [&](const typename KernelTuple::func_type tgt) {
+          EXPECT_TRUE(tgt != nullptr);
+          std::vector<T> outtgt(sz), residual_outtgt(sz), meantgt(height),
+              vartgt(height);
+          jit::norm_t param = make_param(outtgt.data(),
+                                         residual_outtgt.data(),
+                                         meantgt.data(),
+                                         vartgt.data());
+          tgt(&param, width);
+          ExpectEQ<T>(outtgt.data(), outref.data(), sz);
+          ExpectEQ<T>(residual_outtgt.data(), residual_outref.data(), sz);
+          ExpectEQ<T>(meantgt.data(), meanref.data(), height);
+          ExpectEQ<T>(vartgt.data(), varref.data(), height);
+        };
+        TestAllImpls<KernelTuple, PlaceType>(width, verifier);
+      }
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void TestKernelCRFDecoding() {
   using T = typename KernelTuple::data_type;
@@ -1508,6 +1606,12 @@ TEST(JITKernel_key, sgd) {
 #define TestKernelGRUHtPart1 TestKernelGRU
 #define TestKernelGRUHtPart2 TestKernelGRU
 
+#define TestKernelSoftmax TestKernelXYNBS
+#define TestKernelLogSoftmax TestKernelXYNBS
+
+#define TestKernelRMSNorm TestKernelNorm
+#define TestKernelResidualLayerNorm TestKernelNorm
+
 #define TEST_CPU_KERNEL(kernel_type)                                      \
   TEST(JITKernel, kernel_type) {                                          \
     TestKernel##kernel_type<jit::kernel_type##Tuple<float>, CPUPlace>();  \
@@ -1537,7 +1641,12 @@ TEST_CPU_KERNEL(GRUH1);
 TEST_CPU_KERNEL(GRUHtPart1);
 TEST_CPU_KERNEL(GRUHtPart2);
 
+TEST_CPU_KERNEL(Softmax);
+TEST_CPU_KERNEL(LogSoftmax);
+
 TEST_CPU_KERNEL(LayerNorm);
+TEST_CPU_KERNEL(RMSNorm);
+TEST_CPU_KERNEL(ResidualLayerNorm);
 TEST_CPU_KERNEL(CRFDecoding);
 
 TEST_CPU_KERNEL(SeqPool);
@@ -0,0 +1,67 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include "paddle/common/macros.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+
+namespace phi {
+namespace funcs {
+
+// Calls fn(begin, end) on disjoint ranges covering [0, n). The ranges run on
+// the intra-op threads of a CPUContext, other contexts call fn(0, n) directly.
+// cost_per_unit is the rough number of scalar operations for one index.
+template <typename Context, typename Function>
+void ParallelFor(const Context& dev_ctx UNUSED,
+                 int64_t n,
+                 int64_t cost_per_unit UNUSED,
+                 const Function& fn) {
+  if (n > 0) {
+    fn(0, n);
+  }
+}
+
+template <typename Function>
+void ParallelFor(const phi::CPUContext& dev_ctx,
+                 int64_t n,
+                 int64_t cost_per_unit,
+                 const Function& fn) {
+  dev_ctx.ParallelFor(n, cost_per_unit, fn);
+}
+
+// ParallelFor for kernels that were split by OpenMP on MKL builds before the
+// intra-op threads existed. They keep doing so, one index per call, while
+// the context has no intra-op threads, which is the default.
+template <typename Function>
+void ParallelForOmpFallback(const phi::CPUContext& dev_ctx,
+                            int64_t n,
+                            int64_t cost_per_unit,
+                            const Function& fn) {
+#ifdef PADDLE_WITH_MKLML
+  if (dev_ctx.GetIntraOpNumThreads() <= 1) {
+#pragma omp parallel for
+    for (int64_t i = 0; i < n; ++i) {
+      fn(i, i + 1);
+    }
+    return;
+  }
+#endif
+  dev_ctx.ParallelFor(n, cost_per_unit, fn);
+}
+
+}  // namespace funcs
+}  // namespace phi
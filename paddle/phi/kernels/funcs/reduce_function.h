@@ -57,6 +57,8 @@ using dim3 = phi::kps::dim3;
 
 #endif
 
+#include <algorithm>
+
 #include "paddle/common/array.h"
 #include "paddle/phi/core/dense_tensor.h"
 #include "paddle/phi/core/enforce.h"
@@ -64,6 +66,7 @@ using dim3 = phi::kps::dim3;
 #include "paddle/phi/kernels/funcs/eigen/common.h"
 #include "paddle/phi/kernels/funcs/eigen/eigen_function.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 namespace phi {
 namespace funcs {
 
@@ -1254,6 +1257,31 @@ void ReduceFunctor(const Context& context,
     functor(place, &x, &out, reduce_dim);
   } else {
     auto out = EigenTensor<T, (D - R_D)>::From(*output, out_dims);
+    if constexpr (D > R_D) {
+      bool keep_first_dim =
+          std::find(dims_ref.begin(), dims_ref.end(), 0) == dims_ref.end();
+      if (keep_first_dim && x.dimension(0) > 1) {
+        // rows of the first dim are reduced independently, so they are
+        // split across the intra-op threads
+        const int64_t rows = x.dimension(0);
+        const int64_t x_row_numel = input.numel() / rows;
+        const int64_t out_row_numel = output->numel() / rows;
+        ParallelFor(
+            context, rows, x_row_numel, [&](int64_t begin, int64_t end) {
+              auto x_dims = x.dimensions();
+              auto part_dims = out.dimensions();
+              x_dims[0] = end - begin;
+              part_dims[0] = end - begin;
+              typename EigenTensor<T, D>::ConstType x_part(
+                  x.data() + begin * x_row_numel, x_dims);
+              typename EigenTensor<T, (D - R_D)>::Type out_part(
+                  out.data() + begin * out_row_numel, part_dims);
+              Functor part_functor;
+              part_functor(place, &x_part, &out_part, reduce_dim);
+            });
+        return;
+      }
+    }
     functor(place, &x, &out, reduce_dim);
   }
 }
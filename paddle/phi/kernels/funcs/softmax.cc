@@ -15,10 +15,35 @@ limitations under the License. */
 #include "paddle/phi/kernels/funcs/softmax.h"
 
 #include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
 #include "paddle/phi/kernels/funcs/softmax_impl.h"
 
 namespace phi::funcs {
 
+template <typename T>
+void SoftmaxRowsCPU(const phi::CPUContext& context,
+                    const T* in_data,
+                    T* out_data,
+                    int batch_size,
+                    int num_classes) {
+  auto compute_softmax =
+      phi::jit::KernelFuncs<phi::jit::SoftmaxTuple<T>, phi::CPUPlace>::Cache()
+          .At(num_classes);
+  // rows are independent and split across the intra-op threads
+  ParallelFor(
+      context, batch_size, num_classes, [&](int64_t begin, int64_t end) {
+        compute_softmax(in_data + begin * num_classes,
+                        out_data + begin * num_classes,
+                        num_classes,
+                        static_cast<int>(end - begin));
+      });
+}
+
+template void SoftmaxRowsCPU<float>(
+    const phi::CPUContext&, const float*, float*, int, int);
+template void SoftmaxRowsCPU<double>(
+    const phi::CPUContext&, const double*, double*, int, int);
+
 template class SoftmaxFunctor<phi::CPUContext, float>;
 template class SoftmaxFunctor<phi::CPUContext, double>;
 template class SoftmaxGradFunctor<phi::CPUContext, float>;
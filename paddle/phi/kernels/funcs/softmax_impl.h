@@ -23,6 +23,7 @@ limitations under the License. */
 #include "paddle/phi/core/dense_tensor.h"
 #include "paddle/phi/kernels/funcs/cpu_vec.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 namespace phi {
 namespace funcs {
@@ -226,6 +227,15 @@ void SoftmaxFunctor<DeviceContext, T, Enable>::operator()(
   SoftmaxEigen<DeviceContext, T>()(context, axis_dim, X, Y);
 }
 
+// softmax of batch_size rows of num_classes with the jit Softmax kernel,
+// defined for float and double in softmax.cc
+template <typename T>
+void SoftmaxRowsCPU(const phi::CPUContext& context,
+                    const T* in_data,
+                    T* out_data,
+                    int batch_size,
+                    int num_classes);
+
 template <class DeviceContext>
 using enable_if_CPU = typename std::enable_if<
     std::is_same<DeviceContext, phi::CPUContext>::value>::type;
@@ -245,28 +255,21 @@ class SoftmaxFunctor<DeviceContext, T, enable_if_CPU<DeviceContext>> {
     const int batch_size = in_dims[kBatchDim];
     const int num_remain = num_classes / axis_dim;
 
-    if (num_remain == 1 &&
-        phi::backends::cpu::MayIUse(phi::backends::cpu::avx)) {
-      const T* in_data = X->data<T>();
-      T* out_data = Y->data<T>();
-      for (int bs = 0; bs < batch_size; ++bs) {
-        T max_val = *std::max_element(in_data, in_data + num_classes);
-        max_val *= static_cast<T>(-1);
-        vec_add_bias<T, phi::backends::cpu::avx>(
-            num_classes, max_val, in_data, out_data);
-        vec_clip<T, phi::backends::cpu::avx>(
-            num_classes, static_cast<T>(-64), out_data, out_data);
-        vec_exp<T>(num_classes, out_data, out_data);
-
-        T sum = 0;
-        vec_sum<T, phi::backends::cpu::avx>(num_classes, out_data, &sum);
-        sum = static_cast<T>(1) / sum;
-        vec_scal<T, phi::backends::cpu::avx>(
-            num_classes, sum, out_data, out_data);
-
-        in_data += num_classes;
-        out_data += num_classes;
+    if constexpr (std::is_floating_point<T>::value) {
+      if (num_remain == 1) {
+        SoftmaxRowsCPU<T>(
+            context, X->data<T>(), Y->data<T>(), batch_size, num_classes);
+        return;
       }
+    }
+    if (context.GetIntraOpNumThreads() > 1 && batch_size > 1) {
+      ParallelFor(
+          context, batch_size, num_classes, [&](int64_t begin, int64_t end) {
+            const phi::DenseTensor x_part = X->Slice(begin, end);
+            phi::DenseTensor y_part = Y->Slice(begin, end);
+            SoftmaxEigen<DeviceContext, T>()(
+                context, axis_dim, &x_part, &y_part);
+          });
     } else {
       SoftmaxEigen<DeviceContext, T>()(context, axis_dim, X, Y);
     }
@@ -0,0 +1,113 @@
+// Copyright (c) 2024 PaddlePaddle Authors All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/core/tensor_utils.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+
+namespace phi {
+namespace fusion {
+
+template <typename T, typename Context>
+void FusedLayerNormKernel(const Context& dev_ctx,
+                          const DenseTensor& x,
+                          const paddle::optional<DenseTensor>& bias,
+                          const paddle::optional<DenseTensor>& residual,
+                          const paddle::optional<DenseTensor>& norm_weight,
+                          const paddle::optional<DenseTensor>& norm_bias,
+                          const float epsilon,
+                          const float residual_alpha,
+                          const int begin_norm_axis,
+                          const float quant_scale,
+                          const int quant_round_type,
+                          const float quant_max_bound,
+                          const float quant_min_bound,
+                          DenseTensor* out,
+                          DenseTensor* residual_out,
+                          DenseTensor* mean,
+                          DenseTensor* variance) {
+  if (quant_scale > 0.0f) {
+    PD_THROW("NOT supported quant int8. ");
+  }
+  auto matrix_dim = common::flatten_to_2d(x.dims(), begin_norm_axis);
+  const int rows = static_cast<int>(matrix_dim[0]);
+  const int cols = static_cast<int>(matrix_dim[1]);
+
+  const T* x_data = x.data<T>();
+  const T* bias_data = bias ? bias.get().data<T>() : nullptr;
+  const T* residual_data = residual ? residual.get().data<T>() : nullptr;
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  T* mean_out = dev_ctx.template Alloc<T>(mean);
+  T* var_out = dev_ctx.template Alloc<T>(variance);
+  T* residual_out_data =
+      residual ? dev_ctx.template Alloc<T>(residual_out) : nullptr;
+  if (rows == 0 || cols == 0) {
+    return;
+  }
+
+  if (!norm_weight && !norm_bias) {
+    // out = x + residual_alpha * residual + bias, without normalization
+    const T alpha = static_cast<T>(residual_alpha);
+    funcs::ParallelForOmpFallback(
+        dev_ctx, rows, cols, [&](int64_t begin, int64_t end) {
+          for (int64_t r = begin; r < end; ++r) {
+            const T* px = x_data + r * cols;
+            const T* pr = residual_data ? residual_data + r * cols : nullptr;
+            T* py = out_data + r * cols;
+            for (int c = 0; c < cols; ++c) {
+              py[c] = px[c] + (pr ? alpha * pr[c] : 0) +
+                      (bias_data ? bias_data[c] : 0);
+            }
+          }
+        });
+    return;
+  }
+
+  jit::norm_t param;
+  param.bias = bias_data;
+  param.scale = norm_weight ? norm_weight.get().data<T>() : nullptr;
+  param.norm_bias = norm_bias ? norm_bias.get().data<T>() : nullptr;
+  param.epsilon = epsilon;
+  param.residual_alpha = residual_alpha;
+  auto compute_layer_norm =
+      jit::KernelFuncs<jit::ResidualLayerNormTuple<T>, phi::CPUPlace>::Cache()
+          .At(cols);
+  funcs::ParallelForOmpFallback(
+      dev_ctx, rows, cols * 5, [&](int64_t begin, int64_t end) {
+        jit::norm_t part = param;
+        const int64_t offset = begin * cols;
+        part.x = x_data + offset;
+        if (residual_data) {
+          part.residual = residual_data + offset;
+          part.residual_out = residual_out_data + offset;
+        }
+        part.out = out_data + offset;
+        // variance holds 1 / sqrt(variance + epsilon) of each row
+        part.mean = mean_out + begin;
+        part.var = var_out + begin;
+        part.height = static_cast<int>(end - begin);
+        compute_layer_norm(&part, cols);
+      });
+}
+
+}  // namespace fusion
+}  // namespace phi
+
+PD_REGISTER_KERNEL(fused_bias_residual_layernorm,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::fusion::FusedLayerNormKernel,
+                   float) {}
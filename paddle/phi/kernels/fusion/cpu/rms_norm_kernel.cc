@@ -0,0 +1,86 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/core/tensor_utils.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+
+namespace phi {
+namespace fusion {
+
+template <typename T, typename Context>
+void RmsNormKernel(const Context& dev_ctx,
+                   const DenseTensor& x,
+                   const paddle::optional<DenseTensor>& bias,
+                   const paddle::optional<DenseTensor>& residual,
+                   const DenseTensor& norm_weight,
+                   const paddle::optional<DenseTensor>& norm_bias,
+                   const float epsilon,
+                   const int begin_norm_axis,
+                   const float quant_scale,
+                   const int quant_round_type,
+                   const float quant_max_bound,
+                   const float quant_min_bound,
+                   DenseTensor* out,
+                   DenseTensor* residual_out,
+                   DenseTensor* inv_var) {
+  if (quant_scale > 0.0f) {
+    PD_THROW("NOT supported quant int8. ");
+  }
+
+  auto matrix_dim = common::flatten_to_2d(x.dims(), begin_norm_axis);
+  const int rows = static_cast<int>(matrix_dim[0]);
+  const int cols = static_cast<int>(matrix_dim[1]);
+
+  const T* x_data = x.data<T>();
+  const T* residual_data = residual ? residual.get().data<T>() : nullptr;
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  T* residual_out_data =
+      residual ? dev_ctx.template Alloc<T>(residual_out) : nullptr;
+  float* inv_var_data =
+      inv_var ? dev_ctx.template Alloc<float>(inv_var) : nullptr;
+  if (rows == 0 || cols == 0) {
+    return;
+  }
+
+  jit::norm_t param;
+  param.bias = bias ? bias.get().data<T>() : nullptr;
+  param.scale = norm_weight.data<T>();
+  param.norm_bias = norm_bias ? norm_bias.get().data<T>() : nullptr;
+  param.epsilon = epsilon;
+  auto compute_rms_norm =
+      jit::KernelFuncs<jit::RMSNormTuple<T>, phi::CPUPlace>::Cache().At(cols);
+  funcs::ParallelForOmpFallback(
+      dev_ctx, rows, cols * 4, [&](int64_t begin, int64_t end) {
+        jit::norm_t part = param;
+        const int64_t offset = begin * cols;
+        part.x = x_data + offset;
+        if (residual_data) {
+          part.residual = residual_data + offset;
+          part.residual_out = residual_out_data + offset;
+        }
+        part.out = out_data + offset;
+        part.var = inv_var_data ? inv_var_data + begin : nullptr;
+        part.height = static_cast<int>(end - begin);
+        compute_rms_norm(&part, cols);
+      });
+}
+
+}  // namespace fusion
+}  // namespace phi
+
+PD_REGISTER_KERNEL(
+    rms_norm, CPU, ALL_LAYOUT, phi::fusion::RmsNormKernel, float) {}
@@ -773,6 +773,7 @@ class DistributedStrategy:
             'DownpourUnitAccessor',
             'DownpourDoubleUnitAccessor',
             'DownpourCtrDymfAccessor',
+            'DownpourCtrQuantAccessor',
         ]
         table_param = self.strategy.downpour_table_param
 
@@ -925,13 +926,15 @@ class DistributedStrategy:
             )
             if accessor_class not in support_sparse_accessor_class:
                 raise ValueError(
-                    f"support sparse_accessor_class: ['DownpourSparseValueAccessor', 'DownpourCtrAccessor', 'DownpourCtrDoubleAccessor', 'DownpourUnitAccessor', 'DownpourDoubleUnitAccessor', 'DownpourCtrDymfAccessor'], but actual {accessor_class}"
+                    f"support sparse_accessor_class: ['DownpourSparseValueAccessor', 'DownpourCtrAccessor', 'DownpourCtrDoubleAccessor', 'DownpourUnitAccessor', 'DownpourDoubleUnitAccessor', 'DownpourCtrDymfAccessor', 'DownpourCtrQuantAccessor'], but actual {accessor_class}"
                 )
 
             if accessor_class.find("Double") >= 0:
                 table_data.accessor.accessor_class = 'CtrDoubleAccessor'
             elif accessor_class.find("Dymf") >= 0:
                 table_data.accessor.accessor_class = 'CtrDymfAccessor'
+            elif accessor_class.find("Quant") >= 0:
+                table_data.accessor.accessor_class = 'CtrQuantAccessor'
             else:
                 table_data.accessor.accessor_class = 'CtrCommonAccessor'
 
@@ -987,6 +990,9 @@ class DistributedStrategy:
             table_data.accessor.ctr_accessor_param.zero_init = config.get(
                 'sparse_zero_init', True
             )
+            table_data.accessor.ctr_accessor_param.embedx_quant_bits = (
+                config.get('sparse_embedx_quant_bits', 16)
+            )
             # gpu graph mode set zero_init False for sparse adam init
             if table_data.use_gpu_graph is True:
                 table_data.accessor.ctr_accessor_param.zero_init = False
@@ -1006,6 +1012,7 @@ class DistributedStrategy:
             if (
                 accessor_class == 'DownpourCtrAccessor'
                 or accessor_class == 'DownpourCtrDoubleAccessor'
+                or accessor_class == 'DownpourCtrQuantAccessor'
             ):
                 sparse_optimizer_config(
                     table_data.accessor.embed_sgd_param, config, ''
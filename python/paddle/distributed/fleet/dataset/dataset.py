@@ -881,6 +881,25 @@ class InMemoryDataset(DatasetBase):
         """
         self.dataset.set_shuffle_by_uid(enable_shuffle_uid)
 
+    def _set_lock_free_channel(self, lock_free):
+        """
+        Set if Dataset moves records through lock-free channels, which cuts
+        lock contention when many threads load, shuffle and consume data.
+
+        Args:
+            lock_free(bool): if use lock-free channels or not
+
+        Examples:
+            .. code-block:: python
+
+                >>> import paddle
+                >>> paddle.enable_static()
+                >>> dataset = paddle.distributed.InMemoryDataset()
+                >>> dataset._set_lock_free_channel(True)
+
+        """
+        self.dataset.set_lock_free_channel(lock_free)
+
     def _set_generate_unique_feasigns(self, generate_uni_feasigns, shard_num):
         self.dataset.set_generate_unique_feasigns(generate_uni_feasigns)
         self.gen_uni_feasigns = generate_uni_feasigns
@@ -1165,6 +1184,67 @@ class InMemoryDataset(DatasetBase):
         if fleet is not None:
             fleet._role_maker.barrier_worker()
 
+    def _start_streaming_global_shuffle(
+        self, fleet: Fleet | None = None, thread_num: int = 12
+    ) -> None:
+        """
+        Start global shuffle in background. Records are sent to other trainers
+        in batches of fleet_send_batch_size while they are still being loaded,
+        and loading waits when sending falls behind. Call it after
+        preload_into_memory, and call _wait_streaming_global_shuffle_done
+        after wait_preload_done.
+
+        Args:
+            fleet(Fleet): fleet singleton. Default None.
+            thread_num(int): shuffle thread num. Default is 12.
+
+        Examples:
+            .. code-block:: python
+
+                >>> # doctest: +SKIP('No files to read')
+                >>> import paddle
+                >>> paddle.enable_static()
+                >>> dataset = paddle.distributed.InMemoryDataset()
+                >>> dataset.set_filelist(["a.txt", "b.txt"])
+                >>> dataset.preload_into_memory()
+                >>> dataset._start_streaming_global_shuffle()
+                >>> # train the previous pass here
+                >>> dataset.wait_preload_done()
+                >>> dataset._wait_streaming_global_shuffle_done()
+
+        """
+        trainer_num = 1
+        if fleet is not None:
+            fleet._role_maker.barrier_worker()
+            trainer_num = fleet.worker_num()
+        if self.fleet_send_batch_size is None:
+            self.fleet_send_batch_size = 1024
+        self.dataset.register_client2client_msg_handler()
+        self.dataset.set_trainer_num(trainer_num)
+        self.dataset.set_fleet_send_batch_size(self.fleet_send_batch_size)
+        if fleet is not None:
+            fleet._role_maker.barrier_worker()
+        self.dataset.start_global_shuffle(thread_num)
+
+    def _wait_streaming_global_shuffle_done(
+        self, fleet: Fleet | None = None
+    ) -> None:
+        """
+        Wait the global shuffle started by _start_streaming_global_shuffle.
+        Loading must be done before calling it.
+
+        Args:
+            fleet(Fleet): fleet singleton. Default None.
+
+        """
+        self.dataset.wait_global_shuffle_done()
+        if fleet is not None:
+            fleet._role_maker.barrier_worker()
+        if self.merge_by_lineid:
+            self.dataset.merge_by_lineid()
+        if fleet is not None:
+            fleet._role_maker.barrier_worker()
+
     def release_memory(self) -> None:
         """
         :api_attr: Static Graph
@@ -0,0 +1,80 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/channel.h"
+
+namespace paddle {
+namespace framework {
+
+// Compares the throughput of the mutex guarded and the lock-free channel
+// under contention, every thread moving blocks through ChannelWriter and
+// ChannelReader. Built but not run as a test, run ./channel_benchmark.
+TEST(ChannelBenchmark, Contention) {
+  const int thread_num =
+      std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+  const uint64_t n = 200000;
+  for (bool lock_free : {false, true}) {
+    Channel<uint64_t> chan = MakeChannel<uint64_t>();
+    chan->SetLockFree(lock_free);
+    chan->SetBlockSize(64);
+    std::atomic<uint64_t> count(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int i = 0; i < thread_num; ++i) {
+      producers.emplace_back([chan, n]() {
+        ChannelWriter<uint64_t> writer(chan.get());
+        for (uint64_t x = 0; x < n; ++x) {
+          writer << x;
+        }
+        writer.Flush();
+      });
+    }
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < thread_num; ++i) {
+      consumers.emplace_back([chan, &count]() {
+        ChannelReader<uint64_t> reader(chan.get());
+        uint64_t x = 0;
+        uint64_t local_count = 0;
+        while (reader >> x) {
+          ++local_count;
+        }
+        count += local_count;
+      });
+    }
+    for (auto& t : producers) {
+      t.join();
+    }
+    chan->Close();
+    for (auto& t : consumers) {
+      t.join();
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    EXPECT_EQ(count, thread_num * n);
+    LOG(INFO) << (lock_free ? "lock-free" : "mutex") << " channel, "
+              << thread_num << " producers and consumers: "
+              << count / seconds / 1e6 << "M items/s";
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,78 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/core/memory/allocation/auto_growth_best_fit_allocator.h"
+#include "paddle/phi/core/memory/allocation/cpu_allocator.h"
+#include "paddle/phi/core/memory/allocation/segregated_fit_allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// Every thread keeps 64 live allocations of random sizes and replaces a
+// random one per step.
+static void AllocateAndFree(const std::shared_ptr<Allocator> &allocator,
+                            int thread_num,
+                            int loop_num) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thread_num; ++i) {
+    threads.emplace_back([&, i] {
+      std::mt19937 engine(i);
+      std::uniform_int_distribution<size_t> size_dist(1, 1 << 16);
+      std::vector<AllocationPtr> live(64);
+      for (int j = 0; j < loop_num; ++j) {
+        live[engine() % live.size()] = allocator->Allocate(size_dist(engine));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// Compares the allocation latency with AutoGrowthBestFitAllocator under many
+// threads, only CPU memory is used. Built but not run as a test, run
+// ./segregated_fit_allocator_benchmark.
+TEST(SegregatedFitAllocatorBenchmark, MultiThread) {
+  constexpr int kLoopNum = 50000;
+  int thread_num = std::min(
+      16, std::max(4, static_cast<int>(std::thread::hardware_concurrency())));
+  auto run = [&](const std::shared_ptr<Allocator> &allocator) {
+    AllocateAndFree(allocator, thread_num, kLoopNum / 10);
+    auto start = std::chrono::steady_clock::now();
+    AllocateAndFree(allocator, thread_num, kLoopNum);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           kLoopNum;
+  };
+
+  double auto_growth_ns = run(std::make_shared<AutoGrowthBestFitAllocator>(
+      std::make_shared<CPUAllocator>(), 256, 1 << 20));
+  double segregated_fit_ns = run(std::make_shared<SegregatedFitAllocator>(
+      std::make_shared<CPUAllocator>(), 256, 1 << 20, true, thread_num));
+  LOG(INFO) << thread_num << " threads, ns per allocate and free: "
+            << "AutoGrowthBestFitAllocator " << auto_growth_ns
+            << ", SegregatedFitAllocator " << segregated_fit_ns;
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,116 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>  // NOLINT
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_kernel.h"
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+namespace paddle {
+namespace distributed {
+
+// Returns the ns per key of UpdateValue over kKeyNum values of embed_dim,
+// with the given kernels or the scalar loops for nullptr.
+template <class Rule>
+static double UpdateValueNs(const SparseCommonSGDRuleParameter &param,
+                            const SparseSgdKernels *kernels,
+                            size_t embed_dim) {
+  constexpr size_t kKeyNum = 4096;
+  constexpr int kRoundNum = 50;
+  Rule rule;
+  rule.LoadConfig(param, embed_dim);
+  rule.SetSimdKernels(kernels);
+  const size_t value_dim = embed_dim + rule.Dim();
+  std::vector<float> values(kKeyNum * value_dim);
+  for (size_t k = 0; k < kKeyNum; ++k) {
+    rule.InitValue(&values[k * value_dim],
+                   &values[k * value_dim + embed_dim],
+                   false);
+  }
+  std::mt19937 engine(2024);
+  std::uniform_real_distribution<float> dist(-1.0, 1.0);
+  std::vector<float> grads(kKeyNum * embed_dim);
+  for (auto &g : grads) {
+    g = dist(engine);
+  }
+
+  auto run = [&](int round_num) {
+    for (int round = 0; round < round_num; ++round) {
+      for (size_t k = 0; k < kKeyNum; ++k) {
+        float *w = &values[k * value_dim];
+        rule.UpdateValue(w, w + embed_dim, &grads[k * embed_dim], 2.0);
+      }
+    }
+  };
+  run(1);
+  auto start = std::chrono::steady_clock::now();
+  run(kRoundNum);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (kKeyNum * kRoundNum);
+}
+
+template <class Rule>
+static void CompareScalarWithSimd(const SparseCommonSGDRuleParameter &param,
+                                  const char *rule_name) {
+  const SparseSgdKernels *kernels = GetSparseSgdKernels();
+  if (kernels == nullptr) {
+    LOG(INFO) << "no simd kernels for " << rule_name << ", skip";
+    return;
+  }
+  for (size_t embed_dim : {16, 64, 256}) {
+    double scalar_ns = UpdateValueNs<Rule>(param, nullptr, embed_dim);
+    double simd_ns = UpdateValueNs<Rule>(param, kernels, embed_dim);
+    LOG(INFO) << rule_name << " dim " << embed_dim
+              << ", ns per UpdateValue: scalar " << scalar_ns << ", "
+              << kernels->name << " " << simd_ns << ", speedup "
+              << scalar_ns / simd_ns;
+  }
+}
+
+// Compares the scalar and simd UpdateValue paths of the sparse sgd rules.
+// Built but not run as a test, run ./sparse_sgd_rule_benchmark.
+TEST(SparseSgdRuleBenchmark, UpdateValue) {
+  SparseCommonSGDRuleParameter adagrad;
+  adagrad.set_name("adagrad");
+  auto *adagrad_param = adagrad.mutable_adagrad();
+  adagrad_param->set_learning_rate(0.1);
+  adagrad_param->set_initial_g2sum(3.0);
+  adagrad_param->set_initial_range(0.3);
+  adagrad_param->add_weight_bounds(-10.0);
+  adagrad_param->add_weight_bounds(10.0);
+  CompareScalarWithSimd<SparseAdaGradSGDRule>(adagrad, "adagrad");
+  CompareScalarWithSimd<StdAdaGradSGDRule>(adagrad, "std_adagrad");
+  CompareScalarWithSimd<SparseAdaGradV2SGDRule>(adagrad, "adagrad_v2");
+
+  SparseCommonSGDRuleParameter adam;
+  adam.set_name("adam");
+  auto *adam_param = adam.mutable_adam();
+  adam_param->set_learning_rate(0.1);
+  adam_param->set_initial_range(0.3);
+  adam_param->set_beta1_decay_rate(0.9);
+  adam_param->set_beta2_decay_rate(0.999);
+  adam_param->set_ada_epsilon(1e-08);
+  adam_param->add_weight_bounds(-10.0);
+  adam_param->add_weight_bounds(10.0);
+  CompareScalarWithSimd<SparseAdamSGDRule>(adam, "adam");
+  CompareScalarWithSimd<SparseSharedAdamSGDRule>(adam, "shared_adam");
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,148 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/channel.h"
+
+#include <atomic>
+#include <deque>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+// producers write [0, n) each through ChannelWriter, consumers read through
+// ChannelReader until the channel is closed and empty
+static void RunProducersConsumers(Channel<uint64_t> chan,
+                                  int producer_num,
+                                  int consumer_num,
+                                  uint64_t n,
+                                  uint64_t* sum,
+                                  uint64_t* count) {
+  std::atomic<uint64_t> total_sum(0);
+  std::atomic<uint64_t> total_count(0);
+  std::vector<std::thread> producers;
+  for (int i = 0; i < producer_num; ++i) {
+    producers.emplace_back([chan, n]() {
+      ChannelWriter<uint64_t> writer(chan.get());
+      for (uint64_t x = 0; x < n; ++x) {
+        writer << x;
+      }
+      writer.Flush();
+    });
+  }
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < consumer_num; ++i) {
+    consumers.emplace_back([chan, &total_sum, &total_count]() {
+      ChannelReader<uint64_t> reader(chan.get());
+      uint64_t x = 0;
+      uint64_t local_sum = 0;
+      uint64_t local_count = 0;
+      while (reader >> x) {
+        local_sum += x;
+        ++local_count;
+      }
+      total_sum += local_sum;
+      total_count += local_count;
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  chan->Close();
+  for (auto& t : consumers) {
+    t.join();
+  }
+  *sum = total_sum;
+  *count = total_count;
+}
+
+TEST(Channel, LockFreeReadWrite) {
+  Channel<int> chan = MakeChannel<int>();
+  chan->SetLockFree(true);
+  std::vector<int> in(5000);
+  for (size_t i = 0; i < in.size(); ++i) {
+    in[i] = static_cast<int>(i);
+  }
+  EXPECT_EQ(chan->Write(in), in.size());
+  EXPECT_EQ(chan->Size(), in.size());
+
+  std::vector<int> out;
+  chan->Close();
+  EXPECT_EQ(chan->ReadAll(out), in.size());
+  EXPECT_EQ(out, in);
+  EXPECT_TRUE(chan->Empty());
+  // closed and empty
+  int x = 0;
+  EXPECT_FALSE(chan->Get(x));
+  EXPECT_FALSE(chan->Put(1));
+
+  chan->Open();
+  EXPECT_TRUE(chan->Put(7));
+  EXPECT_TRUE(chan->Get(x));
+  EXPECT_EQ(x, 7);
+  chan->Clear();
+  chan->SetLockFree(false);
+  EXPECT_FALSE(chan->LockFree());
+}
+
+TEST(Channel, LockFreeMultiProducerConsumer) {
+  const int thread_num = 8;
+  const uint64_t n = 100000;
+  Channel<uint64_t> chan = MakeChannel<uint64_t>();
+  chan->SetLockFree(true);
+  chan->SetBlockSize(100);
+  uint64_t sum = 0;
+  uint64_t count = 0;
+  RunProducersConsumers(chan, thread_num, thread_num, n, &sum, &count);
+  EXPECT_EQ(count, thread_num * n);
+  EXPECT_EQ(sum, thread_num * (n * (n - 1) / 2));
+}
+
+TEST(Channel, LockFreeCapacity) {
+  const uint64_t n = 10000;
+  Channel<uint64_t> chan = MakeChannel<uint64_t>(16);
+  chan->SetLockFree(true);
+  chan->SetBlockSize(64);
+  uint64_t sum = 0;
+  uint64_t count = 0;
+  RunProducersConsumers(chan, 2, 2, n, &sum, &count);
+  EXPECT_EQ(count, 2 * n);
+  EXPECT_EQ(sum, 2 * (n * (n - 1) / 2));
+}
+
+// the items still in a lock-free channel are moved back to the deque
+TEST(Channel, LockFreeGetData) {
+  Channel<int> chan = MakeChannel<int>();
+  chan->SetLockFree(true);
+  std::vector<int> in(3000);
+  for (size_t i = 0; i < in.size(); ++i) {
+    in[i] = static_cast<int>(i);
+  }
+  EXPECT_EQ(chan->Write(in), in.size());
+  std::vector<int> out(1500);
+  EXPECT_EQ(chan->Read(out.size(), out.data()), out.size());
+
+  const std::deque<int>& data = chan->GetData();
+  EXPECT_FALSE(chan->LockFree());
+  ASSERT_EQ(data.size(), 1500UL);
+  EXPECT_EQ(data.front(), 1500);
+  EXPECT_EQ(data.back(), 2999);
+  EXPECT_EQ(chan->Size(), 1500UL);
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,247 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/channel.h"
+#include "paddle/fluid/framework/data_feed.h"
+
+namespace paddle {
+namespace framework {
+
+TEST(DataFeedColumnar, ParseFeasignMatchesLibc) {
+  std::vector<std::string> tokens = {"0",
+                                     "7",
+                                     "12345678",
+                                     "123456789012",
+                                     "18446744073709551615",
+                                     "  42",
+                                     "0.5",
+                                     "-0.125",
+                                     "3.14159",
+                                     ".75",
+                                     "5.",
+                                     "16777217",
+                                     "0.1234567891234",
+                                     "1e-3",
+                                     "-2.5E4",
+                                     "0x1A",
+                                     "nan",
+                                     "-"};
+  for (auto& token : tokens) {
+    std::string line = token + " 9";
+    const char* str = line.c_str();
+    const char* end = str + line.size();
+
+    char* expect_end = nullptr;
+    char* end_ptr = nullptr;
+    uint64_t expect_id = strtoull(str, &expect_end, 10);
+    uint64_t id = parse_uint64_feasign(str, end, &end_ptr);
+    EXPECT_EQ(id, expect_id) << token;
+    EXPECT_EQ(end_ptr, expect_end) << token;
+
+    float expect_value = strtof(str, &expect_end);
+    float value = parse_float_feasign(str, end, &end_ptr);
+    if (std::isnan(expect_value)) {
+      EXPECT_TRUE(std::isnan(value)) << token;
+    } else {
+      EXPECT_EQ(value, expect_value) << token;
+    }
+    EXPECT_EQ(end_ptr, expect_end) << token;
+  }
+}
+
+TEST(DataFeedColumnar, WriteAndRead) {
+  std::string path = "data_feed_columnar_test.bin";
+  SlotRecordColumnarWriter writer(2, 1, true);
+  writer.AddInstance({{1, 2, 3}, {4}}, {{0.5f}}, "ins0");
+  writer.AddInstance({{5}, {6, 7}}, {{1.5f, 2.5f}}, "ins1");
+  writer.Save(path);
+
+  SlotRecordColumnarReader reader;
+  reader.Open(path);
+  const SlotRecordColumnarHeader& header = reader.header();
+  ASSERT_EQ(header.ins_num, 2UL);
+  ASSERT_EQ(header.uint64_slot_num, 2U);
+  ASSERT_EQ(header.float_slot_num, 1U);
+  ASSERT_EQ(header.has_ins_id, 1U);
+
+  std::vector<uint64_t> uint64_offsets(reader.uint64_offsets(),
+                                       reader.uint64_offsets() + 5);
+  EXPECT_EQ(uint64_offsets, std::vector<uint64_t>({0, 3, 4, 5, 7}));
+  std::vector<uint64_t> uint64_values(reader.uint64_values(),
+                                      reader.uint64_values() + 7);
+  EXPECT_EQ(uint64_values, std::vector<uint64_t>({1, 2, 3, 4, 5, 6, 7}));
+  std::vector<uint64_t> float_offsets(reader.float_offsets(),
+                                      reader.float_offsets() + 3);
+  EXPECT_EQ(float_offsets, std::vector<uint64_t>({0, 1, 3}));
+  EXPECT_EQ(reader.float_values()[2], 2.5f);
+  const uint64_t* ins_id_offsets = reader.ins_id_offsets();
+  EXPECT_EQ(std::string(reader.ins_ids() + ins_id_offsets[1],
+                        ins_id_offsets[2] - ins_id_offsets[1]),
+            "ins1");
+  reader.Close();
+  remove(path.c_str());
+}
+
+TEST(DataFeedColumnar, RejectCorruptedOffsets) {
+  std::string path = "data_feed_columnar_corrupted_test.bin";
+  SlotRecordColumnarWriter writer(2, 1, false);
+  writer.AddInstance({{1, 2, 3}, {4}}, {{0.5f}});
+  writer.AddInstance({{5}, {6, 7}}, {{1.5f, 2.5f}});
+  writer.Save(path);
+  std::ifstream fin(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(fin)),
+                   std::istreambuf_iterator<char>());
+  fin.close();
+
+  // the second uint64 offset goes back before the first one
+  std::string corrupted = data;
+  uint64_t offset = 1;
+  memcpy(&corrupted[sizeof(SlotRecordColumnarHeader) + 2 * sizeof(uint64_t)],
+         &offset,
+         sizeof(offset));
+  // and a file cut in the float values
+  std::string truncated = data.substr(0, data.size() - 4);
+  for (auto* bytes : {&corrupted, &truncated}) {
+    std::ofstream fout(path, std::ios::binary);
+    fout.write(bytes->data(), bytes->size());
+    fout.close();
+    SlotRecordColumnarReader reader;
+    EXPECT_THROW(reader.Open(path), common::EnforceNotMet);
+  }
+  remove(path.c_str());
+}
+
+// exposes the columnar loading of SlotRecordInMemoryDataFeed
+class ColumnarDataFeed : public SlotRecordInMemoryDataFeed {
+ public:
+  using SlotRecordInMemoryDataFeed::LoadIntoMemoryByColumnar;
+  using SlotRecordInMemoryDataFeed::ParseOneColumnarInstance;
+};
+
+// u0 used, u1 not used, f0 sparse, f1 dense
+DataFeedDesc ColumnarDataFeedDesc(const std::string& pipe_command) {
+  DataFeedDesc desc;
+  desc.set_name("SlotRecordInMemoryDataFeed");
+  desc.set_batch_size(2);
+  desc.set_pipe_command(pipe_command);
+  auto* multi_slot_desc = desc.mutable_multi_slot_desc();
+  auto add_slot = [multi_slot_desc](const char* name,
+                                    const char* type,
+                                    bool used,
+                                    bool dense) {
+    auto* slot = multi_slot_desc->add_slots();
+    slot->set_name(name);
+    slot->set_type(type);
+    slot->set_is_used(used);
+    slot->set_is_dense(dense);
+  };
+  add_slot("u0", "uint64", true, false);
+  add_slot("u1", "uint64", false, false);
+  add_slot("f0", "float", true, false);
+  add_slot("f1", "float", true, true);
+  return desc;
+}
+
+void WriteColumnarFile(const std::string& path, uint64_t first_key) {
+  SlotRecordColumnarWriter writer(2, 2, false);
+  writer.AddInstance({{first_key, first_key + 1}, {9}},
+                     {{0.0f, 0.5f, 1e-8f}, {0.0f, 2.0f}});
+  writer.AddInstance({{first_key + 2}, {9}}, {{1.5f}, {3.0f}});
+  writer.Save(path);
+}
+
+TEST(DataFeedColumnar, ParseOneColumnarInstance) {
+  std::string path = "data_feed_columnar_parse_test.bin";
+  WriteColumnarFile(path, 1);
+  SlotRecordColumnarWriter empty_writer(2, 2, false);
+  empty_writer.AddInstance({{1}, {}}, {{0.5f}, {1.0f}});
+  empty_writer.Save(path + ".empty");
+
+  ColumnarDataFeed feed;
+  feed.Init(ColumnarDataFeedDesc("cat"));
+  std::vector<SlotRecord> records;
+  SlotRecordPool().get(&records, 1);
+  SlotRecordColumnarReader reader;
+  reader.Open(path);
+  ASSERT_TRUE(feed.ParseOneColumnarInstance(reader, 0, &records[0]));
+
+  // u1 is skipped, the zeros of the sparse f0 are dropped, not of dense f1
+  auto& uint64_feasigns = records[0]->slot_uint64_feasigns_;
+  EXPECT_EQ(uint64_feasigns.slot_values, std::vector<uint64_t>({1, 2}));
+  EXPECT_EQ(uint64_feasigns.slot_offsets, std::vector<uint32_t>({0, 2}));
+  auto& float_feasigns = records[0]->slot_float_feasigns_;
+  EXPECT_EQ(float_feasigns.slot_values, std::vector<float>({0.5f, 0, 2.0f}));
+  EXPECT_EQ(float_feasigns.slot_offsets, std::vector<uint32_t>({0, 1, 3}));
+
+  // as in text lines, a slot without values is an error even when unused
+  reader.Open(path + ".empty");
+  EXPECT_THROW(feed.ParseOneColumnarInstance(reader, 0, &records[0]),
+               common::EnforceNotMet);
+  reader.Close();
+  SlotRecordPool().put(&records);
+  remove(path.c_str());
+  remove((path + ".empty").c_str());
+}
+
+TEST(DataFeedColumnar, LoadIntoMemoryByColumnar) {
+  std::vector<std::string> files = {"data_feed_columnar_load_test0.bin",
+                                    "data_feed_columnar_load_test1.bin"};
+  WriteColumnarFile(files[0], 10);
+  WriteColumnarFile(files[1], 20);
+  // mapped without a converter, read through the pipe command with one
+  for (std::string pipe_command : {"cat", "tail -c +1"}) {
+    ColumnarDataFeed feed;
+    feed.Init(ColumnarDataFeedDesc(pipe_command));
+    std::mutex mutex;
+    size_t file_idx = 0;
+    feed.SetFileListMutex(&mutex);
+    feed.SetFileListIndex(&file_idx);
+    feed.SetFileList(files);
+    auto channel = MakeChannel<SlotRecord>();
+    feed.SetInputChannel(channel.get());
+    feed.LoadIntoMemoryByColumnar();
+    channel->Close();
+
+    std::vector<SlotRecord> records;
+    channel->ReadAll(records);
+    ASSERT_EQ(records.size(), 4UL) << pipe_command;
+    std::vector<uint64_t> keys;
+    for (auto& record : records) {
+      auto& values = record->slot_uint64_feasigns_.slot_values;
+      keys.insert(keys.end(), values.begin(), values.end());
+      EXPECT_EQ(record->slot_float_feasigns_.slot_offsets.size(), 3UL);
+    }
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(keys, std::vector<uint64_t>({10, 11, 12, 20, 21, 22}))
+        << pipe_command;
+    SlotRecordPool().put(&records);
+  }
+  for (auto& file : files) {
+    remove(file.c_str());
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
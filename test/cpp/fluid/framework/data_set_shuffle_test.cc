@@ -0,0 +1,108 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <future>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/data_set.h"
+
+namespace paddle {
+namespace framework {
+
+// exposes the channels and the message handler so that trainers can be
+// connected in process
+class LocalShuffleDataset : public MultiSlotDataset {
+ public:
+  using MultiSlotDataset::ReceiveFromClient;
+
+  Channel<Record> InputChannel() { return input_channel_; }
+
+  void ReadShuffled(std::set<std::string>* ins_ids) {
+    for (auto& chan : multi_output_channel_) {
+      std::vector<Record> data;
+      chan->Close();
+      chan->ReadAll(data);
+      for (auto& rec : data) {
+        ins_ids->insert(rec.ins_id_);
+      }
+    }
+  }
+};
+
+TEST(DataSetShuffle, StreamingGlobalShuffle) {
+  const int trainer_num = 2;
+  const int ins_num = 1000;
+  const int batch_size = 16;
+  const int thread_num = 2;
+  std::vector<LocalShuffleDataset> trainers(trainer_num);
+  for (int i = 0; i < trainer_num; ++i) {
+    auto& dataset = trainers[i];
+    dataset.SetTrainerNum(trainer_num);
+    dataset.SetChannelNum(2);
+    dataset.SetFleetSendBatchSize(batch_size);
+    dataset.CreateChannel();
+    dataset.SetShuffleSendFunc(
+        [&trainers, i](int client_id, const std::string& msg) {
+          auto receive = [&trainers, i, client_id, msg]() {
+            return static_cast<int32_t>(
+                trainers[client_id].ReceiveFromClient(0, i, msg));
+          };
+          return std::async(std::launch::async, receive);
+        });
+  }
+
+  for (auto& dataset : trainers) {
+    dataset.StartGlobalShuffle(thread_num);
+    EXPECT_EQ(dataset.InputChannel()->Capacity(),
+              static_cast<size_t>(batch_size * thread_num * 2));
+  }
+  // loaders are blocked by the bounded input channel until records are sent
+  std::vector<std::thread> loaders;
+  for (int i = 0; i < trainer_num; ++i) {
+    loaders.emplace_back([&trainers, i, ins_num]() {
+      auto chan = trainers[i].InputChannel();
+      ChannelWriter<Record> writer(chan.get());
+      for (int j = 0; j < ins_num; ++j) {
+        Record rec;
+        rec.ins_id_ = std::to_string(i) + "_" + std::to_string(j);
+        writer << rec;
+      }
+      writer.Flush();
+      chan->Close();
+    });
+  }
+  for (auto& t : loaders) {
+    t.join();
+  }
+  for (auto& dataset : trainers) {
+    dataset.WaitGlobalShuffleDone();
+    EXPECT_EQ(dataset.InputChannel()->Size(), 0UL);
+  }
+
+  std::set<std::string> ins_ids;
+  int64_t total = 0;
+  for (auto& dataset : trainers) {
+    total += dataset.GetShuffleDataSize();
+    dataset.ReadShuffled(&ins_ids);
+  }
+  EXPECT_EQ(total, trainer_num * ins_num);
+  EXPECT_EQ(ins_ids.size(), static_cast<size_t>(trainer_num * ins_num));
+}
+
+}  // namespace framework
+}  // namespace paddle
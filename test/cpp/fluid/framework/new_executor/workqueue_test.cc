@@ -14,11 +14,14 @@
 
 #include "paddle/fluid/framework/new_executor/workqueue/workqueue.h"
 
+#include <algorithm>
 #include <atomic>
-#include <thread>
+#include <functional>
+#include <thread>  // NOLINT
 
 #include "glog/logging.h"
 #include "gtest/gtest.h"
+#include "paddle/fluid/framework/new_executor/workqueue/nonblocking_threadpool.h"
 #include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 
 TEST(WorkQueueUtils, TestEventsWaiter) {
@@ -203,3 +206,124 @@ TEST(WorkQueue, TestWorkQueueGroup) {
   queue_group.reset();
   waiter_thread.join();
 }
+
+TEST(WorkQueue, TestLocalityAwareWorkQueue) {
+  using paddle::framework::CreateMultiThreadedWorkQueue;
+  using paddle::framework::EventsWaiter;
+  using paddle::framework::GetCpuCacheTopology;
+  using paddle::framework::WorkQueue;
+  using paddle::framework::WorkQueueOptions;
+  const auto& topology = GetCpuCacheTopology();
+  EXPECT_GT(topology.cpus.size(), 0u);
+  EXPECT_EQ(topology.l2_domain.size(), topology.cpus.size());
+  EXPECT_EQ(topology.l3_domain.size(), topology.cpus.size());
+
+  std::atomic<unsigned> counter{0};
+  constexpr unsigned kDepth = 12;
+  EventsWaiter events_waiter;
+  WorkQueueOptions options(/*name*/ "LocalityAwareWorkQueueForTesting",
+                           /*num_threads*/ 4,
+                           /*allow_spinning*/ true,
+                           /*always_spinning*/ false,
+                           /*track_task*/ true,
+                           /*detached*/ true,
+                           &events_waiter);
+  options.locality_aware = true;
+  auto work_queue = CreateMultiThreadedWorkQueue(options);
+  // Each task spawns two more from inside a worker, which go to the queue of
+  // that worker and are stolen by the others.
+  std::function<void(unsigned)> spawn = [&](unsigned depth) {
+    ++counter;
+    if (depth > 0) {
+      work_queue->AddTask([&, depth]() { spawn(depth - 1); });
+      work_queue->AddTask([&, depth]() { spawn(depth - 1); });
+    }
+  };
+  work_queue->AddTask([&]() { spawn(kDepth); });
+  EXPECT_EQ(events_waiter.WaitEvent(), paddle::framework::kQueueEmptyEvent);
+  EXPECT_EQ(counter.load(), (1u << (kDepth + 1)) - 1);
+
+  auto stats = work_queue->GetWorkerStats();
+  EXPECT_EQ(stats.size(), 4u);
+  uint64_t tasks = 0;
+  for (auto& worker_stats : stats) {
+    tasks += worker_stats.tasks;
+  }
+  EXPECT_EQ(tasks, counter.load());
+
+  // A task added by a worker goes to the front of the queue of that worker,
+  // so a chain of tasks stays on one worker while the others are busy.
+  constexpr unsigned kChainLength = 16;
+  std::atomic<unsigned> started{0};
+  std::atomic<bool> chain_done{false};
+  std::atomic<bool> chain_on_one_worker{true};
+  std::function<void(unsigned, std::thread::id)> chain =
+      [&](unsigned length, std::thread::id owner) {
+        if (std::this_thread::get_id() != owner) {
+          chain_on_one_worker = false;
+        }
+        if (length == 0) {
+          chain_done = true;
+          return;
+        }
+        work_queue->AddTask(
+            [&, length, owner]() { chain(length - 1, owner); });
+      };
+  for (unsigned i = 0; i < 4; ++i) {
+    work_queue->AddTask([&, i]() {
+      // all the workers run one of these tasks at the same time
+      ++started;
+      while (started.load() < 4) {
+        std::this_thread::yield();
+      }
+      if (i == 0) {
+        chain(kChainLength, std::this_thread::get_id());
+        return;
+      }
+      while (!chain_done.load()) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  EXPECT_EQ(events_waiter.WaitEvent(), paddle::framework::kQueueEmptyEvent);
+  EXPECT_TRUE(chain_done.load());
+  EXPECT_TRUE(chain_on_one_worker.load());
+}
+
+TEST(WorkQueue, TestLocalityAwareStealPartitions) {
+  using paddle::framework::GetCpuCacheTopology;
+  using paddle::framework::NonblockingThreadPool;
+  const auto& topology = GetCpuCacheTopology();
+  auto cpu_index = [&](int cpu) {
+    return static_cast<size_t>(
+        std::find(topology.cpus.begin(), topology.cpus.end(), cpu) -
+        topology.cpus.begin());
+  };
+
+  // Each worker steals from the workers sharing its L2 cache first, then
+  // from those sharing its L3 cache, before trying the whole pool.
+  constexpr int kThreadNum = 4;
+  NonblockingThreadPool pool("LocalityAwarePoolForTesting",
+                             kThreadNum,
+                             /*allow_spinning*/ false,
+                             /*always_spinning*/ false,
+                             /*locality_aware*/ true);
+  for (int i = 0; i < kThreadNum; ++i) {
+    auto l2 = pool.StealPartition(i);
+    auto l3 = pool.DomainStealPartition(i);
+    EXPECT_LE(l2.first, static_cast<unsigned>(i));
+    EXPECT_GT(l2.second, static_cast<unsigned>(i));
+    EXPECT_LE(l3.first, l2.first);
+    EXPECT_GE(l3.second, l2.second);
+    size_t index = cpu_index(pool.WorkerCpu(i));
+    ASSERT_LT(index, topology.cpus.size());
+    for (unsigned j = l3.first; j < l3.second; ++j) {
+      size_t other = cpu_index(pool.WorkerCpu(static_cast<int>(j)));
+      ASSERT_LT(other, topology.cpus.size());
+      EXPECT_EQ(topology.l3_domain[other], topology.l3_domain[index]);
+      if (j >= l2.first && j < l2.second) {
+        EXPECT_EQ(topology.l2_domain[other], topology.l2_domain[index]);
+      }
+    }
+  }
+}
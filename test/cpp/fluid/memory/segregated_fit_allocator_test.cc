@@ -0,0 +1,147 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/core/memory/allocation/segregated_fit_allocator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+class RecordedAllocator : public Allocator {
+ public:
+  bool IsAllocThreadSafe() const override { return true; }
+
+  int64_t AllocatedSize() const { return allocated_size_; }
+
+ protected:
+  phi::Allocation *AllocateImpl(size_t size) override {
+    allocated_size_ += size;
+    void *ptr = nullptr;
+    EXPECT_EQ(posix_memalign(&ptr, 4096, size), 0);
+    return new Allocation(ptr, size, phi::CPUPlace());
+  }
+
+  void FreeImpl(phi::Allocation *allocation) override {
+    allocated_size_ -= allocation->size();
+    free(allocation->ptr());  // NOLINT
+    delete allocation;
+  }
+
+ private:
+  std::atomic<int64_t> allocated_size_{0};
+};
+
+TEST(SegregatedFitAllocator, split_and_merge) {
+  auto recorded_allocator = std::make_shared<RecordedAllocator>();
+  size_t alignment = 256;
+  size_t chunk_size = 1 << 20;
+  auto allocator = std::make_shared<SegregatedFitAllocator>(
+      recorded_allocator, alignment, chunk_size);
+
+  auto a = allocator->Allocate(1000);
+  auto b = allocator->Allocate(3000);
+  auto c = allocator->Allocate(100000);
+  ASSERT_EQ(recorded_allocator->AllocatedSize(),
+            static_cast<int64_t>(chunk_size));
+  ASSERT_EQ(a->size(), 1024UL);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(b->ptr()) % alignment, 0UL);
+  ASSERT_EQ(static_cast<uint8_t *>(b->ptr()),
+            static_cast<uint8_t *>(a->ptr()) + a->size());
+
+  b.reset();
+  a.reset();
+  c.reset();
+  // All blocks are merged back, so the whole chunk fits without growing.
+  auto whole = allocator->Allocate(chunk_size);
+  ASSERT_EQ(recorded_allocator->AllocatedSize(),
+            static_cast<int64_t>(chunk_size));
+  whole.reset();
+
+  ASSERT_EQ(allocator->Release(phi::CPUPlace()), chunk_size);
+  ASSERT_EQ(recorded_allocator->AllocatedSize(), 0);
+}
+
+TEST(SegregatedFitAllocator, best_bin) {
+  auto recorded_allocator = std::make_shared<RecordedAllocator>();
+  auto allocator = std::make_shared<SegregatedFitAllocator>(
+      recorded_allocator, 64, 1 << 20);
+
+  // Leave free holes of several sizes between allocated blocks.
+  std::vector<AllocationPtr> holes, guards;
+  for (size_t size : {64 * 17, 64 * 40, 64 * 300, 64 * 5000}) {
+    holes.emplace_back(allocator->Allocate(size));
+    guards.emplace_back(allocator->Allocate(64));
+  }
+  std::vector<void *> hole_ptrs;
+  for (auto &hole : holes) {
+    hole_ptrs.emplace_back(hole->ptr());
+  }
+  holes.clear();
+
+  // Each request is served by the smallest hole that fits.
+  auto a = allocator->Allocate(64 * 30);
+  ASSERT_EQ(a->ptr(), hole_ptrs[1]);
+  auto b = allocator->Allocate(64 * 16);
+  ASSERT_EQ(b->ptr(), hole_ptrs[0]);
+  auto c = allocator->Allocate(64 * 200);
+  ASSERT_EQ(c->ptr(), hole_ptrs[2]);
+}
+
+static void StressTest(const std::shared_ptr<Allocator> &allocator,
+                       int thread_num,
+                       int loop_num) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thread_num; ++i) {
+    threads.emplace_back([&, i] {
+      std::mt19937 engine(i);
+      std::uniform_int_distribution<size_t> size_dist(1, 1 << 16);
+      std::vector<AllocationPtr> live(64);
+      for (int j = 0; j < loop_num; ++j) {
+        auto &slot = live[engine() % live.size()];
+        if (slot != nullptr) {
+          auto *data = static_cast<uint8_t *>(slot->ptr());
+          ASSERT_EQ(data[0], static_cast<uint8_t>(i));
+          ASSERT_EQ(data[slot->size() - 1], static_cast<uint8_t>(i));
+        }
+        slot = allocator->Allocate(size_dist(engine));
+        memset(slot->ptr(), i, slot->size());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(SegregatedFitAllocator, multi_thread) {
+  auto recorded_allocator = std::make_shared<RecordedAllocator>();
+  auto allocator = std::make_shared<SegregatedFitAllocator>(
+      recorded_allocator, 256, 1 << 20, true, 4);
+  StressTest(allocator, 8, 10000);
+  allocator->Release(phi::CPUPlace());
+  ASSERT_EQ(recorded_allocator->AllocatedSize(), 0);
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,150 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/core/memory/allocation/thread_local_cpu_allocator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+class CountedAllocator : public Allocator {
+ public:
+  bool IsAllocThreadSafe() const override { return true; }
+
+  int64_t AllocCount() const { return alloc_count_; }
+  int64_t LiveCount() const { return live_count_; }
+
+ protected:
+  phi::Allocation *AllocateImpl(size_t size) override {
+    ++alloc_count_;
+    ++live_count_;
+    return new Allocation(malloc(size), size, phi::CPUPlace());  // NOLINT
+  }
+
+  void FreeImpl(phi::Allocation *allocation) override {
+    --live_count_;
+    free(allocation->ptr());  // NOLINT
+    delete allocation;
+  }
+
+ private:
+  std::atomic<int64_t> alloc_count_{0};
+  std::atomic<int64_t> live_count_{0};
+};
+
+TEST(ThreadLocalCPUAllocator, size_class) {
+  for (size_t i = 0; i < CPUSizeClass::kNumClasses; ++i) {
+    ASSERT_EQ(CPUSizeClass::Index(CPUSizeClass::Size(i)), i);
+  }
+  ASSERT_EQ(CPUSizeClass::Size(CPUSizeClass::kNumClasses - 1),
+            CPUSizeClass::kMaxSize);
+  for (size_t size = 1; size <= CPUSizeClass::kMaxSize; size += 7) {
+    size_t index = CPUSizeClass::Index(size);
+    ASSERT_LT(index, CPUSizeClass::kNumClasses);
+    ASSERT_GE(CPUSizeClass::Size(index), size);
+    if (index > 0) {
+      ASSERT_LT(CPUSizeClass::Size(index - 1), size);
+    }
+  }
+}
+
+TEST(ThreadLocalCPUAllocator, reuse_in_thread) {
+  auto backend = std::make_shared<CountedAllocator>();
+  auto allocator = std::make_shared<ThreadLocalCPUAllocator>(backend, 1 << 20);
+
+  auto allocation = allocator->Allocate(1000);
+  void *ptr = allocation->ptr();
+  ASSERT_EQ(allocation->size(),
+            CPUSizeClass::Size(CPUSizeClass::Index(1000)));
+  allocation.reset();
+  ASSERT_EQ(backend->LiveCount(), 1);
+
+  // The same size class is served from the cache of this thread.
+  allocation = allocator->Allocate(1010);
+  ASSERT_EQ(allocation->ptr(), ptr);
+  ASSERT_EQ(backend->AllocCount(), 1);
+  allocation.reset();
+
+  allocator->Release(phi::CPUPlace());
+  ASSERT_EQ(backend->LiveCount(), 0);
+}
+
+TEST(ThreadLocalCPUAllocator, large_and_full_cache) {
+  auto backend = std::make_shared<CountedAllocator>();
+  auto allocator = std::make_shared<ThreadLocalCPUAllocator>(backend, 4096);
+
+  auto large = allocator->Allocate(CPUSizeClass::kMaxSize + 1);
+  ASSERT_EQ(large->size(), CPUSizeClass::kMaxSize + 1);
+  large.reset();
+  ASSERT_EQ(backend->LiveCount(), 0);
+
+  // Only the first block fits in the cache, the second goes to the backend.
+  auto first = allocator->Allocate(4096);
+  auto second = allocator->Allocate(4096);
+  first.reset();
+  second.reset();
+  ASSERT_EQ(backend->LiveCount(), 1);
+
+  allocator.reset();
+  ASSERT_EQ(backend->LiveCount(), 0);
+}
+
+TEST(ThreadLocalCPUAllocator, multi_thread) {
+  auto backend = std::make_shared<CountedAllocator>();
+  auto allocator = std::make_shared<ThreadLocalCPUAllocator>(backend, 1 << 20);
+
+  constexpr int kThreadNum = 8;
+  constexpr int kLoop = 1000;
+  // Blocks allocated by one thread are freed by the next one.
+  std::vector<std::vector<AllocationPtr>> handoff(kThreadNum);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadNum; ++i) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < kLoop; ++j) {
+        size_t size = 64 + (i * kLoop + j) % 8192;
+        auto allocation = allocator->Allocate(size);
+        ASSERT_GE(allocation->size(), size);
+        memset(allocation->ptr(), i, size);
+        if (j % 10 == 0) {
+          handoff[i].emplace_back(std::move(allocation));
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  for (int i = 0; i < kThreadNum; ++i) {
+    threads.emplace_back([&, i] { handoff[(i + 1) % kThreadNum].clear(); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // All threads have exited, so every cached block went back to the backend.
+  ASSERT_EQ(backend->LiveCount(), 0);
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,142 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/inference/io.h"
+#include "paddle/phi/core/framework/dense_tensor_serialize.h"
+
+namespace paddle {
+namespace inference {
+
+template <typename T>
+static phi::DenseTensor MakeTensor(const std::vector<int64_t>& dims,
+                                   T start) {
+  phi::DenseTensor tensor;
+  tensor.Resize(common::make_ddim(dims));
+  T* data = tensor.mutable_data<T>(phi::CPUPlace());
+  for (int64_t i = 0; i < tensor.numel(); ++i) {
+    data[i] = static_cast<T>(start + i);
+  }
+  return tensor;
+}
+
+template <typename T>
+static void ExpectEqual(const phi::DenseTensor& a, const phi::DenseTensor& b) {
+  ASSERT_EQ(a.dims(), b.dims());
+  ASSERT_EQ(a.dtype(), b.dtype());
+  ASSERT_EQ(a.lod(), b.lod());
+  for (int64_t i = 0; i < a.numel(); ++i) {
+    ASSERT_EQ(a.data<T>()[i], b.data<T>()[i]);
+  }
+}
+
+TEST(LoadCombinedParamsByMmap, load) {
+  std::vector<phi::DenseTensor> saved;
+  saved.emplace_back(MakeTensor<float>({2, 3}, 1.f));
+  saved.emplace_back(MakeTensor<uint8_t>({3}, 7));
+  saved.emplace_back(MakeTensor<int64_t>({4}, 100));
+  saved.emplace_back(MakeTensor<float>({5, 2}, -3.f));
+  saved[3].ResetLoD({{0, 2, 5}});
+
+  std::string filename = "mmap_params_test.pdiparams";
+  {
+    std::ofstream fout(filename, std::ios::binary);
+    for (auto& tensor : saved) {
+      phi::SerializeToStream(fout, tensor);
+    }
+  }
+
+  std::vector<phi::DenseTensor> loaded(saved.size());
+  std::vector<phi::DenseTensor*> tensors;
+  for (auto& tensor : loaded) {
+    tensors.push_back(&tensor);
+  }
+  LoadCombinedParamsByMmap(filename, tensors);
+  ExpectEqual<float>(saved[0], loaded[0]);
+  ExpectEqual<uint8_t>(saved[1], loaded[1]);
+  ExpectEqual<int64_t>(saved[2], loaded[2]);
+  ExpectEqual<float>(saved[3], loaded[3]);
+
+  // Writing a loaded parameter changes neither the file nor the others
+  // loading it.
+  std::vector<phi::DenseTensor> reloaded(saved.size());
+  std::vector<phi::DenseTensor*> retensors;
+  for (auto& tensor : reloaded) {
+    retensors.push_back(&tensor);
+  }
+  LoadCombinedParamsByMmap(filename, retensors);
+  loaded[0].data<float>()[0] = 42.f;
+  ExpectEqual<float>(saved[0], reloaded[0]);
+  loaded.clear();
+  reloaded.clear();
+
+  std::vector<phi::DenseTensor> partial(saved.size() - 1);
+  std::vector<phi::DenseTensor*> partial_tensors;
+  for (auto& tensor : partial) {
+    partial_tensors.push_back(&tensor);
+  }
+  EXPECT_ANY_THROW(LoadCombinedParamsByMmap(filename, partial_tensors));
+  std::remove(filename.c_str());
+}
+
+TEST(SaveCombinedParamsForMmap, aligned) {
+  std::vector<phi::DenseTensor> saved;
+  saved.emplace_back(MakeTensor<float>({2, 3}, 1.f));
+  saved.emplace_back(MakeTensor<uint8_t>({3}, 7));
+  saved.emplace_back(MakeTensor<int64_t>({4}, 100));
+  saved.emplace_back(MakeTensor<float>({5, 2}, -3.f));
+  saved[3].ResetLoD({{0, 2, 5}});
+  std::vector<const phi::DenseTensor*> saved_tensors;
+  for (auto& tensor : saved) {
+    saved_tensors.push_back(&tensor);
+  }
+
+  std::string filename = "mmap_params_aligned_test.pdiparams";
+  SaveCombinedParamsForMmap(filename, saved_tensors);
+
+  // All parameters are used in place.
+  std::vector<phi::DenseTensor> loaded(saved.size());
+  std::vector<phi::DenseTensor*> tensors;
+  for (auto& tensor : loaded) {
+    tensors.push_back(&tensor);
+  }
+  LoadCombinedParamsByMmap(filename, tensors);
+  for (auto& tensor : loaded) {
+    EXPECT_EQ(
+        reinterpret_cast<uintptr_t>(tensor.data()) % kMmapParamsAlignment, 0UL);
+  }
+  ExpectEqual<float>(saved[0], loaded[0]);
+  ExpectEqual<uint8_t>(saved[1], loaded[1]);
+  ExpectEqual<int64_t>(saved[2], loaded[2]);
+  ExpectEqual<float>(saved[3], loaded[3]);
+
+  // The file is still readable as a normal combined parameters file.
+  std::ifstream fin(filename, std::ios::binary);
+  std::vector<phi::DenseTensor> deserialized(saved.size());
+  for (auto& tensor : deserialized) {
+    phi::DeserializeFromStream(fin, &tensor);
+  }
+  ExpectEqual<float>(saved[0], deserialized[0]);
+  ExpectEqual<uint8_t>(saved[1], deserialized[1]);
+  ExpectEqual<int64_t>(saved[2], deserialized[2]);
+  ExpectEqual<float>(saved[3], deserialized[3]);
+  std::remove(filename.c_str());
+}
+
+}  // namespace inference
+}  // namespace paddle
@@ -15,6 +15,8 @@ limitations under the License. */
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <chrono>  // NOLINT
+
 #include "paddle/common/flags.h"
 #include "test/cpp/inference/api/tester_helper.h"
 
@@ -95,4 +97,137 @@ TEST(PredictorPool, basic) {
   }
 }
 
+TEST(BatchingPredictorPool, basic) {
+  std::string model_dir = FLAGS_infer_model + "/model";
+  Config config;
+  config.EnableNewIR(false);
+  config.SetModel(model_dir + "/model", model_dir + "/params");
+
+  services::BatchingConfig batching_config;
+  batching_config.max_batch_size = 4;
+  batching_config.max_wait_us = 10000;
+  services::BatchingPredictorPool pool(config, 2, batching_config);
+
+  std::vector<int> in_shape = {1, 3, 318, 318};
+  int in_num = std::accumulate(
+      in_shape.begin(), in_shape.end(), 1, std::multiplies<int>());
+  constexpr int kRequestNum = 8;
+  std::vector<std::vector<float>> inputs(kRequestNum);
+  std::vector<std::future<std::vector<paddle::PaddleTensor>>> futures;
+  for (int i = 0; i < kRequestNum; ++i) {
+    inputs[i].assign(in_num, static_cast<float>(i) / kRequestNum);
+    paddle::PaddleTensor input;
+    input.shape = in_shape;
+    input.dtype = DataType::FLOAT32;
+    input.data.Reset(inputs[i].data(), in_num * sizeof(float));
+    std::vector<paddle::PaddleTensor> request;
+    request.emplace_back(std::move(input));
+    futures.emplace_back(pool.Submit(std::move(request)));
+  }
+
+  // Each request gets the same outputs as running it alone.
+  auto predictor = CreatePredictor(config);
+  for (int i = 0; i < kRequestNum; ++i) {
+    auto outputs = futures[i].get();
+    auto input_t = predictor->GetInputHandle(predictor->GetInputNames()[0]);
+    input_t->Reshape(in_shape);
+    input_t->CopyFromCpu(inputs[i].data());
+    predictor->Run();
+    auto output_t = predictor->GetOutputHandle(predictor->GetOutputNames()[0]);
+    std::vector<int> out_shape = output_t->shape();
+    ASSERT_EQ(outputs[0].shape, out_shape);
+    int out_num = std::accumulate(
+        out_shape.begin(), out_shape.end(), 1, std::multiplies<int>());
+    std::vector<float> expected(out_num);
+    output_t->CopyToCpu(expected.data());
+    const float* data = static_cast<const float*>(outputs[0].data.data());
+    for (int j = 0; j < out_num; ++j) {
+      EXPECT_NEAR(data[j], expected[j], 1e-4);
+    }
+  }
+
+  auto stats = pool.GetStats();
+  EXPECT_EQ(stats.request_num, static_cast<uint64_t>(kRequestNum));
+  EXPECT_LE(stats.batch_num, static_cast<uint64_t>(kRequestNum));
+  EXPECT_GE(stats.batch_num, static_cast<uint64_t>(2));
+}
+
+// A request of one input of `shape`, whose data is held by `data`.
+std::vector<paddle::PaddleTensor> MakeBatchingRequest(
+    const std::vector<int>& shape, std::vector<float>* data) {
+  int num =
+      std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<int>());
+  data->assign(num, 0.5f);
+  paddle::PaddleTensor input;
+  input.shape = shape;
+  input.dtype = DataType::FLOAT32;
+  input.data.Reset(data->data(), num * sizeof(float));
+  std::vector<paddle::PaddleTensor> request;
+  request.emplace_back(std::move(input));
+  return request;
+}
+
+TEST(BatchingPredictorPool, destroy_with_pending_requests) {
+  std::string model_dir = FLAGS_infer_model + "/model";
+  Config config;
+  config.EnableNewIR(false);
+  config.SetModel(model_dir + "/model", model_dir + "/params");
+
+  // The requests never fill a batch and wait far longer than the test, so
+  // they are still pending when the pool is destroyed.
+  services::BatchingConfig batching_config;
+  batching_config.max_batch_size = 64;
+  batching_config.max_wait_us = 600 * 1000 * 1000LL;
+  constexpr int kRequestNum = 5;
+  std::vector<std::vector<float>> inputs(kRequestNum);
+  std::vector<std::future<std::vector<paddle::PaddleTensor>>> futures;
+  {
+    services::BatchingPredictorPool pool(config, 3, batching_config);
+    for (int i = 0; i < kRequestNum; ++i) {
+      // Requests of different shapes are run in different batches.
+      std::vector<int> shape = {1, 3, 318 - i % 2, 318};
+      futures.emplace_back(
+          pool.Submit(MakeBatchingRequest(shape, &inputs[i])));
+    }
+  }
+
+  // The destructor runs the pending requests before stopping the workers.
+  for (auto& future : futures) {
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(0)),
+              std::future_status::ready);
+    auto outputs = future.get();
+    ASSERT_FALSE(outputs.empty());
+    EXPECT_EQ(outputs[0].shape[0], 1);
+  }
+}
+
+TEST(BatchingPredictorPool, predictor_error) {
+  std::string model_dir = FLAGS_infer_model + "/model";
+  Config config;
+  config.EnableNewIR(false);
+  config.SetModel(model_dir + "/model", model_dir + "/params");
+
+  services::BatchingConfig batching_config;
+  batching_config.max_batch_size = 4;
+  batching_config.max_wait_us = 10000;
+  services::BatchingPredictorPool pool(config, 1, batching_config);
+
+  // The model takes 3 channels, a batch of 1 channel inputs fails to run
+  // and every request in it gets the error.
+  std::vector<std::vector<float>> inputs(3);
+  auto bad_0 = pool.Submit(MakeBatchingRequest({1, 1, 318, 318}, &inputs[0]));
+  auto bad_1 = pool.Submit(MakeBatchingRequest({1, 1, 318, 318}, &inputs[1]));
+  auto good = pool.Submit(MakeBatchingRequest({1, 3, 318, 318}, &inputs[2]));
+  EXPECT_ANY_THROW(bad_0.get());
+  EXPECT_ANY_THROW(bad_1.get());
+  EXPECT_FALSE(good.get().empty());
+
+  std::vector<paddle::PaddleTensor> outputs;
+  EXPECT_FALSE(
+      pool.Run(MakeBatchingRequest({1, 1, 318, 318}, &inputs[0]), &outputs));
+  EXPECT_TRUE(
+      pool.Run(MakeBatchingRequest({1, 3, 318, 318}, &inputs[2]), &outputs));
+  EXPECT_FALSE(outputs.empty());
+}
+
 }  // namespace paddle_infer
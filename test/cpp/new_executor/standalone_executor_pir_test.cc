@@ -17,8 +17,10 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "paddle/phi/core/kernel_registry.h"
 
@@ -33,18 +35,25 @@
 
 #include "paddle/fluid/pir/dialect/operator/ir/op_type.h"
 
+#include "paddle/common/flags.h"
 #include "paddle/common/macros.h"
 #include "paddle/pir/include/dialect/control_flow/ir/cf_dialect.h"
 #include "paddle/pir/include/dialect/control_flow/ir/cf_op.h"
 
 DECLARE_FILE_SYMBOLS(kernel_dialect);
 
+COMMON_DECLARE_bool(enable_pir_in_executor_trace_run);
+COMMON_DECLARE_bool(pir_interpreter_static_memory_plan);
+COMMON_DECLARE_bool(pir_interpreter_shape_bucket_plan);
+COMMON_DECLARE_bool(pir_interpreter_sequential_run);
+
 PD_DECLARE_KERNEL(full, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(full_int_array, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(uniform, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(add, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(sqrt, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(less_than, CPU, ALL_LAYOUT);
+PD_DECLARE_KERNEL(data, CPU, ALL_LAYOUT);
 
 bool simple_cmp(float a, float b) { return std::abs((a - b) / a) < 1e-5; }
 
@@ -385,5 +394,205 @@ TEST(StandaloneExecutor, while_op) {
   EXPECT_EQ(res0, true);
 }
 
+// out = sqrt(x + x) + x, where x has shape [-1, 4]. The intermediates are
+// garbage collected, so they can be planned by the static memory plan.
+std::unique_ptr<pir::Program> BuildSqrtAddProgram() {
+  pir::IrContext* ctx = pir::IrContext::Instance();
+  ctx->GetOrRegisterDialect<paddle::dialect::OperatorDialect>();
+  pir::Program program(ctx);
+  pir::Builder builder = pir::Builder(ctx, program.block());
+
+  auto x = builder
+               .Build<paddle::dialect::DataOp>("x",
+                                               std::vector<int64_t>{-1, 4},
+                                               phi::DataType::FLOAT32,
+                                               phi::CPUPlace())
+               .result(0);
+  auto double_x = builder.Build<paddle::dialect::AddOp>(x, x).result(0);
+  auto sqrt = builder.Build<paddle::dialect::SqrtOp>(double_x).result(0);
+  auto out = builder.Build<paddle::dialect::AddOp>(sqrt, x).result(0);
+  builder.Build<pir::ShadowOutputOp>(out, "sqrt_add_out");
+
+  return paddle::dialect::PdOpLowerToKernelPass(&program);
+}
+
+// Runs the program on rows x 4 elements starting from `start` and checks the
+// output.
+void RunSqrtAdd(InterpreterCore* core,
+                Scope* scope,
+                int64_t rows,
+                float start) {
+  phi::DenseTensor x;
+  x.Resize({rows, 4});
+  float* x_data = x.mutable_data<float>(phi::CPUPlace());
+  for (int64_t i = 0; i < x.numel(); ++i) {
+    x_data[i] = start + static_cast<float>(i);
+  }
+
+  core->Run({"x"}, {x});
+
+  const Scope* out_scope =
+      core->local_scope() == nullptr ? scope : core->local_scope();
+  const auto& out = out_scope->FindVar("sqrt_add_out")->Get<phi::DenseTensor>();
+  ASSERT_EQ(out.numel(), x.numel());
+  for (int64_t i = 0; i < x.numel(); ++i) {
+    EXPECT_TRUE(simple_cmp(out.data<float>()[i],
+                           std::sqrt(2 * x_data[i]) + x_data[i]))
+        << "element " << i << " of " << out.data<float>()[i];
+  }
+}
+
+TEST(StandaloneExecutor, static_memory_plan) {
+  FLAGS_enable_pir_in_executor_trace_run = true;
+  FLAGS_pir_interpreter_static_memory_plan = true;
+  auto kernel_program = BuildSqrtAddProgram();
+
+  Scope scope;
+  InterpreterCore test_core(
+      phi::CPUPlace(), {}, kernel_program->block(), &scope);
+  test_core.SetSkipGcVars({"sqrt_add_out"});
+  auto* interpreter = dynamic_cast<const PirInterpreter*>(test_core.Impl());
+  ASSERT_NE(interpreter, nullptr);
+
+  // The first run profiles the memory, the later ones reuse the plan.
+  RunSqrtAdd(&test_core, &scope, 8, 1.0);
+  const auto* planner = interpreter->GetStaticMemoryPlanner();
+  ASSERT_NE(planner, nullptr);
+  EXPECT_FALSE(planner->IsProfiling());
+  // The intermediates x + x and sqrt(x + x) live in the arena.
+  std::vector<std::string> planned_op_names;
+  for (auto& op : *kernel_program->block()) {
+    if (!op.HasAttribute("op_name") || op.num_results() == 0) {
+      continue;
+    }
+    auto op_name = op.attribute<pir::StrAttribute>("op_name").AsString();
+    if (op_name == "pd_op.sqrt" ||
+        (op_name == "pd_op.add" && planned_op_names.empty())) {
+      EXPECT_TRUE(interpreter->IsStaticMemoryPlanned(op.result(0)))
+          << op_name;
+      planned_op_names.push_back(op_name);
+    }
+  }
+  EXPECT_EQ(planned_op_names.size(), 2UL);
+  RunSqrtAdd(&test_core, &scope, 8, 100.0);
+  RunSqrtAdd(&test_core, &scope, 8, 3.0);
+  EXPECT_EQ(interpreter->GetStaticMemoryPlanner(), planner);
+
+  FLAGS_enable_pir_in_executor_trace_run = false;
+  FLAGS_pir_interpreter_static_memory_plan = false;
+}
+
+TEST(StandaloneExecutor, shape_bucket_plan) {
+  FLAGS_enable_pir_in_executor_trace_run = true;
+  FLAGS_pir_interpreter_static_memory_plan = true;
+  FLAGS_pir_interpreter_shape_bucket_plan = true;
+  auto kernel_program = BuildSqrtAddProgram();
+
+  Scope scope;
+  InterpreterCore test_core(
+      phi::CPUPlace(), {}, kernel_program->block(), &scope);
+  test_core.SetSkipGcVars({"sqrt_add_out"});
+  auto* interpreter = dynamic_cast<const PirInterpreter*>(test_core.Impl());
+  ASSERT_NE(interpreter, nullptr);
+
+  // 8 rows are in the bucket of 8, 40 rows in the bucket of 64.
+  RunSqrtAdd(&test_core, &scope, 8, 1.0);
+  const auto* small_planner = interpreter->GetStaticMemoryPlanner();
+  ASSERT_NE(small_planner, nullptr);
+  RunSqrtAdd(&test_core, &scope, 40, 2.0);
+  const auto* large_planner = interpreter->GetStaticMemoryPlanner();
+  ASSERT_NE(large_planner, nullptr);
+  EXPECT_NE(large_planner, small_planner);
+  EXPECT_FALSE(large_planner->IsProfiling());
+
+  // Alternating shapes switch between the cached plans.
+  for (int round = 0; round < 3; ++round) {
+    RunSqrtAdd(&test_core, &scope, 8, 3.0 + round);
+    EXPECT_EQ(interpreter->GetStaticMemoryPlanner(), small_planner);
+    RunSqrtAdd(&test_core, &scope, 40, 4.0 + round);
+    EXPECT_EQ(interpreter->GetStaticMemoryPlanner(), large_planner);
+  }
+  // A smaller shape of the same bucket keeps its plan.
+  RunSqrtAdd(&test_core, &scope, 5, 5.0);
+  EXPECT_EQ(interpreter->GetStaticMemoryPlanner(), small_planner);
+
+  FLAGS_enable_pir_in_executor_trace_run = false;
+  FLAGS_pir_interpreter_static_memory_plan = false;
+  FLAGS_pir_interpreter_shape_bucket_plan = false;
+}
+
+TEST(StandaloneExecutor, sequential_run) {
+  auto kernel_program = BuildSqrtAddProgram();
+  for (bool sequential_run : {false, true}) {
+    FLAGS_pir_interpreter_sequential_run = sequential_run;
+    Scope scope;
+    InterpreterCore test_core(
+        phi::CPUPlace(), {}, kernel_program->block(), &scope);
+    test_core.SetSkipGcVars({"sqrt_add_out"});
+    auto* interpreter = dynamic_cast<const PirInterpreter*>(test_core.Impl());
+    ASSERT_NE(interpreter, nullptr);
+
+    // The first run is by multi-thread mode, the later ones sequential.
+    RunSqrtAdd(&test_core, &scope, 8, 1.0);
+    EXPECT_EQ(interpreter->UseSequentialRun(), sequential_run);
+    RunSqrtAdd(&test_core, &scope, 8, 100.0);
+    RunSqrtAdd(&test_core, &scope, 3, 7.0);
+  }
+  FLAGS_pir_interpreter_sequential_run = false;
+}
+
+TEST(StandaloneExecutor, sequential_run_parallel_program) {
+  pir::IrContext* ctx = pir::IrContext::Instance();
+  ctx->GetOrRegisterDialect<paddle::dialect::OperatorDialect>();
+  pir::Program program(ctx);
+  pir::Builder builder = pir::Builder(ctx, program.block());
+
+  // out = (sqrt(x) + sqrt(x)) + (sqrt(x) + sqrt(x)), 7 instructions on a
+  // critical path of 3
+  auto x = builder
+               .Build<paddle::dialect::DataOp>("x",
+                                               std::vector<int64_t>{-1, 4},
+                                               phi::DataType::FLOAT32,
+                                               phi::CPUPlace())
+               .result(0);
+  std::vector<pir::Value> sums;
+  for (int i = 0; i < 2; ++i) {
+    auto a = builder.Build<paddle::dialect::SqrtOp>(x).result(0);
+    auto b = builder.Build<paddle::dialect::SqrtOp>(x).result(0);
+    sums.push_back(builder.Build<paddle::dialect::AddOp>(a, b).result(0));
+  }
+  auto out = builder.Build<paddle::dialect::AddOp>(sums[0], sums[1]).result(0);
+  builder.Build<pir::ShadowOutputOp>(out, "out");
+  auto kernel_program = paddle::dialect::PdOpLowerToKernelPass(&program);
+
+  FLAGS_pir_interpreter_sequential_run = true;
+  Scope scope;
+  InterpreterCore test_core(
+      phi::CPUPlace(), {}, kernel_program->block(), &scope);
+  test_core.SetSkipGcVars({"out"});
+  auto* interpreter = dynamic_cast<const PirInterpreter*>(test_core.Impl());
+  ASSERT_NE(interpreter, nullptr);
+
+  phi::DenseTensor x_tensor;
+  x_tensor.Resize({2, 4});
+  float* x_data = x_tensor.mutable_data<float>(phi::CPUPlace());
+  for (int64_t i = 0; i < x_tensor.numel(); ++i) {
+    x_data[i] = static_cast<float>(i + 1);
+  }
+  for (int run = 0; run < 2; ++run) {
+    test_core.Run({"x"}, {x_tensor});
+    // The program has enough parallelism to stay in multi-thread mode.
+    EXPECT_FALSE(interpreter->UseSequentialRun());
+    const Scope* out_scope =
+        test_core.local_scope() == nullptr ? &scope : test_core.local_scope();
+    const auto& out_tensor = out_scope->FindVar("out")->Get<phi::DenseTensor>();
+    for (int64_t i = 0; i < x_tensor.numel(); ++i) {
+      EXPECT_TRUE(
+          simple_cmp(out_tensor.data<float>()[i], 4 * std::sqrt(x_data[i])));
+    }
+  }
+  FLAGS_pir_interpreter_sequential_run = false;
+}
+
 }  // namespace framework
 }  // namespace paddle
@@ -0,0 +1,79 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpreter/static_memory_plan.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+TEST(StaticMemoryPlan, reuse_dead_tensor) {
+  // a -> b -> c, a is dead when c is produced, so c reuses the memory of a.
+  std::vector<TensorLifetime> lifetimes = {
+      {1000, 0, 1}, {500, 1, 2}, {1000, 2, 3}};
+  std::vector<size_t> offsets;
+  size_t arena_size = PlanStaticMemoryOffsets(lifetimes, 256, &offsets);
+  EXPECT_EQ(arena_size, 1024UL + 512UL);
+  EXPECT_EQ(offsets[0], offsets[2]);
+  EXPECT_EQ(offsets[1], 1024UL);
+}
+
+TEST(StaticMemoryPlan, no_overlap) {
+  std::mt19937 engine(0);
+  std::vector<TensorLifetime> lifetimes;
+  for (size_t i = 0; i < 500; ++i) {
+    size_t first_step = engine() % 200;
+    lifetimes.push_back(
+        {engine() % 100000 + 1, first_step, first_step + engine() % 30});
+  }
+  std::vector<size_t> offsets;
+  size_t arena_size = PlanStaticMemoryOffsets(lifetimes, 256, &offsets);
+
+  size_t total_size = 0;
+  for (size_t i = 0; i < lifetimes.size(); ++i) {
+    const auto& a = lifetimes[i];
+    total_size += a.size;
+    ASSERT_EQ(offsets[i] % 256, 0UL);
+    ASSERT_LE(offsets[i] + a.size, arena_size);
+    for (size_t j = 0; j < i; ++j) {
+      const auto& b = lifetimes[j];
+      if (a.first_step <= b.last_step && b.first_step <= a.last_step) {
+        ASSERT_TRUE(offsets[i] + a.size <= offsets[j] ||
+                    offsets[j] + b.size <= offsets[i]);
+      }
+    }
+  }
+  EXPECT_LT(arena_size, total_size);
+}
+
+TEST(StaticMemoryPlan, shape_bucket_dim) {
+  EXPECT_EQ(ShapeBucketDim(-1, 0), -1);
+  EXPECT_EQ(ShapeBucketDim(0, 0), 0);
+  EXPECT_EQ(ShapeBucketDim(1, 0), 1);
+  EXPECT_EQ(ShapeBucketDim(3, 0), 4);
+  EXPECT_EQ(ShapeBucketDim(64, 0), 64);
+  EXPECT_EQ(ShapeBucketDim(65, 0), 128);
+  EXPECT_EQ(ShapeBucketDim(1, 32), 32);
+  EXPECT_EQ(ShapeBucketDim(32, 32), 32);
+  EXPECT_EQ(ShapeBucketDim(33, 32), 64);
+}
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,124 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/backends/context_pool.h"
+#include "paddle/phi/kernels/funcs/elementwise_base.h"
+#include "paddle/phi/kernels/funcs/elementwise_functor.h"
+
+namespace phi {
+namespace tests {
+
+// reference implementation that computes indices per element
+static std::vector<float> NaiveBroadcast(const phi::DenseTensor& x,
+                                         const phi::DenseTensor& y,
+                                         const phi::DDim& out_dims,
+                                         int axis) {
+  int max_dim = out_dims.size();
+  std::vector<int> x_dims_array(max_dim);
+  std::vector<int> y_dims_array(max_dim);
+  std::vector<int> out_dims_array(max_dim);
+  phi::funcs::GetBroadcastDimsArrays(x.dims(),
+                                     y.dims(),
+                                     x_dims_array.data(),
+                                     y_dims_array.data(),
+                                     out_dims_array.data(),
+                                     max_dim,
+                                     axis);
+  std::vector<int> index(max_dim, 0);
+  std::vector<float> out(common::product(out_dims));
+  for (size_t i = 0; i < out.size(); ++i) {
+    int x_index = phi::funcs::GetElementwiseIndex(
+        x_dims_array.data(), max_dim, index.data());
+    int y_index = phi::funcs::GetElementwiseIndex(
+        y_dims_array.data(), max_dim, index.data());
+    float x_value = x.data<float>()[x_index];
+    float y_value = y.data<float>()[y_index];
+    out[i] = x_value - y_value;
+    phi::funcs::UpdateElementwiseIndexArray(
+        out_dims_array.data(), max_dim, index.data());
+  }
+  return out;
+}
+
+TEST(elementwise_broadcast_cpu, match_naive) {
+  auto* dev_ctx = static_cast<phi::CPUContext*>(
+      phi::DeviceContextPool::Instance().Get(phi::CPUPlace()));
+  struct Case {
+    std::vector<int64_t> x;
+    std::vector<int64_t> y;
+    std::vector<int64_t> out;
+    int axis;
+  };
+  // y of {6, 1} at axis 1 reaches past x of {4, 6}, its trailing 1 is
+  // trimmed before broadcasting
+  std::vector<Case> cases = {{{64, 300}, {64, 300}, {64, 300}, -1},
+                             {{64, 300}, {300}, {64, 300}, -1},
+                             {{2, 3, 1, 5}, {2, 1, 4, 1}, {2, 3, 4, 5}, -1},
+                             {{8, 1, 16}, {1, 9, 16}, {8, 9, 16}, -1},
+                             {{4, 6, 5}, {6, 1}, {4, 6, 5}, -1},
+                             {{4, 6}, {6, 1}, {4, 6}, 1},
+                             {{7}, {3, 5, 7}, {3, 5, 7}, -1},
+                             {{3, 4}, {1}, {3, 4}, -1}};
+  for (int num_threads : {1, 4}) {
+    dev_ctx->SetIntraOpNumThreads(num_threads);
+    for (auto& c : cases) {
+      phi::DenseTensor x;
+      phi::DenseTensor y;
+      phi::DenseTensor out;
+      x.Resize(common::make_ddim(c.x));
+      y.Resize(common::make_ddim(c.y));
+      out.Resize(common::make_ddim(c.out));
+      float* x_data = dev_ctx->template Alloc<float>(&x);
+      float* y_data = dev_ctx->template Alloc<float>(&y);
+      for (int64_t i = 0; i < x.numel(); ++i) {
+        x_data[i] = static_cast<float>(i % 31);
+      }
+      for (int64_t i = 0; i < y.numel(); ++i) {
+        y_data[i] = static_cast<float>(i % 17) * 100;
+      }
+      bool is_xsize_larger = x.dims().size() >= y.dims().size();
+      if (is_xsize_larger) {
+        phi::funcs::ElementwiseCompute<phi::funcs::SubtractFunctor<float>,
+                                       float>(
+            *dev_ctx, x, y, phi::funcs::SubtractFunctor<float>(), &out, c.axis);
+      } else {
+        phi::funcs::ElementwiseCompute<
+            phi::funcs::InverseSubtractFunctor<float>,
+            float>(*dev_ctx,
+                   x,
+                   y,
+                   phi::funcs::InverseSubtractFunctor<float>(),
+                   &out,
+                   c.axis);
+      }
+      int axis = c.axis;
+      if (axis == -1) {
+        axis = std::abs(x.dims().size() - y.dims().size());
+      } else if (axis + y.dims().size() > x.dims().size()) {
+        y.Resize(phi::funcs::TrimTrailingSingularDims(y.dims()));
+      }
+      std::vector<float> expect = NaiveBroadcast(x, y, out.dims(), axis);
+      std::vector<float> result(out.data<float>(),
+                                out.data<float>() + out.numel());
+      EXPECT_EQ(result, expect) << out.dims();
+    }
+  }
+  dev_ctx->SetIntraOpNumThreads(0);
+}
+
+}  // namespace tests
+}  // namespace phi
@@ -0,0 +1,101 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/backends/context_pool.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+#include "paddle/phi/kernels/funcs/reduce_function.h"
+#include "paddle/phi/kernels/funcs/reduce_functor.h"
+#include "paddle/phi/kernels/funcs/softmax.h"
+
+namespace phi {
+namespace tests {
+
+// a context of the test's own, so the thread numbers it sets do not leak
+// into the global one
+static std::unique_ptr<phi::CPUContext> MakeCPUContext() {
+  auto* global_ctx = static_cast<phi::CPUContext*>(
+      phi::DeviceContextPool::Instance().Get(phi::CPUPlace()));
+  auto dev_ctx = std::make_unique<phi::CPUContext>(phi::CPUPlace());
+  dev_ctx->SetAllocator(&global_ctx->GetAllocator());
+  dev_ctx->SetHostAllocator(&global_ctx->GetHostAllocator());
+  return dev_ctx;
+}
+
+TEST(parallel_for, cover_range) {
+  auto dev_ctx = MakeCPUContext();
+  dev_ctx->SetIntraOpNumThreads(4);
+  const int64_t n = 100003;
+  std::vector<std::atomic<int>> hits(n);
+  for (auto& hit : hits) {
+    hit = 0;
+  }
+  dev_ctx->ParallelFor(n, 1024, [&](int64_t begin, int64_t end) {
+    // nested calls run on the calling thread
+    dev_ctx->ParallelFor(end - begin, 1024, [&](int64_t b, int64_t e) {
+      for (int64_t i = begin + b; i < begin + e; ++i) {
+        hits[i]++;
+      }
+    });
+  });
+  for (int64_t i = 0; i < n; ++i) {
+    EXPECT_EQ(hits[i], 1) << i;
+  }
+  dev_ctx->SetIntraOpNumThreads(0);
+  EXPECT_EQ(dev_ctx->GetIntraOpNumThreads(), 1);
+}
+
+TEST(parallel_for, reduce_and_softmax) {
+  auto dev_ctx = MakeCPUContext();
+  const int rows = 512;
+  const int cols = 300;
+  phi::DenseTensor x;
+  x.Resize({rows, 4, cols});
+  float* x_data = dev_ctx->template Alloc<float>(&x);
+  for (int64_t i = 0; i < x.numel(); ++i) {
+    x_data[i] = static_cast<float>(i % 97) / 13.0f;
+  }
+
+  std::vector<std::vector<float>> sums;
+  std::vector<std::vector<float>> softmaxes;
+  for (int num_threads : {1, 4}) {
+    dev_ctx->SetIntraOpNumThreads(num_threads);
+    phi::DenseTensor out;
+    out.Resize({rows, 4});
+    phi::funcs::ReduceKernelImpl<phi::CPUContext,
+                                 float,
+                                 float,
+                                 phi::funcs::SumFunctor>(
+        *dev_ctx, x, &out, {2}, false, false);
+    sums.emplace_back(out.data<float>(), out.data<float>() + out.numel());
+
+    phi::DenseTensor x_2d = x;
+    x_2d.Resize({rows, 4 * cols});
+    phi::DenseTensor y;
+    y.Resize({rows, 4 * cols});
+    dev_ctx->template Alloc<float>(&y);
+    phi::funcs::SoftmaxFunctor<phi::CPUContext, float>()(
+        *dev_ctx, 4, &x_2d, &y);
+    softmaxes.emplace_back(y.data<float>(), y.data<float>() + y.numel());
+  }
+  EXPECT_EQ(sums[0], sums[1]);
+  EXPECT_EQ(softmaxes[0], softmaxes[1]);
+}
+
+}  // namespace tests
+}  // namespace phi
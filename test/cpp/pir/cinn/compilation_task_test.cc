@@ -14,16 +14,23 @@
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 
+#include "paddle/cinn/cinn.h"
+#include "paddle/cinn/common/test_helper.h"
 #include "paddle/cinn/hlir/dialect/operator/ir/cinn_op.h"
 #include "paddle/cinn/hlir/dialect/operator/ir/op_attribute.h"
 #include "paddle/cinn/hlir/dialect/operator/ir/op_dialect.h"
+#include "paddle/cinn/hlir/framework/pir/compilation_cache.h"
 #include "paddle/cinn/hlir/framework/pir/compilation_task.h"
+#include "paddle/cinn/hlir/framework/pir/disk_compilation_cache.h"
+#include "paddle/cinn/hlir/framework/pir/fusion_info.h"
 #include "paddle/cinn/hlir/framework/pir/utils.h"
 #include "paddle/cinn/hlir/framework/pir_compiler.h"
 #include "paddle/fluid/pir/dialect/operator/ir/op_dialect.h"
@@ -32,21 +39,26 @@
 #include "paddle/pir/include/core/ir_context.h"
 #include "paddle/pir/include/core/program.h"
 
+using cinn::hlir::framework::pir::BackendResource;
+using cinn::hlir::framework::pir::CINNKernelInfo;
 using cinn::hlir::framework::pir::CompatibleInfo;
+using cinn::hlir::framework::pir::CompilationResult;
+using cinn::hlir::framework::pir::DiskCompilationCache;
+using cinn::hlir::framework::pir::FusionInfo;
 using cinn::hlir::framework::pir::OpLoweringGroup;
 using cinn::hlir::framework::pir::OpLoweringGroupPtr;
 
 using ProgramInfo = std::tuple<std::shared_ptr<::pir::Program>,
                                std::vector<OpLoweringGroupPtr>>;
-ProgramInfo BuildProgram(std::vector<int64_t> input_shape) {
+ProgramInfo BuildProgram(std::vector<int64_t> input_shape,
+                         float value = 1.0) {
   ::pir::IrContext* ctx = ::pir::IrContext::Instance();
   ctx->GetOrRegisterDialect<paddle::dialect::OperatorDialect>();
   auto program = std::make_shared<::pir::Program>(ctx);
   ::pir::Builder builder = ::pir::Builder(ctx, program->block());
 
-  const float value_one = 1.0;
   auto full_op_x = builder.Build<paddle::dialect::FullOp>(
-      input_shape, value_one, phi::DataType::FLOAT32, phi::GPUPlace());
+      input_shape, value, phi::DataType::FLOAT32, phi::GPUPlace());
 
   std::vector<OpLoweringGroupPtr> groups;
   const std::string fn_name = CompatibleInfo::GroupOpsName(
@@ -59,6 +71,178 @@ ProgramInfo BuildProgram(std::vector<int64_t> input_shape) {
   return {program, groups};
 }
 
+TEST(FusionInfo, Fingerprint) {
+  auto prog_info = BuildProgram({4096, 128});
+  auto same_prog_info = BuildProgram({4096, 128});
+  auto other_prog_info = BuildProgram({4096, 256});
+
+  FusionInfo fusion_info(*std::get<1>(prog_info)[0]);
+  FusionInfo same_fusion_info(*std::get<1>(same_prog_info)[0]);
+  FusionInfo other_fusion_info(*std::get<1>(other_prog_info)[0]);
+  // The same group in another program, e.g. built by another process, has the
+  // same fingerprint.
+  EXPECT_EQ(fusion_info.Fingerprint(), same_fusion_info.Fingerprint());
+  EXPECT_NE(fusion_info.Fingerprint(), other_fusion_info.Fingerprint());
+}
+
+TEST(FusionInfo, FingerprintFloatAttribute) {
+  auto prog_info = BuildProgram({4096, 128}, 1.0f);
+  auto close_prog_info = BuildProgram({4096, 128}, 1.0000001f);
+
+  FusionInfo fusion_info(*std::get<1>(prog_info)[0]);
+  FusionInfo close_fusion_info(*std::get<1>(close_prog_info)[0]);
+  // Both values print as 1 with the default precision of streams.
+  EXPECT_NE(fusion_info.Fingerprint(), close_fusion_info.Fingerprint());
+}
+
+constexpr int kAddOneSize = 32;
+
+// Compiles out = x + 1 for the host, as PirCompiler does for a group.
+std::shared_ptr<CompilationResult> CompileAddOne(
+    const cinn::common::Target& target) {
+  cinn::Placeholder<float> x("x", {cinn::Expr(kAddOneSize)});
+  auto out = cinn::Compute(
+      {cinn::Expr(kAddOneSize)},
+      [&](cinn::Var i) { return x(i) + cinn::Expr(1.f); },
+      "out");
+  cinn::ast_gen_ius::TensorGroup tensor_group({x, out});
+  auto func = cinn::LowerToAst("fn_add_one", {x, out}, &tensor_group, target);
+  cinn::ir::Module::Builder builder("add_one", target);
+  builder.AddFunction(cinn::optim::Optimize(func, target));
+
+  // The kernel is its own infer shape function, which is only looked up.
+  auto backend_resource = std::make_shared<BackendResource>(
+      target,
+      "fn_add_one",
+      "fn_add_one",
+      std::map<int, CINNKernelInfo::SymbolArgBindInfo>(),
+      std::vector<int64_t>());
+  backend_resource->GetBackendCompiler()->Build(builder.Build());
+  backend_resource->GetBackendCompiler()->EndCompile();
+  auto result = std::make_shared<CompilationResult>(target);
+  result->SetBackendResource(backend_resource);
+  return result;
+}
+
+void CheckAddOne(CompilationResult* result) {
+  auto kernel_info = result->GetKernelInfo();
+  auto* x = cinn::common::BufferBuilder(cinn::common::Float(32), {kAddOneSize})
+                .set_random()
+                .Build();
+  auto* out = cinn::common::BufferBuilder(cinn::common::Float(32),
+                                          {kAddOneSize})
+                  .set_zero()
+                  .Build();
+  cinn_pod_value_t args[] = {cinn_pod_value_t(x), cinn_pod_value_t(out)};
+  reinterpret_cast<void (*)(void*, int32_t)>(kernel_info.fn_ptr)(args, 2);
+  auto* x_data = reinterpret_cast<float*>(x->memory);
+  auto* out_data = reinterpret_cast<float*>(out->memory);
+  for (int i = 0; i < kAddOneSize; ++i) {
+    EXPECT_FLOAT_EQ(out_data[i], x_data[i] + 1.f);
+  }
+  cinn_buffer_free(nullptr, x);
+  cinn_buffer_free(nullptr, out);
+  cinn_buffer_t::delete_(x);
+  cinn_buffer_t::delete_(out);
+}
+
+// The only file of the cache in `dir`.
+std::filesystem::path CacheFile(const std::filesystem::path& dir) {
+  std::vector<std::filesystem::path> files;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    files.push_back(entry.path());
+  }
+  EXPECT_EQ(files.size(), 1UL);
+  return files.empty() ? std::filesystem::path() : files[0];
+}
+
+TEST(DiskCompilationCache, SaveLoad) {
+  const auto target = cinn::common::DefaultHostTarget();
+  const auto dir =
+      std::filesystem::temp_directory_path() / "disk_compilation_cache_test";
+  std::filesystem::remove_all(dir);
+
+  auto prog_info = BuildProgram({64, 128});
+  auto other_prog_info = BuildProgram({64, 256});
+  FusionInfo fusion_info(*std::get<1>(prog_info)[0]);
+  FusionInfo other_fusion_info(*std::get<1>(other_prog_info)[0]);
+
+  DiskCompilationCache cache(target, dir.string());
+  EXPECT_EQ(cache.Load(fusion_info), nullptr);
+  auto result = CompileAddOne(target);
+  // The object code exists once the kernel is linked.
+  CheckAddOne(result.get());
+  cache.Save(fusion_info, *result);
+
+  // As by another process.
+  DiskCompilationCache other_cache(target, dir.string());
+  auto loaded = other_cache.Load(fusion_info);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(loaded->GetHostFuncName(), "fn_add_one");
+  CheckAddOne(loaded.get());
+  EXPECT_EQ(other_cache.Load(other_fusion_info), nullptr);
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST(DiskCompilationCache, CorruptFile) {
+  const auto target = cinn::common::DefaultHostTarget();
+  const auto dir = std::filesystem::temp_directory_path() /
+                   "disk_compilation_cache_corrupt_test";
+  std::filesystem::remove_all(dir);
+
+  auto prog_info = BuildProgram({64, 128});
+  FusionInfo fusion_info(*std::get<1>(prog_info)[0]);
+  DiskCompilationCache cache(target, dir.string());
+  auto result = CompileAddOne(target);
+  CheckAddOne(result.get());
+  cache.Save(fusion_info, *result);
+  const auto path = CacheFile(dir);
+  const auto size = std::filesystem::file_size(path);
+  ASSERT_NE(cache.Load(fusion_info), nullptr);
+
+  // Truncated, e.g. by a full disk.
+  std::filesystem::resize_file(path, size / 2);
+  EXPECT_EQ(cache.Load(fusion_info), nullptr);
+  std::filesystem::resize_file(path, 0);
+  EXPECT_EQ(cache.Load(fusion_info), nullptr);
+
+  // Overwritten magic, which follows its 8 byte size.
+  cache.Save(fusion_info, *result);
+  ASSERT_NE(cache.Load(fusion_info), nullptr);
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(sizeof(uint64_t));
+    file.write("XXXX", 4);
+  }
+  EXPECT_EQ(cache.Load(fusion_info), nullptr);
+
+  // Overwritten key, which follows the magic and the format version.
+  cache.Save(fusion_info, *result);
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(2 * sizeof(uint64_t) + 9 + sizeof(uint32_t));
+    file.write("XXXX", 4);
+  }
+  EXPECT_EQ(cache.Load(fusion_info), nullptr);
+
+  // Trailing bytes.
+  cache.Save(fusion_info, *result);
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file.write("XXXX", 4);
+  }
+  EXPECT_EQ(cache.Load(fusion_info), nullptr);
+
+  // Saving again repairs the entry.
+  cache.Save(fusion_info, *result);
+  auto loaded = cache.Load(fusion_info);
+  ASSERT_NE(loaded, nullptr);
+  CheckAddOne(loaded.get());
+
+  std::filesystem::remove_all(dir);
+}
+
 // TODO(LiuYang): This test is temporarily
 // TEST(CompilationTask, Basic) {
 //   auto prog_info = BuildProgram({4096, 128});